@@ -0,0 +1,445 @@
+/*
+ *  gstvaapibufferarena.c - VA buffer arena
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Idle parameter and slice data buffers of a VA context, kept by type
+ * and size so that they can be handed out again instead of going
+ * through vaCreateBuffer() and vaDestroyBuffer() for every picture and
+ * slice. Slice data buffers are rounded up to size classes, since the
+ * actual payload size is conveyed by the slice parameters; any other
+ * buffer is kept at its exact size, as drivers infer the number of
+ * elements from it.
+ *
+ * A buffer released after vaEndPicture() may still be read by the
+ * hardware, so it remembers the surface it was submitted for and is
+ * only handed out again once that surface is no longer rendering.
+ */
+
+#include "sysdeps.h"
+#include "gstvaapicompat.h"
+#include "gstvaapibufferarena.h"
+#include "gstvaapiutils.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+/* Maximum number of idle buffers kept per (type, size class) */
+#define MAX_BUFFERS_PER_CLASS (16)
+
+/* Maximum total size of the idle buffers */
+#define MAX_ARENA_SIZE (32 * 1024 * 1024)
+
+/* Smallest slice data size class */
+#define MIN_SLICE_DATA_SIZE (4096)
+
+typedef struct _ArenaBuffer ArenaBuffer;
+struct _ArenaBuffer
+{
+  GList link;
+  VABufferID id;
+  int type;
+  guint size;
+  VASurfaceID target;
+};
+
+typedef struct _ArenaBucket ArenaBucket;
+struct _ArenaBucket
+{
+  gint64 key;
+  GQueue buffers;               /* least recently released first */
+};
+
+struct _GstVaapiBufferArena
+{
+  GMutex mutex;
+  VAContextID va_context;
+  GHashTable *buckets;
+  GHashTable *buffers;          /* buffers handed out, by VABufferID */
+  guint num_buffers;
+  gsize size;
+  guint64 hits;
+  guint64 misses;
+};
+
+static inline gint64
+make_key (int type, guint size)
+{
+  return ((gint64) type << 32) | size;
+}
+
+/* Returns the size to allocate for a buffer of the given type. Slice
+   data sizes are rounded up to an eighth of the next power of two */
+static guint
+get_alloc_size (int type, guint size)
+{
+  guint step;
+
+  if (type != VASliceDataBufferType)
+    return size;
+  if (size <= MIN_SLICE_DATA_SIZE)
+    return MIN_SLICE_DATA_SIZE;
+
+  step = (1U << g_bit_storage (size - 1)) / 8;
+  return (size + step - 1) & ~(step - 1);
+}
+
+static void
+arena_buffer_free (ArenaBuffer * buf)
+{
+  g_slice_free (ArenaBuffer, buf);
+}
+
+static void
+arena_buffer_destroy (ArenaBuffer * buf, VADisplay dpy)
+{
+  vaapi_destroy_buffer (dpy, &buf->id);
+  arena_buffer_free (buf);
+}
+
+static void
+arena_bucket_free (ArenaBucket * bucket)
+{
+  g_slice_free (ArenaBucket, bucket);
+}
+
+/* Checks whether the hardware is done with the last submission
+   the buffer was part of */
+static gboolean
+arena_buffer_is_idle (ArenaBuffer * buf, VADisplay dpy)
+{
+  VASurfaceStatus surface_status;
+  VAStatus status;
+
+  if (buf->target == VA_INVALID_SURFACE)
+    return TRUE;
+
+  /* A failure most likely means the surface is gone, and so is any
+     pending work on it */
+  status = vaQuerySurfaceStatus (dpy, buf->target, &surface_status);
+  if (status == VA_STATUS_SUCCESS && (surface_status & VASurfaceRendering))
+    return FALSE;
+
+  buf->target = VA_INVALID_SURFACE;
+  return TRUE;
+}
+
+static ArenaBuffer *
+arena_pop_unlocked (GstVaapiBufferArena * arena, VADisplay dpy, int type,
+    guint size)
+{
+  const gint64 key = make_key (type, size);
+  ArenaBucket *bucket;
+  ArenaBuffer *buf;
+  GList *link;
+
+  bucket = g_hash_table_lookup (arena->buckets, &key);
+  if (!bucket)
+    return NULL;
+
+  /* Buffers were released in submission order, so if the oldest one
+     is still in use, the others are as well */
+  link = g_queue_peek_head_link (&bucket->buffers);
+  if (!link || !arena_buffer_is_idle (link->data, dpy))
+    return NULL;
+
+  g_queue_unlink (&bucket->buffers, link);
+  buf = link->data;
+  arena->num_buffers--;
+  arena->size -= buf->size;
+  return buf;
+}
+
+static gboolean
+arena_push_unlocked (GstVaapiBufferArena * arena, ArenaBuffer * buf)
+{
+  const gint64 key = make_key (buf->type, buf->size);
+  ArenaBucket *bucket;
+
+  if (arena->size + buf->size > MAX_ARENA_SIZE)
+    return FALSE;
+
+  bucket = g_hash_table_lookup (arena->buckets, &key);
+  if (!bucket) {
+    bucket = g_slice_new (ArenaBucket);
+    bucket->key = key;
+    g_queue_init (&bucket->buffers);
+    g_hash_table_insert (arena->buckets, &bucket->key, bucket);
+  } else if (bucket->buffers.length >= MAX_BUFFERS_PER_CLASS)
+    return FALSE;
+
+  buf->link.data = buf;
+  g_queue_push_tail_link (&bucket->buffers, &buf->link);
+  arena->num_buffers++;
+  arena->size += buf->size;
+  return TRUE;
+}
+
+/* Refills a recycled buffer as vaCreateBuffer() would fill a new one,
+   zeroing it when no initial data is supplied */
+static gboolean
+arena_buffer_fill (ArenaBuffer * buf, VADisplay dpy, guint size,
+    gconstpointer data, gpointer * mapped_data)
+{
+  gpointer ptr;
+
+  if (!data && !mapped_data)
+    return TRUE;
+
+  ptr = vaapi_map_buffer (dpy, buf->id);
+  if (!ptr)
+    return FALSE;
+
+  if (data)
+    memcpy (ptr, data, size);
+  else
+    memset (ptr, 0, size);
+
+  if (mapped_data)
+    *mapped_data = ptr;
+  else
+    vaapi_unmap_buffer (dpy, buf->id, NULL);
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_buffer_arena_new:
+ *
+ * Creates an empty buffer arena. It does not recycle anything until
+ * it is bound to a VA context with gst_vaapi_buffer_arena_reset().
+ *
+ * Return value: the newly allocated #GstVaapiBufferArena
+ */
+GstVaapiBufferArena *
+gst_vaapi_buffer_arena_new (void)
+{
+  GstVaapiBufferArena *arena;
+
+  arena = g_slice_new0 (GstVaapiBufferArena);
+  g_mutex_init (&arena->mutex);
+  arena->va_context = VA_INVALID_ID;
+  arena->buckets = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL,
+      (GDestroyNotify) arena_bucket_free);
+  arena->buffers = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) arena_buffer_free);
+  return arena;
+}
+
+/**
+ * gst_vaapi_buffer_arena_free:
+ * @arena: a #GstVaapiBufferArena
+ * @dpy: the VA display the buffers were created on
+ *
+ * Destroys the idle buffers held by @arena and frees it. This shall
+ * happen before the VA context the buffers belong to is destroyed.
+ */
+void
+gst_vaapi_buffer_arena_free (GstVaapiBufferArena * arena, VADisplay dpy)
+{
+  if (!arena)
+    return;
+
+  gst_vaapi_buffer_arena_reset (arena, dpy, VA_INVALID_ID);
+  g_hash_table_unref (arena->buckets);
+  g_hash_table_unref (arena->buffers);
+  g_mutex_clear (&arena->mutex);
+  g_slice_free (GstVaapiBufferArena, arena);
+}
+
+/**
+ * gst_vaapi_buffer_arena_reset:
+ * @arena: a #GstVaapiBufferArena
+ * @dpy: the VA display the buffers were created on
+ * @ctx: the VA context to recycle buffers for, or %VA_INVALID_ID
+ *
+ * Destroys the idle buffers held by @arena and binds it to @ctx. The
+ * buffers still in use are forgotten about, so they are destroyed
+ * rather than recycled when released. Only the buffers created for
+ * @ctx are recycled from now on.
+ */
+void
+gst_vaapi_buffer_arena_reset (GstVaapiBufferArena * arena, VADisplay dpy,
+    VAContextID ctx)
+{
+  GHashTableIter iter;
+  ArenaBucket *bucket;
+  ArenaBuffer *buf;
+
+  g_return_if_fail (arena != NULL);
+
+  g_mutex_lock (&arena->mutex);
+  if (arena->va_context != VA_INVALID_ID)
+    GST_DEBUG ("context 0x%08x: %" G_GUINT64_FORMAT " hits, %"
+        G_GUINT64_FORMAT " misses, %u idle buffers (%" G_GSIZE_FORMAT
+        " bytes)", arena->va_context, arena->hits, arena->misses,
+        arena->num_buffers, arena->size);
+
+  g_hash_table_iter_init (&iter, arena->buckets);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & bucket)) {
+    while ((buf = g_queue_pop_head (&bucket->buffers)))
+      arena_buffer_destroy (buf, dpy);
+  }
+  g_hash_table_remove_all (arena->buckets);
+  g_hash_table_remove_all (arena->buffers);
+  arena->num_buffers = 0;
+  arena->size = 0;
+  arena->va_context = ctx;
+  g_mutex_unlock (&arena->mutex);
+}
+
+/**
+ * gst_vaapi_buffer_arena_create_buffer:
+ * @arena: a #GstVaapiBufferArena, or %NULL
+ * @dpy: a VADisplay
+ * @ctx: the VA context to create the buffer for
+ * @type: the VABufferType
+ * @size: the buffer size, in bytes
+ * @data: the initial buffer contents, or %NULL
+ * @buf_id_ptr: return location for the VABufferID
+ * @mapped_data: return location for the mapped buffer contents, or %NULL
+ *
+ * Acts as vaapi_create_buffer(), but hands out an idle buffer of the
+ * same type and size class if @arena holds one. Buffers created for a
+ * context other than the one @arena is bound to are not recycled.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_vaapi_buffer_arena_create_buffer (GstVaapiBufferArena * arena,
+    VADisplay dpy, VAContextID ctx, int type, guint size, gconstpointer data,
+    VABufferID * buf_id_ptr, gpointer * mapped_data)
+{
+  ArenaBuffer *buf;
+  guint alloc_size;
+  gboolean success;
+
+  if (!arena || ctx == VA_INVALID_ID || ctx != arena->va_context)
+    return vaapi_create_buffer (dpy, ctx, type, size, data, buf_id_ptr,
+        mapped_data);
+
+  alloc_size = get_alloc_size (type, size);
+
+  g_mutex_lock (&arena->mutex);
+  buf = arena_pop_unlocked (arena, dpy, type, alloc_size);
+  g_mutex_unlock (&arena->mutex);
+
+  if (buf && !arena_buffer_fill (buf, dpy, size, data, mapped_data)) {
+    arena_buffer_destroy (buf, dpy);
+    buf = NULL;
+  }
+
+  if (buf) {
+    g_mutex_lock (&arena->mutex);
+    arena->hits++;
+  } else {
+    buf = g_slice_new (ArenaBuffer);
+    buf->type = type;
+    buf->size = alloc_size;
+    buf->target = VA_INVALID_SURFACE;
+
+    /* vaCreateBuffer() would read past data for a rounded up size */
+    if (alloc_size == size || !data) {
+      success = vaapi_create_buffer (dpy, ctx, type, alloc_size, data,
+          &buf->id, mapped_data);
+    } else {
+      success = vaapi_create_buffer (dpy, ctx, type, alloc_size, NULL,
+          &buf->id, NULL);
+      if (success && !arena_buffer_fill (buf, dpy, size, data, mapped_data)) {
+        vaapi_destroy_buffer (dpy, &buf->id);
+        success = FALSE;
+      }
+    }
+    if (!success) {
+      arena_buffer_free (buf);
+      return FALSE;
+    }
+
+    g_mutex_lock (&arena->mutex);
+    arena->misses++;
+  }
+  g_hash_table_insert (arena->buffers, GUINT_TO_POINTER (buf->id), buf);
+  g_mutex_unlock (&arena->mutex);
+
+  *buf_id_ptr = buf->id;
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_buffer_arena_release_buffer:
+ * @arena: a #GstVaapiBufferArena, or %NULL
+ * @dpy: a VADisplay
+ * @buf_id_ptr: pointer to the VABufferID to release
+ * @mapped_data: pointer to the mapped buffer contents, or %NULL
+ * @target: the surface the buffer was last submitted for, or
+ *   %VA_INVALID_SURFACE
+ *
+ * Acts as vaapi_destroy_buffer(), but gives buffers created through
+ * @arena back to it. The buffer is unmapped first if *@mapped_data
+ * is set. It will not be handed out again until @target is no longer
+ * rendering.
+ */
+void
+gst_vaapi_buffer_arena_release_buffer (GstVaapiBufferArena * arena,
+    VADisplay dpy, VABufferID * buf_id_ptr, gpointer * mapped_data,
+    VASurfaceID target)
+{
+  ArenaBuffer *buf = NULL;
+
+  if (!buf_id_ptr || *buf_id_ptr == VA_INVALID_ID)
+    return;
+
+  if (mapped_data && *mapped_data)
+    vaapi_unmap_buffer (dpy, *buf_id_ptr, mapped_data);
+
+  if (arena) {
+    g_mutex_lock (&arena->mutex);
+    buf = g_hash_table_lookup (arena->buffers, GUINT_TO_POINTER (*buf_id_ptr));
+    if (buf) {
+      g_hash_table_steal (arena->buffers, GUINT_TO_POINTER (*buf_id_ptr));
+      buf->target = target;
+      if (arena_push_unlocked (arena, buf))
+        *buf_id_ptr = VA_INVALID_ID;
+      else
+        arena_buffer_free (buf);
+    }
+    g_mutex_unlock (&arena->mutex);
+  }
+  vaapi_destroy_buffer (dpy, buf_id_ptr);
+}
+
+/**
+ * gst_vaapi_buffer_arena_get_stats:
+ * @arena: a #GstVaapiBufferArena
+ * @stats: return location for the #GstVaapiBufferArenaStats
+ *
+ * Retrieves the usage statistics of @arena since it was created.
+ */
+void
+gst_vaapi_buffer_arena_get_stats (GstVaapiBufferArena * arena,
+    GstVaapiBufferArenaStats * stats)
+{
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (stats != NULL);
+
+  g_mutex_lock (&arena->mutex);
+  stats->hits = arena->hits;
+  stats->misses = arena->misses;
+  stats->num_buffers = arena->num_buffers;
+  stats->size = arena->size;
+  g_mutex_unlock (&arena->mutex);
+}
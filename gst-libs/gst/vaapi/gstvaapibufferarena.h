@@ -0,0 +1,80 @@
+/*
+ *  gstvaapibufferarena.h - VA buffer arena
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_BUFFER_ARENA_H
+#define GST_VAAPI_BUFFER_ARENA_H
+
+#include <glib.h>
+#include <va/va.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiBufferArena GstVaapiBufferArena;
+typedef struct _GstVaapiBufferArenaStats GstVaapiBufferArenaStats;
+
+/**
+ * GstVaapiBufferArenaStats:
+ * @hits: number of buffers handed out again from the arena
+ * @misses: number of buffers that had to be created
+ * @num_buffers: number of idle buffers currently held by the arena
+ * @size: total size of the idle buffers, in bytes
+ *
+ * Usage statistics of a #GstVaapiBufferArena.
+ */
+struct _GstVaapiBufferArenaStats
+{
+  guint64 hits;
+  guint64 misses;
+  guint num_buffers;
+  gsize size;
+};
+
+G_GNUC_INTERNAL
+GstVaapiBufferArena *
+gst_vaapi_buffer_arena_new (void);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_buffer_arena_free (GstVaapiBufferArena * arena, VADisplay dpy);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_buffer_arena_reset (GstVaapiBufferArena * arena, VADisplay dpy,
+    VAContextID ctx);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_buffer_arena_create_buffer (GstVaapiBufferArena * arena,
+    VADisplay dpy, VAContextID ctx, int type, guint size, gconstpointer data,
+    VABufferID * buf_id_ptr, gpointer * mapped_data);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_buffer_arena_release_buffer (GstVaapiBufferArena * arena,
+    VADisplay dpy, VABufferID * buf_id_ptr, gpointer * mapped_data,
+    VASurfaceID target);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_buffer_arena_get_stats (GstVaapiBufferArena * arena,
+    GstVaapiBufferArenaStats * stats);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_BUFFER_ARENA_H */
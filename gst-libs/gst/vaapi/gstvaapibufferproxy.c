@@ -42,10 +42,10 @@ gst_vaapi_buffer_proxy_acquire_handle (GstVaapiBufferProxy * proxy)
   if (!proxy->parent || proxy->va_buf == VA_INVALID_ID)
     return FALSE;
 
-  GST_VAAPI_OBJECT_LOCK_DISPLAY (proxy->parent);
+  GST_VAAPI_OBJECT_LOCK_DISPLAY_SHARED (proxy->parent);
   va_status = vaAcquireBufferHandle (GST_VAAPI_OBJECT_VADISPLAY (proxy->parent),
       proxy->va_buf, &proxy->va_info);
-  GST_VAAPI_OBJECT_UNLOCK_DISPLAY (proxy->parent);
+  GST_VAAPI_OBJECT_UNLOCK_DISPLAY_SHARED (proxy->parent);
   if (!vaapi_check_status (va_status, "vaAcquireBufferHandle()"))
     return FALSE;
   if (proxy->va_info.mem_type != mem_type)
@@ -64,10 +64,10 @@ gst_vaapi_buffer_proxy_release_handle (GstVaapiBufferProxy * proxy)
   if (!proxy->parent || proxy->va_buf == VA_INVALID_ID)
     return FALSE;
 
-  GST_VAAPI_OBJECT_LOCK_DISPLAY (proxy->parent);
+  GST_VAAPI_OBJECT_LOCK_DISPLAY_SHARED (proxy->parent);
   va_status = vaReleaseBufferHandle (GST_VAAPI_OBJECT_VADISPLAY (proxy->parent),
       proxy->va_buf);
-  GST_VAAPI_OBJECT_UNLOCK_DISPLAY (proxy->parent);
+  GST_VAAPI_OBJECT_UNLOCK_DISPLAY_SHARED (proxy->parent);
   if (!vaapi_check_status (va_status, "vaReleaseBufferHandle()"))
     return FALSE;
   return TRUE;
@@ -0,0 +1,211 @@
+/*
+ *  gstvaapicapscache.c - Persistent VA capability cache
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Results of VA capability queries (profiles, entrypoints, image
+ * formats, encoder surface formats, VPP filter caps), saved to a file
+ * so that later display instances and processes do not have to issue
+ * the queries again. The file is a GKeyFile with one group per driver
+ * identity, i.e. libva version, display type and device, and driver
+ * vendor string. Each entry is an opaque blob, base64 encoded. The
+ * file only makes sense on the machine that wrote it.
+ *
+ * The file lives in $XDG_CACHE_HOME/gstreamer-1.0/vaapi-caps.cache by
+ * default. The GST_VAAPI_CAPS_CACHE environment variable overrides the
+ * path, or disables the cache if it is empty.
+ */
+
+#include "sysdeps.h"
+#include "gstvaapicapscache.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+/* Bump when the layout of any cached entry changes */
+#define CAPS_CACHE_VERSION 1
+
+#define CAPS_CACHE_GROUP "cache"
+
+G_LOCK_DEFINE_STATIC (caps_cache);
+static GKeyFile *g_caps_cache;
+static gchar *g_caps_cache_path;
+static gboolean g_caps_cache_loaded;
+static gboolean g_caps_cache_dirty;
+
+static gchar *
+get_cache_path (void)
+{
+  const gchar *const path = g_getenv ("GST_VAAPI_CAPS_CACHE");
+
+  if (path)
+    return *path ? g_strdup (path) : NULL;
+  return g_build_filename (g_get_user_cache_dir (), "gstreamer-1.0",
+      "vaapi-caps.cache", NULL);
+}
+
+/* Loads the cache file on first use. Returns NULL if the cache is
+   disabled */
+static GKeyFile *
+ensure_cache_unlocked (void)
+{
+  GError *error = NULL;
+
+  if (g_caps_cache_loaded)
+    return g_caps_cache;
+  g_caps_cache_loaded = TRUE;
+
+  g_caps_cache_path = get_cache_path ();
+  if (!g_caps_cache_path)
+    return NULL;
+
+  g_caps_cache = g_key_file_new ();
+  if (!g_key_file_load_from_file (g_caps_cache, g_caps_cache_path,
+          G_KEY_FILE_NONE, &error)) {
+    if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+      GST_WARNING ("failed to load '%s': %s", g_caps_cache_path,
+          error->message);
+    g_clear_error (&error);
+  } else if (g_key_file_get_integer (g_caps_cache, CAPS_CACHE_GROUP,
+          "version", NULL) != CAPS_CACHE_VERSION) {
+    GST_INFO ("discarding outdated '%s'", g_caps_cache_path);
+    g_key_file_free (g_caps_cache);
+    g_caps_cache = g_key_file_new ();
+  }
+  g_key_file_set_integer (g_caps_cache, CAPS_CACHE_GROUP, "version",
+      CAPS_CACHE_VERSION);
+  return g_caps_cache;
+}
+
+static void
+save_cache_unlocked (GKeyFile * cache)
+{
+  GError *error = NULL;
+  gchar *dirname;
+
+  dirname = g_path_get_dirname (g_caps_cache_path);
+  g_mkdir_with_parents (dirname, 0755);
+  g_free (dirname);
+
+  /* The file is written to a temporary file that is renamed, so
+     concurrent readers never see a partial file */
+  if (!g_key_file_save_to_file (cache, g_caps_cache_path, &error)) {
+    GST_WARNING ("failed to save '%s': %s", g_caps_cache_path,
+        error->message);
+    g_clear_error (&error);
+  }
+}
+
+static inline gchar *
+get_group_name (const gchar * identity)
+{
+  return g_compute_checksum_for_string (G_CHECKSUM_SHA1, identity, -1);
+}
+
+/**
+ * gst_vaapi_caps_cache_lookup:
+ * @identity: the driver identity string
+ * @key: the entry name
+ * @data_ptr: return location for the entry data, to be g_free()'d
+ * @size_ptr: return location for the entry size, in bytes
+ *
+ * Looks up the entry @key saved for the driver @identity.
+ *
+ * Return value: %TRUE if the entry was found
+ */
+gboolean
+gst_vaapi_caps_cache_lookup (const gchar * identity, const gchar * key,
+    gpointer * data_ptr, gsize * size_ptr)
+{
+  GKeyFile *cache;
+  gchar *group, *str = NULL;
+
+  g_return_val_if_fail (identity != NULL, FALSE);
+  g_return_val_if_fail (key != NULL, FALSE);
+  g_return_val_if_fail (data_ptr != NULL, FALSE);
+  g_return_val_if_fail (size_ptr != NULL, FALSE);
+
+  group = get_group_name (identity);
+  G_LOCK (caps_cache);
+  cache = ensure_cache_unlocked ();
+  if (cache)
+    str = g_key_file_get_string (cache, group, key, NULL);
+  G_UNLOCK (caps_cache);
+  g_free (group);
+
+  if (!str)
+    return FALSE;
+
+  *data_ptr = g_base64_decode (str, size_ptr);
+  g_free (str);
+  GST_DEBUG ("found '%s' (%" G_GSIZE_FORMAT " bytes)", key, *size_ptr);
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_caps_cache_store:
+ * @identity: the driver identity string
+ * @key: the entry name
+ * @data: the entry data
+ * @size: the entry size, in bytes
+ *
+ * Saves the entry @key for the driver @identity, replacing any
+ * previous entry of that name. The cache file itself is only written
+ * by gst_vaapi_caps_cache_save().
+ */
+void
+gst_vaapi_caps_cache_store (const gchar * identity, const gchar * key,
+    gconstpointer data, gsize size)
+{
+  GKeyFile *cache;
+  gchar *group, *str;
+
+  g_return_if_fail (identity != NULL);
+  g_return_if_fail (key != NULL);
+  g_return_if_fail (data != NULL || size == 0);
+
+  group = get_group_name (identity);
+  str = g_base64_encode (data, size);
+  G_LOCK (caps_cache);
+  cache = ensure_cache_unlocked ();
+  if (cache) {
+    g_key_file_set_string (cache, group, "identity", identity);
+    g_key_file_set_string (cache, group, key, str);
+    g_caps_cache_dirty = TRUE;
+  }
+  G_UNLOCK (caps_cache);
+  g_free (group);
+  g_free (str);
+}
+
+/**
+ * gst_vaapi_caps_cache_save:
+ *
+ * Writes the cache file if any entry was stored since it was last
+ * written.
+ */
+void
+gst_vaapi_caps_cache_save (void)
+{
+  G_LOCK (caps_cache);
+  if (g_caps_cache && g_caps_cache_dirty) {
+    save_cache_unlocked (g_caps_cache);
+    g_caps_cache_dirty = FALSE;
+  }
+  G_UNLOCK (caps_cache);
+}
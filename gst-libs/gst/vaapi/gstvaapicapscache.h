@@ -0,0 +1,43 @@
+/*
+ *  gstvaapicapscache.h - Persistent VA capability cache
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_CAPS_CACHE_H
+#define GST_VAAPI_CAPS_CACHE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_caps_cache_lookup (const gchar * identity, const gchar * key,
+    gpointer * data_ptr, gsize * size_ptr);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_caps_cache_store (const gchar * identity, const gchar * key,
+    gconstpointer data, gsize size);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_caps_cache_save (void);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_CAPS_CACHE_H */
@@ -26,6 +26,9 @@
 #include <gst/vaapi/gstvaapicontext.h>
 #include "gstvaapicodec_objects.h"
 #include "gstvaapidecoder_priv.h"
+#if USE_ENCODERS
+#include "gstvaapiencoder_priv.h"
+#endif
 #include "gstvaapicompat.h"
 #include "gstvaapiutils.h"
 
@@ -67,6 +70,20 @@ gst_vaapi_codec_object_create (GstVaapiCodecObject * object,
   return TRUE;
 }
 
+/* Codec objects are allocated from the arena of the decoder or
+   encoder they belong to, as they are created at frame or slice rate */
+static GstVaapiMiniObjectArena *
+get_object_arena (GstVaapiCodecBase * codec)
+{
+  if (GST_VAAPI_IS_DECODER (codec))
+    return GST_VAAPI_DECODER_CAST (codec)->object_arena;
+#if USE_ENCODERS
+  if (GST_VAAPI_IS_ENCODER (codec))
+    return GST_VAAPI_ENCODER_CAST (codec)->object_arena;
+#endif
+  return NULL;
+}
+
 GstVaapiCodecObject *
 gst_vaapi_codec_object_new (const GstVaapiCodecObjectClass * object_class,
     GstVaapiCodecBase * codec, gconstpointer param, guint param_size,
@@ -76,7 +93,8 @@ gst_vaapi_codec_object_new (const GstVaapiCodecObjectClass * object_class,
   GstVaapiCodecObjectConstructorArgs args;
 
   obj = (GstVaapiCodecObject *)
-      gst_vaapi_mini_object_new0 (GST_VAAPI_MINI_OBJECT_CLASS (object_class));
+      gst_vaapi_mini_object_new0_from_arena (GST_VAAPI_MINI_OBJECT_CLASS
+      (object_class), get_object_arena (codec));
   if (!obj)
     return NULL;
 
@@ -99,6 +117,9 @@ gst_vaapi_codec_object_new (const GstVaapiCodecObjectClass * object_class,
 #define GET_DECODER(obj)    GST_VAAPI_DECODER_CAST((obj)->parent_instance.codec)
 #define GET_VA_DISPLAY(obj) GET_DECODER(obj)->va_display
 #define GET_VA_CONTEXT(obj) GET_DECODER(obj)->va_context
+#define GET_CONTEXT(obj)    GET_DECODER(obj)->context
+#define GET_ARENA(obj) \
+  (GET_CONTEXT(obj) ? GET_CONTEXT(obj)->buffer_arena : NULL)
 
 /* ------------------------------------------------------------------------- */
 /* --- Inverse Quantization Matrices                                     --- */
@@ -109,7 +130,9 @@ GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiIqMatrix, gst_vaapi_iq_matrix);
 void
 gst_vaapi_iq_matrix_destroy (GstVaapiIqMatrix * iq_matrix)
 {
-  vaapi_destroy_buffer (GET_VA_DISPLAY (iq_matrix), &iq_matrix->param_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (iq_matrix),
+      GET_VA_DISPLAY (iq_matrix), &iq_matrix->param_id, &iq_matrix->param,
+      VA_INVALID_SURFACE);
   iq_matrix->param = NULL;
 }
 
@@ -118,9 +141,10 @@ gst_vaapi_iq_matrix_create (GstVaapiIqMatrix * iq_matrix,
     const GstVaapiCodecObjectConstructorArgs * args)
 {
   iq_matrix->param_id = VA_INVALID_ID;
-  return vaapi_create_buffer (GET_VA_DISPLAY (iq_matrix),
-      GET_VA_CONTEXT (iq_matrix), VAIQMatrixBufferType,
-      args->param_size, args->param, &iq_matrix->param_id, &iq_matrix->param);
+  return gst_vaapi_buffer_arena_create_buffer (GET_ARENA (iq_matrix),
+      GET_VA_DISPLAY (iq_matrix), GET_VA_CONTEXT (iq_matrix),
+      VAIQMatrixBufferType, args->param_size, args->param,
+      &iq_matrix->param_id, &iq_matrix->param);
 }
 
 GstVaapiIqMatrix *
@@ -145,7 +169,9 @@ GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiBitPlane, gst_vaapi_bitplane);
 void
 gst_vaapi_bitplane_destroy (GstVaapiBitPlane * bitplane)
 {
-  vaapi_destroy_buffer (GET_VA_DISPLAY (bitplane), &bitplane->data_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (bitplane),
+      GET_VA_DISPLAY (bitplane), &bitplane->data_id,
+      (gpointer *) & bitplane->data, VA_INVALID_SURFACE);
   bitplane->data = NULL;
 }
 
@@ -154,9 +180,10 @@ gst_vaapi_bitplane_create (GstVaapiBitPlane * bitplane,
     const GstVaapiCodecObjectConstructorArgs * args)
 {
   bitplane->data_id = VA_INVALID_ID;
-  return vaapi_create_buffer (GET_VA_DISPLAY (bitplane),
-      GET_VA_CONTEXT (bitplane), VABitPlaneBufferType, args->param_size,
-      args->param, &bitplane->data_id, (void **) &bitplane->data);
+  return gst_vaapi_buffer_arena_create_buffer (GET_ARENA (bitplane),
+      GET_VA_DISPLAY (bitplane), GET_VA_CONTEXT (bitplane),
+      VABitPlaneBufferType, args->param_size, args->param,
+      &bitplane->data_id, (void **) &bitplane->data);
 }
 
 
@@ -182,7 +209,9 @@ GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiHuffmanTable, gst_vaapi_huffman_table);
 void
 gst_vaapi_huffman_table_destroy (GstVaapiHuffmanTable * huf_table)
 {
-  vaapi_destroy_buffer (GET_VA_DISPLAY (huf_table), &huf_table->param_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (huf_table),
+      GET_VA_DISPLAY (huf_table), &huf_table->param_id, &huf_table->param,
+      VA_INVALID_SURFACE);
   huf_table->param = NULL;
 }
 
@@ -191,9 +220,10 @@ gst_vaapi_huffman_table_create (GstVaapiHuffmanTable * huf_table,
     const GstVaapiCodecObjectConstructorArgs * args)
 {
   huf_table->param_id = VA_INVALID_ID;
-  return vaapi_create_buffer (GET_VA_DISPLAY (huf_table),
-      GET_VA_CONTEXT (huf_table), VAHuffmanTableBufferType, args->param_size,
-      args->param, &huf_table->param_id, (void **) &huf_table->param);
+  return gst_vaapi_buffer_arena_create_buffer (GET_ARENA (huf_table),
+      GET_VA_DISPLAY (huf_table), GET_VA_CONTEXT (huf_table),
+      VAHuffmanTableBufferType, args->param_size, args->param,
+      &huf_table->param_id, (void **) &huf_table->param);
 }
 
 GstVaapiHuffmanTable *
@@ -215,7 +245,9 @@ GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiProbabilityTable,
 void
 gst_vaapi_probability_table_destroy (GstVaapiProbabilityTable * prob_table)
 {
-  vaapi_destroy_buffer (GET_VA_DISPLAY (prob_table), &prob_table->param_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (prob_table),
+      GET_VA_DISPLAY (prob_table), &prob_table->param_id, &prob_table->param,
+      VA_INVALID_SURFACE);
   prob_table->param = NULL;
 }
 
@@ -224,10 +256,10 @@ gst_vaapi_probability_table_create (GstVaapiProbabilityTable * prob_table,
     const GstVaapiCodecObjectConstructorArgs * args)
 {
   prob_table->param_id = VA_INVALID_ID;
-  return vaapi_create_buffer (GET_VA_DISPLAY (prob_table),
-      GET_VA_CONTEXT (prob_table),
-      VAProbabilityBufferType,
-      args->param_size, args->param, &prob_table->param_id, &prob_table->param);
+  return gst_vaapi_buffer_arena_create_buffer (GET_ARENA (prob_table),
+      GET_VA_DISPLAY (prob_table), GET_VA_CONTEXT (prob_table),
+      VAProbabilityBufferType, args->param_size, args->param,
+      &prob_table->param_id, &prob_table->param);
 }
 
 GstVaapiProbabilityTable *
@@ -38,11 +38,11 @@ coded_buffer_create (GstVaapiCodedBuffer * buf, guint buf_size,
   VABufferID buf_id;
   gboolean success;
 
-  GST_VAAPI_DISPLAY_LOCK (display);
+  GST_VAAPI_CONTEXT_LOCK (context);
   success = vaapi_create_buffer (GST_VAAPI_DISPLAY_VADISPLAY (display),
       GST_VAAPI_OBJECT_ID (context), VAEncCodedBufferType, buf_size, NULL,
       &buf_id, NULL);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
+  GST_VAAPI_CONTEXT_UNLOCK (context);
   if (!success)
     return FALSE;
 
@@ -57,13 +57,15 @@ coded_buffer_destroy (GstVaapiCodedBuffer * buf)
   GstVaapiDisplay *const display = GST_VAAPI_OBJECT_DISPLAY (buf);
   VABufferID buf_id;
 
+  coded_buffer_unmap (buf);
+
   buf_id = GST_VAAPI_OBJECT_ID (buf);
   GST_DEBUG ("coded buffer %" GST_VAAPI_ID_FORMAT, GST_VAAPI_ID_ARGS (buf_id));
 
   if (buf_id != VA_INVALID_ID) {
-    GST_VAAPI_DISPLAY_LOCK (display);
+    GST_VAAPI_OBJECT_LOCK_DISPLAY_SHARED (buf);
     vaapi_destroy_buffer (GST_VAAPI_DISPLAY_VADISPLAY (display), &buf_id);
-    GST_VAAPI_DISPLAY_UNLOCK (display);
+    GST_VAAPI_OBJECT_UNLOCK_DISPLAY_SHARED (buf);
     GST_VAAPI_OBJECT_ID (buf) = VA_INVALID_ID;
   }
 }
@@ -74,10 +76,10 @@ coded_buffer_map (GstVaapiCodedBuffer * buf)
   if (buf->segment_list)
     return TRUE;
 
-  GST_VAAPI_OBJECT_LOCK_DISPLAY (buf);
+  GST_VAAPI_OBJECT_LOCK_DISPLAY_SHARED (buf);
   buf->segment_list = vaapi_map_buffer (GST_VAAPI_OBJECT_VADISPLAY (buf),
       GST_VAAPI_OBJECT_ID (buf));
-  GST_VAAPI_OBJECT_UNLOCK_DISPLAY (buf);
+  GST_VAAPI_OBJECT_UNLOCK_DISPLAY_SHARED (buf);
   return buf->segment_list != NULL;
 }
 
@@ -87,10 +89,10 @@ coded_buffer_unmap (GstVaapiCodedBuffer * buf)
   if (!buf->segment_list)
     return;
 
-  GST_VAAPI_OBJECT_LOCK_DISPLAY (buf);
+  GST_VAAPI_OBJECT_LOCK_DISPLAY_SHARED (buf);
   vaapi_unmap_buffer (GST_VAAPI_OBJECT_VADISPLAY (buf),
       GST_VAAPI_OBJECT_ID (buf), (void **) &buf->segment_list);
-  GST_VAAPI_OBJECT_UNLOCK_DISPLAY (buf);
+  GST_VAAPI_OBJECT_UNLOCK_DISPLAY_SHARED (buf);
 }
 
 /* *INDENT-OFF* */
@@ -187,10 +189,13 @@ gssize
 gst_vaapi_coded_buffer_get_size (GstVaapiCodedBuffer * buf)
 {
   VACodedBufferSegment *segment;
+  gboolean was_mapped;
   gssize size;
 
   g_return_val_if_fail (buf != NULL, -1);
 
+  /* Keep a mapping established beforehand, e.g. by the encoder */
+  was_mapped = buf->segment_list != NULL;
   if (!coded_buffer_map (buf))
     return -1;
 
@@ -198,10 +203,46 @@ gst_vaapi_coded_buffer_get_size (GstVaapiCodedBuffer * buf)
   for (segment = buf->segment_list; segment != NULL; segment = segment->next)
     size += segment->size;
 
-  coded_buffer_unmap (buf);
+  if (!was_mapped)
+    coded_buffer_unmap (buf);
   return size;
 }
 
+/**
+ * gst_vaapi_coded_buffer_get_data:
+ * @buf: a #GstVaapiCodedBuffer
+ * @data_ptr: return location for the coded data
+ * @size_ptr: return location for the coded data size, in bytes
+ *
+ * Maps the VA coded buffer, if needed, and returns its data without
+ * copying it. This only succeeds if the coded data is held in a
+ * single non-empty segment. The data remains valid until the coded
+ * buffer is released back to its pool.
+ *
+ * Return value: %TRUE if successful, %FALSE otherwise
+ */
+gboolean
+gst_vaapi_coded_buffer_get_data (GstVaapiCodedBuffer * buf,
+    guint8 ** data_ptr, gsize * size_ptr)
+{
+  VACodedBufferSegment *segment;
+
+  g_return_val_if_fail (buf != NULL, FALSE);
+  g_return_val_if_fail (data_ptr != NULL, FALSE);
+  g_return_val_if_fail (size_ptr != NULL, FALSE);
+
+  if (!coded_buffer_map (buf))
+    return FALSE;
+
+  segment = buf->segment_list;
+  if (segment->next || segment->size == 0)
+    return FALSE;
+
+  *data_ptr = segment->buf;
+  *size_ptr = segment->size;
+  return TRUE;
+}
+
 /**
  * gst_vaapi_coded_buffer_copy_into:
  * @dest: the destination #GstBuffer
@@ -215,12 +256,14 @@ gboolean
 gst_vaapi_coded_buffer_copy_into (GstBuffer * dest, GstVaapiCodedBuffer * src)
 {
   VACodedBufferSegment *segment;
+  gboolean was_mapped;
   goffset offset;
   gsize size;
 
   g_return_val_if_fail (src != NULL, FALSE);
   g_return_val_if_fail (dest != NULL, FALSE);
 
+  was_mapped = src->segment_list != NULL;
   if (!coded_buffer_map (src))
     return FALSE;
 
@@ -232,6 +275,7 @@ gst_vaapi_coded_buffer_copy_into (GstBuffer * dest, GstVaapiCodedBuffer * src)
     offset += segment->size;
   }
 
-  coded_buffer_unmap (src);
+  if (!was_mapped)
+    coded_buffer_unmap (src);
   return segment == NULL;
 }
@@ -45,6 +45,10 @@ typedef struct _GstVaapiCodedBufferPool         GstVaapiCodedBufferPool;
 gssize
 gst_vaapi_coded_buffer_get_size (GstVaapiCodedBuffer * buf);
 
+gboolean
+gst_vaapi_coded_buffer_get_data (GstVaapiCodedBuffer * buf,
+    guint8 ** data_ptr, gsize * size_ptr);
+
 gboolean
 gst_vaapi_coded_buffer_copy_into (GstBuffer * dest, GstVaapiCodedBuffer * src);
 
@@ -43,6 +43,8 @@ static void
 coded_buffer_proxy_finalize (GstVaapiCodedBufferProxy * proxy)
 {
   if (proxy->buffer) {
+    /* Drop the mapping the encoder may have kept for the output */
+    gst_vaapi_coded_buffer_unmap (proxy->buffer);
     if (proxy->pool)
       gst_vaapi_video_pool_put_object (proxy->pool, proxy->buffer);
     gst_vaapi_object_unref (proxy->buffer);
@@ -34,7 +34,7 @@
 #include "gstvaapiobject_priv.h"
 #include "gstvaapisurface.h"
 #include "gstvaapisurfacepool.h"
-#include "gstvaapisurfaceproxy.h"
+#include "gstvaapisurfaceproxy_priv.h"
 #include "gstvaapivideopool_priv.h"
 #include "gstvaapiutils.h"
 
@@ -88,10 +88,12 @@ context_destroy (GstVaapiContext * context)
   GST_DEBUG ("context 0x%08x", context_id);
 
   if (context_id != VA_INVALID_ID) {
-    GST_VAAPI_DISPLAY_LOCK (display);
+    GST_VAAPI_CONTEXT_LOCK (context);
+    gst_vaapi_buffer_arena_reset (context->buffer_arena,
+        GST_VAAPI_DISPLAY_VADISPLAY (display), VA_INVALID_ID);
     status = vaDestroyContext (GST_VAAPI_DISPLAY_VADISPLAY (display),
         context_id);
-    GST_VAAPI_DISPLAY_UNLOCK (display);
+    GST_VAAPI_CONTEXT_UNLOCK (context);
     if (!vaapi_check_status (status, "vaDestroyContext()"))
       GST_WARNING ("failed to destroy context 0x%08x", context_id);
     GST_VAAPI_OBJECT_ID (context) = VA_INVALID_ID;
@@ -194,16 +196,18 @@ context_create (GstVaapiContext * context)
   }
   g_assert (surfaces->len == context->surfaces->len);
 
-  GST_VAAPI_DISPLAY_LOCK (display);
+  GST_VAAPI_CONTEXT_LOCK (context);
   status = vaCreateContext (GST_VAAPI_DISPLAY_VADISPLAY (display),
       context->va_config, cip->width, cip->height, VA_PROGRESSIVE,
       (VASurfaceID *) surfaces->data, surfaces->len, &context_id);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
+  GST_VAAPI_CONTEXT_UNLOCK (context);
   if (!vaapi_check_status (status, "vaCreateContext()"))
     goto cleanup;
 
   GST_DEBUG ("context 0x%08x", context_id);
   GST_VAAPI_OBJECT_ID (context) = context_id;
+  gst_vaapi_buffer_arena_reset (context->buffer_arena,
+      GST_VAAPI_DISPLAY_VADISPLAY (display), context_id);
   success = TRUE;
 
 cleanup:
@@ -391,6 +395,8 @@ gst_vaapi_context_init (GstVaapiContext * context,
   context->reset_on_resize = TRUE;
 
   context->attribs = NULL;
+  context->buffer_arena = gst_vaapi_buffer_arena_new ();
+  g_mutex_init (&context->lock);
 }
 
 static void
@@ -398,6 +404,11 @@ gst_vaapi_context_finalize (GstVaapiContext * context)
 {
   context_destroy (context);
   context_destroy_surfaces (context);
+
+  gst_vaapi_buffer_arena_free (context->buffer_arena,
+      GST_VAAPI_OBJECT_VADISPLAY (context));
+  context->buffer_arena = NULL;
+  g_mutex_clear (&context->lock);
 }
 
 GST_VAAPI_OBJECT_DEFINE_CLASS (GstVaapiContext, gst_vaapi_context);
@@ -543,6 +554,8 @@ gst_vaapi_context_get_id (GstVaapiContext * context)
 /**
  * gst_vaapi_context_get_surface_proxy:
  * @context: a #GstVaapiContext
+ * @arena: (optional): a #GstVaapiMiniObjectArena to allocate the
+ *   proxy from
  *
  * Acquires a free surface, wrapped into a #GstVaapiSurfaceProxy. The
  * returned surface will be automatically released when the proxy is
@@ -556,13 +569,14 @@ gst_vaapi_context_get_id (GstVaapiContext * context)
  * Return value: a free surface, or %NULL if none is available
  */
 GstVaapiSurfaceProxy *
-gst_vaapi_context_get_surface_proxy (GstVaapiContext * context)
+gst_vaapi_context_get_surface_proxy (GstVaapiContext * context,
+    GstVaapiMiniObjectArena * arena)
 {
   g_return_val_if_fail (context != NULL, NULL);
 
   return
-      gst_vaapi_surface_proxy_new_from_pool (GST_VAAPI_SURFACE_POOL
-      (context->surfaces_pool));
+      gst_vaapi_surface_proxy_new_from_pool_with_arena (GST_VAAPI_SURFACE_POOL
+      (context->surfaces_pool), arena);
 }
 
 /**
@@ -655,3 +669,20 @@ gst_vaapi_context_get_surface_attributes (GstVaapiContext * context,
 
   return TRUE;
 }
+
+/**
+ * gst_vaapi_context_get_buffer_stats:
+ * @context: a #GstVaapiContext
+ * @stats: return location for the #GstVaapiBufferArenaStats
+ *
+ * Retrieves how many parameter and slice data buffers of @context
+ * were recycled rather than created.
+ */
+void
+gst_vaapi_context_get_buffer_stats (GstVaapiContext * context,
+    GstVaapiBufferArenaStats * stats)
+{
+  g_return_if_fail (context != NULL);
+
+  gst_vaapi_buffer_arena_get_stats (context->buffer_arena, stats);
+}
@@ -32,12 +32,35 @@
 #include "gstvaapisurface.h"
 #include "gstvaapiutils_core.h"
 #include "gstvaapivideopool.h"
+#include "gstvaapibufferarena.h"
 
 G_BEGIN_DECLS
 
 #define GST_VAAPI_CONTEXT(obj) \
   ((GstVaapiContext *) (obj))
 
+/**
+ * GST_VAAPI_CONTEXT_LOCK:
+ * @context: a #GstVaapiContext
+ *
+ * Locks @context for a VA call that only involves this context. This
+ * is the display lock, unless the display lock mode is
+ * %GST_VAAPI_DISPLAY_LOCK_MODE_CONTEXT.
+ */
+#define GST_VAAPI_CONTEXT_LOCK(context) \
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (GST_VAAPI_OBJECT_DISPLAY (context), \
+      &GST_VAAPI_CONTEXT (context)->lock)
+
+/**
+ * GST_VAAPI_CONTEXT_UNLOCK:
+ * @context: a #GstVaapiContext
+ *
+ * Unlocks @context locked with GST_VAAPI_CONTEXT_LOCK().
+ */
+#define GST_VAAPI_CONTEXT_UNLOCK(context) \
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (GST_VAAPI_OBJECT_DISPLAY (context), \
+      &GST_VAAPI_CONTEXT (context)->lock)
+
 typedef struct _GstVaapiConfigInfoEncoder GstVaapiConfigInfoEncoder;
 typedef struct _GstVaapiContextInfo GstVaapiContextInfo;
 typedef struct _GstVaapiContext GstVaapiContext;
@@ -117,6 +140,8 @@ struct _GstVaapiContext
   guint overlay_id;
   gboolean reset_on_resize;
   GstVaapiConfigSurfaceAttributes *attribs;
+  GstVaapiBufferArena *buffer_arena;
+  GMutex lock;
 };
 
 /**
@@ -146,7 +171,8 @@ gst_vaapi_context_get_id (GstVaapiContext * context);
 
 G_GNUC_INTERNAL
 GstVaapiSurfaceProxy *
-gst_vaapi_context_get_surface_proxy (GstVaapiContext * context);
+gst_vaapi_context_get_surface_proxy (GstVaapiContext * context,
+    GstVaapiMiniObjectArena * arena);
 
 G_GNUC_INTERNAL
 guint
@@ -166,6 +192,11 @@ gboolean
 gst_vaapi_context_get_surface_attributes (GstVaapiContext * context,
     GstVaapiConfigSurfaceAttributes * out_attribs);
 
+G_GNUC_INTERNAL
+void
+gst_vaapi_context_get_buffer_stats (GstVaapiContext * context,
+    GstVaapiBufferArenaStats * stats);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_CONTEXT_H */
@@ -133,6 +133,13 @@ push_buffer (GstVaapiDecoder * decoder, GstBuffer * buffer)
   GST_DEBUG ("queue encoded data buffer %p (%zu bytes)",
       buffer, gst_buffer_get_size (buffer));
 
+  if (decoder->parse_thread) {
+    g_mutex_lock (&decoder->parse_mutex);
+    decoder->parse_pending++;
+    if (decoder->parse_status == GST_VAAPI_DECODER_STATUS_END_OF_STREAM)
+      decoder->parse_status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+    g_mutex_unlock (&decoder->parse_mutex);
+  }
   g_async_queue_push (decoder->buffers, buffer);
   return TRUE;
 }
@@ -152,6 +159,120 @@ pop_buffer (GstVaapiDecoder * decoder)
   return buffer;
 }
 
+/* Decodes the units from the first one that was not decoded while
+   parsing */
+static GstVaapiDecoderStatus
+do_decode_units (GstVaapiDecoder * decoder, GArray * units, guint first)
+{
+  GstVaapiDecoderClass *const klass = GST_VAAPI_DECODER_GET_CLASS (decoder);
+  GstVaapiDecoderStatus status;
+  guint i;
+
+  for (i = first; i < units->len; i++) {
+    GstVaapiDecoderUnit *const unit =
+        &g_array_index (units, GstVaapiDecoderUnit, i);
+    if (GST_VAAPI_DECODER_UNIT_IS_SKIPPED (unit))
+      continue;
+    status = klass->decode (decoder, unit);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+      return status;
+  }
+  return GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+/* Decodes a unit of a frame that is still being parsed. The frame input
+   buffer is only assembled once the frame is complete, so the codec is
+   given the unit data alone */
+static GstVaapiDecoderStatus
+do_decode_subframe_unit (GstVaapiDecoder * decoder,
+    GstVideoCodecFrame * base_frame, GstVaapiDecoderUnit * unit,
+    GstBuffer * buffer, gboolean is_first_slice)
+{
+  GstVaapiDecoderClass *const klass = GST_VAAPI_DECODER_GET_CLASS (decoder);
+  GstVaapiDecoderStatus status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+  GstBuffer *const input_buffer = base_frame->input_buffer;
+  GstVaapiDecoderUnit decode_unit;
+
+  if (GST_VAAPI_DECODER_UNIT_IS_SKIPPED (unit))
+    return GST_VAAPI_DECODER_STATUS_SUCCESS;
+
+  decode_unit = *unit;
+  decode_unit.offset = 0;
+  base_frame->input_buffer = buffer;
+  if (is_first_slice && klass->start_frame)
+    status = klass->start_frame (decoder, &decode_unit);
+  if (status == GST_VAAPI_DECODER_STATUS_SUCCESS)
+    status = klass->decode (decoder, &decode_unit);
+  base_frame->input_buffer = input_buffer;
+  return status;
+}
+
+/* Decodes the units parsed so far, so that the slices of a frame reach
+   the hardware while the next ones are still being received. A slice
+   is only decoded once the next unit is parsed, as that may still
+   change its flags, e.g. when it ends the access unit. The units are
+   decoded in order, and the ones ending the frame are left to
+   gst_vaapi_decoder_decode() */
+static void
+do_decode_subframe (GstVaapiDecoder * decoder, GstVideoCodecFrame * base_frame,
+    GstVaapiParserFrame * frame, GstAdapter * adapter,
+    GstVaapiDecoderUnit * unit)
+{
+  GstVaapiDecoderStatus status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+  const gboolean is_slice = GST_VAAPI_DECODER_UNIT_IS_SLICE (unit);
+  guint num_pre_units, num_units;
+  GstClockTime start_time;
+  GstBuffer *buffer;
+
+  if (frame->decode_status != GST_VAAPI_DECODER_STATUS_SUCCESS
+      || GST_VAAPI_DECODER_UNIT_IS_FRAME_END (unit))
+    return;
+
+  /* the units parsed before this one */
+  num_pre_units = frame->pre_units->len - (is_slice ? 0 : 1);
+  num_units = frame->units->len - (is_slice ? 1 : 0);
+  if (frame->num_decoded_pre_units != num_pre_units)
+    return;
+
+  /* Don't start the picture without a free surface: the frame is then
+     left to gst_vaapi_decoder_decode(), which waits for one */
+  if (frame->pending_buffer && frame->num_decoded_units == 0
+      && num_units == 1 && gst_vaapi_decoder_check_status (decoder) !=
+      GST_VAAPI_DECODER_STATUS_SUCCESS) {
+    gst_buffer_replace (&frame->pending_buffer, NULL);
+    return;
+  }
+
+  decoder->decode_frame_number = base_frame->system_frame_number;
+  start_time = gst_util_get_timestamp ();
+
+  if (frame->pending_buffer && frame->num_decoded_units + 1 == num_units) {
+    status = do_decode_subframe_unit (decoder, base_frame,
+        &g_array_index (frame->units, GstVaapiDecoderUnit, num_units - 1),
+        frame->pending_buffer, num_units == 1);
+    frame->num_decoded_units++;
+  }
+  gst_buffer_replace (&frame->pending_buffer, NULL);
+
+  if (frame->num_decoded_units == num_units
+      && status == GST_VAAPI_DECODER_STATUS_SUCCESS) {
+    buffer = gst_adapter_get_buffer (adapter, unit->size);
+    if (is_slice)
+      frame->pending_buffer = buffer;
+    else {
+      status = do_decode_subframe_unit (decoder, base_frame, &g_array_index
+          (frame->pre_units, GstVaapiDecoderUnit, num_pre_units), buffer,
+          FALSE);
+      frame->num_decoded_pre_units++;
+      gst_buffer_unref (buffer);
+    }
+  }
+
+  frame->decode_time += gst_util_get_timestamp () - start_time;
+  decoder->decode_frame_number = -1;
+  frame->decode_status = status;
+}
+
 static GstVaapiDecoderStatus
 do_parse (GstVaapiDecoder * decoder,
     GstVideoCodecFrame * base_frame, GstAdapter * adapter, gboolean at_eos,
@@ -161,6 +282,7 @@ do_parse (GstVaapiDecoder * decoder,
   GstVaapiParserFrame *frame;
   GstVaapiDecoderUnit *unit;
   GstVaapiDecoderStatus status;
+  GstClockTime start_time;
 
   *got_unit_size_ptr = 0;
   *got_frame_ptr = FALSE;
@@ -169,7 +291,7 @@ do_parse (GstVaapiDecoder * decoder,
   if (!frame) {
     GstVideoCodecState *const codec_state = decoder->codec_state;
     frame = gst_vaapi_parser_frame_new (codec_state->info.width,
-        codec_state->info.height);
+        codec_state->info.height, decoder->object_arena);
     if (!frame)
       return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
     gst_video_codec_frame_set_user_data (base_frame,
@@ -185,9 +307,10 @@ do_parse (GstVaapiDecoder * decoder,
   }
   gst_vaapi_decoder_unit_init (unit);
 
-  ps->current_frame = base_frame;
+  start_time = gst_util_get_timestamp ();
   status = GST_VAAPI_DECODER_GET_CLASS (decoder)->parse (decoder,
       adapter, at_eos, unit);
+  frame->parse_time += gst_util_get_timestamp () - start_time;
   if (status != GST_VAAPI_DECODER_STATUS_SUCCESS) {
     if (at_eos && frame->units->len > 0 &&
         status == GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA) {
@@ -206,44 +329,98 @@ do_parse (GstVaapiDecoder * decoder,
 
 got_unit:
   gst_vaapi_parser_frame_append_unit (frame, unit);
+  if (decoder->subframe_decode && decoder->parse_ahead == 0
+      && decoder->keyframe_interval == 0)
+    do_decode_subframe (decoder, base_frame, frame, adapter, unit);
   *got_unit_size_ptr = unit->size;
   *got_frame_ptr = GST_VAAPI_DECODER_UNIT_IS_FRAME_END (unit);
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
+/* Decodes the units that don't hold picture data, e.g. parameter
+   sets, so that the next frames can still be decoded */
 static GstVaapiDecoderStatus
-do_decode_units (GstVaapiDecoder * decoder, GArray * units)
+do_decode_headers (GstVaapiDecoder * decoder, GstVaapiParserFrame * frame)
 {
-  GstVaapiDecoderClass *const klass = GST_VAAPI_DECODER_GET_CLASS (decoder);
   GstVaapiDecoderStatus status;
-  guint i;
 
-  for (i = 0; i < units->len; i++) {
-    GstVaapiDecoderUnit *const unit =
-        &g_array_index (units, GstVaapiDecoderUnit, i);
-    if (GST_VAAPI_DECODER_UNIT_IS_SKIPPED (unit))
-      continue;
-    status = klass->decode (decoder, unit);
+  if (frame->pre_units->len > 0) {
+    status = do_decode_units (decoder, frame->pre_units,
+        frame->num_decoded_pre_units);
     if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
       return status;
   }
+  if (frame->post_units->len > 0)
+    return do_decode_units (decoder, frame->post_units, 0);
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
+/* Checks whether all the slices of the frame were marked with the
+   specified flag by the parser */
+static gboolean
+is_frame_flagged (GstVaapiParserFrame * frame, guint flag)
+{
+  guint i;
+
+  if (frame->units->len == 0)
+    return FALSE;
+
+  for (i = 0; i < frame->units->len; i++) {
+    GstVaapiDecoderUnit *const unit =
+        &g_array_index (frame->units, GstVaapiDecoderUnit, i);
+    if (!GST_VAAPI_DECODER_UNIT_IS_SKIPPED (unit)
+        && !GST_VAAPI_DECODER_UNIT_FLAG_IS_SET (unit, flag))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* Checks whether the frame is a keyframe to decode, i.e. the first one
+   out of every keyframe_interval keyframes. Second fields and non-base
+   views are not counted, and follow the picture they complete */
+static gboolean
+is_wanted_keyframe (GstVaapiDecoder * decoder, GstVaapiParserFrame * frame)
+{
+  if (is_frame_flagged (frame, GST_VAAPI_DECODER_UNIT_FLAG_SECONDARY))
+    return decoder->keyframe_wanted;
+
+  decoder->keyframe_wanted =
+      is_frame_flagged (frame, GST_VAAPI_DECODER_UNIT_FLAG_KEYFRAME)
+      && decoder->keyframe_count++ % decoder->keyframe_interval == 0;
+  return decoder->keyframe_wanted;
+}
+
 static GstVaapiDecoderStatus
 do_decode_1 (GstVaapiDecoder * decoder, GstVaapiParserFrame * frame)
 {
   GstVaapiDecoderClass *const klass = GST_VAAPI_DECODER_GET_CLASS (decoder);
   GstVaapiDecoderStatus status;
 
+  /* Report the errors of the units decoded while parsing */
+  if (frame->decode_status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+    return frame->decode_status;
+
+  /* Only process the headers of the frames that are not decoded in
+     keyframe mode, and drop them */
+  if (G_UNLIKELY (decoder->keyframe_interval > 0) && frame->units->len > 0
+      && frame->num_decoded_units == 0
+      && !is_wanted_keyframe (decoder, frame)) {
+    status = do_decode_headers (decoder, frame);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+      return status;
+    gst_vaapi_decoder_stats_add_skipped (decoder->stats);
+    return (GstVaapiDecoderStatus) GST_VAAPI_DECODER_STATUS_DROP_FRAME;
+  }
+
   if (frame->pre_units->len > 0) {
-    status = do_decode_units (decoder, frame->pre_units);
+    status = do_decode_units (decoder, frame->pre_units,
+        frame->num_decoded_pre_units);
     if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
       return status;
   }
 
   if (frame->units->len > 0) {
-    if (klass->start_frame) {
+    if (klass->start_frame && frame->num_decoded_units == 0) {
       GstVaapiDecoderUnit *const unit =
           &g_array_index (frame->units, GstVaapiDecoderUnit, 0);
       status = klass->start_frame (decoder, unit);
@@ -251,7 +428,7 @@ do_decode_1 (GstVaapiDecoder * decoder, GstVaapiParserFrame * frame)
         return status;
     }
 
-    status = do_decode_units (decoder, frame->units);
+    status = do_decode_units (decoder, frame->units, frame->num_decoded_units);
     if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
       return status;
 
@@ -263,7 +440,7 @@ do_decode_1 (GstVaapiDecoder * decoder, GstVaapiParserFrame * frame)
   }
 
   if (frame->post_units->len > 0) {
-    status = do_decode_units (decoder, frame->post_units);
+    status = do_decode_units (decoder, frame->post_units, 0);
     if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
       return status;
   }
@@ -274,18 +451,44 @@ do_decode_1 (GstVaapiDecoder * decoder, GstVaapiParserFrame * frame)
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
+static void
+add_frame_stats (GstVaapiDecoder * decoder, GstVideoCodecFrame * base_frame,
+    GstVaapiParserFrame * frame, GstClockTime decode_time)
+{
+  GstVaapiDecoderStatsFrame stats_frame;
+
+  stats_frame.frame_number = base_frame->system_frame_number;
+  stats_frame.parse_time = frame->parse_time;
+  stats_frame.decode_time = decode_time;
+  stats_frame.input_queue = MAX (g_async_queue_length (decoder->buffers), 0);
+  stats_frame.parse_queue = 0;
+  if (decoder->parse_thread) {
+    g_mutex_lock (&decoder->parse_mutex);
+    stats_frame.parse_queue = decoder->parsed_frames.length;
+    g_mutex_unlock (&decoder->parse_mutex);
+  }
+  gst_vaapi_decoder_stats_add_frame (decoder->stats, GST_OBJECT (decoder),
+      &stats_frame);
+}
+
 static inline GstVaapiDecoderStatus
 do_decode (GstVaapiDecoder * decoder, GstVideoCodecFrame * base_frame)
 {
   GstVaapiParserState *const ps = &decoder->parser_state;
   GstVaapiParserFrame *const frame = base_frame->user_data;
   GstVaapiDecoderStatus status;
+  GstClockTime start_time;
 
   ps->current_frame = base_frame;
+  decoder->decode_frame_number = base_frame->system_frame_number;
 
   gst_vaapi_parser_frame_ref (frame);
+  start_time = gst_util_get_timestamp ();
   status = do_decode_1 (decoder, frame);
+  add_frame_stats (decoder, base_frame, frame,
+      frame->decode_time + gst_util_get_timestamp () - start_time);
   gst_vaapi_parser_frame_unref (frame);
+  decoder->decode_frame_number = -1;
 
   switch ((guint) status) {
     case GST_VAAPI_DECODER_STATUS_DROP_FRAME:
@@ -296,31 +499,21 @@ do_decode (GstVaapiDecoder * decoder, GstVideoCodecFrame * base_frame)
   return status;
 }
 
+/* Parses the input adapter until a complete frame is available. The
+   frame being assembled is kept in *frame_ptr across calls */
 static GstVaapiDecoderStatus
-decode_step (GstVaapiDecoder * decoder)
+parse_frame (GstVaapiDecoder * decoder, GstVideoCodecFrame ** frame_ptr,
+    gboolean * got_frame_ptr)
 {
   GstVaapiParserState *const ps = &decoder->parser_state;
   GstVaapiDecoderStatus status;
+  GstVideoCodecFrame *frame;
   GstBuffer *buffer;
   gboolean got_frame;
   guint got_unit_size, input_size;
 
-  status = gst_vaapi_decoder_check_status (decoder);
-  if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
-    return status;
-
-  /* Fill adapter with all buffers we have in the queue */
-  for (;;) {
-    buffer = pop_buffer (decoder);
-    if (!buffer)
-      break;
-
-    ps->at_eos = GST_BUFFER_IS_EOS (buffer);
-    if (!ps->at_eos)
-      gst_adapter_push (ps->input_adapter, buffer);
-  }
+  *got_frame_ptr = FALSE;
 
-  /* Parse and decode all decode units */
   input_size = gst_adapter_available (ps->input_adapter);
   if (input_size == 0) {
     if (ps->at_eos)
@@ -329,16 +522,18 @@ decode_step (GstVaapiDecoder * decoder)
   }
 
   do {
-    if (!ps->current_frame) {
-      ps->current_frame = g_slice_new0 (GstVideoCodecFrame);
-      if (!ps->current_frame)
+    frame = *frame_ptr;
+    if (!frame) {
+      frame = g_slice_new0 (GstVideoCodecFrame);
+      if (!frame)
         return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
-      ps->current_frame->ref_count = 1;
-      ps->current_frame->system_frame_number = ps->current_frame_number++;
+      frame->ref_count = 1;
+      frame->system_frame_number = ps->current_frame_number++;
+      *frame_ptr = frame;
     }
 
-    status = do_parse (decoder, ps->current_frame, ps->input_adapter,
-        ps->at_eos, &got_unit_size, &got_frame);
+    status = do_parse (decoder, frame, ps->input_adapter, ps->at_eos,
+        &got_unit_size, &got_frame);
     GST_DEBUG ("parse frame (status = %d)", status);
     if (status != GST_VAAPI_DECODER_STATUS_SUCCESS) {
       if (status == GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA && ps->at_eos)
@@ -351,27 +546,265 @@ decode_step (GstVaapiDecoder * decoder)
       input_size -= got_unit_size;
 
       if (gst_adapter_available (ps->output_adapter) == 0) {
-        ps->current_frame->pts = gst_adapter_prev_pts (ps->input_adapter, NULL);
+        frame->pts = gst_adapter_prev_pts (ps->input_adapter, NULL);
       }
       gst_adapter_push (ps->output_adapter, buffer);
     }
 
     if (got_frame) {
-      ps->current_frame->input_buffer =
-          gst_adapter_take_buffer (ps->output_adapter,
+      frame->input_buffer = gst_adapter_take_buffer (ps->output_adapter,
           gst_adapter_available (ps->output_adapter));
+      *got_frame_ptr = TRUE;
+      break;
+    }
+  } while (input_size > 0);
+  return status;
+}
+
+/* Hands a complete frame over to the decode thread. This blocks while
+   parse_ahead frames are already queued */
+static gboolean
+push_parsed_frame (GstVaapiDecoder * decoder, GstVideoCodecFrame * frame)
+{
+  g_mutex_lock (&decoder->parse_mutex);
+  while (decoder->parsed_frames.length >= decoder->parse_ahead &&
+      !decoder->parse_stop)
+    g_cond_wait (&decoder->parse_cond, &decoder->parse_mutex);
+  if (decoder->parse_stop) {
+    g_mutex_unlock (&decoder->parse_mutex);
+    gst_video_codec_frame_unref (frame);
+    return FALSE;
+  }
+  g_queue_push_tail (&decoder->parsed_frames, frame);
+  g_cond_broadcast (&decoder->parse_cond);
+  g_mutex_unlock (&decoder->parse_mutex);
+  return TRUE;
+}
 
-      status = do_decode (decoder, ps->current_frame);
-      GST_DEBUG ("decode frame (status = %d)", status);
+/* Reports a parser status to the decode thread, after the frames that
+   were parsed before it. Errors are reported once, and parsing only
+   resumes after that, as in the synchronous case */
+static gboolean
+push_parse_status (GstVaapiDecoder * decoder, GstVaapiDecoderStatus status)
+{
+  gboolean stop;
+
+  g_mutex_lock (&decoder->parse_mutex);
+  decoder->parse_status = status;
+  g_cond_broadcast (&decoder->parse_cond);
+  if (status != GST_VAAPI_DECODER_STATUS_END_OF_STREAM) {
+    while (decoder->parse_status != GST_VAAPI_DECODER_STATUS_SUCCESS &&
+        !decoder->parse_stop)
+      g_cond_wait (&decoder->parse_cond, &decoder->parse_mutex);
+  }
+  stop = decoder->parse_stop;
+  g_mutex_unlock (&decoder->parse_mutex);
+  return !stop;
+}
 
-      gst_video_codec_frame_unref (ps->current_frame);
-      ps->current_frame = NULL;
+static gpointer
+parse_thread_func (gpointer data)
+{
+  GstVaapiDecoder *const decoder = data;
+  GstVaapiParserState *const ps = &decoder->parser_state;
+  GstVaapiDecoderStatus status;
+  GstVideoCodecFrame *frame;
+  GstBuffer *buffer;
+  gboolean got_frame, stop;
+
+  for (;;) {
+    buffer = g_async_queue_pop (decoder->buffers);
+
+    g_mutex_lock (&decoder->parse_mutex);
+    stop = decoder->parse_stop;
+    if (decoder->parse_status == GST_VAAPI_DECODER_STATUS_END_OF_STREAM)
+      decoder->parse_status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+    g_mutex_unlock (&decoder->parse_mutex);
+    if (stop) {
+      gst_buffer_unref (buffer);
       break;
     }
-  } while (input_size > 0);
+
+    ps->at_eos = GST_BUFFER_IS_EOS (buffer);
+    if (!ps->at_eos)
+      gst_adapter_push (ps->input_adapter, buffer);
+    else
+      gst_buffer_unref (buffer);
+
+    /* Parse all frames completed by this buffer */
+    for (;;) {
+      status = parse_frame (decoder, &decoder->parse_frame, &got_frame);
+      if (got_frame) {
+        frame = decoder->parse_frame;
+        decoder->parse_frame = NULL;
+        if (!push_parsed_frame (decoder, frame))
+          return NULL;
+        continue;
+      }
+      if (status == GST_VAAPI_DECODER_STATUS_SUCCESS)
+        continue;
+      if (status == GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA)
+        break;
+      if (!push_parse_status (decoder, status))
+        return NULL;
+      if (status == GST_VAAPI_DECODER_STATUS_END_OF_STREAM)
+        break;
+    }
+
+    g_mutex_lock (&decoder->parse_mutex);
+    decoder->parse_pending--;
+    g_cond_broadcast (&decoder->parse_cond);
+    g_mutex_unlock (&decoder->parse_mutex);
+  }
+  return NULL;
+}
+
+static gboolean
+parse_thread_start (GstVaapiDecoder * decoder)
+{
+  g_assert (decoder->parse_thread == NULL);
+
+  decoder->parse_stop = FALSE;
+  decoder->parse_status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+  decoder->parse_thread = g_thread_try_new ("vaapiparse", parse_thread_func,
+      decoder, NULL);
+  return decoder->parse_thread != NULL;
+}
+
+/* Stops the parser thread and drops whatever it did not hand over */
+static void
+parse_thread_stop (GstVaapiDecoder * decoder)
+{
+  GstVideoCodecFrame *frame;
+  GstBuffer *buffer;
+
+  if (!decoder->parse_thread)
+    return;
+
+  g_mutex_lock (&decoder->parse_mutex);
+  decoder->parse_stop = TRUE;
+  g_cond_broadcast (&decoder->parse_cond);
+  g_mutex_unlock (&decoder->parse_mutex);
+
+  /* Wake the parser thread up if it is waiting for input */
+  g_async_queue_push (decoder->buffers, gst_buffer_new ());
+  g_thread_join (decoder->parse_thread);
+  decoder->parse_thread = NULL;
+
+  while ((buffer = g_async_queue_try_pop (decoder->buffers)) != NULL)
+    gst_buffer_unref (buffer);
+  while ((frame = g_queue_pop_head (&decoder->parsed_frames)) != NULL)
+    gst_video_codec_frame_unref (frame);
+  if (decoder->parse_frame) {
+    gst_video_codec_frame_unref (decoder->parse_frame);
+    decoder->parse_frame = NULL;
+  }
+  decoder->parse_pending = 0;
+  decoder->parse_status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+}
+
+/* Decodes the next frame from the parser thread, waiting for it if the
+   parser thread still has input to process */
+static GstVaapiDecoderStatus
+decode_step_threaded (GstVaapiDecoder * decoder)
+{
+  GstVaapiParserState *const ps = &decoder->parser_state;
+  GstVaapiDecoderStatus status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+  GstVideoCodecFrame *frame;
+
+  g_mutex_lock (&decoder->parse_mutex);
+  while (g_queue_is_empty (&decoder->parsed_frames) &&
+      decoder->parse_pending > 0 &&
+      decoder->parse_status == GST_VAAPI_DECODER_STATUS_SUCCESS)
+    g_cond_wait (&decoder->parse_cond, &decoder->parse_mutex);
+
+  frame = g_queue_pop_head (&decoder->parsed_frames);
+  if (!frame) {
+    status = decoder->parse_status;
+    if (status == GST_VAAPI_DECODER_STATUS_SUCCESS)
+      status = GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
+    else if (status != GST_VAAPI_DECODER_STATUS_END_OF_STREAM)
+      decoder->parse_status = GST_VAAPI_DECODER_STATUS_SUCCESS;
+  }
+  g_cond_broadcast (&decoder->parse_cond);
+  g_mutex_unlock (&decoder->parse_mutex);
+  if (!frame)
+    return status;
+
+  status = do_decode (decoder, frame);
+  GST_DEBUG ("decode frame (status = %d)", status);
+
+  gst_video_codec_frame_unref (frame);
+  ps->current_frame = NULL;
+  return status;
+}
+
+static GstVaapiDecoderStatus
+decode_step (GstVaapiDecoder * decoder)
+{
+  GstVaapiParserState *const ps = &decoder->parser_state;
+  GstVaapiDecoderStatus status;
+  GstBuffer *buffer;
+  gboolean got_frame;
+
+  status = gst_vaapi_decoder_check_status (decoder);
+  if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+    return status;
+
+  if (decoder->parse_thread)
+    return decode_step_threaded (decoder);
+
+  /* Fill adapter with all buffers we have in the queue */
+  for (;;) {
+    buffer = pop_buffer (decoder);
+    if (!buffer)
+      break;
+
+    ps->at_eos = GST_BUFFER_IS_EOS (buffer);
+    if (!ps->at_eos)
+      gst_adapter_push (ps->input_adapter, buffer);
+  }
+
+  /* Parse and decode all decode units */
+  status = parse_frame (decoder, &ps->current_frame, &got_frame);
+  if (got_frame) {
+    status = do_decode (decoder, ps->current_frame);
+    GST_DEBUG ("decode frame (status = %d)", status);
+
+    gst_video_codec_frame_unref (ps->current_frame);
+    ps->current_frame = NULL;
+  }
   return status;
 }
 
+/* Samples the output queue and the surfaces held out of the pool,
+   i.e. by the DPB, the output queue and downstream */
+static void
+add_output_stats (GstVaapiDecoder * decoder, GstVideoCodecFrame * frame,
+    gboolean dropped)
+{
+  guint num_surfaces = 0, surfaces_in_use = 0;
+  gint latency = -1;
+
+  if (decoder->context && decoder->context->surfaces_pool) {
+    num_surfaces =
+        gst_vaapi_video_pool_get_capacity (decoder->context->surfaces_pool);
+    surfaces_in_use = num_surfaces -
+        MIN (gst_vaapi_context_get_surface_count (decoder->context),
+        num_surfaces);
+  }
+
+  /* A frame output while decoding a later one was held by the DPB,
+     frames output when draining have no meaningful latency */
+  if (!dropped && decoder->decode_frame_number >= 0)
+    latency = MAX (decoder->decode_frame_number - frame->system_frame_number,
+        0);
+
+  gst_vaapi_decoder_stats_add_output (decoder->stats,
+      MAX (g_async_queue_length (decoder->frames), 0), surfaces_in_use,
+      num_surfaces, latency, dropped);
+}
+
 static void
 drop_frame (GstVaapiDecoder * decoder, GstVideoCodecFrame * frame)
 {
@@ -385,6 +818,8 @@ drop_frame (GstVaapiDecoder * decoder, GstVideoCodecFrame * frame)
       GST_VIDEO_CODEC_FRAME_FLAG_DECODE_ONLY);
 
   g_async_queue_push (decoder->frames, gst_video_codec_frame_ref (frame));
+  gst_vaapi_mini_object_arena_mark_frame (decoder->object_arena);
+  add_output_stats (decoder, frame, TRUE);
 }
 
 static inline void
@@ -396,6 +831,8 @@ push_frame (GstVaapiDecoder * decoder, GstVideoCodecFrame * frame)
       (guint32) GST_VAAPI_SURFACE_PROXY_SURFACE_ID (proxy));
 
   g_async_queue_push (decoder->frames, gst_video_codec_frame_ref (frame));
+  gst_vaapi_mini_object_arena_mark_frame (decoder->object_arena);
+  add_output_stats (decoder, frame, FALSE);
 }
 
 static inline GstVideoCodecFrame *
@@ -471,6 +908,10 @@ gst_vaapi_decoder_finalize (GObject * object)
   gst_video_codec_state_unref (decoder->codec_state);
   decoder->codec_state = NULL;
 
+  parse_thread_stop (decoder);
+  g_mutex_clear (&decoder->parse_mutex);
+  g_cond_clear (&decoder->parse_cond);
+
   parser_state_finalize (&decoder->parser_state);
 
   if (decoder->buffers) {
@@ -489,6 +930,12 @@ gst_vaapi_decoder_finalize (GObject * object)
   gst_vaapi_display_replace (&decoder->display, NULL);
   decoder->va_display = NULL;
 
+  gst_vaapi_mini_object_arena_unref (decoder->object_arena);
+  decoder->object_arena = NULL;
+
+  gst_vaapi_decoder_stats_free (decoder->stats);
+  decoder->stats = NULL;
+
   G_OBJECT_CLASS (gst_vaapi_decoder_parent_class)->finalize (object);
 }
 
@@ -574,13 +1021,19 @@ gst_vaapi_decoder_init (GstVaapiDecoder * decoder)
   GstVideoCodecState *codec_state;
 
   parser_state_init (&decoder->parser_state);
+  g_mutex_init (&decoder->parse_mutex);
+  g_cond_init (&decoder->parse_cond);
+  g_queue_init (&decoder->parsed_frames);
 
   codec_state = g_slice_new0 (GstVideoCodecState);
   codec_state->ref_count = 1;
   gst_video_info_init (&codec_state->info);
 
   decoder->va_context = VA_INVALID_ID;
+  decoder->decode_frame_number = -1;
   decoder->codec_state = codec_state;
+  decoder->object_arena = gst_vaapi_mini_object_arena_new ();
+  decoder->stats = gst_vaapi_decoder_stats_new ();
   decoder->buffers = g_async_queue_new_full ((GDestroyNotify) gst_buffer_unref);
   decoder->frames = g_async_queue_new_full ((GDestroyNotify)
       gst_video_codec_frame_unref);
@@ -702,6 +1155,252 @@ gst_vaapi_decoder_get_caps (GstVaapiDecoder * decoder)
   return get_caps (decoder);
 }
 
+/**
+ * gst_vaapi_decoder_set_parse_ahead:
+ * @decoder: a #GstVaapiDecoder
+ * @num_frames: the maximum number of frames to parse ahead, or zero
+ *
+ * Lets a dedicated thread parse the buffers queued with
+ * gst_vaapi_decoder_put_buffer(), up to @num_frames frames ahead of
+ * the frame being decoded by gst_vaapi_decoder_get_surface(). That
+ * way, parsing the bitstream and building the reference lists of the
+ * next frames overlaps with the VA submission of the current one.
+ * Frames are still decoded in order, and parser errors are reported
+ * after the frames that were parsed before them. A value of zero
+ * parses and decodes on the calling thread, which is the default.
+ *
+ * The parser thread is only available for the codecs whose parser
+ * state is independent from their decoder state, currently H.264 and
+ * H.265. It can be turned on or off only while no input is pending,
+ * i.e. before the first buffer is queued or after
+ * gst_vaapi_decoder_reset(), whereas @num_frames can be changed at any
+ * time. gst_vaapi_decoder_parse() is not available while the parser
+ * thread runs.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_vaapi_decoder_set_parse_ahead (GstVaapiDecoder * decoder,
+    guint num_frames)
+{
+  GstVaapiParserState *ps;
+  gboolean is_idle;
+
+  g_return_val_if_fail (decoder != NULL, FALSE);
+
+  ps = &decoder->parser_state;
+  if (num_frames > 0 &&
+      !GST_VAAPI_DECODER_GET_CLASS (decoder)->parse_is_threadsafe) {
+    GST_WARNING_OBJECT (decoder, "parsing ahead is not supported");
+    return FALSE;
+  }
+
+  if (num_frames > 0 && decoder->subframe_decode)
+    GST_WARNING_OBJECT (decoder, "sub-frame decoding is disabled while "
+        "parsing ahead");
+
+  if ((num_frames > 0) != (decoder->parse_thread != NULL)) {
+    g_mutex_lock (&decoder->parse_mutex);
+    is_idle = decoder->parse_pending == 0 &&
+        g_queue_is_empty (&decoder->parsed_frames) && !decoder->parse_frame;
+    g_mutex_unlock (&decoder->parse_mutex);
+    is_idle = is_idle && g_async_queue_length (decoder->buffers) <= 0 &&
+        gst_adapter_available (ps->input_adapter) == 0 && !ps->current_frame;
+    if (!is_idle) {
+      GST_WARNING_OBJECT (decoder, "cannot switch parser thread with pending "
+          "input");
+      return FALSE;
+    }
+
+    if (num_frames == 0)
+      parse_thread_stop (decoder);
+    else {
+      decoder->parse_ahead = num_frames;
+      if (!parse_thread_start (decoder)) {
+        decoder->parse_ahead = 0;
+        return FALSE;
+      }
+    }
+  }
+
+  g_mutex_lock (&decoder->parse_mutex);
+  decoder->parse_ahead = num_frames;
+  g_cond_broadcast (&decoder->parse_cond);
+  g_mutex_unlock (&decoder->parse_mutex);
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_decoder_set_keyframe_interval:
+ * @decoder: a #GstVaapiDecoder
+ * @interval: decode the first keyframe out of every @interval ones, or
+ *   zero to decode all the frames
+ *
+ * Restricts decoding to the keyframes, i.e. the pictures that don't
+ * refer to any previous one, e.g. for generating thumbnails or seek
+ * previews. Among them, only the first one out of every @interval is
+ * decoded. The other frames are parsed and their parameter sets are
+ * processed, but nothing is submitted to VA for them: they are
+ * dropped as if they could not be decoded, and counted in the
+ * "frames-skipped" field of gst_vaapi_decoder_get_stats(). The codecs
+ * also keep no reference picture across keyframes, and output each
+ * of them as soon as it is decoded.
+ *
+ * Keyframes are IDR and I pictures for H.264, IRAP pictures for H.265,
+ * I pictures for MPEG-2, and key frames for VP8 and VP9. A field pair,
+ * or an H.264 MVC access unit, counts as a single keyframe: its second
+ * field and its non-base views are decoded along with the first field
+ * of the base view, even if they are predicted from it. Once the
+ * keyframe mode is turned off, the frames are correct again from the
+ * next keyframe on. A value of zero decodes all the frames, which is
+ * the default.
+ *
+ * Return value: %TRUE on success, %FALSE if the codec does not detect
+ *   keyframes
+ */
+gboolean
+gst_vaapi_decoder_set_keyframe_interval (GstVaapiDecoder * decoder,
+    guint interval)
+{
+  g_return_val_if_fail (decoder != NULL, FALSE);
+
+  if (interval > 0 && !GST_VAAPI_DECODER_GET_CLASS (decoder)->flags_keyframes) {
+    GST_WARNING_OBJECT (decoder, "keyframe mode is not supported");
+    return FALSE;
+  }
+
+  if (interval > 0 && decoder->subframe_decode)
+    GST_WARNING_OBJECT (decoder, "sub-frame decoding is disabled in "
+        "keyframe mode");
+
+  if (interval != decoder->keyframe_interval)
+    decoder->keyframe_count = 0;
+  /* Complete the last picture that was decoded before */
+  if (decoder->keyframe_interval == 0)
+    decoder->keyframe_wanted = TRUE;
+  decoder->keyframe_interval = interval;
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_decoder_set_subframe_decode:
+ * @decoder: a #GstVaapiDecoder
+ * @enable: %TRUE to decode the units of a frame as they are parsed
+ *
+ * Decodes each unit as soon as gst_vaapi_decoder_parse() returns it,
+ * instead of waiting for the whole frame. The slices are then
+ * submitted to the hardware while the next ones are still being
+ * received, and gst_vaapi_decoder_decode() only completes the picture
+ * once the end of the frame is known. This cuts the decoding latency
+ * of multi-slice streams by up to a frame interval, e.g. for low-delay
+ * contribution links.
+ *
+ * Sub-frame decoding is only available for H.264 and H.265. It does
+ * not apply while the parser thread runs, see
+ * gst_vaapi_decoder_set_parse_ahead(), nor in keyframe mode, and a
+ * warning is logged when they are combined. If no surface is free
+ * when the first slice of a frame is parsed, that frame is decoded as
+ * a whole by gst_vaapi_decoder_decode(). The frames whose decoding
+ * has started cannot be skipped anymore with gst_vaapi_decoder_skip().
+ * It is disabled by default.
+ *
+ * Return value: %TRUE on success, %FALSE if the codec does not support
+ *   sub-frame decoding
+ */
+gboolean
+gst_vaapi_decoder_set_subframe_decode (GstVaapiDecoder * decoder,
+    gboolean enable)
+{
+  g_return_val_if_fail (decoder != NULL, FALSE);
+
+  if (enable && !GST_VAAPI_DECODER_GET_CLASS (decoder)->decodes_subframes) {
+    GST_WARNING_OBJECT (decoder, "sub-frame decoding is not supported");
+    return FALSE;
+  }
+
+  if (enable && decoder->parse_ahead > 0)
+    GST_WARNING_OBJECT (decoder, "sub-frame decoding is disabled while "
+        "parsing ahead");
+  else if (enable && decoder->keyframe_interval > 0)
+    GST_WARNING_OBJECT (decoder, "sub-frame decoding is disabled in "
+        "keyframe mode");
+
+  decoder->subframe_decode = enable;
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_decoder_get_object_stats:
+ * @decoder: a #GstVaapiDecoder
+ *
+ * Retrieves how the per-frame objects of @decoder (parser frames and
+ * parser info, pictures, slices, surface proxies) were allocated, as
+ * an "application/x-vaapi-decoder-object-stats" structure.
+ * "object-allocs" counts all allocations, "object-heap-allocs" the ones
+ * that could not be recycled, and "object-heap-allocs-last-frame" the
+ * ones made for the last output frame, which is expected to drop to
+ * zero in steady state.
+ *
+ * Return value: (transfer full): a newly allocated #GstStructure
+ */
+GstStructure *
+gst_vaapi_decoder_get_object_stats (GstVaapiDecoder * decoder)
+{
+  GstVaapiMiniObjectArenaStats stats;
+
+  g_return_val_if_fail (decoder != NULL, NULL);
+
+  gst_vaapi_mini_object_arena_get_stats (decoder->object_arena, &stats);
+  return gst_structure_new ("application/x-vaapi-decoder-object-stats",
+      "frames", G_TYPE_UINT64, stats.num_frames,
+      "object-allocs", G_TYPE_UINT64, stats.num_allocs,
+      "object-heap-allocs", G_TYPE_UINT64, stats.num_heap_allocs,
+      "object-heap-allocs-last-frame", G_TYPE_UINT,
+      stats.last_frame_heap_allocs,
+      "free-objects", G_TYPE_UINT, stats.num_free_objects, NULL);
+}
+
+/**
+ * gst_vaapi_decoder_get_stats:
+ * @decoder: a #GstVaapiDecoder
+ *
+ * Retrieves where the time of @decoder goes, as an
+ * "application/x-vaapi-decoder-stats" structure. "frames-decoded",
+ * "frames-output", "frames-dropped" and "frames-skipped" (see
+ * gst_vaapi_decoder_skip() and gst_vaapi_decoder_set_keyframe_interval())
+ * count frames since @decoder was created, "dpb-size" and "surfaces" are
+ * the current DPB and surface pool sizes, and the following metrics are
+ * sampled once per frame:
+ *
+ * - "parse-time": time spent parsing the frame, in ns
+ * - "decode-time": time spent decoding the frame, in ns
+ * - "submit-time": time spent in vaRenderPicture(), in ns
+ * - "end-picture-time": time spent in vaEndPicture(), in ns
+ * - "dpb-occupancy": number of pictures held by the DPB
+ * - "input-queue": number of buffers waiting to be parsed
+ * - "parse-queue": number of frames parsed ahead, see
+ *   gst_vaapi_decoder_set_parse_ahead()
+ * - "output-queue": number of frames waiting to be output
+ * - "surfaces-in-use": number of surfaces held by the DPB, the output
+ *   queue and downstream
+ * - "output-latency": number of frames decoded after a frame until it
+ *   was output, sampled once per output frame, except when draining
+ *
+ * Each metric yields "<metric>-p50", "<metric>-p90", "<metric>-p99"
+ * and "<metric>-max" #guint64 fields, computed over the last "window"
+ * frames. The same samples are logged for every decoded frame as
+ * "vaapidecoder" tracer records, in the GST_TRACER debug category.
+ *
+ * Return value: (transfer full): a newly allocated #GstStructure
+ */
+GstStructure *
+gst_vaapi_decoder_get_stats (GstVaapiDecoder * decoder)
+{
+  g_return_val_if_fail (decoder != NULL, NULL);
+
+  return gst_vaapi_decoder_stats_get (decoder->stats);
+}
+
 /**
  * gst_vaapi_decoder_put_buffer:
  * @decoder: a #GstVaapiDecoder
@@ -1023,7 +1722,10 @@ gst_vaapi_decoder_parse (GstVaapiDecoder * decoder,
       GST_VAAPI_DECODER_STATUS_ERROR_INVALID_PARAMETER);
   g_return_val_if_fail (got_frame_ptr != NULL,
       GST_VAAPI_DECODER_STATUS_ERROR_INVALID_PARAMETER);
+  g_return_val_if_fail (decoder->parse_thread == NULL,
+      GST_VAAPI_DECODER_STATUS_ERROR_INVALID_PARAMETER);
 
+  decoder->parser_state.current_frame = base_frame;
   return do_parse (decoder, base_frame, adapter, at_eos,
       got_unit_size_ptr, got_frame_ptr);
 }
@@ -1046,6 +1748,58 @@ gst_vaapi_decoder_decode (GstVaapiDecoder * decoder, GstVideoCodecFrame * frame)
   return do_decode (decoder, frame);
 }
 
+/**
+ * gst_vaapi_decoder_skip:
+ * @decoder: a #GstVaapiDecoder
+ * @frame: a #GstVideoCodecFrame returned by gst_vaapi_decoder_parse()
+ *
+ * Skips the decoding of @frame if none of its pictures is used for
+ * reference, e.g. a B-frame, so that no VA submission happens for
+ * it. The units that don't hold picture data, such as parameter sets,
+ * are still processed. This is meant for dropping late frames while
+ * keeping the following ones intact.
+ *
+ * The codecs that mark non-reference pictures are H.264, H.265 and
+ * MPEG-2; frames of the other codecs are never skipped. Neither are
+ * H.264 and MPEG-2 field pictures, since the two fields of a frame
+ * come in separate frames that must be decoded together.
+ *
+ * Return value: %TRUE if @frame was skipped, in which case the caller
+ *   shall drop it instead of calling gst_vaapi_decoder_decode(), or
+ *   %FALSE if @frame has to be decoded
+ */
+gboolean
+gst_vaapi_decoder_skip (GstVaapiDecoder * decoder,
+    GstVideoCodecFrame * base_frame)
+{
+  GstVaapiParserState *const ps = &decoder->parser_state;
+  GstVaapiParserFrame *frame;
+  GstVaapiDecoderStatus status;
+
+  g_return_val_if_fail (decoder != NULL, FALSE);
+  g_return_val_if_fail (base_frame != NULL, FALSE);
+  g_return_val_if_fail (base_frame->user_data != NULL, FALSE);
+
+  frame = base_frame->user_data;
+  if (frame->num_decoded_units > 0
+      || !is_frame_flagged (frame, GST_VAAPI_DECODER_UNIT_FLAG_NON_REF))
+    return FALSE;
+
+  ps->current_frame = base_frame;
+  gst_vaapi_parser_frame_ref (frame);
+  status = do_decode_headers (decoder, frame);
+  gst_vaapi_parser_frame_unref (frame);
+
+  /* let gst_vaapi_decoder_decode() report the error */
+  if (status != GST_VAAPI_DECODER_STATUS_SUCCESS)
+    return FALSE;
+
+  GST_DEBUG ("skip frame %d", base_frame->system_frame_number);
+  gst_vaapi_mini_object_arena_mark_frame (decoder->object_arena);
+  gst_vaapi_decoder_stats_add_skipped (decoder->stats);
+  return TRUE;
+}
+
 /* This function really marks the end of input,
  * so that the decoder will drain out any pending
  * frames on calls to gst_vaapi_decoder_get_frame_with_timeout() */
@@ -1081,6 +1835,8 @@ gst_vaapi_decoder_reset (GstVaapiDecoder * decoder)
 
   GST_DEBUG ("Resetting decoder");
 
+  parse_thread_stop (decoder);
+
   if (klass->reset) {
     ret = klass->reset (decoder);
   } else {
@@ -1103,6 +1859,11 @@ gst_vaapi_decoder_reset (GstVaapiDecoder * decoder)
   }
 
   parser_state_reset (&decoder->parser_state);
+  decoder->keyframe_count = 0;
+  decoder->keyframe_wanted = FALSE;
+
+  if (decoder->parse_ahead > 0 && !parse_thread_start (decoder))
+    return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
 
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
@@ -106,6 +106,24 @@ gst_vaapi_decoder_get_caps (GstVaapiDecoder * decoder);
 GArray *
 gst_vaapi_decoder_get_surface_formats (GstVaapiDecoder * decoder);
 
+gboolean
+gst_vaapi_decoder_set_parse_ahead (GstVaapiDecoder * decoder,
+    guint num_frames);
+
+gboolean
+gst_vaapi_decoder_set_keyframe_interval (GstVaapiDecoder * decoder,
+    guint interval);
+
+gboolean
+gst_vaapi_decoder_set_subframe_decode (GstVaapiDecoder * decoder,
+    gboolean enable);
+
+GstStructure *
+gst_vaapi_decoder_get_object_stats (GstVaapiDecoder * decoder);
+
+GstStructure *
+gst_vaapi_decoder_get_stats (GstVaapiDecoder * decoder);
+
 gboolean
 gst_vaapi_decoder_put_buffer (GstVaapiDecoder * decoder, GstBuffer * buf);
 
@@ -130,6 +148,10 @@ GstVaapiDecoderStatus
 gst_vaapi_decoder_decode (GstVaapiDecoder * decoder,
     GstVideoCodecFrame * frame);
 
+gboolean
+gst_vaapi_decoder_skip (GstVaapiDecoder * decoder,
+    GstVideoCodecFrame * frame);
+
 GstVaapiDecoderStatus
 gst_vaapi_decoder_flush (GstVaapiDecoder * decoder);
 
@@ -22,6 +22,7 @@
 
 #include "sysdeps.h"
 #include "gstvaapidecoder_dpb.h"
+#include "gstvaapidecoder_priv.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -387,6 +388,7 @@ gboolean
 gst_vaapi_dpb_add (GstVaapiDpb * dpb, GstVaapiPicture * picture)
 {
   const GstVaapiDpbClass *klass;
+  GstVaapiDecoder *decoder;
 
   g_return_val_if_fail (GST_VAAPI_IS_DPB (dpb), FALSE);
   g_return_val_if_fail (GST_VAAPI_IS_PICTURE (picture), FALSE);
@@ -394,7 +396,14 @@ gst_vaapi_dpb_add (GstVaapiDpb * dpb, GstVaapiPicture * picture)
   klass = GST_VAAPI_DPB_GET_CLASS (dpb);
   if (G_UNLIKELY (!klass || !klass->add))
     return FALSE;
-  return klass->add (dpb, picture);
+  if (!klass->add (dpb, picture))
+    return FALSE;
+
+  decoder = GST_VAAPI_DECODER_CAST (picture->parent_instance.codec);
+  if (decoder)
+    gst_vaapi_decoder_stats_add_dpb (decoder->stats, dpb->num_pictures,
+        dpb->max_pictures);
+  return TRUE;
 }
 
 guint
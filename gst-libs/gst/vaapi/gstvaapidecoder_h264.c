@@ -34,6 +34,7 @@
 #include "gstvaapidisplay_priv.h"
 #include "gstvaapiobject_priv.h"
 #include "gstvaapiutils_h264_priv.h"
+#include "gstvaapiutils_scan.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -94,6 +95,8 @@ struct _GstVaapiParserInfoH264
   guint flags;                  // Same as decoder unit flags (persistent)
   guint view_id;                // View ID of slice
   guint voc;                    // View order index (VOIdx) of slice
+  guint pps_id;                 // PPS ID of slice, resolved when parsed
+  guint sps_id;                 // SPS ID of slice, resolved when parsed
 };
 
 static void
@@ -130,10 +133,11 @@ gst_vaapi_parser_info_h264_class (void)
 }
 
 static inline GstVaapiParserInfoH264 *
-gst_vaapi_parser_info_h264_new (void)
+gst_vaapi_parser_info_h264_new (GstVaapiDecoderH264 * decoder)
 {
   return (GstVaapiParserInfoH264 *)
-      gst_vaapi_mini_object_new (gst_vaapi_parser_info_h264_class ());
+      gst_vaapi_mini_object_new_from_arena (gst_vaapi_parser_info_h264_class (),
+      GST_VAAPI_DECODER_CAST (decoder)->object_arena);
 }
 
 #define gst_vaapi_parser_info_h264_ref(pi) \
@@ -320,7 +324,8 @@ gst_vaapi_frame_store_finalize (gpointer object)
 }
 
 static GstVaapiFrameStore *
-gst_vaapi_frame_store_new (GstVaapiPictureH264 * picture)
+gst_vaapi_frame_store_new (GstVaapiDecoderH264 * decoder,
+    GstVaapiPictureH264 * picture)
 {
   GstVaapiFrameStore *fs;
 
@@ -330,7 +335,8 @@ gst_vaapi_frame_store_new (GstVaapiPictureH264 * picture)
   };
 
   fs = (GstVaapiFrameStore *)
-      gst_vaapi_mini_object_new (&GstVaapiFrameStoreClass);
+      gst_vaapi_mini_object_new_from_arena (&GstVaapiFrameStoreClass,
+      GST_VAAPI_DECODER_CAST (decoder)->object_arena);
   if (!fs)
     return NULL;
 
@@ -493,6 +499,7 @@ struct _GstVaapiDecoderH264Private
   GstVaapiParserInfoH264 *active_pps;
   GstVaapiParserInfoH264 *prev_pi;
   GstVaapiParserInfoH264 *prev_slice_pi;
+  GstVaapiParserInfoH264 *parse_first_field_pi;
   GstVaapiFrameStore **prev_ref_frames;
   GstVaapiFrameStore **prev_frames;
   guint prev_frames_alloc;
@@ -534,6 +541,8 @@ struct _GstVaapiDecoderH264Private
   guint has_context:1;
   guint progressive_sequence:1;
   guint top_field_first:1;
+  guint got_subset_sps:1;
+  guint parse_second_field:1;
 
   gboolean force_low_latency;
   gboolean base_only;
@@ -1113,7 +1122,7 @@ dpb_add (GstVaapiDecoderH264 * decoder, GstVaapiPictureH264 * picture)
     dpb_output (decoder, fs);
 
   // Create new frame store, and split fields if necessary
-  fs = gst_vaapi_frame_store_new (picture);
+  fs = gst_vaapi_frame_store_new (decoder, picture);
   if (!fs)
     return FALSE;
   gst_vaapi_frame_store_replace (&priv->prev_frames[picture->base.voc], fs);
@@ -1153,6 +1162,8 @@ dpb_add (GstVaapiDecoderH264 * decoder, GstVaapiPictureH264 * picture)
     }
   }
   gst_vaapi_frame_store_replace (&priv->dpb[priv->dpb_count++], fs);
+  gst_vaapi_decoder_stats_add_dpb (GST_VAAPI_DECODER_CAST (decoder)->stats,
+      priv->dpb_count, priv->dpb_size);
   return TRUE;
 }
 
@@ -1263,6 +1274,8 @@ gst_vaapi_decoder_h264_close (GstVaapiDecoderH264 * decoder)
   gst_vaapi_picture_replace (&priv->current_picture, NULL);
   gst_vaapi_parser_info_h264_replace (&priv->prev_slice_pi, NULL);
   gst_vaapi_parser_info_h264_replace (&priv->prev_pi, NULL);
+  gst_vaapi_parser_info_h264_replace (&priv->parse_first_field_pi, NULL);
+  priv->parse_second_field = FALSE;
 
   dpb_clear (decoder, NULL);
 
@@ -1300,6 +1313,7 @@ gst_vaapi_decoder_h264_destroy (GstVaapiDecoder * base_decoder)
 
   gst_vaapi_decoder_h264_close (decoder);
   priv->is_opened = FALSE;
+  priv->got_subset_sps = FALSE;
 
   g_clear_pointer (&priv->dpb, g_free);
   priv->dpb_size_max = priv->dpb_size = 0;
@@ -1346,6 +1360,9 @@ gst_vaapi_decoder_h264_reset (GstVaapiDecoder * base_decoder)
   gst_vaapi_decoder_h264_close (decoder);
   priv->is_opened = FALSE;
 
+  /* The parser is recreated, so the next stream sends its own SPS */
+  priv->got_subset_sps = FALSE;
+
   priv->dpb_size = 0;
 
   g_clear_pointer (&priv->prev_ref_frames, g_free);
@@ -1364,12 +1381,14 @@ gst_vaapi_decoder_h264_reset (GstVaapiDecoder * base_decoder)
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
-/* Activates the supplied PPS */
+/* Activates the PPS with the supplied id. The parser tables may
+   already hold the parameter sets of the next frames, so the id is the
+   one the slice referred to when it was parsed */
 static GstH264PPS *
-ensure_pps (GstVaapiDecoderH264 * decoder, GstH264PPS * pps)
+ensure_pps (GstVaapiDecoderH264 * decoder, guint pps_id)
 {
   GstVaapiDecoderH264Private *const priv = &decoder->priv;
-  GstVaapiParserInfoH264 *const pi = priv->pps[pps->id];
+  GstVaapiParserInfoH264 *const pi = priv->pps[pps_id];
 
   gst_vaapi_parser_info_h264_replace (&priv->active_pps, pi);
   return pi ? &pi->data.pps : NULL;
@@ -1384,12 +1403,12 @@ get_pps (GstVaapiDecoderH264 * decoder)
   return pi ? &pi->data.pps : NULL;
 }
 
-/* Activate the supplied SPS */
+/* Activate the SPS with the supplied id */
 static GstH264SPS *
-ensure_sps (GstVaapiDecoderH264 * decoder, GstH264SPS * sps)
+ensure_sps (GstVaapiDecoderH264 * decoder, guint sps_id)
 {
   GstVaapiDecoderH264Private *const priv = &decoder->priv;
-  GstVaapiParserInfoH264 *const pi = priv->sps[sps->id];
+  GstVaapiParserInfoH264 *const pi = priv->sps[sps_id];
 
   /* Propagate "got I-frame" state to the next SPS unit if the
      current sequence was not ended */
@@ -1735,7 +1754,7 @@ decode_current_picture (GstVaapiDecoderH264 * decoder)
   if (!dpb_add (decoder, picture))
     goto error;
 
-  if (priv->force_low_latency)
+  if (priv->force_low_latency || GST_VAAPI_DECODER_KEYFRAMES_ONLY (decoder))
     dpb_output_ready_frames (decoder);
   gst_vaapi_picture_replace (&priv->current_picture, NULL);
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
@@ -1799,6 +1818,7 @@ parse_subset_sps (GstVaapiDecoderH264 * decoder, GstVaapiDecoderUnit * unit)
     return get_status (result);
 
   priv->parser_state |= GST_H264_VIDEO_STATE_GOT_SPS;
+  priv->got_subset_sps = TRUE;
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
@@ -1906,6 +1926,8 @@ parse_slice (GstVaapiDecoderH264 * decoder, GstVaapiDecoderUnit * unit)
     return get_status (result);
 
   sps = slice_hdr->pps->sequence;
+  pi->pps_id = slice_hdr->pps->id;
+  pi->sps_id = sps->id;
 
   /* Update MVC data */
   pi->view_id = get_view_id (&pi->nalu);
@@ -3363,6 +3385,11 @@ init_picture (GstVaapiDecoderH264 * decoder,
     GST_DEBUG ("<IDR>");
     GST_VAAPI_PICTURE_FLAG_SET (picture, GST_VAAPI_PICTURE_FLAG_IDR);
     dpb_flush (decoder, picture);
+  } else if (GST_VAAPI_DECODER_KEYFRAMES_ONLY (decoder)) {
+    /* The previous keyframe is no longer needed, and the frames in
+       between were skipped: don't fill the frame_num gap */
+    if (GST_VAAPI_PICTURE_IS_FIRST_FIELD (picture))
+      dpb_flush (decoder, picture);
   } else if (!fill_picture_gaps (decoder, picture, slice_hdr))
     return FALSE;
 
@@ -3938,6 +3965,24 @@ is_new_access_unit (GstVaapiParserInfoH264 * pi,
   return pi->voc < prev_pi->voc;
 }
 
+/* Detection of the second field of a base view picture, paired with the
+   first field as find_first_field() does, assuming we are already in
+   presence of a new picture */
+static gboolean
+is_second_field (GstVaapiParserInfoH264 * pi,
+    GstVaapiParserInfoH264 * first_field_pi)
+{
+  GstH264SliceHdr *const slice_hdr = &pi->data.slice_hdr;
+  GstH264SliceHdr *first_slice_hdr;
+
+  if (!first_field_pi || !slice_hdr->field_pic_flag)
+    return FALSE;
+
+  first_slice_hdr = &first_field_pi->data.slice_hdr;
+  return slice_hdr->frame_num == first_slice_hdr->frame_num &&
+      slice_hdr->bottom_field_flag != first_slice_hdr->bottom_field_flag;
+}
+
 /* Determines whether the supplied picture has the same field parity
    than a picture specified through the other slice header */
 static inline gboolean
@@ -3994,9 +4039,8 @@ decode_picture (GstVaapiDecoderH264 * decoder, GstVaapiDecoderUnit * unit)
 {
   GstVaapiDecoderH264Private *const priv = &decoder->priv;
   GstVaapiParserInfoH264 *const pi = unit->parsed_info;
-  GstH264SliceHdr *const slice_hdr = &pi->data.slice_hdr;
-  GstH264PPS *const pps = ensure_pps (decoder, slice_hdr->pps);
-  GstH264SPS *const sps = ensure_sps (decoder, slice_hdr->pps->sequence);
+  GstH264PPS *const pps = ensure_pps (decoder, pi->pps_id);
+  GstH264SPS *const sps = ensure_sps (decoder, pi->sps_id);
   GstVaapiPictureH264 *picture, *first_field;
   GstVaapiDecoderStatus status;
 
@@ -4233,12 +4277,12 @@ decode_slice (GstVaapiDecoderH264 * decoder, GstVaapiDecoderUnit * unit)
     return GST_VAAPI_DECODER_STATUS_SUCCESS;
   }
 
-  if (!ensure_pps (decoder, slice_hdr->pps)) {
+  if (!ensure_pps (decoder, pi->pps_id)) {
     GST_ERROR ("failed to activate PPS");
     return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
   }
 
-  if (!ensure_sps (decoder, slice_hdr->pps->sequence)) {
+  if (!ensure_sps (decoder, pi->sps_id)) {
     GST_ERROR ("failed to activate SPS");
     return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
   }
@@ -4274,17 +4318,21 @@ decode_slice (GstVaapiDecoderH264 * decoder, GstVaapiDecoderUnit * unit)
 
   gst_vaapi_picture_add_slice (GST_VAAPI_PICTURE_CAST (picture), slice);
   picture->last_slice_hdr = slice_hdr;
+
+  /* Submit the slice right away, unless the picture could still be
+     dropped for lack of a previous I frame */
+  if (GST_VAAPI_DECODER_SUBFRAME_DECODE (decoder) &&
+      (priv->active_sps->state & GST_H264_VIDEO_STATE_GOT_I_FRAME) &&
+      !gst_vaapi_picture_decode_slices (GST_VAAPI_PICTURE_CAST (picture),
+          picture->base.slices->len))
+    return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
 static inline gint
 scan_for_start_code (GstAdapter * adapter, guint ofs, guint size, guint32 * scp)
 {
-  if (size == 0)
-    return -1;
-
-  return (gint) gst_adapter_masked_scan_uint32_peek (adapter,
-      0xffffff00, 0x00000100, ofs, size, scp);
+  return gst_vaapi_adapter_scan_for_start_code (adapter, ofs, size, scp);
 }
 
 static GstVaapiDecoderStatus
@@ -4371,7 +4419,7 @@ gst_vaapi_decoder_h264_decode_codec_data (GstVaapiDecoder * base_decoder,
   ofs = 6;
 
   for (i = 0; i < num_sps; i++) {
-    pi = gst_vaapi_parser_info_h264_new ();
+    pi = gst_vaapi_parser_info_h264_new (decoder);
     if (!pi)
       return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
     unit.parsed_info = pi;
@@ -4401,7 +4449,7 @@ gst_vaapi_decoder_h264_decode_codec_data (GstVaapiDecoder * base_decoder,
   ofs++;
 
   for (i = 0; i < num_pps; i++) {
-    pi = gst_vaapi_parser_info_h264_new ();
+    pi = gst_vaapi_parser_info_h264_new (decoder);
     if (!pi)
       return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
     unit.parsed_info = pi;
@@ -4551,7 +4599,7 @@ gst_vaapi_decoder_h264_parse (GstVaapiDecoder * base_decoder,
 
   unit->size = buf_size;
 
-  pi = gst_vaapi_parser_info_h264_new ();
+  pi = gst_vaapi_parser_info_h264_new (decoder);
   if (!pi)
     return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
 
@@ -4641,6 +4689,23 @@ gst_vaapi_decoder_h264_parse (GstVaapiDecoder * base_decoder,
     case GST_H264_NAL_SLICE_IDR:
     case GST_H264_NAL_SLICE:
       flags |= GST_VAAPI_DECODER_UNIT_FLAG_SLICE;
+      /* Fields are paired with the next one, and base view pictures
+         may be inter-view references, so only flag frames of single
+         view streams */
+      if (pi->nalu.type == GST_H264_NAL_SLICE && pi->nalu.ref_idc == 0
+          && !pi->data.slice_hdr.field_pic_flag
+          && (priv->base_only || !priv->got_subset_sps))
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_NON_REF;
+      /* Base view pictures made of intra slices only refer to themselves.
+         The non-base views are decoded along with them, so they also
+         need to be in an anchor access unit for MVC streams */
+      if (pi->nalu.type == GST_H264_NAL_SLICE_IDR
+          || (pi->nalu.type == GST_H264_NAL_SLICE
+              && (GST_H264_IS_I_SLICE (&pi->data.slice_hdr)
+                  || GST_H264_IS_SI_SLICE (&pi->data.slice_hdr))
+              && (priv->base_only || !priv->got_subset_sps
+                  || pi->nalu.extension.mvc.anchor_pic_flag)))
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_KEYFRAME;
       if (priv->prev_pi &&
           (priv->prev_pi->flags & GST_VAAPI_DECODER_UNIT_FLAG_AU_END)) {
         flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_START |
@@ -4650,6 +4715,20 @@ gst_vaapi_decoder_h264_parse (GstVaapiDecoder * base_decoder,
         if (is_new_access_unit (pi, priv->prev_slice_pi))
           flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_START;
       }
+      /* Second fields and non-base views complete the base view picture
+         before them */
+      if (pi->nalu.type != GST_H264_NAL_SLICE_EXT
+          && (flags & GST_VAAPI_DECODER_UNIT_FLAG_FRAME_START)) {
+        priv->parse_second_field =
+            is_second_field (pi, priv->parse_first_field_pi);
+        if (pi->data.slice_hdr.field_pic_flag && !priv->parse_second_field)
+          gst_vaapi_parser_info_h264_replace (&priv->parse_first_field_pi, pi);
+        else
+          gst_vaapi_parser_info_h264_replace (&priv->parse_first_field_pi,
+              NULL);
+      }
+      if (pi->nalu.type == GST_H264_NAL_SLICE_EXT || priv->parse_second_field)
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_SECONDARY;
       gst_vaapi_parser_info_h264_replace (&priv->prev_slice_pi, pi);
       break;
     case GST_H264_NAL_SPS_EXT:
@@ -4669,7 +4748,10 @@ gst_vaapi_decoder_h264_parse (GstVaapiDecoder * base_decoder,
             GST_VAAPI_DECODER_UNIT_FLAG_FRAME_START;
       break;
   }
-  if ((flags & GST_VAAPI_DECODER_UNIT_FLAGS_AU) && priv->prev_slice_pi)
+  /* The previous slice may already be decoded by another thread if it
+     ended its frame, in which case it is flagged already */
+  if ((flags & GST_VAAPI_DECODER_UNIT_FLAGS_AU) && priv->prev_slice_pi
+      && !(priv->prev_slice_pi->flags & GST_VAAPI_DECODER_UNIT_FLAG_AU_END))
     priv->prev_slice_pi->flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_END;
   GST_VAAPI_DECODER_UNIT_FLAG_SET (unit, flags);
 
@@ -4752,6 +4834,9 @@ gst_vaapi_decoder_h264_class_init (GstVaapiDecoderH264Class * klass)
   decoder_class->end_frame = gst_vaapi_decoder_h264_end_frame;
   decoder_class->flush = gst_vaapi_decoder_h264_flush;
   decoder_class->decode_codec_data = gst_vaapi_decoder_h264_decode_codec_data;
+  decoder_class->parse_is_threadsafe = TRUE;
+  decoder_class->flags_keyframes = TRUE;
+  decoder_class->decodes_subframes = TRUE;
 
   object_class->finalize = gst_vaapi_decoder_h264_finalize;
 }
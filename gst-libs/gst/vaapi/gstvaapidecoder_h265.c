@@ -36,6 +36,7 @@
 #include "gstvaapidisplay_priv.h"
 #include "gstvaapiobject_priv.h"
 #include "gstvaapiutils_h265_priv.h"
+#include "gstvaapiutils_scan.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -89,6 +90,8 @@ struct _GstVaapiParserInfoH265
   } data;
   guint state;
   guint flags;                  // Same as decoder unit flags (persistent)
+  guint pps_id;                 // PPS ID of slice, resolved when parsed
+  guint sps_id;                 // SPS ID of slice, resolved when parsed
 };
 
 static void
@@ -124,10 +127,11 @@ gst_vaapi_parser_info_h265_class (void)
 }
 
 static inline GstVaapiParserInfoH265 *
-gst_vaapi_parser_info_h265_new (void)
+gst_vaapi_parser_info_h265_new (GstVaapiDecoderH265 * decoder)
 {
   return (GstVaapiParserInfoH265 *)
-      gst_vaapi_mini_object_new (gst_vaapi_parser_info_h265_class ());
+      gst_vaapi_mini_object_new_from_arena (gst_vaapi_parser_info_h265_class (),
+      GST_VAAPI_DECODER_CAST (decoder)->object_arena);
 }
 
 #define gst_vaapi_parser_info_h265_ref(pi) \
@@ -284,7 +288,8 @@ gst_vaapi_frame_store_finalize (gpointer object)
 }
 
 static GstVaapiFrameStore *
-gst_vaapi_frame_store_new (GstVaapiPictureH265 * picture)
+gst_vaapi_frame_store_new (GstVaapiDecoderH265 * decoder,
+    GstVaapiPictureH265 * picture)
 {
   GstVaapiFrameStore *fs;
 
@@ -294,7 +299,8 @@ gst_vaapi_frame_store_new (GstVaapiPictureH265 * picture)
   };
 
   fs = (GstVaapiFrameStore *)
-      gst_vaapi_mini_object_new (&GstVaapiFrameStoreClass);
+      gst_vaapi_mini_object_new_from_arena (&GstVaapiFrameStoreClass,
+      GST_VAAPI_DECODER_CAST (decoder)->object_arena);
   if (!fs)
     return NULL;
 
@@ -388,6 +394,8 @@ struct _GstVaapiDecoderH265Private
   gint32 poc;                   // PicOrderCntVal
   gint32 poc_msb;               // PicOrderCntMsb
   gint32 poc_lsb;               // pic_order_cnt_lsb (from slice_header())
+  gint32 irap_poc;              // POC of the IRAP picture starting the CVS
+  gint32 last_output_poc;       // POC of the last output picture
   gint32 prev_poc_msb;          // prevPicOrderCntMsb
   gint32 prev_poc_lsb;          // prevPicOrderCntLsb
   gint32 prev_tid0pic_poc_lsb;
@@ -410,6 +418,9 @@ struct _GstVaapiDecoderH265Private
   guint new_bitstream:1;
   guint prev_nal_is_eos:1;      /*previous nal type is EOS */
   guint associated_irap_NoRaslOutputFlag:1;
+  guint got_leading_pics:1;     /* all leading pictures of the CVS decoded */
+  guint got_last_output_poc:1;  /* a picture of the CVS was output */
+  gboolean force_low_latency;
 };
 
 /**
@@ -556,12 +567,12 @@ gst_vaapi_picture_h265_new (GstVaapiDecoderH265 * decoder)
   }
 }
 
-/* Activates the supplied PPS */
+/* Activates the PPS with the supplied id */
 static GstH265PPS *
-ensure_pps (GstVaapiDecoderH265 * decoder, GstH265PPS * pps)
+ensure_pps (GstVaapiDecoderH265 * decoder, guint pps_id)
 {
   GstVaapiDecoderH265Private *const priv = &decoder->priv;
-  GstVaapiParserInfoH265 *const pi = priv->pps[pps->id];
+  GstVaapiParserInfoH265 *const pi = priv->pps[pps_id];
 
   gst_vaapi_parser_info_h265_replace (&priv->active_pps, pi);
   return pi ? &pi->data.pps : NULL;
@@ -576,12 +587,12 @@ get_pps (GstVaapiDecoderH265 * decoder)
   return pi ? &pi->data.pps : NULL;
 }
 
-/* Activate the supplied SPS */
+/* Activate the SPS with the supplied id */
 static GstH265SPS *
-ensure_sps (GstVaapiDecoderH265 * decoder, GstH265SPS * sps)
+ensure_sps (GstVaapiDecoderH265 * decoder, guint sps_id)
 {
   GstVaapiDecoderH265Private *const priv = &decoder->priv;
-  GstVaapiParserInfoH265 *const pi = priv->sps[sps->id];
+  GstVaapiParserInfoH265 *const pi = priv->sps[sps_id];
 
   gst_vaapi_parser_info_h265_replace (&priv->active_sps, pi);
   return pi ? &pi->data.sps : NULL;
@@ -680,6 +691,8 @@ dpb_output (GstVaapiDecoderH265 * decoder, GstVaapiFrameStore * fs)
     return FALSE;
 
   picture->output_needed = FALSE;
+  decoder->priv.last_output_poc = picture->poc;
+  decoder->priv.got_last_output_poc = TRUE;
   return gst_vaapi_picture_output (GST_VAAPI_PICTURE_CAST (picture));
 }
 
@@ -772,6 +785,28 @@ dpb_bump (GstVaapiDecoderH265 * decoder, GstVaapiPictureH265 * picture)
   return success;
 }
 
+/* Outputs the pictures that no picture still to be decoded precedes
+   in output order, assuming that POC values are consecutive. Before
+   the first output of a CVS, that is the pictures up to its IRAP once
+   the leading pictures are decoded. This might violate the H.265 spec
+   but allows for the lowest latency */
+static void
+dpb_output_ready_pictures (GstVaapiDecoderH265 * decoder)
+{
+  GstVaapiDecoderH265Private *const priv = &decoder->priv;
+  GstVaapiPictureH265 *found_picture;
+
+  while (dpb_find_lowest_poc (decoder, &found_picture) >= 0) {
+    if (priv->got_last_output_poc) {
+      if (found_picture->poc != priv->last_output_poc + 1)
+        break;
+    } else if (!priv->got_leading_pics || found_picture->poc > priv->irap_poc)
+      break;
+    if (!dpb_bump (decoder, NULL))
+      break;
+  }
+}
+
 static void
 dpb_clear (GstVaapiDecoderH265 * decoder, gboolean hard_flush)
 {
@@ -860,11 +895,13 @@ dpb_add (GstVaapiDecoderH265 * decoder, GstVaapiPictureH265 * picture)
   }
 
   /* Create new frame store */
-  fs = gst_vaapi_frame_store_new (picture);
+  fs = gst_vaapi_frame_store_new (decoder, picture);
   if (!fs)
     return FALSE;
   gst_vaapi_frame_store_replace (&priv->dpb[priv->dpb_count++], fs);
   gst_vaapi_frame_store_unref (fs);
+  gst_vaapi_decoder_stats_add_dpb (GST_VAAPI_DECODER_CAST (decoder)->stats,
+      priv->dpb_count, priv->dpb_size);
 
   if (picture->output_flag) {
     picture->output_needed = 1;
@@ -1035,6 +1072,8 @@ gst_vaapi_decoder_h265_create (GstVaapiDecoder * base_decoder)
   priv->progressive_sequence = TRUE;
   priv->new_bitstream = TRUE;
   priv->prev_nal_is_eos = FALSE;
+  priv->got_leading_pics = FALSE;
+  priv->got_last_output_poc = FALSE;
   return TRUE;
 }
 
@@ -1336,6 +1375,12 @@ decode_current_picture (GstVaapiDecoderH265 * decoder)
   if (!dpb_add (decoder, picture))
     goto error;
 
+  /* Output keyframes right away, the next one flushes the DPB anyway */
+  if (GST_VAAPI_DECODER_KEYFRAMES_ONLY (decoder))
+    while (dpb_bump (decoder, NULL));
+  else if (priv->force_low_latency)
+    dpb_output_ready_pictures (decoder);
+
   gst_vaapi_picture_replace (&priv->current_picture, NULL);
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 
@@ -1458,6 +1503,11 @@ parse_slice (GstVaapiDecoderH265 * decoder, GstVaapiDecoderUnit * unit)
   if (result != GST_H265_PARSER_OK)
     return get_status (result);
 
+  /* The parser tables may be updated by the next frames before this
+     slice is decoded, so only keep the ids of its parameter sets */
+  pi->pps_id = slice_hdr->pps->id;
+  pi->sps_id = slice_hdr->pps->sps->id;
+
   priv->parser_state |= GST_H265_VIDEO_STATE_GOT_SLICE;
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
@@ -1734,10 +1784,12 @@ init_picture (GstVaapiDecoderH265 * decoder,
      2) a BLA picture
      3) a CRA picture that is the first access unit in the bitstream
      4) first picture that follows an end of sequence NAL unit in decoding order
-     5) has HandleCraAsBlaFlag == 1 (set by external means, so not considering )
+     5) has HandleCraAsBlaFlag == 1 (set by external means, here when
+     only keyframes are decoded as the pictures before it were skipped)
    */
   if (nal_is_idr (pi->nalu.type) || nal_is_bla (pi->nalu.type) ||
-      (nal_is_cra (pi->nalu.type) && priv->new_bitstream)
+      (nal_is_cra (pi->nalu.type) && (priv->new_bitstream ||
+              GST_VAAPI_DECODER_KEYFRAMES_ONLY (decoder)))
       || priv->prev_nal_is_eos) {
     picture->NoRaslOutputFlag = 1;
   }
@@ -2301,9 +2353,8 @@ decode_picture (GstVaapiDecoderH265 * decoder, GstVaapiDecoderUnit * unit)
 {
   GstVaapiDecoderH265Private *const priv = &decoder->priv;
   GstVaapiParserInfoH265 *pi = unit->parsed_info;
-  GstH265SliceHdr *const slice_hdr = &pi->data.slice_hdr;
-  GstH265PPS *const pps = ensure_pps (decoder, slice_hdr->pps);
-  GstH265SPS *const sps = ensure_sps (decoder, slice_hdr->pps->sps);
+  GstH265PPS *const pps = ensure_pps (decoder, pi->pps_id);
+  GstH265SPS *const sps = ensure_sps (decoder, pi->sps_id);
   GstVaapiPictureH265 *picture;
   GstVaapiDecoderStatus status;
 
@@ -2358,6 +2409,17 @@ decode_picture (GstVaapiDecoderH265 * decoder, GstVaapiDecoderUnit * unit)
   if (!dpb_init (decoder, picture, pi))
     return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
 
+  /* Leading pictures precede the trailing ones in decoding order, and
+     their IRAP in output order */
+  if (nal_is_irap (pi->nalu.type) && picture->NoRaslOutputFlag) {
+    priv->irap_poc = picture->poc;
+    priv->got_leading_pics = pi->nalu.type == GST_H265_NAL_SLICE_IDR_N_LP ||
+        pi->nalu.type == GST_H265_NAL_SLICE_BLA_N_LP;
+    priv->got_last_output_poc = FALSE;
+  } else if (!nal_is_irap (pi->nalu.type) && !nal_is_radl (pi->nalu.type)
+      && !nal_is_rasl (pi->nalu.type))
+    priv->got_leading_pics = TRUE;
+
   if (!fill_picture (decoder, picture))
     return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
 
@@ -2672,12 +2734,12 @@ decode_slice (GstVaapiDecoderH265 * decoder, GstVaapiDecoderUnit * unit)
     return GST_VAAPI_DECODER_STATUS_SUCCESS;
   }
 
-  if (!ensure_pps (decoder, slice_hdr->pps)) {
+  if (!ensure_pps (decoder, pi->pps_id)) {
     GST_ERROR ("failed to activate PPS");
     return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
   }
 
-  if (!ensure_sps (decoder, slice_hdr->pps->sps)) {
+  if (!ensure_sps (decoder, pi->sps_id)) {
     GST_ERROR ("failed to activate SPS");
     return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
   }
@@ -2719,17 +2781,20 @@ decode_slice (GstVaapiDecoderH265 * decoder, GstVaapiDecoderUnit * unit)
   gst_vaapi_picture_add_slice (GST_VAAPI_PICTURE_CAST (picture), slice);
   picture->last_slice_hdr = slice_hdr;
   priv->decoder_state |= GST_H265_VIDEO_STATE_GOT_SLICE;
+
+  /* Submit the slice right away, unless the picture is to be dropped */
+  if (GST_VAAPI_DECODER_SUBFRAME_DECODE (decoder) &&
+      is_valid_state (priv->decoder_state, GST_H265_VIDEO_STATE_VALID_PICTURE)
+      && !gst_vaapi_picture_decode_slices (GST_VAAPI_PICTURE_CAST (picture),
+          picture->base.slices->len))
+    return GST_VAAPI_DECODER_STATUS_ERROR_UNKNOWN;
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
 static inline gint
 scan_for_start_code (GstAdapter * adapter, guint ofs, guint size, guint32 * scp)
 {
-  if (size == 0)
-    return -1;
-
-  return (gint) gst_adapter_masked_scan_uint32_peek (adapter,
-      0xffffff00, 0x00000100, ofs, size, scp);
+  return gst_vaapi_adapter_scan_for_start_code (adapter, ofs, size, scp);
 }
 
 static GstVaapiDecoderStatus
@@ -2834,7 +2899,7 @@ gst_vaapi_decoder_h265_decode_codec_data (GstVaapiDecoder *
     ofs += 3;
 
     for (j = 0; j < num_nals; j++) {
-      pi = gst_vaapi_parser_info_h265_new ();
+      pi = gst_vaapi_parser_info_h265_new (decoder);
       if (!pi)
         return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
       unit.parsed_info = pi;
@@ -3009,7 +3074,7 @@ gst_vaapi_decoder_h265_parse (GstVaapiDecoder * base_decoder,
   if (!buf)
     return GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA;
   unit->size = buf_size;
-  pi = gst_vaapi_parser_info_h265_new ();
+  pi = gst_vaapi_parser_info_h265_new (decoder);
   if (!pi)
     return GST_VAAPI_DECODER_STATUS_ERROR_ALLOCATION_FAILED;
   gst_vaapi_decoder_unit_set_parsed_info (unit,
@@ -3107,6 +3172,14 @@ gst_vaapi_decoder_h265_parse (GstVaapiDecoder * base_decoder,
     case GST_H265_NAL_SLICE_IDR_N_LP:
     case GST_H265_NAL_SLICE_CRA_NUT:
       flags |= GST_VAAPI_DECODER_UNIT_FLAG_SLICE;
+      /* Sub-layer non-reference pictures may still be referenced by
+         higher sub-layers, unless they are in the highest one */
+      if (!nal_is_ref (pi->nalu.type) && pi->data.slice_hdr.pps
+          && pi->nalu.temporal_id_plus1 - 1 ==
+          pi->data.slice_hdr.pps->sps->max_sub_layers_minus1)
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_NON_REF;
+      if (nal_is_irap (pi->nalu.type))
+        flags |= GST_VAAPI_DECODER_UNIT_FLAG_KEYFRAME;
       if (priv->prev_pi &&
           (priv->prev_pi->flags & GST_VAAPI_DECODER_UNIT_FLAG_AU_END)) {
         flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_START |
@@ -3127,7 +3200,10 @@ gst_vaapi_decoder_h265_parse (GstVaapiDecoder * base_decoder,
       /* Fix */
       break;
   }
-  if ((flags & GST_VAAPI_DECODER_UNIT_FLAGS_AU) && priv->prev_slice_pi)
+  /* The previous slice may already be decoded by another thread if it
+     ended its frame, in which case it is flagged already */
+  if ((flags & GST_VAAPI_DECODER_UNIT_FLAGS_AU) && priv->prev_slice_pi
+      && !(priv->prev_slice_pi->flags & GST_VAAPI_DECODER_UNIT_FLAG_AU_END))
     priv->prev_slice_pi->flags |= GST_VAAPI_DECODER_UNIT_FLAG_AU_END;
   GST_VAAPI_DECODER_UNIT_FLAG_SET (unit, flags);
   pi->nalu.data = NULL;
@@ -3209,6 +3285,9 @@ gst_vaapi_decoder_h265_class_init (GstVaapiDecoderH265Class * klass)
   decoder_class->end_frame = gst_vaapi_decoder_h265_end_frame;
   decoder_class->flush = gst_vaapi_decoder_h265_flush;
   decoder_class->decode_codec_data = gst_vaapi_decoder_h265_decode_codec_data;
+  decoder_class->parse_is_threadsafe = TRUE;
+  decoder_class->flags_keyframes = TRUE;
+  decoder_class->decodes_subframes = TRUE;
 }
 
 static void
@@ -3236,6 +3315,43 @@ gst_vaapi_decoder_h265_set_alignment (GstVaapiDecoderH265 * decoder,
   decoder->priv.stream_alignment = alignment;
 }
 
+/**
+ * gst_vaapi_decoder_h265_set_low_latency:
+ * @decoder: a #GstVaapiDecoderH265
+ * @force_low_latency: %TRUE if force low latency
+ *
+ * If @force_low_latency is %TRUE, the decoded pictures are output as
+ * soon as the pictures preceding them in output order were, assuming
+ * consecutive POC values, instead of waiting for the decoded picture
+ * buffer (DPB) to release them, as driven by the SPS.
+ *
+ * This violates the H.265 specification but it is useful for some
+ * live sources.
+ */
+void
+gst_vaapi_decoder_h265_set_low_latency (GstVaapiDecoderH265 * decoder,
+    gboolean force_low_latency)
+{
+  g_return_if_fail (decoder != NULL);
+
+  decoder->priv.force_low_latency = force_low_latency;
+}
+
+/**
+ * gst_vaapi_decoder_h265_get_low_latency:
+ * @decoder: a #GstVaapiDecoderH265
+ *
+ * Returns: %TRUE if the low latency mode is enabled; otherwise
+ * %FALSE.
+ */
+gboolean
+gst_vaapi_decoder_h265_get_low_latency (GstVaapiDecoderH265 * decoder)
+{
+  g_return_val_if_fail (decoder != NULL, FALSE);
+
+  return decoder->priv.force_low_latency;
+}
+
 /**
  * gst_vaapi_decoder_h265_new:
  * @display: a #GstVaapiDisplay
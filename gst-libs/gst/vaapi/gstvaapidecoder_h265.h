@@ -63,6 +63,13 @@ void
 gst_vaapi_decoder_h265_set_alignment (GstVaapiDecoderH265 *decoder,
     GstVaapiStreamAlignH265 alignment);
 
+gboolean
+gst_vaapi_decoder_h265_get_low_latency (GstVaapiDecoderH265 *decoder);
+
+void
+gst_vaapi_decoder_h265_set_low_latency (GstVaapiDecoderH265 *decoder,
+    gboolean force_low_latency);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_DECODER_H265_H */
@@ -34,6 +34,7 @@
 #include "gstvaapidecoder_priv.h"
 #include "gstvaapidisplay_priv.h"
 #include "gstvaapiobject_priv.h"
+#include "gstvaapiutils_scan.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -270,6 +271,9 @@ struct _GstVaapiDecoderMpeg2Private
   guint progressive_sequence:1;
   guint closed_gop:1;
   guint broken_link:1;
+  guint parse_picture_type:3;
+  guint parse_first_field:1;
+  guint parse_second_field:1;
 };
 
 /**
@@ -317,6 +321,8 @@ gst_vaapi_decoder_mpeg2_close (GstVaapiDecoderMpeg2 * decoder)
   gst_vaapi_parser_info_mpeg2_replace (&priv->slice_hdr, NULL);
 
   priv->state = 0;
+  priv->parse_first_field = FALSE;
+  priv->parse_second_field = FALSE;
 
   gst_vaapi_dpb_replace (&priv->dpb, NULL);
 
@@ -567,6 +573,9 @@ decode_current_picture (GstVaapiDecoderMpeg2 * decoder)
   if (GST_VAAPI_PICTURE_IS_COMPLETE (picture)) {
     if (!gst_vaapi_dpb_add (priv->dpb, picture))
       goto error;
+    /* Output keyframes right away, without keeping them for reference */
+    if (GST_VAAPI_DECODER_KEYFRAMES_ONLY (decoder))
+      gst_vaapi_dpb_flush (priv->dpb);
     gst_vaapi_picture_replace (&priv->current_picture, NULL);
   }
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
@@ -1204,25 +1213,11 @@ static inline gint
 scan_for_start_code (const guchar * buf, guint buf_size,
     GstMpegVideoPacketTypeCode * type_ptr)
 {
-  guint i = 0;
-
-  while (i <= (buf_size - 4)) {
-    if (buf[i + 2] > 1)
-      i += 3;
-    else if (buf[i + 1])
-      i += 2;
-    else if (buf[i] || buf[i + 2] != 1)
-      i++;
-    else
-      break;
-  }
+  const gint ofs = gst_vaapi_scan_for_start_code (buf, buf_size);
 
-  if (i <= (buf_size - 4)) {
-    if (type_ptr)
-      *type_ptr = buf[i + 3];
-    return i;
-  }
-  return -1;
+  if (ofs >= 0 && type_ptr)
+    *type_ptr = buf[ofs + 3];
+  return ofs;
 }
 
 static GstVaapiDecoderStatus
@@ -1358,6 +1353,7 @@ gst_vaapi_decoder_mpeg2_parse (GstVaapiDecoder * base_decoder,
 {
   GstVaapiDecoderMpeg2 *const decoder =
       GST_VAAPI_DECODER_MPEG2_CAST (base_decoder);
+  GstVaapiDecoderMpeg2Private *const priv = &decoder->priv;
   GstVaapiParserState *const ps = GST_VAAPI_PARSER_STATE (base_decoder);
   GstVaapiDecoderStatus status;
   GstMpegVideoPacketTypeCode type, type2 = GST_MPEG_VIDEO_PACKET_NONE;
@@ -1399,6 +1395,27 @@ gst_vaapi_decoder_mpeg2_parse (GstVaapiDecoder * base_decoder,
   ofs2 += ofs;
 
   unit->size = ofs2 - ofs1;
+
+  /* Peek at picture_coding_type, after the 10-bit temporal_reference,
+     to flag the slices of B-pictures which are never referenced, and
+     of I-pictures which refer to no other picture */
+  if (type == GST_MPEG_VIDEO_PACKET_PICTURE && unit->size >= 6)
+    priv->parse_picture_type = (buf[ofs1 + 5] >> 3) & 0x07;
+
+  /* Peek at picture_structure, after the four 4-bit f_code and the 2-bit
+     intra_dc_precision, to flag the slices of second fields. They are
+     paired with the previous first field, as start_frame() does */
+  else if (type == GST_MPEG_VIDEO_PACKET_EXTENSION && unit->size >= 7
+      && (buf[ofs1 + 4] >> 4) == GST_MPEG_VIDEO_PACKET_EXT_PICTURE) {
+    const guint structure = buf[ofs1 + 6] & 0x03;
+    const gboolean is_field =
+        structure == GST_MPEG_VIDEO_PICTURE_STRUCTURE_TOP_FIELD ||
+        structure == GST_MPEG_VIDEO_PICTURE_STRUCTURE_BOTTOM_FIELD;
+
+    priv->parse_second_field = is_field && priv->parse_first_field;
+    priv->parse_first_field = is_field && !priv->parse_second_field;
+  }
+
   gst_adapter_flush (adapter, ofs1);
   ps->input_offset2 = 4;
 
@@ -1425,6 +1442,14 @@ gst_vaapi_decoder_mpeg2_parse (GstVaapiDecoder * base_decoder,
       if (type >= GST_MPEG_VIDEO_PACKET_SLICE_MIN &&
           type <= GST_MPEG_VIDEO_PACKET_SLICE_MAX) {
         flags |= GST_VAAPI_DECODER_UNIT_FLAG_SLICE;
+        /* Fields are paired with the next one, so only flag frames */
+        if (priv->parse_picture_type == GST_MPEG_VIDEO_PICTURE_TYPE_B) {
+          if (!priv->parse_first_field && !priv->parse_second_field)
+            flags |= GST_VAAPI_DECODER_UNIT_FLAG_NON_REF;
+        } else if (priv->parse_picture_type == GST_MPEG_VIDEO_PICTURE_TYPE_I)
+          flags |= GST_VAAPI_DECODER_UNIT_FLAG_KEYFRAME;
+        if (priv->parse_second_field)
+          flags |= GST_VAAPI_DECODER_UNIT_FLAG_SECONDARY;
         switch (type2) {
           case GST_MPEG_VIDEO_PACKET_USER_DATA:
           case GST_MPEG_VIDEO_PACKET_SEQUENCE:
@@ -1597,6 +1622,7 @@ gst_vaapi_decoder_mpeg2_class_init (GstVaapiDecoderMpeg2Class * klass)
   decoder_class->start_frame = gst_vaapi_decoder_mpeg2_start_frame;
   decoder_class->end_frame = gst_vaapi_decoder_mpeg2_end_frame;
   decoder_class->flush = gst_vaapi_decoder_mpeg2_flush;
+  decoder_class->flags_keyframes = TRUE;
 }
 
 static void
@@ -37,6 +37,8 @@
 #define GET_CONTEXT(obj)    GET_DECODER(obj)->context
 #define GET_VA_DISPLAY(obj) GET_DECODER(obj)->va_display
 #define GET_VA_CONTEXT(obj) GET_DECODER(obj)->va_context
+#define GET_ARENA(obj) \
+  (GET_CONTEXT(obj) ? GET_CONTEXT(obj)->buffer_arena : NULL)
 
 static inline void
 gst_video_codec_frame_clear (GstVideoCodecFrame ** frame_ptr)
@@ -62,6 +64,13 @@ enum
 void
 gst_vaapi_picture_destroy (GstVaapiPicture * picture)
 {
+  /* Close a picture whose slices were submitted ahead but that was
+     not completed, so that the context accepts the next one */
+  if (picture->is_begun) {
+    vaEndPicture (GET_VA_DISPLAY (picture), GET_VA_CONTEXT (picture));
+    picture->is_begun = FALSE;
+  }
+
   if (picture->slices) {
     g_ptr_array_unref (picture->slices);
     picture->slices = NULL;
@@ -79,7 +88,9 @@ gst_vaapi_picture_destroy (GstVaapiPicture * picture)
   picture->surface_id = VA_INVALID_ID;
   picture->surface = NULL;
 
-  vaapi_destroy_buffer (GET_VA_DISPLAY (picture), &picture->param_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (picture),
+      GET_VA_DISPLAY (picture), &picture->param_id, &picture->param,
+      VA_INVALID_SURFACE);
   picture->param = NULL;
 
   gst_video_codec_frame_clear (&picture->frame);
@@ -145,7 +156,8 @@ gst_vaapi_picture_create (GstVaapiPicture * picture,
     picture->pts = GST_CLOCK_TIME_NONE;
 
     picture->proxy =
-        gst_vaapi_context_get_surface_proxy (GET_CONTEXT (picture));
+        gst_vaapi_context_get_surface_proxy (GET_CONTEXT (picture),
+        GET_DECODER (picture)->object_arena);
     if (!picture->proxy)
       return FALSE;
 
@@ -155,9 +167,10 @@ gst_vaapi_picture_create (GstVaapiPicture * picture,
   picture->surface = GST_VAAPI_SURFACE_PROXY_SURFACE (picture->proxy);
   picture->surface_id = GST_VAAPI_SURFACE_PROXY_SURFACE_ID (picture->proxy);
 
-  success = vaapi_create_buffer (GET_VA_DISPLAY (picture),
-      GET_VA_CONTEXT (picture), VAPictureParameterBufferType,
-      args->param_size, args->param, &picture->param_id, &picture->param);
+  success = gst_vaapi_buffer_arena_create_buffer (GET_ARENA (picture),
+      GET_VA_DISPLAY (picture), GET_VA_CONTEXT (picture),
+      VAPictureParameterBufferType, args->param_size, args->param,
+      &picture->param_id, &picture->param);
   if (!success)
     return FALSE;
   picture->param_size = args->param_size;
@@ -235,63 +248,75 @@ do_decode (VADisplay dpy, VAContextID ctx, VABufferID * buf_id, void **buf_ptr)
   status = vaRenderPicture (dpy, ctx, buf_id, 1);
   if (!vaapi_check_status (status, "vaRenderPicture()"))
     return FALSE;
-
-  /* XXX: vaRenderPicture() is meant to destroy the VA buffer implicitly */
-  vaapi_destroy_buffer (dpy, buf_id);
   return TRUE;
 }
 
-gboolean
-gst_vaapi_picture_decode (GstVaapiPicture * picture)
+/* Gives a submitted buffer back to the context. The hardware may read
+   it until the picture is decoded, so this only happens after
+   vaEndPicture() and the buffer is not recycled before that */
+static void
+release_buffer (GstVaapiPicture * picture, VABufferID * buf_id)
 {
-  GstVaapiIqMatrix *iq_matrix;
-  GstVaapiBitPlane *bitplane;
-  GstVaapiHuffmanTable *huf_table;
-  GstVaapiProbabilityTable *prob_table;
-  VADisplay va_display;
-  VAContextID va_context;
-  VAStatus status;
-  guint i;
-
-  g_return_val_if_fail (GST_VAAPI_IS_PICTURE (picture), FALSE);
-
-  va_display = GET_VA_DISPLAY (picture);
-  va_context = GET_VA_CONTEXT (picture);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (picture),
+      GET_VA_DISPLAY (picture), buf_id, NULL, picture->surface_id);
+}
 
-  GST_DEBUG ("decode picture 0x%08x", picture->surface_id);
+/* Submits the picture level parameters */
+static gboolean
+begin_picture (GstVaapiPicture * picture)
+{
+  GstVaapiIqMatrix *const iq_matrix = picture->iq_matrix;
+  GstVaapiBitPlane *const bitplane = picture->bitplane;
+  GstVaapiHuffmanTable *const huf_table = picture->huf_table;
+  GstVaapiProbabilityTable *const prob_table = picture->prob_table;
+  VADisplay const va_display = GET_VA_DISPLAY (picture);
+  VAContextID const va_context = GET_VA_CONTEXT (picture);
+  VAStatus status;
 
   status = vaBeginPicture (va_display, va_context, picture->surface_id);
   if (!vaapi_check_status (status, "vaBeginPicture()"))
     return FALSE;
+  picture->is_begun = TRUE;
 
   if (!do_decode (va_display, va_context, &picture->param_id, &picture->param))
     return FALSE;
 
-  iq_matrix = picture->iq_matrix;
   if (iq_matrix && !do_decode (va_display, va_context,
           &iq_matrix->param_id, &iq_matrix->param))
     return FALSE;
 
-  bitplane = picture->bitplane;
   if (bitplane && !do_decode (va_display, va_context,
           &bitplane->data_id, (void **) &bitplane->data))
     return FALSE;
 
-  huf_table = picture->huf_table;
   if (huf_table && !do_decode (va_display, va_context,
           &huf_table->param_id, (void **) &huf_table->param))
     return FALSE;
 
-  prob_table = picture->prob_table;
   if (prob_table && !do_decode (va_display, va_context,
           &prob_table->param_id, (void **) &prob_table->param))
     return FALSE;
+  return TRUE;
+}
 
-  for (i = 0; i < picture->slices->len; i++) {
-    GstVaapiSlice *const slice = g_ptr_array_index (picture->slices, i);
+/* Submits the slices that were not yet, up to num_slices */
+static gboolean
+render_slices (GstVaapiPicture * picture, guint num_slices)
+{
+  VADisplay const va_display = GET_VA_DISPLAY (picture);
+  VAContextID const va_context = GET_VA_CONTEXT (picture);
+  VAStatus status;
+
+  if (!picture->is_begun && !begin_picture (picture))
+    return FALSE;
+
+  for (; picture->num_rendered_slices < num_slices;
+      picture->num_rendered_slices++) {
+    GstVaapiSlice *const slice =
+        g_ptr_array_index (picture->slices, picture->num_rendered_slices);
+    GstVaapiHuffmanTable *const huf_table = slice->huf_table;
     VABufferID va_buffers[2];
 
-    huf_table = slice->huf_table;
     if (huf_table && !do_decode (va_display, va_context,
             &huf_table->param_id, (void **) &huf_table->param))
       return FALSE;
@@ -304,14 +329,81 @@ gst_vaapi_picture_decode (GstVaapiPicture * picture)
     if (!vaapi_check_status (status, "vaRenderPicture()"))
       return FALSE;
   }
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_picture_decode_slices:
+ * @picture: a #GstVaapiPicture
+ * @num_slices: the number of leading slices of @picture to submit
+ *
+ * Submits the picture parameters and the first @num_slices slices of
+ * @picture to the hardware, while the remaining ones are still being
+ * received. The slices that were already submitted are not touched
+ * anymore and gst_vaapi_picture_decode() completes the picture.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_vaapi_picture_decode_slices (GstVaapiPicture * picture, guint num_slices)
+{
+  GstClockTime start_time;
+  gboolean success;
+
+  g_return_val_if_fail (GST_VAAPI_IS_PICTURE (picture), FALSE);
+  g_return_val_if_fail (num_slices <= picture->slices->len, FALSE);
+
+  start_time = gst_util_get_timestamp ();
+  success = render_slices (picture, num_slices);
+  picture->submit_time += gst_util_get_timestamp () - start_time;
+  return success;
+}
+
+gboolean
+gst_vaapi_picture_decode (GstVaapiPicture * picture)
+{
+  VADisplay va_display;
+  VAContextID va_context;
+  VAStatus status;
+  GstClockTime start_time, end_time;
+  guint i;
+
+  g_return_val_if_fail (GST_VAAPI_IS_PICTURE (picture), FALSE);
+
+  va_display = GET_VA_DISPLAY (picture);
+  va_context = GET_VA_CONTEXT (picture);
+
+  GST_DEBUG ("decode picture 0x%08x", picture->surface_id);
+
+  start_time = gst_util_get_timestamp ();
+  if (!render_slices (picture, picture->slices->len))
+    return FALSE;
 
+  end_time = gst_util_get_timestamp ();
   status = vaEndPicture (va_display, va_context);
+  picture->is_begun = FALSE;
+  gst_vaapi_decoder_stats_add_picture (GET_DECODER (picture)->stats,
+      picture->submit_time + end_time - start_time,
+      gst_util_get_timestamp () - end_time);
+
+  release_buffer (picture, &picture->param_id);
+  if (picture->iq_matrix)
+    release_buffer (picture, &picture->iq_matrix->param_id);
+  if (picture->bitplane)
+    release_buffer (picture, &picture->bitplane->data_id);
+  if (picture->prob_table)
+    release_buffer (picture, &picture->prob_table->param_id);
+  if (picture->huf_table)
+    release_buffer (picture, &picture->huf_table->param_id);
 
   for (i = 0; i < picture->slices->len; i++) {
     GstVaapiSlice *const slice = g_ptr_array_index (picture->slices, i);
 
-    vaapi_destroy_buffer (va_display, &slice->param_id);
-    vaapi_destroy_buffer (va_display, &slice->data_id);
+    if (slice->huf_table)
+      release_buffer (picture, &slice->huf_table->param_id);
+    release_buffer (picture, &slice->param_id);
+    release_buffer (picture, &slice->data_id);
+    slice->param = NULL;
   }
 
   if (!vaapi_check_status (status, "vaEndPicture()"))
@@ -351,7 +443,10 @@ do_output (GstVaapiPicture * picture)
   gst_video_codec_frame_set_user_data (out_frame,
       proxy, (GDestroyNotify) gst_vaapi_mini_object_unref);
 
-  out_frame->pts = picture->pts;
+  /* The pts may be unknown yet when the picture is started before its
+     frame is complete, see gst_vaapi_decoder_set_subframe_decode() */
+  if (GST_CLOCK_TIME_IS_VALID (picture->pts))
+    out_frame->pts = picture->pts;
 
   if (GST_VAAPI_PICTURE_IS_SKIPPED (picture))
     GST_VIDEO_CODEC_FRAME_FLAG_SET (out_frame,
@@ -432,12 +527,15 @@ GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiSlice, gst_vaapi_slice);
 void
 gst_vaapi_slice_destroy (GstVaapiSlice * slice)
 {
+  GstVaapiBufferArena *const arena = GET_ARENA (slice);
   VADisplay const va_display = GET_VA_DISPLAY (slice);
 
   gst_vaapi_codec_object_replace (&slice->huf_table, NULL);
 
-  vaapi_destroy_buffer (va_display, &slice->data_id);
-  vaapi_destroy_buffer (va_display, &slice->param_id);
+  gst_vaapi_buffer_arena_release_buffer (arena, va_display, &slice->data_id,
+      NULL, VA_INVALID_SURFACE);
+  gst_vaapi_buffer_arena_release_buffer (arena, va_display, &slice->param_id,
+      &slice->param, VA_INVALID_SURFACE);
   slice->param = NULL;
 }
 
@@ -451,13 +549,14 @@ gst_vaapi_slice_create (GstVaapiSlice * slice,
   slice->param_id = VA_INVALID_ID;
   slice->data_id = VA_INVALID_ID;
 
-  success = vaapi_create_buffer (GET_VA_DISPLAY (slice), GET_VA_CONTEXT (slice),
-      VASliceDataBufferType, args->data_size, args->data, &slice->data_id,
-      NULL);
+  success = gst_vaapi_buffer_arena_create_buffer (GET_ARENA (slice),
+      GET_VA_DISPLAY (slice), GET_VA_CONTEXT (slice), VASliceDataBufferType,
+      args->data_size, args->data, &slice->data_id, NULL);
   if (!success)
     return FALSE;
 
-  success = vaapi_create_buffer (GET_VA_DISPLAY (slice), GET_VA_CONTEXT (slice),
+  success = gst_vaapi_buffer_arena_create_buffer (GET_ARENA (slice),
+      GET_VA_DISPLAY (slice), GET_VA_CONTEXT (slice),
       VASliceParameterBufferType, args->param_size, args->param,
       &slice->param_id, &slice->param);
   if (!success)
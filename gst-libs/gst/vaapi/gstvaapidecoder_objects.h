@@ -147,6 +147,9 @@ struct _GstVaapiPicture
   GstVaapiSurfaceProxy *proxy;
   VABufferID param_id;
   guint param_size;
+  guint num_rendered_slices;
+  GstClockTime submit_time;
+  guint is_begun:1;
 
   /*< public >*/
   GstVaapiPictureType type;
@@ -192,6 +195,10 @@ G_GNUC_INTERNAL
 void
 gst_vaapi_picture_add_slice (GstVaapiPicture * picture, GstVaapiSlice * slice);
 
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_picture_decode_slices (GstVaapiPicture * picture, guint num_slices);
+
 G_GNUC_INTERNAL
 gboolean
 gst_vaapi_picture_decode (GstVaapiPicture * picture);
@@ -29,6 +29,7 @@
 #include <gst/vaapi/gstvaapidecoder.h>
 #include <gst/vaapi/gstvaapidecoder_unit.h>
 #include <gst/vaapi/gstvaapicontext.h>
+#include "gstvaapidecoder_stats.h"
 
 G_BEGIN_DECLS
 
@@ -148,6 +149,28 @@ typedef struct _GstVaapiDecoderClass GstVaapiDecoderClass;
 #define GST_VAAPI_DECODER_HEIGHT(decoder) \
     GST_VAAPI_DECODER_CODEC_STATE(decoder)->info.height
 
+/**
+ * GST_VAAPI_DECODER_KEYFRAMES_ONLY:
+ * @decoder: a #GstVaapiDecoder
+ *
+ * Macro that evaluates to %TRUE if only keyframes are decoded, see
+ * gst_vaapi_decoder_set_keyframe_interval().
+ * This is an internal macro that does not do any run-time type check.
+ */
+#define GST_VAAPI_DECODER_KEYFRAMES_ONLY(decoder) \
+    (GST_VAAPI_DECODER_CAST(decoder)->keyframe_interval > 0)
+
+/**
+ * GST_VAAPI_DECODER_SUBFRAME_DECODE:
+ * @decoder: a #GstVaapiDecoder
+ *
+ * Macro that evaluates to %TRUE if slices are to be submitted as soon
+ * as they are decoded, see gst_vaapi_decoder_set_subframe_decode().
+ * This is an internal macro that does not do any run-time type check.
+ */
+#define GST_VAAPI_DECODER_SUBFRAME_DECODE(decoder) \
+    (GST_VAAPI_DECODER_CAST(decoder)->subframe_decode)
+
 /* End-of-Stream buffer */
 #define GST_BUFFER_FLAG_EOS (GST_BUFFER_FLAG_LAST + 0)
 
@@ -170,6 +193,8 @@ struct _GstVaapiParserState
   guint32 current_frame_number;
   GstAdapter *current_adapter;
   GstAdapter *input_adapter;
+  /* offsets up to which the input adapter was already scanned, so that
+     each byte is scanned once across parse() calls */
   gint input_offset1;
   gint input_offset2;
   GstAdapter *output_adapter;
@@ -198,6 +223,31 @@ struct _GstVaapiDecoder
   GAsyncQueue *buffers;
   GAsyncQueue *frames;
   GstVaapiParserState parser_state;
+  GstVaapiMiniObjectArena *object_arena;
+  GstVaapiDecoderStats *stats;
+
+  /* parser thread, see gst_vaapi_decoder_set_parse_ahead() */
+  GThread *parse_thread;
+  GMutex parse_mutex;
+  GCond parse_cond;
+  GQueue parsed_frames;
+  GstVideoCodecFrame *parse_frame;
+  GstVaapiDecoderStatus parse_status;
+  guint parse_ahead;
+  guint parse_pending;
+  gboolean parse_stop;
+
+  /* system frame number of the frame being decoded, or -1 */
+  gint64 decode_frame_number;
+
+  /* see gst_vaapi_decoder_set_keyframe_interval() */
+  guint keyframe_interval;
+  guint keyframe_count;
+  gboolean keyframe_wanted;
+
+  /* see gst_vaapi_decoder_set_subframe_decode() */
+  gboolean subframe_decode;
+
   GstVaapiDecoderStateChangedFunc codec_state_changed_func;
   gpointer codec_state_changed_data;
 };
@@ -212,6 +262,17 @@ struct _GstVaapiDecoderClass
   /*< private >*/
   GstObjectClass parent_class;
 
+  /* parse() only updates state that decode() does not read, and the
+     other way round, so that both can run on different threads */
+  gboolean parse_is_threadsafe;
+
+  /* parse() sets GST_VAAPI_DECODER_UNIT_FLAG_KEYFRAME */
+  gboolean flags_keyframes;
+
+  /* decode() accepts the units of a frame that is still being parsed,
+     with the input buffer only holding the current unit */
+  gboolean decodes_subframes;
+
   GstVaapiDecoderStatus (*parse) (GstVaapiDecoder * decoder,
       GstAdapter * adapter, gboolean at_eos,
       struct _GstVaapiDecoderUnit * unit);
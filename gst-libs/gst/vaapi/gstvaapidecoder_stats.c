@@ -0,0 +1,385 @@
+/*
+ *  gstvaapidecoder_stats.c - Decoder statistics
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Per-frame timings and queue depths of a decoder. Each metric keeps
+ * its last WINDOW_SIZE samples, from which percentiles are computed on
+ * request only, so that recording a sample stays cheap. Every decoded
+ * frame is also logged as a "vaapidecoder" tracer record, which shows
+ * up in the GST_TRACER debug category along with the records of the
+ * core tracers.
+ */
+
+#include "sysdeps.h"
+#include <stdlib.h>
+#include "gstvaapidecoder_stats.h"
+
+#define WINDOW_SIZE 256
+
+typedef enum
+{
+  STAT_PARSE_TIME,
+  STAT_DECODE_TIME,
+  STAT_SUBMIT_TIME,
+  STAT_END_PICTURE_TIME,
+  STAT_DPB_OCCUPANCY,
+  STAT_INPUT_QUEUE,
+  STAT_PARSE_QUEUE,
+  STAT_OUTPUT_QUEUE,
+  STAT_SURFACES_IN_USE,
+  STAT_OUTPUT_LATENCY,
+  N_STATS
+} StatId;
+
+static const gchar *const g_stat_names[N_STATS] = {
+  "parse-time",
+  "decode-time",
+  "submit-time",
+  "end-picture-time",
+  "dpb-occupancy",
+  "input-queue",
+  "parse-queue",
+  "output-queue",
+  "surfaces-in-use",
+  "output-latency",
+};
+
+typedef struct
+{
+  guint64 samples[WINDOW_SIZE];
+  guint num_samples;
+  guint pos;
+} StatWindow;
+
+struct _GstVaapiDecoderStats
+{
+  GMutex lock;
+  StatWindow windows[N_STATS];
+  guint64 num_decoded;
+  guint64 num_output;
+  guint64 num_dropped;
+  guint64 num_skipped;
+  guint output_queue;
+  guint surfaces_in_use;
+  guint num_surfaces;
+  guint output_latency;
+
+  /* updated by the decode thread only, folded into the windows once
+     the frame is decoded */
+  GstClockTime submit_time;
+  GstClockTime end_time;
+  guint dpb_occupancy;
+  guint dpb_size;
+  gboolean has_dpb_occupancy;
+};
+
+static GstStructure *
+value_spec (GType type, const gchar * description)
+{
+  return gst_structure_new ("value", "type", G_TYPE_GTYPE, type,
+      "description", G_TYPE_STRING, description, NULL);
+}
+
+/* Returns NULL if the core was built without tracer hooks */
+static GstTracerRecord *
+get_tracer_record (void)
+{
+  static GstTracerRecord *g_record;
+  static gsize g_record_init = 0;
+
+  if (g_once_init_enter (&g_record_init)) {
+    GstTracerRecord *const record =
+        gst_tracer_record_new ("vaapidecoder.class",
+        "decoder", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_STRING, "name of the decoder"),
+        "frame-number", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT, "system frame number"),
+        "parse-time", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT64, "time spent parsing the frame, in ns"),
+        "decode-time", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT64, "time spent decoding the frame, in ns"),
+        "submit-time", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT64, "time spent in vaRenderPicture(), in ns"),
+        "end-picture-time", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT64, "time spent in vaEndPicture(), in ns"),
+        "dpb-occupancy", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT, "number of pictures in the DPB"),
+        "input-queue", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT, "number of buffers waiting to be parsed"),
+        "parse-queue", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT, "number of frames parsed ahead"),
+        "output-queue", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT, "number of frames waiting to be output"),
+        "surfaces-in-use", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT, "number of surfaces out of the pool"),
+        "output-latency", GST_TYPE_STRUCTURE,
+        value_spec (G_TYPE_UINT, "frames decoded until the last output one "
+            "was output"), NULL);
+    if (record)
+      GST_OBJECT_FLAG_SET (record, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+    g_record = record;
+    g_once_init_leave (&g_record_init, 1);
+  }
+  return g_record;
+}
+
+static void
+stat_window_add (StatWindow * window, guint64 value)
+{
+  window->samples[window->pos] = value;
+  window->pos = (window->pos + 1) % WINDOW_SIZE;
+  if (window->num_samples < WINDOW_SIZE)
+    window->num_samples++;
+}
+
+static gint
+compare_samples (gconstpointer a, gconstpointer b)
+{
+  const guint64 va = *(const guint64 *) a;
+  const guint64 vb = *(const guint64 *) b;
+
+  return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+/* Nearest-rank percentile of the sorted samples */
+static inline guint64
+get_percentile (const guint64 * samples, guint num_samples, guint percent)
+{
+  guint rank;
+
+  if (num_samples == 0)
+    return 0;
+  rank = (percent * num_samples + 99) / 100;
+  return samples[MAX (rank, 1) - 1];
+}
+
+static void
+stat_window_fill (const StatWindow * window, const gchar * name,
+    GstStructure * structure)
+{
+  guint64 samples[WINDOW_SIZE];
+  const guint n = window->num_samples;
+  gchar field[64];
+
+  memcpy (samples, window->samples, n * sizeof (samples[0]));
+  qsort (samples, n, sizeof (samples[0]), compare_samples);
+
+  g_snprintf (field, sizeof (field), "%s-p50", name);
+  gst_structure_set (structure, field, G_TYPE_UINT64,
+      get_percentile (samples, n, 50), NULL);
+  g_snprintf (field, sizeof (field), "%s-p90", name);
+  gst_structure_set (structure, field, G_TYPE_UINT64,
+      get_percentile (samples, n, 90), NULL);
+  g_snprintf (field, sizeof (field), "%s-p99", name);
+  gst_structure_set (structure, field, G_TYPE_UINT64,
+      get_percentile (samples, n, 99), NULL);
+  g_snprintf (field, sizeof (field), "%s-max", name);
+  gst_structure_set (structure, field, G_TYPE_UINT64,
+      n > 0 ? samples[n - 1] : 0, NULL);
+}
+
+GstVaapiDecoderStats *
+gst_vaapi_decoder_stats_new (void)
+{
+  GstVaapiDecoderStats *const stats = g_new0 (GstVaapiDecoderStats, 1);
+
+  g_mutex_init (&stats->lock);
+  return stats;
+}
+
+void
+gst_vaapi_decoder_stats_free (GstVaapiDecoderStats * stats)
+{
+  if (!stats)
+    return;
+  g_mutex_clear (&stats->lock);
+  g_free (stats);
+}
+
+/**
+ * gst_vaapi_decoder_stats_add_picture:
+ * @stats: a #GstVaapiDecoderStats
+ * @submit_time: time spent submitting the picture buffers, in ns
+ * @end_time: time spent in vaEndPicture(), in ns
+ *
+ * Accounts a picture submitted for the frame being decoded. This must
+ * be called from the decode thread.
+ */
+void
+gst_vaapi_decoder_stats_add_picture (GstVaapiDecoderStats * stats,
+    GstClockTime submit_time, GstClockTime end_time)
+{
+  stats->submit_time += submit_time;
+  stats->end_time += end_time;
+}
+
+/**
+ * gst_vaapi_decoder_stats_add_dpb:
+ * @stats: a #GstVaapiDecoderStats
+ * @occupancy: the number of pictures held by the DPB
+ * @size: the DPB size
+ *
+ * Records the DPB fullness after a picture was added to it. The
+ * highest occupancy reached while decoding a frame is the one sampled
+ * for that frame. This must be called from the decode thread.
+ */
+void
+gst_vaapi_decoder_stats_add_dpb (GstVaapiDecoderStats * stats,
+    guint occupancy, guint size)
+{
+  stats->dpb_occupancy = MAX (stats->dpb_occupancy, occupancy);
+  stats->has_dpb_occupancy = TRUE;
+  g_atomic_int_set (&stats->dpb_size, size);
+}
+
+/**
+ * gst_vaapi_decoder_stats_add_frame:
+ * @stats: a #GstVaapiDecoderStats
+ * @decoder: the decoder, for the tracer record
+ * @frame: the samples of the decoded frame
+ *
+ * Records the samples of a decoded frame, along with the pictures and
+ * DPB fullness accounted since the previous frame, and logs them as a
+ * tracer record.
+ */
+void
+gst_vaapi_decoder_stats_add_frame (GstVaapiDecoderStats * stats,
+    GstObject * decoder, const GstVaapiDecoderStatsFrame * frame)
+{
+  GstTracerRecord *record;
+  GstClockTime submit_time, end_time;
+  guint dpb_occupancy, output_queue, surfaces_in_use, output_latency;
+  gboolean has_dpb_occupancy;
+
+  submit_time = stats->submit_time;
+  end_time = stats->end_time;
+  dpb_occupancy = stats->dpb_occupancy;
+  has_dpb_occupancy = stats->has_dpb_occupancy;
+  stats->submit_time = 0;
+  stats->end_time = 0;
+  stats->dpb_occupancy = 0;
+  stats->has_dpb_occupancy = FALSE;
+
+  g_mutex_lock (&stats->lock);
+  stats->num_decoded++;
+  stat_window_add (&stats->windows[STAT_PARSE_TIME], frame->parse_time);
+  stat_window_add (&stats->windows[STAT_DECODE_TIME], frame->decode_time);
+  stat_window_add (&stats->windows[STAT_SUBMIT_TIME], submit_time);
+  stat_window_add (&stats->windows[STAT_END_PICTURE_TIME], end_time);
+  if (has_dpb_occupancy)
+    stat_window_add (&stats->windows[STAT_DPB_OCCUPANCY], dpb_occupancy);
+  stat_window_add (&stats->windows[STAT_INPUT_QUEUE], frame->input_queue);
+  stat_window_add (&stats->windows[STAT_PARSE_QUEUE], frame->parse_queue);
+  output_queue = stats->output_queue;
+  surfaces_in_use = stats->surfaces_in_use;
+  output_latency = stats->output_latency;
+  g_mutex_unlock (&stats->lock);
+
+  record = get_tracer_record ();
+  if (!record)
+    return;
+  gst_tracer_record_log (record, GST_OBJECT_NAME (decoder),
+      frame->frame_number, (guint64) frame->parse_time,
+      (guint64) frame->decode_time, (guint64) submit_time,
+      (guint64) end_time, dpb_occupancy, frame->input_queue,
+      frame->parse_queue, output_queue, surfaces_in_use, output_latency);
+}
+
+/**
+ * gst_vaapi_decoder_stats_add_output:
+ * @stats: a #GstVaapiDecoderStats
+ * @output_queue: the number of frames waiting to be output
+ * @surfaces_in_use: the number of surfaces out of the surface pool
+ * @num_surfaces: the size of the surface pool
+ * @latency: the number of frames decoded after the frame until now,
+ *   or -1 if unknown
+ * @dropped: %TRUE if the frame was dropped
+ *
+ * Records the queue depths when a frame is handed over for output.
+ * The surfaces in use are those held by the DPB, the output queue,
+ * and downstream.
+ */
+void
+gst_vaapi_decoder_stats_add_output (GstVaapiDecoderStats * stats,
+    guint output_queue, guint surfaces_in_use, guint num_surfaces,
+    gint latency, gboolean dropped)
+{
+  g_mutex_lock (&stats->lock);
+  if (dropped)
+    stats->num_dropped++;
+  else
+    stats->num_output++;
+  stats->output_queue = output_queue;
+  stats->surfaces_in_use = surfaces_in_use;
+  stats->num_surfaces = num_surfaces;
+  stat_window_add (&stats->windows[STAT_OUTPUT_QUEUE], output_queue);
+  stat_window_add (&stats->windows[STAT_SURFACES_IN_USE], surfaces_in_use);
+  if (latency >= 0) {
+    stats->output_latency = latency;
+    stat_window_add (&stats->windows[STAT_OUTPUT_LATENCY], latency);
+  }
+  g_mutex_unlock (&stats->lock);
+}
+
+/**
+ * gst_vaapi_decoder_stats_add_skipped:
+ * @stats: a #GstVaapiDecoderStats
+ *
+ * Counts a frame whose pictures were not decoded at all, see
+ * gst_vaapi_decoder_skip().
+ */
+void
+gst_vaapi_decoder_stats_add_skipped (GstVaapiDecoderStats * stats)
+{
+  g_mutex_lock (&stats->lock);
+  stats->num_skipped++;
+  g_mutex_unlock (&stats->lock);
+}
+
+/**
+ * gst_vaapi_decoder_stats_get:
+ * @stats: a #GstVaapiDecoderStats
+ *
+ * Computes the percentiles of every metric over its last samples.
+ * See gst_vaapi_decoder_get_stats() for the fields.
+ *
+ * Return value: (transfer full): a newly allocated #GstStructure
+ */
+GstStructure *
+gst_vaapi_decoder_stats_get (GstVaapiDecoderStats * stats)
+{
+  GstStructure *structure;
+  guint i;
+
+  structure = gst_structure_new_empty ("application/x-vaapi-decoder-stats");
+
+  g_mutex_lock (&stats->lock);
+  gst_structure_set (structure,
+      "frames-decoded", G_TYPE_UINT64, stats->num_decoded,
+      "frames-output", G_TYPE_UINT64, stats->num_output,
+      "frames-dropped", G_TYPE_UINT64, stats->num_dropped,
+      "frames-skipped", G_TYPE_UINT64, stats->num_skipped,
+      "dpb-size", G_TYPE_UINT, g_atomic_int_get (&stats->dpb_size),
+      "surfaces", G_TYPE_UINT, stats->num_surfaces,
+      "window", G_TYPE_UINT, WINDOW_SIZE, NULL);
+  for (i = 0; i < N_STATS; i++)
+    stat_window_fill (&stats->windows[i], g_stat_names[i], structure);
+  g_mutex_unlock (&stats->lock);
+  return structure;
+}
@@ -0,0 +1,87 @@
+/*
+ *  gstvaapidecoder_stats.h - Decoder statistics
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_DECODER_STATS_H
+#define GST_VAAPI_DECODER_STATS_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiDecoderStats GstVaapiDecoderStats;
+
+/**
+ * GstVaapiDecoderStatsFrame:
+ * @frame_number: the system frame number of the decoded frame
+ * @parse_time: time spent parsing the frame, in ns
+ * @decode_time: time spent decoding the frame, in ns
+ * @input_queue: number of buffers waiting to be parsed
+ * @parse_queue: number of frames parsed ahead
+ *
+ * Per-frame samples collected by the decoder once a frame is decoded.
+ */
+typedef struct
+{
+  guint32 frame_number;
+  GstClockTime parse_time;
+  GstClockTime decode_time;
+  guint input_queue;
+  guint parse_queue;
+} GstVaapiDecoderStatsFrame;
+
+G_GNUC_INTERNAL
+GstVaapiDecoderStats *
+gst_vaapi_decoder_stats_new (void);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_decoder_stats_free (GstVaapiDecoderStats * stats);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_decoder_stats_add_picture (GstVaapiDecoderStats * stats,
+    GstClockTime submit_time, GstClockTime end_time);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_decoder_stats_add_dpb (GstVaapiDecoderStats * stats,
+    guint occupancy, guint size);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_decoder_stats_add_frame (GstVaapiDecoderStats * stats,
+    GstObject * decoder, const GstVaapiDecoderStatsFrame * frame);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_decoder_stats_add_output (GstVaapiDecoderStats * stats,
+    guint output_queue, guint surfaces_in_use, guint num_surfaces,
+    gint latency, gboolean dropped);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_decoder_stats_add_skipped (GstVaapiDecoderStats * stats);
+
+G_GNUC_INTERNAL
+GstStructure *
+gst_vaapi_decoder_stats_get (GstVaapiDecoderStats * stats);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_DECODER_STATS_H */
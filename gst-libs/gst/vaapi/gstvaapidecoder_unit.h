@@ -40,6 +40,13 @@ typedef struct _GstVaapiDecoderUnit             GstVaapiDecoderUnit;
  * @GST_VAAPI_DECODER_UNIT_FLAG_STREAM_END: marks the end of a stream.
  * @GST_VAAPI_DECODER_UNIT_FLAG_SLICE: the unit contains slice data.
  * @GST_VAAPI_DECODER_UNIT_FLAG_SKIP: marks the unit as unused/skipped.
+ * @GST_VAAPI_DECODER_UNIT_FLAG_NON_REF: the unit contains slice data of
+ *   a picture that is never used for reference.
+ * @GST_VAAPI_DECODER_UNIT_FLAG_KEYFRAME: the unit contains slice data of
+ *   a picture that can be decoded without any previous picture.
+ * @GST_VAAPI_DECODER_UNIT_FLAG_SECONDARY: the unit contains slice data
+ *   of a picture that completes the previous one, i.e. a second field or
+ *   a non-base view.
  *
  * Flags for #GstVaapiDecoderUnit.
  */
@@ -49,7 +56,10 @@ typedef enum {
     GST_VAAPI_DECODER_UNIT_FLAG_STREAM_END  = (1 << 2),
     GST_VAAPI_DECODER_UNIT_FLAG_SLICE       = (1 << 3),
     GST_VAAPI_DECODER_UNIT_FLAG_SKIP        = (1 << 4),
-    GST_VAAPI_DECODER_UNIT_FLAG_LAST        = (1 << 5)
+    GST_VAAPI_DECODER_UNIT_FLAG_NON_REF     = (1 << 5),
+    GST_VAAPI_DECODER_UNIT_FLAG_KEYFRAME    = (1 << 6),
+    GST_VAAPI_DECODER_UNIT_FLAG_SECONDARY   = (1 << 7),
+    GST_VAAPI_DECODER_UNIT_FLAG_LAST        = (1 << 8)
 } GstVaapiDecoderUnitFlags;
 
 /**
@@ -149,6 +159,42 @@ typedef enum {
     (GST_VAAPI_DECODER_UNIT_FLAG_IS_SET(unit,   \
         GST_VAAPI_DECODER_UNIT_FLAG_SKIP))
 
+/**
+ * GST_VAAPI_DECODER_UNIT_IS_NON_REF:
+ * @unit: a #GstVaapiDecoderUnit
+ *
+ * Tests if the decoder unit contains slice data of a picture that no
+ * other picture refers to, i.e. whose decoding can be skipped without
+ * affecting the following pictures.
+ */
+#define GST_VAAPI_DECODER_UNIT_IS_NON_REF(unit) \
+    (GST_VAAPI_DECODER_UNIT_FLAG_IS_SET(unit,   \
+        GST_VAAPI_DECODER_UNIT_FLAG_NON_REF))
+
+/**
+ * GST_VAAPI_DECODER_UNIT_IS_KEYFRAME:
+ * @unit: a #GstVaapiDecoderUnit
+ *
+ * Tests if the decoder unit contains slice data of a picture that
+ * only refers to itself, e.g. an IDR or an I picture, so that it can
+ * be decoded after the previous pictures were skipped.
+ */
+#define GST_VAAPI_DECODER_UNIT_IS_KEYFRAME(unit) \
+    (GST_VAAPI_DECODER_UNIT_FLAG_IS_SET(unit,   \
+        GST_VAAPI_DECODER_UNIT_FLAG_KEYFRAME))
+
+/**
+ * GST_VAAPI_DECODER_UNIT_IS_SECONDARY:
+ * @unit: a #GstVaapiDecoderUnit
+ *
+ * Tests if the decoder unit contains slice data of a picture that is
+ * only complete with the previous one, e.g. the second field of a
+ * frame, so that both are either decoded or skipped.
+ */
+#define GST_VAAPI_DECODER_UNIT_IS_SECONDARY(unit) \
+    (GST_VAAPI_DECODER_UNIT_FLAG_IS_SET(unit,   \
+        GST_VAAPI_DECODER_UNIT_FLAG_SECONDARY))
+
 /**
  * GstVaapiDecoderUnit:
  * @size: size in bytes of this bitstream unit
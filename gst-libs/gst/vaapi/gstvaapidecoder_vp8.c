@@ -558,6 +558,7 @@ static GstVaapiDecoderStatus
 gst_vaapi_decoder_vp8_parse (GstVaapiDecoder * base_decoder,
     GstAdapter * adapter, gboolean at_eos, GstVaapiDecoderUnit * unit)
 {
+  const guchar *buf;
   guint flags = 0;
 
   unit->size = gst_adapter_available (adapter);
@@ -566,6 +567,14 @@ gst_vaapi_decoder_vp8_parse (GstVaapiDecoder * base_decoder,
   flags |= GST_VAAPI_DECODER_UNIT_FLAG_FRAME_START;
   flags |= GST_VAAPI_DECODER_UNIT_FLAG_SLICE;
   flags |= GST_VAAPI_DECODER_UNIT_FLAG_FRAME_END;
+
+  /* The first bit of the frame tag is cleared for key frames */
+  if (unit->size > 0) {
+    buf = gst_adapter_map (adapter, 1);
+    if (buf && !(buf[0] & 0x01))
+      flags |= GST_VAAPI_DECODER_UNIT_FLAG_KEYFRAME;
+    gst_adapter_unmap (adapter);
+  }
   GST_VAAPI_DECODER_UNIT_FLAG_SET (unit, flags);
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 
@@ -650,6 +659,7 @@ gst_vaapi_decoder_vp8_class_init (GstVaapiDecoderVp8Class * klass)
   decoder_class->start_frame = gst_vaapi_decoder_vp8_start_frame;
   decoder_class->end_frame = gst_vaapi_decoder_vp8_end_frame;
   decoder_class->flush = gst_vaapi_decoder_vp8_flush;
+  decoder_class->flags_keyframes = TRUE;
 }
 
 static void
@@ -673,6 +673,24 @@ parse_frame_header (GstVaapiDecoderVp9 * decoder, const guchar * buf,
   return GST_VAAPI_DECODER_STATUS_SUCCESS;
 }
 
+/* Peeks at frame_type in the first byte of the uncompressed header:
+   frame_marker (2 bits), profile (2 bits), a reserved bit for profile
+   3, show_existing_frame and then frame_type */
+static gboolean
+is_key_frame (const guchar * buf, guint buf_size)
+{
+  guint profile, shift;
+
+  if (buf_size < 1 || (buf[0] >> 6) != 2)
+    return FALSE;
+
+  profile = ((buf[0] >> 5) & 1) | ((buf[0] >> 3) & 2);
+  shift = profile == 3 ? 2 : 3;
+  if ((buf[0] >> shift) & 1)
+    return FALSE;
+  return ((buf[0] >> (shift - 1)) & 1) == GST_VP9_KEY_FRAME;
+}
+
 static GstVaapiDecoderStatus
 gst_vaapi_decoder_vp9_parse (GstVaapiDecoder * base_decoder,
     GstAdapter * adapter, gboolean at_eos, GstVaapiDecoderUnit * unit)
@@ -711,6 +729,8 @@ gst_vaapi_decoder_vp9_parse (GstVaapiDecoder * base_decoder,
   flags |= GST_VAAPI_DECODER_UNIT_FLAG_FRAME_START;
   flags |= GST_VAAPI_DECODER_UNIT_FLAG_SLICE;
   flags |= GST_VAAPI_DECODER_UNIT_FLAG_FRAME_END;
+  if (is_key_frame (buf, unit->size))
+    flags |= GST_VAAPI_DECODER_UNIT_FLAG_KEYFRAME;
 
   GST_VAAPI_DECODER_UNIT_FLAG_SET (unit, flags);
 
@@ -803,6 +823,7 @@ gst_vaapi_decoder_vp9_class_init (GstVaapiDecoderVp9Class * klass)
   decoder_class->start_frame = gst_vaapi_decoder_vp9_start_frame;
   decoder_class->end_frame = gst_vaapi_decoder_vp9_end_frame;
   decoder_class->flush = gst_vaapi_decoder_vp9_flush;
+  decoder_class->flags_keyframes = TRUE;
 }
 
 static void
@@ -33,6 +33,7 @@
 #include "gstvaapidisplay.h"
 #include "gstvaapitexturemap.h"
 #include "gstvaapidisplay_priv.h"
+#include "gstvaapicapscache.h"
 #include "gstvaapiworkarounds.h"
 
 /* Debug category for all vaapi libs */
@@ -131,6 +132,10 @@ gst_vaapi_display_type_get_type (void)
 #if USE_DRM
     {GST_VAAPI_DISPLAY_TYPE_DRM,
         "VA/DRM display", "drm"},
+#endif
+#if USE_NULL
+    {GST_VAAPI_DISPLAY_TYPE_NULL,
+        "VA/null software display", "null"},
 #endif
     {0, NULL, NULL},
   };
@@ -452,6 +457,54 @@ find_property_id (const gchar * name)
   return 0;
 }
 
+/* Loads decoder and encoder configs from the capability cache */
+static gboolean
+load_cached_profiles (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  gpointer decoders = NULL, encoders = NULL, vpp = NULL;
+  gsize decoders_size, encoders_size, vpp_size;
+  gboolean success = FALSE;
+
+  if (!gst_vaapi_display_lookup_caps (display, "decoders", &decoders,
+          &decoders_size) ||
+      !gst_vaapi_display_lookup_caps (display, "encoders", &encoders,
+          &encoders_size) ||
+      !gst_vaapi_display_lookup_caps (display, "vpp", &vpp, &vpp_size))
+    goto cleanup;
+  if (decoders_size % sizeof (GstVaapiConfig) != 0 ||
+      encoders_size % sizeof (GstVaapiConfig) != 0 ||
+      vpp_size != sizeof (guint32))
+    goto cleanup;
+
+  g_array_append_vals (priv->decoders, decoders,
+      decoders_size / sizeof (GstVaapiConfig));
+  g_array_append_vals (priv->encoders, encoders,
+      encoders_size / sizeof (GstVaapiConfig));
+  priv->has_vpp = *(guint32 *) vpp != 0;
+  success = TRUE;
+
+cleanup:
+  g_free (decoders);
+  g_free (encoders);
+  g_free (vpp);
+  return success;
+}
+
+static void
+store_cached_profiles (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  const guint32 vpp = priv->has_vpp;
+
+  gst_vaapi_display_store_caps (display, "decoders", priv->decoders->data,
+      priv->decoders->len * sizeof (GstVaapiConfig));
+  gst_vaapi_display_store_caps (display, "encoders", priv->encoders->data,
+      priv->encoders->len * sizeof (GstVaapiConfig));
+  gst_vaapi_display_store_caps (display, "vpp", &vpp, sizeof (vpp));
+  gst_vaapi_caps_cache_save ();
+}
+
 /* Initialize VA profiles (decoders, encoders) */
 static gboolean
 ensure_profiles (GstVaapiDisplay * display)
@@ -478,6 +531,11 @@ ensure_profiles (GstVaapiDisplay * display)
     goto cleanup;
   priv->has_profiles = TRUE;
 
+  if (load_cached_profiles (display)) {
+    success = TRUE;
+    goto cleanup;
+  }
+
   /* VA profiles */
   profiles = g_new (VAProfile, vaMaxNumProfiles (priv->display));
   if (!profiles)
@@ -544,6 +602,7 @@ ensure_profiles (GstVaapiDisplay * display)
         priv->has_vpp = TRUE;
     }
   }
+  store_cached_profiles (display);
   success = TRUE;
 
 cleanup:
@@ -648,6 +707,7 @@ ensure_image_formats (GstVaapiDisplay * display)
   GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
   VAImageFormat *formats = NULL;
   VAStatus status;
+  gsize size;
   gint i, n;
   gboolean success = FALSE;
 
@@ -662,14 +722,23 @@ ensure_image_formats (GstVaapiDisplay * display)
     goto cleanup;
 
   /* VA image formats */
-  formats = g_new (VAImageFormat, vaMaxNumImageFormats (priv->display));
-  if (!formats)
-    goto cleanup;
-
-  n = 0;
-  status = vaQueryImageFormats (priv->display, formats, &n);
-  if (!vaapi_check_status (status, "vaQueryImageFormats()"))
-    goto cleanup;
+  if (gst_vaapi_display_lookup_caps (display, "image-formats",
+          (gpointer *) & formats, &size) &&
+      size % sizeof (VAImageFormat) == 0)
+    n = size / sizeof (VAImageFormat);
+  else {
+    g_free (formats);
+    formats = g_new (VAImageFormat, vaMaxNumImageFormats (priv->display));
+    if (!formats)
+      goto cleanup;
+
+    n = 0;
+    status = vaQueryImageFormats (priv->display, formats, &n);
+    if (!vaapi_check_status (status, "vaQueryImageFormats()"))
+      goto cleanup;
+    gst_vaapi_display_store_caps (display, "image-formats", formats,
+        n * sizeof (VAImageFormat));
+  }
 
   GST_DEBUG ("%d image formats", n);
   for (i = 0; i < n; i++)
@@ -698,6 +767,7 @@ ensure_subpicture_formats (GstVaapiDisplay * display)
   VAImageFormat *formats = NULL;
   unsigned int *flags = NULL;
   VAStatus status;
+  gsize size, flags_size;
   guint i, n;
   gboolean success = FALSE;
 
@@ -712,24 +782,41 @@ ensure_subpicture_formats (GstVaapiDisplay * display)
   if (!priv->subpicture_formats)
     goto cleanup;
 
-  /* VA subpicture formats */
-  n = vaMaxNumSubpictureFormats (priv->display);
-  formats = g_new (VAImageFormat, n);
-  if (!formats)
-    goto cleanup;
-  flags = g_new (guint, n);
-  if (!flags)
-    goto cleanup;
-
-  n = 0;
-  status = vaQuerySubpictureFormats (priv->display, formats, flags, &n);
-  if (!vaapi_check_status (status, "vaQuerySubpictureFormats()"))
-    goto cleanup;
-
-  GST_DEBUG ("%d subpicture formats", n);
-  for (i = 0; i < n; i++) {
-    GST_DEBUG ("  %" GST_FOURCC_FORMAT, GST_FOURCC_ARGS (formats[i].fourcc));
-    flags[i] = to_GstVaapiSubpictureFlags (flags[i]);
+  /* VA subpicture formats, with flags already converted if cached */
+  if (gst_vaapi_display_lookup_caps (display, "subpicture-formats",
+          (gpointer *) & formats, &size) &&
+      gst_vaapi_display_lookup_caps (display, "subpicture-flags",
+          (gpointer *) & flags, &flags_size) &&
+      size % sizeof (VAImageFormat) == 0 &&
+      flags_size == size / sizeof (VAImageFormat) * sizeof (guint)) {
+    n = size / sizeof (VAImageFormat);
+    GST_DEBUG ("%d cached subpicture formats", n);
+  } else {
+    g_free (formats);
+    g_free (flags);
+    n = vaMaxNumSubpictureFormats (priv->display);
+    formats = g_new (VAImageFormat, n);
+    if (!formats)
+      goto cleanup;
+    flags = g_new (guint, n);
+    if (!flags)
+      goto cleanup;
+
+    n = 0;
+    status = vaQuerySubpictureFormats (priv->display, formats, flags, &n);
+    if (!vaapi_check_status (status, "vaQuerySubpictureFormats()"))
+      goto cleanup;
+
+    GST_DEBUG ("%d subpicture formats", n);
+    for (i = 0; i < n; i++) {
+      GST_DEBUG ("  %" GST_FOURCC_FORMAT,
+          GST_FOURCC_ARGS (formats[i].fourcc));
+      flags[i] = to_GstVaapiSubpictureFlags (flags[i]);
+    }
+    gst_vaapi_display_store_caps (display, "subpicture-formats", formats,
+        n * sizeof (VAImageFormat));
+    gst_vaapi_display_store_caps (display, "subpicture-flags", flags,
+        n * sizeof (guint));
   }
 
   append_formats (priv->subpicture_formats, formats, flags, n);
@@ -841,6 +928,12 @@ gst_vaapi_display_destroy (GstVaapiDisplay * display)
     priv->properties = NULL;
   }
 
+  /* Write the capabilities queried after the profiles, if any */
+  gst_vaapi_caps_cache_save ();
+
+  /* Cached surfaces belong to the VA display, release them first */
+  g_clear_pointer (&priv->surface_cache, gst_vaapi_surface_cache_free);
+
   if (priv->display) {
     if (!priv->parent)
       vaTerminate (priv->display);
@@ -855,10 +948,47 @@ gst_vaapi_display_destroy (GstVaapiDisplay * display)
 
   g_clear_pointer (&priv->display_name, g_free);
   g_clear_pointer (&priv->vendor_string, g_free);
+  g_clear_pointer (&priv->caps_cache_id, g_free);
 
   gst_vaapi_display_replace (&priv->parent, NULL);
 }
 
+/* Returns the surface cache budget from the environment, in bytes. The
+   GST_VAAPI_SURFACE_CACHE_SIZE variable holds a size in MiB */
+static gsize
+get_default_surface_cache_size (void)
+{
+  const gchar *const str = g_getenv ("GST_VAAPI_SURFACE_CACHE_SIZE");
+  gchar *end;
+  guint64 value;
+
+  if (!str || !*str)
+    return 0;
+
+  value = g_ascii_strtoull (str, &end, 10);
+  if (end == str || value > (G_MAXSIZE >> 20)) {
+    GST_WARNING ("invalid surface cache size '%s'", str);
+    return 0;
+  }
+  return (gsize) value << 20;
+}
+
+/* Returns the lock mode from the GST_VAAPI_DISPLAY_LOCK_MODE
+   environment variable, either "global" or "context" */
+static GstVaapiDisplayLockMode
+get_default_lock_mode (void)
+{
+  const gchar *const str = g_getenv ("GST_VAAPI_DISPLAY_LOCK_MODE");
+
+  if (!str || !*str || g_ascii_strcasecmp (str, "global") == 0)
+    return GST_VAAPI_DISPLAY_LOCK_MODE_GLOBAL;
+  if (g_ascii_strcasecmp (str, "context") == 0)
+    return GST_VAAPI_DISPLAY_LOCK_MODE_CONTEXT;
+
+  GST_WARNING ("invalid display lock mode '%s'", str);
+  return GST_VAAPI_DISPLAY_LOCK_MODE_GLOBAL;
+}
+
 static gboolean
 gst_vaapi_display_create (GstVaapiDisplay * display,
     GstVaapiDisplayInitType init_type, gpointer data)
@@ -904,7 +1034,10 @@ gst_vaapi_display_create (GstVaapiDisplay * display,
     return FALSE;
 
   if (!priv->parent) {
-    if (!vaapi_initialize (priv->display))
+    if (klass->initialize) {
+      if (!klass->initialize (display))
+        return FALSE;
+    } else if (!vaapi_initialize (priv->display))
       return FALSE;
   }
 
@@ -912,6 +1045,10 @@ gst_vaapi_display_create (GstVaapiDisplay * display,
   g_free (priv->display_name);
   priv->display_name = g_strdup (info.display_name);
 
+  priv->surface_cache = gst_vaapi_surface_cache_new (display);
+  gst_vaapi_surface_cache_set_max_size (priv->surface_cache,
+      get_default_surface_cache_size ());
+
   if (!ensure_image_formats (display)) {
     gst_vaapi_display_destroy (display);
     return FALSE;
@@ -951,6 +1088,7 @@ gst_vaapi_display_init (GstVaapiDisplay * display)
   priv->par_d = 1;
 
   g_rec_mutex_init (&priv->mutex);
+  priv->lock_mode = get_default_lock_mode ();
 }
 
 static gboolean
@@ -1269,6 +1407,44 @@ gst_vaapi_display_unlock (GstVaapiDisplay * display)
     klass->unlock (display);
 }
 
+/**
+ * gst_vaapi_display_lock_context:
+ * @display: a #GstVaapiDisplay
+ * @lock: (nullable): the #GMutex of the VA object the call operates on
+ *
+ * Locks @display for a VA call that only involves one context, whose
+ * lock is @lock, or only one surface or buffer if @lock is %NULL. In
+ * %GST_VAAPI_DISPLAY_LOCK_MODE_GLOBAL mode, this is the same as
+ * gst_vaapi_display_lock().
+ */
+void
+gst_vaapi_display_lock_context (GstVaapiDisplay * display, GMutex * lock)
+{
+  if (gst_vaapi_display_get_lock_mode (display) ==
+      GST_VAAPI_DISPLAY_LOCK_MODE_GLOBAL)
+    gst_vaapi_display_lock (display);
+  else if (lock)
+    g_mutex_lock (lock);
+}
+
+/**
+ * gst_vaapi_display_unlock_context:
+ * @display: a #GstVaapiDisplay
+ * @lock: (nullable): the #GMutex passed to
+ *   gst_vaapi_display_lock_context()
+ *
+ * Unlocks @display locked with gst_vaapi_display_lock_context().
+ */
+void
+gst_vaapi_display_unlock_context (GstVaapiDisplay * display, GMutex * lock)
+{
+  if (gst_vaapi_display_get_lock_mode (display) ==
+      GST_VAAPI_DISPLAY_LOCK_MODE_GLOBAL)
+    gst_vaapi_display_unlock (display);
+  else if (lock)
+    g_mutex_unlock (lock);
+}
+
 /**
  * gst_vaapi_display_sync:
  * @display: a #GstVaapiDisplay
@@ -2033,6 +2209,79 @@ ensure_vendor_string (GstVaapiDisplay * display)
   return priv->vendor_string != NULL;
 }
 
+/* Ensures the identity of the VA driver in the capability cache was
+   computed. Cached capabilities are dropped when any part changes */
+static const gchar *
+ensure_caps_cache_id (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *const priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+
+  /* Derived displays share the VA display of their parent */
+  if (priv->parent)
+    return ensure_caps_cache_id (priv->parent);
+
+  GST_VAAPI_DISPLAY_LOCK (display);
+  if (!priv->caps_cache_id && ensure_vendor_string (display)) {
+    priv->caps_cache_id = g_strdup_printf ("libva %s;type %d;device %s;%s",
+        VA_VERSION_S, GST_VAAPI_DISPLAY_GET_CLASS_TYPE (display),
+        GST_STR_NULL (priv->display_name), priv->vendor_string);
+  }
+  GST_VAAPI_DISPLAY_UNLOCK (display);
+  return priv->caps_cache_id;
+}
+
+/**
+ * gst_vaapi_display_lookup_caps:
+ * @display: a #GstVaapiDisplay
+ * @key: the entry name
+ * @data_ptr: return location for the entry data, to be g_free()'d
+ * @size_ptr: return location for the entry size, in bytes
+ *
+ * Looks up the capability entry @key saved by a previous
+ * gst_vaapi_display_store_caps() call for the same VA driver, possibly
+ * from another display instance or process.
+ *
+ * Return value: %TRUE if the entry was found
+ */
+gboolean
+gst_vaapi_display_lookup_caps (GstVaapiDisplay * display, const gchar * key,
+    gpointer * data_ptr, gsize * size_ptr)
+{
+  const gchar *caps_cache_id;
+
+  g_return_val_if_fail (display != NULL, FALSE);
+
+  caps_cache_id = ensure_caps_cache_id (display);
+  if (!caps_cache_id)
+    return FALSE;
+  return gst_vaapi_caps_cache_lookup (caps_cache_id, key, data_ptr, size_ptr);
+}
+
+/**
+ * gst_vaapi_display_store_caps:
+ * @display: a #GstVaapiDisplay
+ * @key: the entry name
+ * @data: the entry data
+ * @size: the entry size, in bytes
+ *
+ * Saves the result of a VA capability query as the entry @key of the
+ * capability cache, for all displays using the same VA driver. The
+ * cache file is written once the profiles were probed, and again when
+ * @display is released if more entries were saved in the meantime.
+ */
+void
+gst_vaapi_display_store_caps (GstVaapiDisplay * display, const gchar * key,
+    gconstpointer data, gsize size)
+{
+  const gchar *caps_cache_id;
+
+  g_return_if_fail (display != NULL);
+
+  caps_cache_id = ensure_caps_cache_id (display);
+  if (caps_cache_id)
+    gst_vaapi_caps_cache_store (caps_cache_id, key, data, size);
+}
+
 /**
  * gst_vaapi_display_get_vendor_string:
  * @display: a #GstVaapiDisplay
@@ -2102,3 +2351,132 @@ gst_vaapi_display_reset_texture_map (GstVaapiDisplay * display)
   if ((map = klass->get_texture_map (display)))
     gst_vaapi_texture_map_reset (map);
 }
+
+/**
+ * gst_vaapi_display_set_surface_cache_size:
+ * @display: a #GstVaapiDisplay
+ * @max_size: the memory budget, in bytes, or zero to disable the cache
+ *
+ * Sets the amount of memory the surface cache of @display can hold.
+ * Idle surfaces are then kept in the cache when released, instead of
+ * being destroyed, and surfaces allocated with the same format, chroma
+ * type and size are taken from there first. This avoids reallocating
+ * the whole set of decoder surfaces when the stream resolution toggles
+ * between a few values, e.g. on adaptive bitrate switches. The least
+ * recently released surfaces are destroyed to stay within @max_size.
+ *
+ * The default budget is zero, unless the GST_VAAPI_SURFACE_CACHE_SIZE
+ * environment variable holds a size in MiB.
+ *
+ * This function is thread safe.
+ */
+void
+gst_vaapi_display_set_surface_cache_size (GstVaapiDisplay * display,
+    gsize max_size)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (display != NULL);
+
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  if (priv->surface_cache)
+    gst_vaapi_surface_cache_set_max_size (priv->surface_cache, max_size);
+}
+
+/**
+ * gst_vaapi_display_get_surface_cache_size:
+ * @display: a #GstVaapiDisplay
+ *
+ * Returns the memory budget of the surface cache of @display, see
+ * gst_vaapi_display_set_surface_cache_size().
+ *
+ * Return value: the maximum size of the surface cache, in bytes
+ */
+gsize
+gst_vaapi_display_get_surface_cache_size (GstVaapiDisplay * display)
+{
+  GstVaapiSurfaceCacheStats stats;
+
+  gst_vaapi_display_get_surface_cache_stats (display, &stats);
+  return stats.max_size;
+}
+
+/**
+ * gst_vaapi_display_get_surface_cache_stats:
+ * @display: a #GstVaapiDisplay
+ * @stats: return location for the #GstVaapiSurfaceCacheStats
+ *
+ * Retrieves the statistics of the surface cache of @display, e.g. to
+ * check how many surface allocations it saved and whether the budget
+ * is large enough to avoid evictions.
+ *
+ * This function is thread safe.
+ */
+void
+gst_vaapi_display_get_surface_cache_stats (GstVaapiDisplay * display,
+    GstVaapiSurfaceCacheStats * stats)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (stats != NULL);
+
+  memset (stats, 0, sizeof (*stats));
+  g_return_if_fail (display != NULL);
+
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  if (priv->surface_cache)
+    gst_vaapi_surface_cache_get_stats (priv->surface_cache, stats);
+}
+
+/**
+ * gst_vaapi_display_set_lock_mode:
+ * @display: a #GstVaapiDisplay
+ * @mode: the #GstVaapiDisplayLockMode
+ *
+ * Sets how VA calls issued on @display are serialized. The default
+ * %GST_VAAPI_DISPLAY_LOCK_MODE_GLOBAL mode funnels them all through
+ * the display lock. With %GST_VAAPI_DISPLAY_LOCK_MODE_CONTEXT, VA
+ * calls on distinct contexts, e.g. from decoders and encoders sharing
+ * @display, no longer wait for each other, nor for surface syncs. Only
+ * use it if the VA driver is thread-safe.
+ *
+ * The mode is shared with displays derived from @display, and must be
+ * set before any VA object is created on them. The default mode can
+ * also be set with the GST_VAAPI_DISPLAY_LOCK_MODE environment
+ * variable, to "global" or "context".
+ */
+void
+gst_vaapi_display_set_lock_mode (GstVaapiDisplay * display,
+    GstVaapiDisplayLockMode mode)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_if_fail (display != NULL);
+
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  if (priv->parent)
+    priv = GST_VAAPI_DISPLAY_GET_PRIVATE (priv->parent);
+  priv->lock_mode = mode;
+}
+
+/**
+ * gst_vaapi_display_get_lock_mode:
+ * @display: a #GstVaapiDisplay
+ *
+ * Returns how VA calls issued on @display are serialized, see
+ * gst_vaapi_display_set_lock_mode().
+ *
+ * Return value: the #GstVaapiDisplayLockMode of @display
+ */
+GstVaapiDisplayLockMode
+gst_vaapi_display_get_lock_mode (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayPrivate *priv;
+
+  g_return_val_if_fail (display != NULL, GST_VAAPI_DISPLAY_LOCK_MODE_GLOBAL);
+
+  priv = GST_VAAPI_DISPLAY_GET_PRIVATE (display);
+  if (priv->parent)
+    priv = GST_VAAPI_DISPLAY_GET_PRIVATE (priv->parent);
+  return priv->lock_mode;
+}
@@ -86,6 +86,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstVaapiDisplayInfo             GstVaapiDisplayInfo;
 typedef struct _GstVaapiDisplay                 GstVaapiDisplay;
+typedef struct _GstVaapiSurfaceCacheStats       GstVaapiSurfaceCacheStats;
 
 /**
  * GstVaapiDisplayType:
@@ -95,6 +96,8 @@ typedef struct _GstVaapiDisplay                 GstVaapiDisplay;
  * @GST_VAAPI_DISPLAY_TYPE_WAYLAND: VA/Wayland display.
  * @GST_VAAPI_DISPLAY_TYPE_DRM: VA/DRM display.
  * @GST_VAAPI_DISPLAY_TYPE_EGL: VA/EGL display.
+ * @GST_VAAPI_DISPLAY_TYPE_NULL: VA display backed by the in-process
+ *   software driver, for testing without a GPU.
  */
 typedef enum
 {
@@ -104,11 +107,29 @@ typedef enum
   GST_VAAPI_DISPLAY_TYPE_WAYLAND,
   GST_VAAPI_DISPLAY_TYPE_DRM,
   GST_VAAPI_DISPLAY_TYPE_EGL,
+  GST_VAAPI_DISPLAY_TYPE_NULL,
 } GstVaapiDisplayType;
 
 #define GST_VAAPI_TYPE_DISPLAY_TYPE \
     (gst_vaapi_display_type_get_type())
 
+/**
+ * GstVaapiDisplayLockMode:
+ * @GST_VAAPI_DISPLAY_LOCK_MODE_GLOBAL: every locked VA call is
+ *   serialized on the display lock.
+ * @GST_VAAPI_DISPLAY_LOCK_MODE_CONTEXT: VA calls that only involve one
+ *   context take that context lock, VA calls that only involve one
+ *   surface or buffer take no lock, and the display lock is left to
+ *   display-global operations. Requires a thread-safe VA driver.
+ *
+ * How VA calls issued on a #GstVaapiDisplay are serialized.
+ */
+typedef enum
+{
+  GST_VAAPI_DISPLAY_LOCK_MODE_GLOBAL = 0,
+  GST_VAAPI_DISPLAY_LOCK_MODE_CONTEXT,
+} GstVaapiDisplayLockMode;
+
 GType
 gst_vaapi_display_type_get_type (void) G_GNUC_CONST;
 
@@ -132,6 +153,28 @@ struct _GstVaapiDisplayInfo
   gpointer native_display;
 };
 
+/**
+ * GstVaapiSurfaceCacheStats:
+ * @size: the memory held by the cached surfaces, in bytes (estimate).
+ * @max_size: the memory budget of the cache, in bytes.
+ * @num_surfaces: the number of cached surfaces.
+ * @hits: the number of surfaces allocated from the cache.
+ * @misses: the number of surfaces that could not be allocated from the
+ *   cache while it was enabled.
+ * @evictions: the number of surfaces destroyed to stay within budget.
+ *
+ * Statistics of the surface cache of a #GstVaapiDisplay.
+ */
+struct _GstVaapiSurfaceCacheStats
+{
+  gsize size;
+  gsize max_size;
+  guint num_surfaces;
+  guint64 hits;
+  guint64 misses;
+  guint64 evictions;
+};
+
 /**
  * GstVaapiDisplayProperties:
  * @GST_VAAPI_DISPLAY_PROP_RENDER_MODE: rendering mode (#GstVaapiRenderMode).
@@ -251,6 +294,24 @@ gst_vaapi_display_has_opengl (GstVaapiDisplay * display);
 void
 gst_vaapi_display_reset_texture_map (GstVaapiDisplay * display);
 
+void
+gst_vaapi_display_set_surface_cache_size (GstVaapiDisplay * display,
+    gsize max_size);
+
+gsize
+gst_vaapi_display_get_surface_cache_size (GstVaapiDisplay * display);
+
+void
+gst_vaapi_display_get_surface_cache_stats (GstVaapiDisplay * display,
+    GstVaapiSurfaceCacheStats * stats);
+
+void
+gst_vaapi_display_set_lock_mode (GstVaapiDisplay * display,
+    GstVaapiDisplayLockMode mode);
+
+GstVaapiDisplayLockMode
+gst_vaapi_display_get_lock_mode (GstVaapiDisplay * display);
+
 #ifdef G_DEFINE_AUTOPTR_CLEANUP_FUNC
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GstVaapiDisplay, gst_object_unref)
 #endif
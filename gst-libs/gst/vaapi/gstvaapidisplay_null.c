@@ -0,0 +1,248 @@
+/*
+ *  gstvaapidisplay_null.c - VA display backed by a software driver
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapidisplay_null
+ * @short_description: VA display backed by a software driver
+ *
+ * The null display does not need any GPU nor any VA driver module:
+ * it binds an in-process software implementation of the VA driver
+ * interface. Decoders consume bitstreams and produce blank surfaces,
+ * encoders produce packed headers followed by filler payloads, and
+ * every submitted picture completes after a configurable latency.
+ * This makes it possible to exercise and profile the CPU side of the
+ * library (parsers, pools, threading, element logic) on any machine.
+ *
+ * The display options string is a list of comma separated key=value
+ * pairs. The only key currently understood is "latency", the time in
+ * microseconds a picture takes to complete. The GST_VAAPI_NULL_LATENCY
+ * environment variable provides the default value.
+ */
+
+#include "sysdeps.h"
+#include "gstvaapiutils_null.h"
+#include "gstvaapidisplay_priv.h"
+#include "gstvaapidisplay_null.h"
+#include "gstvaapidisplay_null_priv.h"
+#include "gstvaapiwindow_null.h"
+
+#define DEBUG_VAAPI_DISPLAY 1
+#include "gstvaapidebug.h"
+
+G_DEFINE_TYPE_WITH_PRIVATE (GstVaapiDisplayNull, gst_vaapi_display_null,
+    GST_TYPE_VAAPI_DISPLAY);
+
+static guint
+parse_latency (const gchar * str, guint default_value)
+{
+  gchar *end;
+  guint64 value;
+
+  if (!str || !*str)
+    return default_value;
+
+  value = g_ascii_strtoull (str, &end, 10);
+  if (end == str || value > G_MAXUINT) {
+    GST_WARNING ("invalid latency value '%s'", str);
+    return default_value;
+  }
+  return value;
+}
+
+static gboolean
+parse_options (GstVaapiDisplay * display, const gchar * options)
+{
+  GstVaapiDisplayNullPrivate *const priv =
+      GST_VAAPI_DISPLAY_NULL_PRIVATE (display);
+  gchar **tokens;
+  guint i;
+
+  priv->latency = parse_latency (g_getenv ("GST_VAAPI_NULL_LATENCY"), 0);
+  if (!options)
+    return TRUE;
+
+  tokens = g_strsplit (options, ",", -1);
+  for (i = 0; tokens[i] != NULL; i++) {
+    gchar *const token = g_strstrip (tokens[i]);
+
+    if (!*token)
+      continue;
+    if (g_str_has_prefix (token, "latency="))
+      priv->latency = parse_latency (token + 8, priv->latency);
+    else
+      GST_WARNING ("unknown null display option '%s'", token);
+  }
+  g_strfreev (tokens);
+  return TRUE;
+}
+
+static gboolean
+gst_vaapi_display_null_open_display (GstVaapiDisplay * display,
+    const gchar * name)
+{
+  GstVaapiDisplayNullPrivate *const priv =
+      GST_VAAPI_DISPLAY_NULL_PRIVATE (display);
+
+  g_free (priv->options);
+  priv->options = g_strdup (name ? name : "null");
+  return parse_options (display, name);
+}
+
+static void
+gst_vaapi_display_null_close_display (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayNullPrivate *const priv =
+      GST_VAAPI_DISPLAY_NULL_PRIVATE (display);
+
+  g_clear_pointer (&priv->options, g_free);
+}
+
+static gboolean
+gst_vaapi_display_null_get_display_info (GstVaapiDisplay * display,
+    GstVaapiDisplayInfo * info)
+{
+  GstVaapiDisplayNullPrivate *const priv =
+      GST_VAAPI_DISPLAY_NULL_PRIVATE (display);
+
+  info->native_display = NULL;
+  info->display_name = priv->options;
+  if (!info->va_display) {
+    info->va_display = gst_vaapi_null_driver_open ();
+    if (!info->va_display)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+static gboolean
+gst_vaapi_display_null_initialize (GstVaapiDisplay * display)
+{
+  GstVaapiDisplayNullPrivate *const priv =
+      GST_VAAPI_DISPLAY_NULL_PRIVATE (display);
+  VADisplay const va_display = GST_VAAPI_DISPLAY_VADISPLAY (display);
+
+  if (!gst_vaapi_null_driver_initialize (va_display))
+    return FALSE;
+  gst_vaapi_null_driver_set_latency (va_display, priv->latency);
+  return TRUE;
+}
+
+static GstVaapiWindow *
+gst_vaapi_display_null_create_window (GstVaapiDisplay * display,
+    GstVaapiID id, guint width, guint height)
+{
+  return id != GST_VAAPI_ID_INVALID ?
+      NULL : gst_vaapi_window_null_new (display, width, height);
+}
+
+static void
+gst_vaapi_display_null_init (GstVaapiDisplayNull * display)
+{
+  GstVaapiDisplayNullPrivate *const priv =
+      gst_vaapi_display_null_get_instance_private (display);
+
+  display->priv = priv;
+}
+
+static void
+gst_vaapi_display_null_class_init (GstVaapiDisplayNullClass * klass)
+{
+  GstVaapiDisplayClass *const dpy_class = GST_VAAPI_DISPLAY_CLASS (klass);
+
+  dpy_class->display_type = GST_VAAPI_DISPLAY_TYPE_NULL;
+  dpy_class->open_display = gst_vaapi_display_null_open_display;
+  dpy_class->close_display = gst_vaapi_display_null_close_display;
+  dpy_class->initialize = gst_vaapi_display_null_initialize;
+  dpy_class->get_display = gst_vaapi_display_null_get_display_info;
+  dpy_class->create_window = gst_vaapi_display_null_create_window;
+}
+
+/**
+ * gst_vaapi_display_null_new:
+ * @options: (nullable): a comma separated list of key=value options
+ *
+ * Creates a #GstVaapiDisplay bound to the in-process software VA
+ * driver. See the section description for the supported @options.
+ *
+ * Return value: a newly allocated #GstVaapiDisplay object
+ */
+GstVaapiDisplay *
+gst_vaapi_display_null_new (const gchar * options)
+{
+  GstVaapiDisplay *display;
+
+  display = g_object_new (GST_TYPE_VAAPI_DISPLAY_NULL, NULL);
+  return gst_vaapi_display_config (display,
+      GST_VAAPI_DISPLAY_INIT_FROM_DISPLAY_NAME, (gpointer) options);
+}
+
+/**
+ * gst_vaapi_display_null_set_latency:
+ * @display: a #GstVaapiDisplayNull
+ * @latency: the per-picture latency, in microseconds
+ *
+ * Changes the time each picture takes to complete. Pictures submitted
+ * to the same VA context are processed one after another, so this
+ * also bounds the throughput of a single decoder or encoder.
+ */
+void
+gst_vaapi_display_null_set_latency (GstVaapiDisplayNull * display,
+    guint latency)
+{
+  g_return_if_fail (GST_VAAPI_IS_DISPLAY_NULL (display));
+
+  GST_VAAPI_DISPLAY_NULL_PRIVATE (display)->latency = latency;
+  gst_vaapi_null_driver_set_latency (GST_VAAPI_DISPLAY_VADISPLAY (display),
+      latency);
+}
+
+/**
+ * gst_vaapi_display_null_get_latency:
+ * @display: a #GstVaapiDisplayNull
+ *
+ * Return value: the per-picture latency, in microseconds
+ */
+guint
+gst_vaapi_display_null_get_latency (GstVaapiDisplayNull * display)
+{
+  g_return_val_if_fail (GST_VAAPI_IS_DISPLAY_NULL (display), 0);
+
+  return GST_VAAPI_DISPLAY_NULL_PRIVATE (display)->latency;
+}
+
+/**
+ * gst_vaapi_display_null_get_statistics:
+ * @display: a #GstVaapiDisplayNull
+ *
+ * Returns the software driver counters: number of surfaces and
+ * buffers created, pictures submitted, vaRenderPicture() and
+ * vaSyncSurface() calls, cumulated time spent waiting in
+ * vaSyncSurface() (in microseconds), and coded bytes produced.
+ *
+ * Return value: (transfer full): a newly allocated #GstStructure
+ */
+GstStructure *
+gst_vaapi_display_null_get_statistics (GstVaapiDisplayNull * display)
+{
+  g_return_val_if_fail (GST_VAAPI_IS_DISPLAY_NULL (display), NULL);
+
+  return
+      gst_vaapi_null_driver_get_statistics (GST_VAAPI_DISPLAY_VADISPLAY
+      (display));
+}
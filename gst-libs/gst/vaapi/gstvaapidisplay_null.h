@@ -0,0 +1,51 @@
+/*
+ *  gstvaapidisplay_null.h - VA display backed by a software driver
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_DISPLAY_NULL_H
+#define GST_VAAPI_DISPLAY_NULL_H
+
+#include <gst/vaapi/gstvaapidisplay.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VAAPI_DISPLAY_NULL             (gst_vaapi_display_null_get_type ())
+#define GST_VAAPI_DISPLAY_NULL(obj) \
+    (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_VAAPI_DISPLAY_NULL, GstVaapiDisplayNull))
+
+typedef struct _GstVaapiDisplayNull             GstVaapiDisplayNull;
+
+GstVaapiDisplay *
+gst_vaapi_display_null_new (const gchar * options);
+
+void
+gst_vaapi_display_null_set_latency (GstVaapiDisplayNull * display,
+    guint latency);
+
+guint
+gst_vaapi_display_null_get_latency (GstVaapiDisplayNull * display);
+
+GstStructure *
+gst_vaapi_display_null_get_statistics (GstVaapiDisplayNull * display);
+
+GType
+gst_vaapi_display_null_get_type (void) G_GNUC_CONST;
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_DISPLAY_NULL_H */
@@ -0,0 +1,72 @@
+/*
+ *  gstvaapidisplay_null_priv.h - Internal VA/null interface
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_DISPLAY_NULL_PRIV_H
+#define GST_VAAPI_DISPLAY_NULL_PRIV_H
+
+#include <gst/vaapi/gstvaapidisplay_null.h>
+#include "gstvaapidisplay_priv.h"
+
+G_BEGIN_DECLS
+
+#define GST_VAAPI_IS_DISPLAY_NULL(display) \
+    (G_TYPE_CHECK_INSTANCE_TYPE ((display), GST_TYPE_VAAPI_DISPLAY_NULL))
+
+#define GST_VAAPI_DISPLAY_NULL_CAST(display) \
+    ((GstVaapiDisplayNull *)(display))
+
+#define GST_VAAPI_DISPLAY_NULL_PRIVATE(display) \
+    (GST_VAAPI_DISPLAY_NULL_CAST(display)->priv)
+
+typedef struct _GstVaapiDisplayNullPrivate      GstVaapiDisplayNullPrivate;
+typedef struct _GstVaapiDisplayNullClass        GstVaapiDisplayNullClass;
+
+struct _GstVaapiDisplayNullPrivate
+{
+  gchar *options;
+  guint latency;                // Per-picture latency, in microseconds
+};
+
+/**
+ * GstVaapiDisplayNull:
+ *
+ * VA display backed by the in-process software driver.
+ */
+struct _GstVaapiDisplayNull
+{
+  /*< private >*/
+  GstVaapiDisplay parent_instance;
+
+  GstVaapiDisplayNullPrivate *priv;
+};
+
+/**
+ * GstVaapiDisplayNullClass:
+ *
+ * VA/null display wrapper class.
+ */
+struct _GstVaapiDisplayNullClass
+{
+  /*< private >*/
+  GstVaapiDisplayClass parent_class;
+};
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_DISPLAY_NULL_PRIV_H */
@@ -30,6 +30,7 @@
 #include <gst/vaapi/gstvaapitexture.h>
 #include <gst/vaapi/gstvaapitexturemap.h>
 #include "gstvaapiminiobject.h"
+#include "gstvaapisurfacecache.h"
 
 G_BEGIN_DECLS
 
@@ -107,6 +108,29 @@ typedef enum _GstVaapiDisplayInitType           GstVaapiDisplayInitType;
 #define GST_VAAPI_DISPLAY_HAS_VPP(display) \
   gst_vaapi_display_has_video_processing (GST_VAAPI_DISPLAY_CAST (display))
 
+/**
+ * GST_VAAPI_DISPLAY_LOCK_CONTEXT:
+ * @display: a #GstVaapiDisplay
+ * @lock: (nullable): a #GMutex, or %NULL
+ *
+ * Locks @display for a VA call that only involves the VA object
+ * protected by @lock, or a single surface or buffer if @lock is %NULL.
+ * This is an internal macro that does not do any run-time type check.
+ */
+#define GST_VAAPI_DISPLAY_LOCK_CONTEXT(display, lock) \
+  gst_vaapi_display_lock_context (GST_VAAPI_DISPLAY_CAST (display), lock)
+
+/**
+ * GST_VAAPI_DISPLAY_UNLOCK_CONTEXT:
+ * @display: a #GstVaapiDisplay
+ * @lock: (nullable): a #GMutex, or %NULL
+ *
+ * Unlocks @display locked with GST_VAAPI_DISPLAY_LOCK_CONTEXT().
+ * This is an internal macro that does not do any run-time type check.
+ */
+#define GST_VAAPI_DISPLAY_UNLOCK_CONTEXT(display, lock) \
+  gst_vaapi_display_unlock_context (GST_VAAPI_DISPLAY_CAST (display), lock)
+
 struct _GstVaapiDisplayPrivate
 {
   GstVaapiDisplay *parent;
@@ -126,6 +150,9 @@ struct _GstVaapiDisplayPrivate
   GArray *subpicture_formats;
   GArray *properties;
   gchar *vendor_string;
+  gchar *caps_cache_id;
+  GstVaapiSurfaceCache *surface_cache;
+  GstVaapiDisplayLockMode lock_mode;
   guint use_foreign_display:1;
   guint has_vpp:1;
   guint has_profiles:1;
@@ -149,6 +176,8 @@ struct _GstVaapiDisplay
  * GstVaapiDisplayClass:
  * @open_display: virtual function to open a display
  * @close_display: virtual function to close a display
+ * @initialize: (optional) virtual function to initialize the VA
+ *   display, defaults to vaInitialize()
  * @lock: (optional) virtual function to lock a display
  * @unlock: (optional) virtual function to unlock a display
  * @sync: (optional) virtual function to sync a display
@@ -177,6 +206,7 @@ struct _GstVaapiDisplayClass
   gboolean            (*bind_display)    (GstVaapiDisplay * display, gpointer native_dpy);
   gboolean            (*open_display)    (GstVaapiDisplay * display, const gchar * name);
   void                (*close_display)   (GstVaapiDisplay * display);
+  gboolean            (*initialize)      (GstVaapiDisplay * display);
   void                (*lock)            (GstVaapiDisplay * display);
   void                (*unlock)          (GstVaapiDisplay * display);
   void                (*sync)            (GstVaapiDisplay * display);
@@ -204,6 +234,24 @@ GstVaapiDisplay *
 gst_vaapi_display_config (GstVaapiDisplay * display,
     GstVaapiDisplayInitType init_type, gpointer init_value);
 
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_lock_context (GstVaapiDisplay * display, GMutex * lock);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_unlock_context (GstVaapiDisplay * display, GMutex * lock);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_display_lookup_caps (GstVaapiDisplay * display, const gchar * key,
+    gpointer * data_ptr, gsize * size_ptr);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_display_store_caps (GstVaapiDisplay * display, const gchar * key,
+    gconstpointer data, gsize size);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_DISPLAY_PRIV_H */
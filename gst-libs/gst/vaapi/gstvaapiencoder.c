@@ -25,6 +25,7 @@
 #include "gstvaapicompat.h"
 #include "gstvaapiencoder.h"
 #include "gstvaapiencoder_priv.h"
+#include "gstvaapicodedbufferproxy_priv.h"
 #include "gstvaapicontext.h"
 #include "gstvaapidisplay_priv.h"
 #include "gstvaapiutils.h"
@@ -34,6 +35,10 @@
 #define DEBUG 1
 #include "gstvaapidebug.h"
 
+/* Maximum time a submitted picture is held back by the reaper thread
+   while it waits for async-depth pictures to be queued, in microseconds */
+#define REAPER_MAX_HOLD_TIME 100000
+
 gboolean
 gst_vaapi_encoder_ensure_param_quality_level (GstVaapiEncoder * encoder,
     GstVaapiEncPicture * picture)
@@ -239,6 +244,27 @@ gst_vaapi_encoder_replace (GstVaapiEncoder ** old_encoder_ptr,
       (GstObject *) new_encoder);
 }
 
+/* Tracks threads blocked on a resource held by pending pictures, so
+   that the reaper thread completes them without waiting for more */
+static inline void
+gst_vaapi_encoder_block_unlocked (GstVaapiEncoder * encoder, gboolean blocked)
+{
+  if (blocked) {
+    encoder->num_blocked++;
+    g_cond_broadcast (&encoder->codedbuf_ready);
+  } else
+    encoder->num_blocked--;
+}
+
+/* Coded buffers stay allocated while the reaper holds them, so the
+   pool needs room for the submitted pictures plus the ones being
+   encoded and retrieved, and the ones held downstream on output */
+static guint
+get_codedbuf_pool_capacity (GstVaapiEncoder * encoder)
+{
+  return MAX (5, encoder->async_depth + 2) + encoder->output_hold;
+}
+
 /* Notifies gst_vaapi_encoder_create_coded_buffer() that a new buffer is free */
 static void
 _coded_buffer_proxy_released_notify (GstVaapiEncoder * encoder)
@@ -263,7 +289,9 @@ gst_vaapi_encoder_create_coded_buffer (GstVaapiEncoder * encoder)
       break;
 
     /* Wait for a free coded buffer to become available */
+    gst_vaapi_encoder_block_unlocked (encoder, TRUE);
     g_cond_wait (&encoder->codedbuf_free, &encoder->mutex);
+    gst_vaapi_encoder_block_unlocked (encoder, FALSE);
     codedbuf_proxy = gst_vaapi_coded_buffer_proxy_new_from_pool (pool);
   } while (0);
   g_mutex_unlock (&encoder->mutex);
@@ -295,12 +323,15 @@ gst_vaapi_encoder_create_surface (GstVaapiEncoder * encoder)
 
   g_mutex_lock (&encoder->mutex);
   for (;;) {
-    proxy = gst_vaapi_context_get_surface_proxy (encoder->context);
+    proxy = gst_vaapi_context_get_surface_proxy (encoder->context,
+        encoder->object_arena);
     if (proxy)
       break;
 
     /* Wait for a free surface proxy to become available */
+    gst_vaapi_encoder_block_unlocked (encoder, TRUE);
     g_cond_wait (&encoder->surface_free, &encoder->mutex);
+    gst_vaapi_encoder_block_unlocked (encoder, FALSE);
   }
   g_mutex_unlock (&encoder->mutex);
 
@@ -309,9 +340,200 @@ gst_vaapi_encoder_create_surface (GstVaapiEncoder * encoder)
   return proxy;
 }
 
+/* Waits until fewer than max-inflight frames are submitted and not
+   retrieved yet, or until the encoder is set flushing */
+static void
+gst_vaapi_encoder_wait_inflight (GstVaapiEncoder * encoder)
+{
+  g_mutex_lock (&encoder->mutex);
+  while (encoder->max_inflight > 0 &&
+      encoder->num_inflight >= encoder->max_inflight && !encoder->flushing) {
+    gst_vaapi_encoder_block_unlocked (encoder, TRUE);
+    g_cond_wait (&encoder->inflight_free, &encoder->mutex);
+    gst_vaapi_encoder_block_unlocked (encoder, FALSE);
+  }
+  g_mutex_unlock (&encoder->mutex);
+}
+
+static void
+latency_add_sample (GstVaapiEncoderLatency * latency, gint64 value)
+{
+  guint i;
+
+  value = MAX (value, 0);
+  if (latency->count == 0 || (guint64) value < latency->min)
+    latency->min = value;
+  if ((guint64) value > latency->max)
+    latency->max = value;
+  latency->count++;
+  latency->sum += value;
+
+  for (i = 0; i < GST_VAAPI_ENCODER_LATENCY_BUCKETS - 1; i++) {
+    if (value < (250 << i))
+      break;
+  }
+  latency->buckets[i]++;
+}
+
+static void
+latency_set_structure (const GstVaapiEncoderLatency * latency,
+    GstStructure * structure, const gchar * prefix)
+{
+  GValue histogram = G_VALUE_INIT;
+  GValue bucket = G_VALUE_INIT;
+  gchar name[64];
+  guint i;
+
+  g_value_init (&histogram, GST_TYPE_ARRAY);
+  g_value_init (&bucket, G_TYPE_UINT64);
+  for (i = 0; i < GST_VAAPI_ENCODER_LATENCY_BUCKETS; i++) {
+    g_value_set_uint64 (&bucket, latency->buckets[i]);
+    gst_value_array_append_value (&histogram, &bucket);
+  }
+  g_value_unset (&bucket);
+
+  g_snprintf (name, sizeof (name), "%s-histogram", prefix);
+  gst_structure_take_value (structure, name, &histogram);
+
+  g_snprintf (name, sizeof (name), "%s-min", prefix);
+  gst_structure_set (structure, name, G_TYPE_UINT64, latency->min, NULL);
+  g_snprintf (name, sizeof (name), "%s-max", prefix);
+  gst_structure_set (structure, name, G_TYPE_UINT64, latency->max, NULL);
+  g_snprintf (name, sizeof (name), "%s-avg", prefix);
+  gst_structure_set (structure, name, G_TYPE_UINT64,
+      latency->count ? latency->sum / latency->count : 0, NULL);
+}
+
+/* Waits for the completion of the picture attached to @codedbuf_proxy,
+   then replaces it with its parent frame. On error, the user data is
+   cleared */
+static gboolean
+gst_vaapi_encoder_complete_coded_buffer (GstVaapiEncoder * encoder,
+    GstVaapiCodedBufferProxy * codedbuf_proxy)
+{
+  GstVaapiEncPicture *picture;
+  gint64 sync_time, done_time;
+  gboolean success;
+
+  picture = gst_vaapi_coded_buffer_proxy_get_user_data (codedbuf_proxy);
+  sync_time = g_get_monotonic_time ();
+  success = gst_vaapi_surface_sync (picture->surface);
+  done_time = g_get_monotonic_time ();
+
+  if (!success) {
+    gst_vaapi_coded_buffer_proxy_set_user_data (codedbuf_proxy, NULL, NULL);
+    return FALSE;
+  }
+
+  g_mutex_lock (&encoder->mutex);
+  latency_add_sample (&encoder->encode_latency,
+      done_time - picture->submit_time);
+  latency_add_sample (&encoder->sync_latency, done_time - sync_time);
+  g_mutex_unlock (&encoder->mutex);
+
+  if (encoder->lookahead)
+    gst_vaapi_encoder_lookahead_add_coded_size (encoder->lookahead,
+        picture->frame, gst_vaapi_coded_buffer_get_size
+        (GST_VAAPI_CODED_BUFFER_PROXY_BUFFER (codedbuf_proxy)));
+
+  gst_vaapi_coded_buffer_proxy_set_user_data (codedbuf_proxy,
+      gst_video_codec_frame_ref (picture->frame),
+      (GDestroyNotify) gst_video_codec_frame_unref);
+  return TRUE;
+}
+
+/* Whether the reaper thread shall complete the oldest pending picture
+   now. Otherwise, *deadline is set to the time it shall do it anyway */
+static gboolean
+reaper_can_complete_unlocked (GstVaapiEncoder * encoder, gint64 * deadline)
+{
+  GstVaapiCodedBufferProxy *const codedbuf_proxy =
+      g_queue_peek_head (&encoder->codedbuf_queue);
+  GstVaapiEncPicture *picture;
+
+  if (encoder->flushing || encoder->draining || encoder->num_blocked > 0)
+    return TRUE;
+  if (encoder->codedbuf_queue.length >= encoder->async_depth)
+    return TRUE;
+
+  /* Don't hold pictures back forever if upstream stalls */
+  picture = gst_vaapi_coded_buffer_proxy_get_user_data (codedbuf_proxy);
+  *deadline = picture->submit_time + REAPER_MAX_HOLD_TIME;
+  return g_get_monotonic_time () >= *deadline;
+}
+
+/* Keeps async-depth pictures submitted to the hardware, then waits
+   for the completion of the oldest one and maps its coded buffer, so
+   that the output thread never blocks on the hardware */
+static gpointer
+gst_vaapi_encoder_reaper_thread (GstVaapiEncoder * encoder)
+{
+  GstVaapiCodedBufferProxy *codedbuf_proxy;
+  VACodedBufferSegment *segment;
+  gint64 deadline;
+
+  g_mutex_lock (&encoder->mutex);
+  while (!encoder->reaper_quit) {
+    if (g_queue_is_empty (&encoder->codedbuf_queue)) {
+      g_cond_wait (&encoder->codedbuf_ready, &encoder->mutex);
+      continue;
+    }
+    if (!reaper_can_complete_unlocked (encoder, &deadline)) {
+      g_cond_wait_until (&encoder->codedbuf_ready, &encoder->mutex, deadline);
+      continue;
+    }
+
+    codedbuf_proxy = g_queue_pop_head (&encoder->codedbuf_queue);
+    encoder->num_reaping++;
+    g_mutex_unlock (&encoder->mutex);
+
+    if (gst_vaapi_encoder_complete_coded_buffer (encoder, codedbuf_proxy))
+      gst_vaapi_coded_buffer_map (GST_VAAPI_CODED_BUFFER_PROXY_BUFFER
+          (codedbuf_proxy), &segment);
+
+    g_mutex_lock (&encoder->mutex);
+    encoder->num_reaping--;
+    g_queue_push_tail (&encoder->codedbuf_done_queue, codedbuf_proxy);
+    g_cond_broadcast (&encoder->codedbuf_done);
+  }
+  g_mutex_unlock (&encoder->mutex);
+  return NULL;
+}
+
+static gboolean
+gst_vaapi_encoder_ensure_reaper_thread (GstVaapiEncoder * encoder)
+{
+  if (encoder->async_depth == 0 || encoder->reaper_thread)
+    return TRUE;
+
+  encoder->reaper_thread = g_thread_try_new ("vaapiencoder-reaper",
+      (GThreadFunc) gst_vaapi_encoder_reaper_thread, encoder, NULL);
+  if (!encoder->reaper_thread) {
+    GST_WARNING ("failed to create reaper thread, completing synchronously");
+    encoder->async_depth = 0;
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void
+gst_vaapi_encoder_stop_reaper_thread (GstVaapiEncoder * encoder)
+{
+  if (!encoder->reaper_thread)
+    return;
+
+  g_mutex_lock (&encoder->mutex);
+  encoder->reaper_quit = TRUE;
+  g_cond_broadcast (&encoder->codedbuf_ready);
+  g_mutex_unlock (&encoder->mutex);
+
+  g_thread_join (encoder->reaper_thread);
+  encoder->reaper_thread = NULL;
+}
+
 /* Create a coded buffer proxy where the picture is going to be
  * decoded, the subclass encode vmethod is called and, if it doesn't
- * fail, the coded buffer is pushed into the async queue */
+ * fail, the coded buffer is pushed into the output queue */
 static GstVaapiEncoderStatus
 gst_vaapi_encoder_encode_and_queue (GstVaapiEncoder * encoder,
     GstVaapiEncPicture * picture)
@@ -320,18 +542,27 @@ gst_vaapi_encoder_encode_and_queue (GstVaapiEncoder * encoder,
   GstVaapiCodedBufferProxy *codedbuf_proxy;
   GstVaapiEncoderStatus status;
 
+  gst_vaapi_encoder_ensure_reaper_thread (encoder);
+  gst_vaapi_encoder_wait_inflight (encoder);
+
   codedbuf_proxy = gst_vaapi_encoder_create_coded_buffer (encoder);
   if (!codedbuf_proxy)
     goto error_create_coded_buffer;
 
+  picture->submit_time = g_get_monotonic_time ();
   status = klass->encode (encoder, picture, codedbuf_proxy);
   if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
     goto error_encode;
 
   gst_vaapi_coded_buffer_proxy_set_user_data (codedbuf_proxy,
       picture, (GDestroyNotify) gst_vaapi_mini_object_unref);
-  g_async_queue_push (encoder->codedbuf_queue, codedbuf_proxy);
+
+  g_mutex_lock (&encoder->mutex);
+  g_queue_push_tail (&encoder->codedbuf_queue, codedbuf_proxy);
   encoder->num_codedbuf_queued++;
+  encoder->num_inflight++;
+  g_cond_broadcast (&encoder->codedbuf_ready);
+  g_mutex_unlock (&encoder->mutex);
 
   return status;
 
@@ -349,18 +580,9 @@ error_encode:
   }
 }
 
-/**
- * gst_vaapi_encoder_put_frame:
- * @encoder: a #GstVaapiEncoder
- * @frame: a #GstVideoCodecFrame
- *
- * Queues a #GstVideoCodedFrame to the HW encoder. The encoder holds
- * an extra reference to the @frame.
- *
- * Return value: a #GstVaapiEncoderStatus
- */
-GstVaapiEncoderStatus
-gst_vaapi_encoder_put_frame (GstVaapiEncoder * encoder,
+/* Reorders @frame, then encodes every picture that became ready */
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_reorder_and_encode (GstVaapiEncoder * encoder,
     GstVideoCodecFrame * frame)
 {
   GstVaapiEncoderClass *const klass = GST_VAAPI_ENCODER_GET_CLASS (encoder);
@@ -378,6 +600,7 @@ gst_vaapi_encoder_put_frame (GstVaapiEncoder * encoder,
     status = gst_vaapi_encoder_encode_and_queue (encoder, picture);
     if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
       goto error_encode;
+    gst_vaapi_mini_object_arena_mark_frame (encoder->object_arena);
 
     /* Try again with any pending reordered frame now available for encoding */
     frame = NULL;
@@ -397,6 +620,46 @@ error_encode:
   }
 }
 
+/* Encodes the frames the lookahead is done with */
+static GstVaapiEncoderStatus
+gst_vaapi_encoder_pop_lookahead (GstVaapiEncoder * encoder, gboolean drain)
+{
+  GstVaapiEncoderStatus status = GST_VAAPI_ENCODER_STATUS_SUCCESS;
+  GstVideoCodecFrame *frame;
+
+  while (status == GST_VAAPI_ENCODER_STATUS_SUCCESS &&
+      (frame = gst_vaapi_encoder_lookahead_pop (encoder->lookahead, drain))) {
+    status = gst_vaapi_encoder_reorder_and_encode (encoder, frame);
+    gst_video_codec_frame_unref (frame);
+  }
+  return status;
+}
+
+/**
+ * gst_vaapi_encoder_put_frame:
+ * @encoder: a #GstVaapiEncoder
+ * @frame: a #GstVideoCodecFrame
+ *
+ * Queues a #GstVideoCodedFrame to the HW encoder. The encoder holds
+ * an extra reference to the @frame.
+ *
+ * Return value: a #GstVaapiEncoderStatus
+ */
+GstVaapiEncoderStatus
+gst_vaapi_encoder_put_frame (GstVaapiEncoder * encoder,
+    GstVideoCodecFrame * frame)
+{
+  g_mutex_lock (&encoder->mutex);
+  encoder->draining = FALSE;
+  g_mutex_unlock (&encoder->mutex);
+
+  if (encoder->lookahead) {
+    gst_vaapi_encoder_lookahead_push (encoder->lookahead, frame);
+    return gst_vaapi_encoder_pop_lookahead (encoder, FALSE);
+  }
+  return gst_vaapi_encoder_reorder_and_encode (encoder, frame);
+}
+
 /**
  * gst_vaapi_encoder_get_buffer_with_timeout:
  * @encoder: a #GstVaapiEncoder
@@ -409,6 +672,10 @@ error_encode:
  * after usage. Otherwise, @GST_VAAPI_DECODER_STATUS_ERROR_NO_BUFFER
  * is returned if no coded buffer is available so far (timeout).
  *
+ * A @timeout of %G_MAXUINT64 waits until the next coded buffer is
+ * submitted, so that it is returned as soon as its surface is
+ * completed. Waiting is interrupted by gst_vaapi_encoder_set_flushing().
+ *
  * The parent frame is available as a #GstVideoCodecFrame attached to
  * the user-data anchor of the output coded buffer. Ownership of the
  * frame is transferred to the coded buffer.
@@ -419,21 +686,63 @@ GstVaapiEncoderStatus
 gst_vaapi_encoder_get_buffer_with_timeout (GstVaapiEncoder * encoder,
     GstVaapiCodedBufferProxy ** out_codedbuf_proxy_ptr, guint64 timeout)
 {
-  GstVaapiEncPicture *picture;
   GstVaapiCodedBufferProxy *codedbuf_proxy;
+  GQueue *queue;
+  GCond *cond;
+  gint64 end_time = 0;
+  gboolean async, pending, success;
+
+  if (timeout != G_MAXUINT64)
+    end_time = g_get_monotonic_time () + MIN (timeout, G_MAXINT64 / 2);
+
+  g_mutex_lock (&encoder->mutex);
+  async = encoder->reaper_thread != NULL;
+  if (async) {
+    queue = &encoder->codedbuf_done_queue;
+    cond = &encoder->codedbuf_done;
+  } else {
+    queue = &encoder->codedbuf_queue;
+    cond = &encoder->codedbuf_ready;
+  }
 
-  codedbuf_proxy = g_async_queue_timeout_pop (encoder->codedbuf_queue, timeout);
+  for (;;) {
+    codedbuf_proxy = g_queue_pop_head (queue);
+    if (codedbuf_proxy || encoder->flushing)
+      break;
+
+    /* Pictures already submitted are waited for, as in synchronous
+       mode, where they are completed right away */
+    pending = async && (encoder->num_reaping > 0 ||
+        !g_queue_is_empty (&encoder->codedbuf_queue));
+    if (timeout == 0 && !pending)
+      break;
+
+    if (timeout == G_MAXUINT64 || pending)
+      g_cond_wait (cond, &encoder->mutex);
+    else if (!g_cond_wait_until (cond, &encoder->mutex, end_time)) {
+      codedbuf_proxy = g_queue_pop_head (queue);
+      break;
+    }
+  }
+  g_mutex_unlock (&encoder->mutex);
   if (!codedbuf_proxy)
     return GST_VAAPI_ENCODER_STATUS_NO_BUFFER;
 
   /* Wait for completion of all operations and report any error that occurred */
-  picture = gst_vaapi_coded_buffer_proxy_get_user_data (codedbuf_proxy);
-  if (!gst_vaapi_surface_sync (picture->surface))
-    goto error_invalid_buffer;
+  if (async)
+    success = gst_vaapi_coded_buffer_proxy_get_user_data (codedbuf_proxy) !=
+        NULL;
+  else
+    success = gst_vaapi_encoder_complete_coded_buffer (encoder,
+        codedbuf_proxy);
 
-  gst_vaapi_coded_buffer_proxy_set_user_data (codedbuf_proxy,
-      gst_video_codec_frame_ref (picture->frame),
-      (GDestroyNotify) gst_video_codec_frame_unref);
+  g_mutex_lock (&encoder->mutex);
+  encoder->num_inflight--;
+  g_cond_signal (&encoder->inflight_free);
+  g_mutex_unlock (&encoder->mutex);
+
+  if (!success)
+    goto error_invalid_buffer;
 
   if (out_codedbuf_proxy_ptr)
     *out_codedbuf_proxy_ptr = gst_vaapi_coded_buffer_proxy_ref (codedbuf_proxy);
@@ -476,6 +785,12 @@ gst_vaapi_encoder_flush (GstVaapiEncoder * encoder)
   GstVaapiEncoderStatus status;
   gpointer iter = NULL;
 
+  if (encoder->lookahead) {
+    status = gst_vaapi_encoder_pop_lookahead (encoder, TRUE);
+    if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+      return status;
+  }
+
   picture = NULL;
   while (_get_pending_reordered (encoder, &picture, &iter)) {
     if (!picture)
@@ -486,6 +801,12 @@ gst_vaapi_encoder_flush (GstVaapiEncoder * encoder)
   }
   g_free (iter);
 
+  /* Let the reaper thread complete every picture submitted so far */
+  g_mutex_lock (&encoder->mutex);
+  encoder->draining = TRUE;
+  g_cond_broadcast (&encoder->codedbuf_ready);
+  g_mutex_unlock (&encoder->mutex);
+
   return klass->flush (encoder);
 
   /* ERRORS */
@@ -496,6 +817,152 @@ error_encode:
   }
 }
 
+/**
+ * gst_vaapi_encoder_set_flushing:
+ * @encoder: a #GstVaapiEncoder
+ * @flushing: whether the @encoder is flushing
+ *
+ * While the @encoder is flushing, gst_vaapi_encoder_put_frame() does
+ * not wait for the number of frames in flight to drop below
+ * #GstVaapiEncoder:max-inflight, and
+ * gst_vaapi_encoder_get_buffer_with_timeout() returns as soon as no
+ * coded buffer is available. Setting @flushing to %TRUE wakes up any
+ * thread blocked in those functions.
+ */
+void
+gst_vaapi_encoder_set_flushing (GstVaapiEncoder * encoder, gboolean flushing)
+{
+  g_return_if_fail (GST_VAAPI_IS_ENCODER (encoder));
+
+  g_mutex_lock (&encoder->mutex);
+  encoder->flushing = flushing;
+  g_cond_broadcast (&encoder->codedbuf_ready);
+  g_cond_broadcast (&encoder->codedbuf_done);
+  g_cond_broadcast (&encoder->inflight_free);
+  g_mutex_unlock (&encoder->mutex);
+}
+
+/**
+ * gst_vaapi_encoder_set_async_depth:
+ * @encoder: a #GstVaapiEncoder
+ * @async_depth: the number of pictures to keep submitted
+ *
+ * Sets the number of pictures the @encoder keeps submitted to the
+ * hardware before it waits for the completion of the oldest one. If
+ * @async_depth is not zero, a dedicated thread waits for completion
+ * and maps the coded buffers, so that
+ * gst_vaapi_encoder_get_buffer_with_timeout() does not block on the
+ * hardware. A picture is never held back for more than 100 ms, nor
+ * while gst_vaapi_encoder_put_frame() waits for resources.
+ *
+ * Note: the @async_depth can only be changed before the first frame
+ * is encoded. Afterwards, any change to this parameter causes this
+ * function to return @GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED.
+ *
+ * Return value: a #GstVaapiEncoderStatus
+ */
+GstVaapiEncoderStatus
+gst_vaapi_encoder_set_async_depth (GstVaapiEncoder * encoder,
+    guint async_depth)
+{
+  g_return_val_if_fail (encoder != NULL, 0);
+
+  if (encoder->async_depth != async_depth && encoder->num_codedbuf_queued > 0)
+    goto error_operation_failed;
+
+  encoder->async_depth = async_depth;
+  if (encoder->codedbuf_pool)
+    gst_vaapi_video_pool_set_capacity (encoder->codedbuf_pool,
+        get_codedbuf_pool_capacity (encoder));
+  return GST_VAAPI_ENCODER_STATUS_SUCCESS;
+
+  /* ERRORS */
+error_operation_failed:
+  {
+    GST_ERROR ("could not change async depth after encoding started");
+    return GST_VAAPI_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+  }
+}
+
+/**
+ * gst_vaapi_encoder_set_output_hold:
+ * @encoder: a #GstVaapiEncoder
+ * @num_buffers: the number of coded buffers held after output
+ *
+ * Declares how many coded buffers the caller keeps alive after they
+ * were retrieved with gst_vaapi_encoder_get_buffer_with_timeout(),
+ * e.g. because their data is handed out downstream without copying.
+ * The coded buffer pool is enlarged accordingly, so that the @encoder
+ * never waits for a buffer the caller holds. This can be changed at
+ * any time.
+ */
+void
+gst_vaapi_encoder_set_output_hold (GstVaapiEncoder * encoder,
+    guint num_buffers)
+{
+  g_return_if_fail (encoder != NULL);
+
+  g_mutex_lock (&encoder->mutex);
+  encoder->output_hold = num_buffers;
+  if (encoder->codedbuf_pool)
+    gst_vaapi_video_pool_set_capacity (encoder->codedbuf_pool,
+        get_codedbuf_pool_capacity (encoder));
+  /* Wake up gst_vaapi_encoder_create_coded_buffer() */
+  g_cond_broadcast (&encoder->codedbuf_free);
+  g_mutex_unlock (&encoder->mutex);
+}
+
+/**
+ * gst_vaapi_encoder_get_stats:
+ * @encoder: a #GstVaapiEncoder
+ *
+ * Returns the output statistics of the @encoder: the number of coded
+ * buffers retrieved ("frames"), the number of frames currently in
+ * flight ("inflight"), and two latency distributions, in
+ * microseconds. "encode-latency-*" measures the time from the
+ * submission of a picture to the completion of its surface, and
+ * "sync-latency-*" the time spent blocked in vaSyncSurface(). Each
+ * distribution has "-min", "-avg" and "-max" fields, and a
+ * "-histogram" array where bucket i counts the samples below
+ * 250 << i microseconds, the last bucket counting the remaining ones.
+ * "object-allocs" counts the per-frame objects allocated so far, and
+ * "object-heap-allocs" and "object-heap-allocs-last-frame" how many of
+ * them could not be recycled, overall and for the last submitted frame.
+ * With lookahead rate control, "lookahead-depth",
+ * "lookahead-frames", "lookahead-qp-avg", "lookahead-coded-bits" and
+ * "lookahead-wanted-bits" report the frames whose QP it chose, their
+ * average QP, and their size against the target bitrate.
+ *
+ * Return value: (transfer full): a newly allocated #GstStructure
+ */
+GstStructure *
+gst_vaapi_encoder_get_stats (GstVaapiEncoder * encoder)
+{
+  GstVaapiMiniObjectArenaStats object_stats;
+  GstStructure *stats;
+
+  g_return_val_if_fail (GST_VAAPI_IS_ENCODER (encoder), NULL);
+
+  gst_vaapi_mini_object_arena_get_stats (encoder->object_arena,
+      &object_stats);
+
+  g_mutex_lock (&encoder->mutex);
+  stats = gst_structure_new ("application/x-vaapi-encoder-stats",
+      "frames", G_TYPE_UINT64, encoder->encode_latency.count,
+      "inflight", G_TYPE_UINT, encoder->num_inflight,
+      "object-allocs", G_TYPE_UINT64, object_stats.num_allocs,
+      "object-heap-allocs", G_TYPE_UINT64, object_stats.num_heap_allocs,
+      "object-heap-allocs-last-frame", G_TYPE_UINT,
+      object_stats.last_frame_heap_allocs, NULL);
+  latency_set_structure (&encoder->encode_latency, stats, "encode-latency");
+  latency_set_structure (&encoder->sync_latency, stats, "sync-latency");
+  g_mutex_unlock (&encoder->mutex);
+
+  if (encoder->lookahead)
+    gst_vaapi_encoder_lookahead_fill_stats (encoder->lookahead, stats);
+  return stats;
+}
+
 /**
  * gst_vaapi_encoder_get_codec_data:
  * @encoder: a #GstVaapiEncoder
@@ -881,7 +1348,8 @@ gst_vaapi_encoder_reconfigure_internal (GstVaapiEncoder * encoder)
     pool = gst_vaapi_coded_buffer_pool_new (encoder, encoder->codedbuf_size);
     if (!pool)
       goto error_alloc_codedbuf_pool;
-    gst_vaapi_video_pool_set_capacity (pool, 5);
+    gst_vaapi_video_pool_set_capacity (pool,
+        get_codedbuf_pool_capacity (encoder));
     gst_vaapi_video_pool_replace (&encoder->codedbuf_pool, pool);
     gst_vaapi_video_pool_unref (pool);
   }
@@ -1222,6 +1690,10 @@ G_DEFINE_ABSTRACT_TYPE (GstVaapiEncoder, gst_vaapi_encoder, GST_TYPE_OBJECT);
  * @ENCODER_PROP_DEFAULT_ROI_VALUE: The default delta qp to apply
  *   to each region of interest.
  * @ENCODER_PROP_TRELLIS: Use trellis quantization method (gboolean).
+ * @ENCODER_PROP_MAX_INFLIGHT: Maximum number of frames submitted and
+ *   not retrieved yet (uint).
+ * @ENCODER_PROP_ASYNC_DEPTH: Number of frames kept submitted before
+ *   waiting for the oldest one (uint).
  *
  * The set of configurable properties for the encoder.
  */
@@ -1234,6 +1706,8 @@ enum
   ENCODER_PROP_QUALITY_LEVEL,
   ENCODER_PROP_DEFAULT_ROI_VALUE,
   ENCODER_PROP_TRELLIS,
+  ENCODER_PROP_MAX_INFLIGHT,
+  ENCODER_PROP_ASYNC_DEPTH,
   ENCODER_N_PROPERTIES
 };
 
@@ -1280,6 +1754,16 @@ gst_vaapi_encoder_set_property (GObject * object, guint prop_id,
       status =
           gst_vaapi_encoder_set_trellis (encoder, g_value_get_boolean (value));
       break;
+    case ENCODER_PROP_MAX_INFLIGHT:
+      g_mutex_lock (&encoder->mutex);
+      encoder->max_inflight = g_value_get_uint (value);
+      g_cond_broadcast (&encoder->inflight_free);
+      g_mutex_unlock (&encoder->mutex);
+      break;
+    case ENCODER_PROP_ASYNC_DEPTH:
+      status = gst_vaapi_encoder_set_async_depth (encoder,
+          g_value_get_uint (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1318,6 +1802,12 @@ gst_vaapi_encoder_get_property (GObject * object, guint prop_id,
     case ENCODER_PROP_TRELLIS:
       g_value_set_boolean (value, encoder->trellis);
       break;
+    case ENCODER_PROP_MAX_INFLIGHT:
+      g_value_set_uint (value, encoder->max_inflight);
+      break;
+    case ENCODER_PROP_ASYNC_DEPTH:
+      g_value_set_uint (value, encoder->async_depth);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1328,15 +1818,19 @@ static void
 gst_vaapi_encoder_init (GstVaapiEncoder * encoder)
 {
   encoder->va_context = VA_INVALID_ID;
+  encoder->object_arena = gst_vaapi_mini_object_arena_new ();
 
   gst_video_info_init (&encoder->video_info);
 
   g_mutex_init (&encoder->mutex);
   g_cond_init (&encoder->surface_free);
   g_cond_init (&encoder->codedbuf_free);
+  g_cond_init (&encoder->codedbuf_ready);
+  g_cond_init (&encoder->inflight_free);
+  g_cond_init (&encoder->codedbuf_done);
 
-  encoder->codedbuf_queue = g_async_queue_new_full ((GDestroyNotify)
-      gst_vaapi_coded_buffer_proxy_unref);
+  g_queue_init (&encoder->codedbuf_queue);
+  g_queue_init (&encoder->codedbuf_done_queue);
 }
 
 /* Base encoder cleanup (internal) */
@@ -1345,6 +1839,8 @@ gst_vaapi_encoder_finalize (GObject * object)
 {
   GstVaapiEncoder *encoder = GST_VAAPI_ENCODER (object);
 
+  gst_vaapi_encoder_stop_reaper_thread (encoder);
+
   gst_vaapi_object_replace (&encoder->context, NULL);
   gst_vaapi_display_replace (&encoder->display, NULL);
   encoder->va_display = NULL;
@@ -1355,13 +1851,20 @@ gst_vaapi_encoder_finalize (GObject * object)
   }
 
   gst_vaapi_video_pool_replace (&encoder->codedbuf_pool, NULL);
-  if (encoder->codedbuf_queue) {
-    g_async_queue_unref (encoder->codedbuf_queue);
-    encoder->codedbuf_queue = NULL;
-  }
+  g_queue_foreach (&encoder->codedbuf_queue,
+      (GFunc) gst_vaapi_coded_buffer_proxy_unref, NULL);
+  g_queue_clear (&encoder->codedbuf_queue);
+  g_queue_foreach (&encoder->codedbuf_done_queue,
+      (GFunc) gst_vaapi_coded_buffer_proxy_unref, NULL);
+  g_queue_clear (&encoder->codedbuf_done_queue);
   g_cond_clear (&encoder->surface_free);
   g_cond_clear (&encoder->codedbuf_free);
+  g_cond_clear (&encoder->codedbuf_ready);
+  g_cond_clear (&encoder->inflight_free);
+  g_cond_clear (&encoder->codedbuf_done);
   g_mutex_clear (&encoder->mutex);
+  gst_vaapi_mini_object_arena_unref (encoder->object_arena);
+  gst_vaapi_encoder_lookahead_free (encoder->lookahead);
 
   G_OBJECT_CLASS (gst_vaapi_encoder_parent_class)->finalize (object);
 }
@@ -1474,39 +1977,87 @@ gst_vaapi_encoder_class_init (GstVaapiEncoderClass * klass)
       FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
       GST_VAAPI_PARAM_ENCODER_EXPOSURE);
 
+  /**
+   * GstVaapiEncoder:max-inflight:
+   *
+   * The maximum number of frames submitted to the hardware and whose
+   * coded buffer was not retrieved yet. Lower values reduce latency
+   * at the expense of throughput. Zero means the number of frames
+   * in flight is only bounded by the number of coded buffers.
+   */
+  properties[ENCODER_PROP_MAX_INFLIGHT] =
+      g_param_spec_uint ("max-inflight",
+      "Max In-flight Frames",
+      "Maximum number of frames being encoded at a time (0: unlimited)",
+      0, 64, 0,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
+  /**
+   * GstVaapiEncoder:async-depth:
+   *
+   * The number of frames kept submitted to the hardware before the
+   * encoder waits for the completion of the oldest one, from a
+   * dedicated thread. Higher values maximize the hardware utilization
+   * for batch transcoding, at the expense of latency. Zero means each
+   * frame is waited for when its coded buffer is retrieved.
+   */
+  properties[ENCODER_PROP_ASYNC_DEPTH] =
+      g_param_spec_uint ("async-depth",
+      "Async Depth",
+      "Number of frames submitted before waiting for the oldest one "
+      "(0: wait on output)", 0, 32, 0,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
   g_object_class_install_properties (object_class, ENCODER_N_PROPERTIES,
       properties);
 }
 
-static GstVaapiContext *
-create_test_context_config (GstVaapiEncoder * encoder, GstVaapiProfile profile)
+static GArray *
+get_profile_surface_formats (GstVaapiEncoder * encoder, GstVaapiProfile profile)
 {
   GstVaapiContextInfo cip = { 0, };
   GstVaapiContext *ctxt;
+  GArray *formats;
+  gpointer data;
+  gsize size;
+  gchar *key;
 
   if (encoder->context)
-    return gst_vaapi_object_ref (encoder->context);
+    return gst_vaapi_context_get_surface_formats (encoder->context);
 
   /* if there is no profile, let's figure out one */
   if (profile == GST_VAAPI_PROFILE_UNKNOWN)
     profile = get_profile (encoder);
 
   init_context_info (encoder, &cip, profile);
-  ctxt = gst_vaapi_context_new (encoder->display, &cip);
-  return ctxt;
-}
 
-static GArray *
-get_profile_surface_formats (GstVaapiEncoder * encoder, GstVaapiProfile profile)
-{
-  GstVaapiContext *ctxt;
-  GArray *formats;
+  /* Creating a test context per profile is expensive, so formats are
+     kept in the capability cache */
+  key = g_strdup_printf ("encoder-surface-formats-%u-%u-%u", cip.profile,
+      cip.entrypoint, cip.chroma_type);
+  if (gst_vaapi_display_lookup_caps (encoder->display, key, &data, &size)) {
+    formats = g_array_sized_new (FALSE, FALSE, sizeof (GstVideoFormat),
+        size / sizeof (GstVideoFormat));
+    g_array_append_vals (formats, data, size / sizeof (GstVideoFormat));
+    g_free (data);
+    goto done;
+  }
 
-  ctxt = create_test_context_config (encoder, profile);
-  if (!ctxt)
-    return NULL;
-  formats = gst_vaapi_context_get_surface_formats (ctxt);
-  gst_vaapi_object_unref (ctxt);
+  formats = NULL;
+  ctxt = gst_vaapi_context_new (encoder->display, &cip);
+  if (ctxt) {
+    formats = gst_vaapi_context_get_surface_formats (ctxt);
+    gst_vaapi_object_unref (ctxt);
+  }
+  if (formats) {
+    gst_vaapi_display_store_caps (encoder->display, key, formats->data,
+        formats->len * sizeof (GstVideoFormat));
+  }
+
+done:
+  g_free (key);
   return formats;
 }
 
@@ -1675,6 +2226,59 @@ gst_vaapi_encoder_ensure_max_num_ref_frames (GstVaapiEncoder * encoder,
   return TRUE;
 }
 
+/**
+ * gst_vaapi_encoder_ensure_lookahead:
+ * @encoder: a #GstVaapiEncoder
+ * @depth: the number of frames to analyse ahead, or zero to disable
+ *   lookahead rate control
+ * @bitrate: the target bitrate, in kbps
+ * @init_qp: the QP to start from
+ * @min_qp: the lowest QP to choose
+ * @max_qp: the highest QP to choose
+ *
+ * Sets up the lookahead rate control, which chooses the QP of each
+ * frame before it is reordered. The derived classes call this while
+ * they are configured, and use gst_vaapi_encoder_get_lookahead_qp()
+ * to fill in their slice parameters. The rate model is kept if the
+ * lookahead was already enabled.
+ */
+void
+gst_vaapi_encoder_ensure_lookahead (GstVaapiEncoder * encoder, guint depth,
+    guint bitrate, guint init_qp, guint min_qp, guint max_qp)
+{
+  if (depth == 0 || bitrate == 0) {
+    g_clear_pointer (&encoder->lookahead, gst_vaapi_encoder_lookahead_free);
+    return;
+  }
+
+  if (!encoder->lookahead)
+    encoder->lookahead = gst_vaapi_encoder_lookahead_new ();
+  gst_vaapi_encoder_lookahead_configure (encoder->lookahead, depth, bitrate,
+      GST_VAAPI_ENCODER_FPS_N (encoder), GST_VAAPI_ENCODER_FPS_D (encoder),
+      init_qp, min_qp, max_qp);
+}
+
+/**
+ * gst_vaapi_encoder_get_lookahead_qp:
+ * @encoder: a #GstVaapiEncoder
+ * @picture: a #GstVaapiEncPicture
+ * @qp_ptr: return location for the QP
+ *
+ * Retrieves the QP the lookahead rate control chose for @picture.
+ *
+ * Return value: %TRUE if lookahead rate control is enabled and chose
+ *   a QP for @picture
+ */
+gboolean
+gst_vaapi_encoder_get_lookahead_qp (GstVaapiEncoder * encoder,
+    GstVaapiEncPicture * picture, guint * qp_ptr)
+{
+  if (!encoder->lookahead || !picture->frame)
+    return FALSE;
+  return gst_vaapi_encoder_lookahead_get_qp (encoder->lookahead,
+      picture->frame, qp_ptr);
+}
+
 GstVaapiProfile
 gst_vaapi_encoder_get_profile (GstVaapiEncoder * encoder)
 {
@@ -173,6 +173,14 @@ gst_vaapi_encoder_set_quality_level (GstVaapiEncoder * encoder,
 GstVaapiEncoderStatus
 gst_vaapi_encoder_set_trellis (GstVaapiEncoder * encoder, gboolean trellis);
 
+GstVaapiEncoderStatus
+gst_vaapi_encoder_set_async_depth (GstVaapiEncoder * encoder,
+    guint async_depth);
+
+void
+gst_vaapi_encoder_set_output_hold (GstVaapiEncoder * encoder,
+    guint num_buffers);
+
 GstVaapiEncoderStatus
 gst_vaapi_encoder_get_buffer_with_timeout (GstVaapiEncoder * encoder,
     GstVaapiCodedBufferProxy ** out_codedbuf_proxy_ptr, guint64 timeout);
@@ -180,6 +188,12 @@ gst_vaapi_encoder_get_buffer_with_timeout (GstVaapiEncoder * encoder,
 GstVaapiEncoderStatus
 gst_vaapi_encoder_flush (GstVaapiEncoder * encoder);
 
+void
+gst_vaapi_encoder_set_flushing (GstVaapiEncoder * encoder, gboolean flushing);
+
+GstStructure *
+gst_vaapi_encoder_get_stats (GstVaapiEncoder * encoder);
+
 GArray *
 gst_vaapi_encoder_get_surface_formats (GstVaapiEncoder * encoder,
     GstVaapiProfile profile);
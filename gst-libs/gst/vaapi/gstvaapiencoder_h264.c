@@ -756,6 +756,8 @@ struct _GstVaapiEncoderH264
   guint32 mb_width;
   guint32 mb_height;
   guint32 quality_factor;
+  guint32 lookahead_depth;
+  guint32 lookahead_bitrate;    /* kbps, kept in CQP mode */
   gboolean use_cabac;
   gboolean use_dct8x8;
   guint temporal_levels;        /* Number of temporal levels */
@@ -2283,6 +2285,7 @@ add_slice_headers (GstVaapiEncoderH264 * encoder, GstVaapiEncPicture * picture,
   guint mb_size;
   guint last_mb_index;
   guint i_slice, i_ref;
+  guint qp;
 
   g_assert (picture);
 
@@ -2391,7 +2394,10 @@ add_slice_headers (GstVaapiEncoderH264 * encoder, GstVaapiEncPicture * picture,
         sizeof (slice_param->chroma_offset_l1));
 
     slice_param->cabac_init_idc = 0;
-    slice_param->slice_qp_delta = encoder->qp_i - encoder->init_qp;
+    if (!gst_vaapi_encoder_get_lookahead_qp (GST_VAAPI_ENCODER_CAST (encoder),
+            picture, &qp))
+      qp = encoder->qp_i;
+    slice_param->slice_qp_delta = qp - encoder->init_qp;
     if (GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP) {
       if (picture->type == GST_VAAPI_PICTURE_TYPE_P) {
         slice_param->slice_qp_delta += encoder->qp_ip;
@@ -2686,6 +2692,27 @@ ensure_bitrate_hrd (GstVaapiEncoderH264 * encoder)
   }
 }
 
+/* Estimates a good enough bitrate, in kbps */
+static guint
+estimate_bitrate (GstVaapiEncoderH264 * encoder)
+{
+  /* According to the literature and testing, CABAC entropy coding
+     mode could provide for +10% to +18% improvement in general,
+     thus estimating +15% here ; and using adaptive 8x8 transforms
+     in I-frames could bring up to +10% improvement. */
+  guint bits_per_mb = 48;
+  guint64 factor;
+
+  if (!encoder->use_cabac)
+    bits_per_mb += (bits_per_mb * 15) / 100;
+  if (!encoder->use_dct8x8)
+    bits_per_mb += (bits_per_mb * 10) / 100;
+
+  factor = (guint64) encoder->mb_width * encoder->mb_height * bits_per_mb;
+  return gst_util_uint64_scale (factor, GST_VAAPI_ENCODER_FPS_N (encoder),
+      GST_VAAPI_ENCODER_FPS_D (encoder)) / 1000;
+}
+
 /* Estimates a good enough bitrate if none was supplied */
 static void
 ensure_bitrate (GstVaapiEncoderH264 * encoder)
@@ -2699,25 +2726,23 @@ ensure_bitrate (GstVaapiEncoderH264 * encoder)
     case GST_VAAPI_RATECONTROL_VBR_CONSTRAINED:
     case GST_VAAPI_RATECONTROL_QVBR:
       if (!base_encoder->bitrate) {
-        /* According to the literature and testing, CABAC entropy coding
-           mode could provide for +10% to +18% improvement in general,
-           thus estimating +15% here ; and using adaptive 8x8 transforms
-           in I-frames could bring up to +10% improvement. */
-        guint bits_per_mb = 48;
-        guint64 factor;
-
-        if (!encoder->use_cabac)
-          bits_per_mb += (bits_per_mb * 15) / 100;
-        if (!encoder->use_dct8x8)
-          bits_per_mb += (bits_per_mb * 10) / 100;
-
-        factor = (guint64) encoder->mb_width * encoder->mb_height * bits_per_mb;
-        base_encoder->bitrate =
-            gst_util_uint64_scale (factor, GST_VAAPI_ENCODER_FPS_N (encoder),
-            GST_VAAPI_ENCODER_FPS_D (encoder)) / 1000;
+        base_encoder->bitrate = estimate_bitrate (encoder);
         GST_INFO ("target bitrate computed to %u kbps", base_encoder->bitrate);
       }
       break;
+    case GST_VAAPI_RATECONTROL_CQP:
+      /* The lookahead targets the bitrate, the driver does not */
+      if (encoder->lookahead_depth > 0) {
+        if (base_encoder->bitrate)
+          encoder->lookahead_bitrate = base_encoder->bitrate;
+        else if (!encoder->lookahead_bitrate) {
+          encoder->lookahead_bitrate = estimate_bitrate (encoder);
+          GST_INFO ("lookahead bitrate computed to %u kbps",
+              encoder->lookahead_bitrate);
+        }
+      }
+      base_encoder->bitrate = 0;
+      break;
     default:
       base_encoder->bitrate = 0;
       break;
@@ -3385,6 +3410,10 @@ gst_vaapi_encoder_h264_reconfigure (GstVaapiEncoder * base_encoder)
 
   reset_properties (encoder);
   ensure_control_rate_params (encoder);
+  gst_vaapi_encoder_ensure_lookahead (base_encoder,
+      GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP ?
+      encoder->lookahead_depth : 0, encoder->lookahead_bitrate,
+      encoder->init_qp, encoder->min_qp, encoder->max_qp);
   return set_context_info (base_encoder);
 }
 
@@ -3556,6 +3585,8 @@ get_view_ids (GstVaapiEncoderH264 * const encoder, GValue * value)
  * @ENCODER_H264_PROP_PREDICTION_TYPE: Reference picture selection modes
  * @ENCODER_H264_PROP_MAX_QP: Maximal quantizer value (uint).
  * @ENCODER_H264_PROP_QUALITY_FACTOR: Factor for ICQ/QVBR bitrate control mode.
+ * @ENCODER_H264_PROP_LOOKAHEAD: Number of frames analysed ahead to
+ *   choose the QP in CQP mode (uint).
  *
  * The set of H.264 encoder specific configurable properties.
  */
@@ -3582,6 +3613,7 @@ enum
   ENCODER_H264_PROP_PREDICTION_TYPE,
   ENCODER_H264_PROP_MAX_QP,
   ENCODER_H264_PROP_QUALITY_FACTOR,
+  ENCODER_H264_PROP_LOOKAHEAD,
   ENCODER_H264_N_PROPERTIES
 };
 
@@ -3665,6 +3697,9 @@ gst_vaapi_encoder_h264_set_property (GObject * object, guint prop_id,
     case ENCODER_H264_PROP_QUALITY_FACTOR:
       encoder->quality_factor = g_value_get_uint (value);
       break;
+    case ENCODER_H264_PROP_LOOKAHEAD:
+      encoder->lookahead_depth = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -3741,6 +3776,9 @@ gst_vaapi_encoder_h264_get_property (GObject * object, guint prop_id,
     case ENCODER_H264_PROP_QUALITY_FACTOR:
       g_value_set_uint (value, encoder->quality_factor);
       break;
+    case ENCODER_H264_PROP_LOOKAHEAD:
+      g_value_set_uint (value, encoder->lookahead_depth);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -4041,6 +4079,22 @@ gst_vaapi_encoder_h264_class_init (GstVaapiEncoderH264Class * klass)
       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
       GST_VAAPI_PARAM_ENCODER_EXPOSURE);
 
+  /**
+   * GstVaapiEncoderH264:lookahead:
+   *
+   * The number of frames analysed ahead to choose the QP of each
+   * frame in CQP mode, so that the stream hits the target bitrate.
+   * Each frame is held that many frames longer before it is
+   * encoded. Zero disables the lookahead rate control.
+   */
+  properties[ENCODER_H264_PROP_LOOKAHEAD] =
+      g_param_spec_uint ("lookahead",
+      "Lookahead",
+      "Number of frames analysed ahead to choose the QP in CQP mode"
+      " (0: disabled)", 0, 60, 0,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
   g_object_class_install_properties (object_class, ENCODER_H264_N_PROPERTIES,
       properties);
 }
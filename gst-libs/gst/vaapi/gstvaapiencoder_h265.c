@@ -107,6 +107,8 @@ struct _GstVaapiEncoderH265
   guint32 qp_ib;
   guint32 num_slices;
   guint32 num_bframes;
+  guint32 lookahead_depth;
+  guint32 lookahead_bitrate;    /* kbps, kept in CQP mode */
   guint32 ctu_width;            /* CTU == Coding Tree Unit */
   guint32 ctu_height;
   guint32 luma_width;
@@ -1677,6 +1679,7 @@ add_slice_headers (GstVaapiEncoderH265 * encoder, GstVaapiEncPicture * picture,
   guint ctu_width_round_factor;
   guint last_ctu_index;
   guint i_slice, i_ref;
+  guint qp;
 
   g_assert (picture);
 
@@ -1770,7 +1773,10 @@ add_slice_headers (GstVaapiEncoderH265 * encoder, GstVaapiEncPicture * picture,
     }
 
     slice_param->max_num_merge_cand = 5;        /* MaxNumMergeCand  */
-    slice_param->slice_qp_delta = encoder->qp_i - encoder->init_qp;
+    if (!gst_vaapi_encoder_get_lookahead_qp (GST_VAAPI_ENCODER_CAST (encoder),
+            picture, &qp))
+      qp = encoder->qp_i;
+    slice_param->slice_qp_delta = qp - encoder->init_qp;
     if (GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP) {
       if (picture->type == GST_VAAPI_PICTURE_TYPE_P) {
         slice_param->slice_qp_delta += encoder->qp_ip;
@@ -1997,6 +2003,20 @@ ensure_bitrate_hrd (GstVaapiEncoderH265 * encoder)
   }
 }
 
+/* Estimates a good enough bitrate, in kbps */
+static guint
+estimate_bitrate (GstVaapiEncoderH265 * encoder)
+{
+  /* FIXME: Provide better estimation */
+  /* Using a 1/6 compression ratio */
+  /* 12 bits per pixel for YUV420 */
+  guint64 factor;
+
+  factor = (guint64) encoder->luma_width * encoder->luma_height * 12 / 6;
+  return gst_util_uint64_scale (factor, GST_VAAPI_ENCODER_FPS_N (encoder),
+      GST_VAAPI_ENCODER_FPS_D (encoder)) / 1000;
+}
+
 /* Estimates a good enough bitrate if none was supplied */
 static void
 ensure_bitrate (GstVaapiEncoderH265 * encoder)
@@ -2007,18 +2027,23 @@ ensure_bitrate (GstVaapiEncoderH265 * encoder)
     case GST_VAAPI_RATECONTROL_CBR:
     case GST_VAAPI_RATECONTROL_VBR:
       if (!base_encoder->bitrate) {
-        /* FIXME: Provide better estimation */
-        /* Using a 1/6 compression ratio */
-        /* 12 bits per pixel for YUV420 */
-        guint64 factor;
-
-        factor = (guint64) encoder->luma_width * encoder->luma_height * 12 / 6;
-        base_encoder->bitrate =
-            gst_util_uint64_scale (factor, GST_VAAPI_ENCODER_FPS_N (encoder),
-            GST_VAAPI_ENCODER_FPS_D (encoder)) / 1000;
+        base_encoder->bitrate = estimate_bitrate (encoder);
         GST_INFO ("target bitrate computed to %u kbps", base_encoder->bitrate);
       }
       break;
+    case GST_VAAPI_RATECONTROL_CQP:
+      /* The lookahead targets the bitrate, the driver does not */
+      if (encoder->lookahead_depth > 0) {
+        if (base_encoder->bitrate)
+          encoder->lookahead_bitrate = base_encoder->bitrate;
+        else if (!encoder->lookahead_bitrate) {
+          encoder->lookahead_bitrate = estimate_bitrate (encoder);
+          GST_INFO ("lookahead bitrate computed to %u kbps",
+              encoder->lookahead_bitrate);
+        }
+      }
+      base_encoder->bitrate = 0;
+      break;
     default:
       base_encoder->bitrate = 0;
       break;
@@ -2591,6 +2616,10 @@ gst_vaapi_encoder_h265_reconfigure (GstVaapiEncoder * base_encoder)
 
   reset_properties (encoder);
   ensure_control_rate_params (encoder);
+  gst_vaapi_encoder_ensure_lookahead (base_encoder,
+      GST_VAAPI_ENCODER_RATE_CONTROL (encoder) == GST_VAAPI_RATECONTROL_CQP ?
+      encoder->lookahead_depth : 0, encoder->lookahead_bitrate,
+      encoder->init_qp, encoder->min_qp, encoder->max_qp);
   return set_context_info (base_encoder);
 }
 
@@ -2679,6 +2708,8 @@ gst_vaapi_encoder_h265_finalize (GObject * object)
  * @ENCODER_H265_PROP_QP_IB: Difference of QP between I and B frame.
  * @ENCODER_H265_PROP_LOW_DELAY_B: use low delay b feature.
  * @ENCODER_H265_PROP_MAX_QP: Maximal quantizer value (uint).
+ * @ENCODER_H265_PROP_LOOKAHEAD: Number of frames analysed ahead to
+ *   choose the QP in CQP mode (uint).
  *
  * The set of H.265 encoder specific configurable properties.
  */
@@ -2697,6 +2728,7 @@ enum
   ENCODER_H265_PROP_QP_IB,
   ENCODER_H265_PROP_LOW_DELAY_B,
   ENCODER_H265_PROP_MAX_QP,
+  ENCODER_H265_PROP_LOOKAHEAD,
   ENCODER_H265_N_PROPERTIES
 };
 
@@ -2756,6 +2788,9 @@ gst_vaapi_encoder_h265_set_property (GObject * object, guint prop_id,
     case ENCODER_H265_PROP_MAX_QP:
       encoder->max_qp = g_value_get_uint (value);
       break;
+    case ENCODER_H265_PROP_LOOKAHEAD:
+      encoder->lookahead_depth = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -2808,6 +2843,9 @@ gst_vaapi_encoder_h265_get_property (GObject * object, guint prop_id,
     case ENCODER_H265_PROP_MAX_QP:
       g_value_set_uint (value, encoder->max_qp);
       break;
+    case ENCODER_H265_PROP_LOOKAHEAD:
+      g_value_set_uint (value, encoder->lookahead_depth);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -3000,6 +3038,22 @@ gst_vaapi_encoder_h265_class_init (GstVaapiEncoderH265Class * klass)
       FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
       GST_VAAPI_PARAM_ENCODER_EXPOSURE);
 
+  /**
+   * GstVaapiEncoderH265:lookahead:
+   *
+   * The number of frames analysed ahead to choose the QP of each
+   * frame in CQP mode, so that the stream hits the target bitrate.
+   * Each frame is held that many frames longer before it is
+   * encoded. Zero disables the lookahead rate control.
+   */
+  properties[ENCODER_H265_PROP_LOOKAHEAD] =
+      g_param_spec_uint ("lookahead",
+      "Lookahead",
+      "Number of frames analysed ahead to choose the QP in CQP mode"
+      " (0: disabled)", 0, 60, 0,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT |
+      GST_VAAPI_PARAM_ENCODER_EXPOSURE);
+
   g_object_class_install_properties (object_class, ENCODER_H265_N_PROPERTIES,
       properties);
 }
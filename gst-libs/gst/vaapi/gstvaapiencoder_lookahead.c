@@ -0,0 +1,540 @@
+/*
+ *  gstvaapiencoder_lookahead.c - Lookahead rate control
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Frame-level rate control for the CQP mode, done on the CPU before
+ * the frames reach the reordering stage of the encoder.
+ *
+ * Each frame is analysed as it is queued: its luma plane is read back
+ * and downscaled by LOOKAHEAD_SCALE in each direction, then split into
+ * 8x8 blocks. A block costs the smallest of its sum of absolute
+ * deviations from its mean (intra) and of its sum of absolute
+ * differences with the co-located block of the previous frame (inter).
+ * The frame complexity is the sum of the block costs.
+ *
+ * A frame leaves the queue once depth frames follow it, or when
+ * draining. Its quantizer scale is then chosen the way x264 does for
+ * ABR: with predicted bits = coeff * cost / qscale, and qscale
+ * proportional to cost^(1 - qcomp), the qscale for which the frames
+ * in the queue would hit the target bitrate on average is
+ *
+ *   qscale = cost^(1 - qcomp) * coeff * sum (cost_j^qcomp) / (n * target)
+ *
+ * so that complex frames get a higher QP, but not as much higher as
+ * it would take to give them the same number of bits. coeff is
+ * calibrated from the size of the coded frames, and the QP is
+ * corrected by the overflow of the coded bits over the wanted bits.
+ */
+
+#include "sysdeps.h"
+#include <math.h>
+#include "gstvaapiencoder_lookahead.h"
+#include "gstvaapisurfaceproxy.h"
+#include "gstvaapisurface.h"
+#include "gstvaapiimage.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+#define LOOKAHEAD_SCALE 4
+#define LOOKAHEAD_BLOCK 8
+#define LOOKAHEAD_QCOMP 0.6
+
+/* Weight of the last coded frame in the bits per cost estimate */
+#define LOOKAHEAD_COEFF_WEIGHT 0.25
+
+/* Number of decided frames kept for get_qp() and add_coded_size(),
+   in case some of them are never coded */
+#define LOOKAHEAD_MAX_DECIDED 256
+
+typedef struct
+{
+  GstVideoCodecFrame *frame;
+  gconstpointer key;            /* the frame, once it left the queue */
+  guint32 frame_number;
+  guint64 cost;
+  gdouble qscale;
+  guint qp;
+} LookaheadFrame;
+
+struct _GstVaapiEncoderLookahead
+{
+  /* frames waiting for a decision, and analysis state. Only used by
+     the thread queueing the frames */
+  GQueue frames;
+  guint8 *luma;
+  guint8 *prev_luma;
+  guint luma_width;
+  guint luma_height;
+  gboolean has_prev_luma;
+  GstVaapiImage *image;
+
+  /* configuration and rate model, protected by lock */
+  GMutex lock;
+  guint depth;
+  gdouble target_bits;
+  gdouble abr_buffer;
+  guint init_qp;
+  guint min_qp;
+  guint max_qp;
+  GQueue decided;
+  gdouble coeff;
+  gboolean has_coeff;
+  gdouble wanted_bits;
+  gdouble coded_bits;
+  guint64 num_frames;
+  guint64 qp_sum;
+};
+
+static inline gdouble
+qp_to_qscale (gdouble qp)
+{
+  return 0.85 * pow (2.0, (qp - 12.0) / 6.0);
+}
+
+static inline gdouble
+qscale_to_qp (gdouble qscale)
+{
+  return 12.0 + 6.0 * log2 (qscale / 0.85);
+}
+
+static void
+lookahead_frame_free (LookaheadFrame * lf)
+{
+  if (lf->frame)
+    gst_video_codec_frame_unref (lf->frame);
+  g_slice_free (LookaheadFrame, lf);
+}
+
+static guint
+get_luma_sample_size (GstVideoFormat format)
+{
+  switch (format) {
+    case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_YV12:
+      return 1;
+    case GST_VIDEO_FORMAT_P010_10LE:
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+/* Reads back the surface of @frame, downscaled. For high bit depth
+   formats, only the most significant byte of each sample is used */
+static gboolean
+read_luma (GstVaapiEncoderLookahead * la, GstVideoCodecFrame * frame)
+{
+  GstVaapiSurfaceProxy *const proxy = frame->user_data;
+  GstVaapiSurface *surface;
+  GstVaapiImage *image;
+  const guint8 *plane, *src;
+  guint8 *dst;
+  guint width, height, pitch, bps, x, y, i, j, sum;
+
+  if (!proxy)
+    return FALSE;
+  surface = GST_VAAPI_SURFACE_PROXY_SURFACE (proxy);
+
+  image = gst_vaapi_surface_derive_image (surface);
+  if (!image) {
+    gst_vaapi_surface_get_size (surface, &width, &height);
+    if (!la->image || GST_VAAPI_IMAGE_WIDTH (la->image) != width ||
+        GST_VAAPI_IMAGE_HEIGHT (la->image) != height) {
+      gst_vaapi_object_replace (&la->image, NULL);
+      la->image = gst_vaapi_image_new (gst_vaapi_object_get_display
+          (GST_VAAPI_OBJECT (surface)), GST_VIDEO_FORMAT_NV12, width, height);
+      if (!la->image)
+        return FALSE;
+    }
+    if (!gst_vaapi_surface_get_image (surface, la->image))
+      return FALSE;
+    image = gst_vaapi_object_ref (la->image);
+  }
+
+  bps = get_luma_sample_size (GST_VAAPI_IMAGE_FORMAT (image));
+  if (bps == 0 || !gst_vaapi_image_map (image)) {
+    gst_vaapi_object_unref (image);
+    return FALSE;
+  }
+
+  gst_vaapi_image_get_size (image, &width, &height);
+  width /= LOOKAHEAD_SCALE;
+  height /= LOOKAHEAD_SCALE;
+  if (width != la->luma_width || height != la->luma_height) {
+    g_free (la->luma);
+    g_free (la->prev_luma);
+    la->luma = g_malloc (width * height);
+    la->prev_luma = g_malloc (width * height);
+    la->luma_width = width;
+    la->luma_height = height;
+    la->has_prev_luma = FALSE;
+  }
+
+  plane = gst_vaapi_image_get_plane (image, 0);
+  pitch = gst_vaapi_image_get_pitch (image, 0);
+  for (y = 0; y < height; y++) {
+    dst = la->luma + y * width;
+    for (x = 0; x < width; x++) {
+      sum = 0;
+      for (j = 0; j < LOOKAHEAD_SCALE; j++) {
+        src = plane + (y * LOOKAHEAD_SCALE + j) * pitch +
+            x * LOOKAHEAD_SCALE * bps + bps - 1;
+        for (i = 0; i < LOOKAHEAD_SCALE; i++)
+          sum += src[i * bps];
+      }
+      dst[x] = sum / (LOOKAHEAD_SCALE * LOOKAHEAD_SCALE);
+    }
+  }
+
+  gst_vaapi_image_unmap (image);
+  gst_vaapi_object_unref (image);
+  return TRUE;
+}
+
+/* Sums the intra or inter cost of each block of the downscaled luma,
+   whichever is the lowest */
+static guint64
+compute_cost (GstVaapiEncoderLookahead * la)
+{
+  const guint stride = la->luma_width;
+  const guint num_bx = la->luma_width / LOOKAHEAD_BLOCK;
+  const guint num_by = la->luma_height / LOOKAHEAD_BLOCK;
+  const guint8 *cur, *prev;
+  guint bx, by, x, y, sum, mean, intra, inter;
+  guint64 cost = 0;
+
+  for (by = 0; by < num_by; by++) {
+    for (bx = 0; bx < num_bx; bx++) {
+      cur = la->luma + by * LOOKAHEAD_BLOCK * stride + bx * LOOKAHEAD_BLOCK;
+      prev = la->prev_luma + (cur - la->luma);
+
+      sum = 0;
+      for (y = 0; y < LOOKAHEAD_BLOCK; y++)
+        for (x = 0; x < LOOKAHEAD_BLOCK; x++)
+          sum += cur[y * stride + x];
+      mean = sum / (LOOKAHEAD_BLOCK * LOOKAHEAD_BLOCK);
+
+      intra = inter = 0;
+      for (y = 0; y < LOOKAHEAD_BLOCK; y++) {
+        for (x = 0; x < LOOKAHEAD_BLOCK; x++) {
+          const guint p = cur[y * stride + x];
+          intra += ABS ((gint) p - (gint) mean);
+          inter += ABS ((gint) p - (gint) prev[y * stride + x]);
+        }
+      }
+      cost += la->has_prev_luma ? MIN (intra, inter) : intra;
+    }
+  }
+
+  /* One unit per block, so that flat frames still cost something */
+  return cost + num_bx * num_by + 1;
+}
+
+static guint64
+analyze_frame (GstVaapiEncoderLookahead * la, GstVideoCodecFrame * frame)
+{
+  guint8 *tmp;
+  guint64 cost;
+
+  /* Frames that cannot be read back all cost the same, which turns
+     the lookahead into plain average bitrate control */
+  if (!read_luma (la, frame)) {
+    la->has_prev_luma = FALSE;
+    return 1;
+  }
+
+  cost = compute_cost (la);
+  tmp = la->prev_luma;
+  la->prev_luma = la->luma;
+  la->luma = tmp;
+  la->has_prev_luma = TRUE;
+  return cost;
+}
+
+/* Chooses the QP of the oldest queued frame. Called with the lock
+   held */
+static void
+decide_frame_unlocked (GstVaapiEncoderLookahead * la, LookaheadFrame * lf)
+{
+  const guint n = la->frames.length + 1;
+  gdouble sum, qscale, overflow, qp;
+  GList *l;
+
+  sum = pow (lf->cost, LOOKAHEAD_QCOMP);
+  for (l = la->frames.head; l != NULL; l = l->next)
+    sum += pow (((LookaheadFrame *) l->data)->cost, LOOKAHEAD_QCOMP);
+
+  /* Start from init-qp until coded frames tell better */
+  if (!la->has_coeff) {
+    la->coeff = qp_to_qscale (la->init_qp) * n * la->target_bits /
+        (pow (lf->cost, 1.0 - LOOKAHEAD_QCOMP) * sum);
+    la->has_coeff = TRUE;
+  }
+
+  qscale = pow (lf->cost, 1.0 - LOOKAHEAD_QCOMP) * la->coeff * sum /
+      (n * la->target_bits);
+
+  overflow = 1.0 + (la->coded_bits - la->wanted_bits) / la->abr_buffer;
+  qscale *= CLAMP (overflow, 0.5, 2.0);
+
+  qp = CLAMP (qscale_to_qp (qscale), la->min_qp, la->max_qp);
+  lf->qp = (guint) (qp + 0.5);
+  lf->qscale = qp_to_qscale (lf->qp);
+
+  GST_DEBUG ("frame %u: cost %" G_GUINT64_FORMAT ", qp %u", lf->frame_number,
+      lf->cost, lf->qp);
+
+  la->num_frames++;
+  la->qp_sum += lf->qp;
+}
+
+static LookaheadFrame *
+find_decided_unlocked (GstVaapiEncoderLookahead * la,
+    GstVideoCodecFrame * frame)
+{
+  GList *l;
+
+  for (l = la->decided.tail; l != NULL; l = l->prev) {
+    LookaheadFrame *const lf = l->data;
+    if (lf->key == frame)
+      return lf;
+  }
+  return NULL;
+}
+
+GstVaapiEncoderLookahead *
+gst_vaapi_encoder_lookahead_new (void)
+{
+  GstVaapiEncoderLookahead *const la = g_new0 (GstVaapiEncoderLookahead, 1);
+
+  g_queue_init (&la->frames);
+  g_queue_init (&la->decided);
+  g_mutex_init (&la->lock);
+  return la;
+}
+
+void
+gst_vaapi_encoder_lookahead_free (GstVaapiEncoderLookahead * la)
+{
+  if (!la)
+    return;
+
+  g_queue_foreach (&la->frames, (GFunc) lookahead_frame_free, NULL);
+  g_queue_clear (&la->frames);
+  g_queue_foreach (&la->decided, (GFunc) lookahead_frame_free, NULL);
+  g_queue_clear (&la->decided);
+  gst_vaapi_object_replace (&la->image, NULL);
+  g_free (la->luma);
+  g_free (la->prev_luma);
+  g_mutex_clear (&la->lock);
+  g_free (la);
+}
+
+/**
+ * gst_vaapi_encoder_lookahead_configure:
+ * @la: a #GstVaapiEncoderLookahead
+ * @depth: the number of frames to analyse ahead
+ * @bitrate: the target bitrate, in kbps
+ * @fps_n: the framerate numerator
+ * @fps_d: the framerate denominator
+ * @init_qp: the QP to start from
+ * @min_qp: the lowest QP to choose
+ * @max_qp: the highest QP to choose
+ *
+ * Updates the lookahead parameters. Frames already queued are kept.
+ */
+void
+gst_vaapi_encoder_lookahead_configure (GstVaapiEncoderLookahead * la,
+    guint depth, guint bitrate, guint fps_n, guint fps_d, guint init_qp,
+    guint min_qp, guint max_qp)
+{
+  g_return_if_fail (la != NULL);
+
+  if (fps_n == 0 || fps_d == 0)
+    fps_n = 30, fps_d = 1;
+
+  g_mutex_lock (&la->lock);
+  la->depth = MAX (depth, 1);
+  la->target_bits = MAX ((gdouble) bitrate * 1000 * fps_d / fps_n, 1.0);
+  la->abr_buffer = MAX (2.0 * bitrate * 1000, la->target_bits);
+  la->init_qp = init_qp;
+  la->min_qp = MIN (min_qp, max_qp);
+  la->max_qp = max_qp;
+  g_mutex_unlock (&la->lock);
+}
+
+guint
+gst_vaapi_encoder_lookahead_get_depth (GstVaapiEncoderLookahead * la)
+{
+  g_return_val_if_fail (la != NULL, 0);
+
+  return la->depth;
+}
+
+/**
+ * gst_vaapi_encoder_lookahead_push:
+ * @la: a #GstVaapiEncoderLookahead
+ * @frame: a #GstVideoCodecFrame, with its input surface proxy as user
+ *   data
+ *
+ * Analyses @frame and queues it. The lookahead holds an extra
+ * reference to @frame until it is returned by
+ * gst_vaapi_encoder_lookahead_pop().
+ */
+void
+gst_vaapi_encoder_lookahead_push (GstVaapiEncoderLookahead * la,
+    GstVideoCodecFrame * frame)
+{
+  LookaheadFrame *lf;
+
+  g_return_if_fail (la != NULL);
+  g_return_if_fail (frame != NULL);
+
+  lf = g_slice_new0 (LookaheadFrame);
+  lf->frame = gst_video_codec_frame_ref (frame);
+  lf->frame_number = frame->system_frame_number;
+  lf->cost = analyze_frame (la, frame);
+  g_queue_push_tail (&la->frames, lf);
+}
+
+/**
+ * gst_vaapi_encoder_lookahead_pop:
+ * @la: a #GstVaapiEncoderLookahead
+ * @drain: whether to return frames without waiting for depth frames
+ *   to follow them
+ *
+ * Chooses the QP of the oldest queued frame and returns it, once it
+ * is followed by enough frames, or right away when draining. The QP
+ * can be retrieved with gst_vaapi_encoder_lookahead_get_qp().
+ *
+ * Return value: (transfer full): the oldest queued frame, or %NULL
+ */
+GstVideoCodecFrame *
+gst_vaapi_encoder_lookahead_pop (GstVaapiEncoderLookahead * la,
+    gboolean drain)
+{
+  LookaheadFrame *lf;
+  GstVideoCodecFrame *frame;
+
+  g_return_val_if_fail (la != NULL, NULL);
+
+  if (la->frames.length == 0 || (!drain && la->frames.length < la->depth))
+    return NULL;
+
+  lf = g_queue_pop_head (&la->frames);
+  frame = lf->frame;
+  lf->frame = NULL;
+  lf->key = frame;
+
+  g_mutex_lock (&la->lock);
+  decide_frame_unlocked (la, lf);
+  g_queue_push_tail (&la->decided, lf);
+  if (la->decided.length > LOOKAHEAD_MAX_DECIDED)
+    lookahead_frame_free (g_queue_pop_head (&la->decided));
+  g_mutex_unlock (&la->lock);
+  return frame;
+}
+
+/**
+ * gst_vaapi_encoder_lookahead_get_qp:
+ * @la: a #GstVaapiEncoderLookahead
+ * @frame: a #GstVideoCodecFrame returned by
+ *   gst_vaapi_encoder_lookahead_pop()
+ * @qp_ptr: return location for the QP
+ *
+ * Retrieves the QP chosen for @frame.
+ *
+ * Return value: %TRUE if a QP was chosen for that frame
+ */
+gboolean
+gst_vaapi_encoder_lookahead_get_qp (GstVaapiEncoderLookahead * la,
+    GstVideoCodecFrame * frame, guint * qp_ptr)
+{
+  LookaheadFrame *lf;
+
+  g_return_val_if_fail (la != NULL, FALSE);
+  g_return_val_if_fail (qp_ptr != NULL, FALSE);
+
+  g_mutex_lock (&la->lock);
+  lf = find_decided_unlocked (la, frame);
+  if (lf)
+    *qp_ptr = lf->qp;
+  g_mutex_unlock (&la->lock);
+  return lf != NULL;
+}
+
+/**
+ * gst_vaapi_encoder_lookahead_add_coded_size:
+ * @la: a #GstVaapiEncoderLookahead
+ * @frame: a #GstVideoCodecFrame returned by
+ *   gst_vaapi_encoder_lookahead_pop()
+ * @size: the coded size of @frame, in bytes
+ *
+ * Calibrates the rate model with the outcome of @frame, and forgets
+ * that frame.
+ */
+void
+gst_vaapi_encoder_lookahead_add_coded_size (GstVaapiEncoderLookahead * la,
+    GstVideoCodecFrame * frame, gsize size)
+{
+  LookaheadFrame *lf;
+  const gdouble bits = (gdouble) size * 8;
+
+  g_return_if_fail (la != NULL);
+
+  g_mutex_lock (&la->lock);
+  lf = find_decided_unlocked (la, frame);
+  if (lf) {
+    la->coeff = la->coeff * (1.0 - LOOKAHEAD_COEFF_WEIGHT) +
+        bits * lf->qscale / lf->cost * LOOKAHEAD_COEFF_WEIGHT;
+    la->coded_bits += bits;
+    la->wanted_bits += la->target_bits;
+    g_queue_remove (&la->decided, lf);
+    lookahead_frame_free (lf);
+  }
+  g_mutex_unlock (&la->lock);
+}
+
+/**
+ * gst_vaapi_encoder_lookahead_fill_stats:
+ * @la: a #GstVaapiEncoderLookahead
+ * @stats: a #GstStructure
+ *
+ * Adds the lookahead counters to the encoder @stats.
+ */
+void
+gst_vaapi_encoder_lookahead_fill_stats (GstVaapiEncoderLookahead * la,
+    GstStructure * stats)
+{
+  g_return_if_fail (la != NULL);
+  g_return_if_fail (stats != NULL);
+
+  g_mutex_lock (&la->lock);
+  gst_structure_set (stats,
+      "lookahead-depth", G_TYPE_UINT, la->depth,
+      "lookahead-frames", G_TYPE_UINT64, la->num_frames,
+      "lookahead-qp-avg", G_TYPE_DOUBLE, la->num_frames > 0 ?
+      (gdouble) la->qp_sum / la->num_frames : 0.0,
+      "lookahead-coded-bits", G_TYPE_UINT64, (guint64) la->coded_bits,
+      "lookahead-wanted-bits", G_TYPE_UINT64, (guint64) la->wanted_bits,
+      NULL);
+  g_mutex_unlock (&la->lock);
+}
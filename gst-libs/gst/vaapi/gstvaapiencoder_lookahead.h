@@ -0,0 +1,74 @@
+/*
+ *  gstvaapiencoder_lookahead.h - Lookahead rate control
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_ENCODER_LOOKAHEAD_H
+#define GST_VAAPI_ENCODER_LOOKAHEAD_H
+
+#include <gst/video/gstvideoutils.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiEncoderLookahead GstVaapiEncoderLookahead;
+
+G_GNUC_INTERNAL
+GstVaapiEncoderLookahead *
+gst_vaapi_encoder_lookahead_new (void);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_encoder_lookahead_free (GstVaapiEncoderLookahead * la);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_encoder_lookahead_configure (GstVaapiEncoderLookahead * la,
+    guint depth, guint bitrate, guint fps_n, guint fps_d, guint init_qp,
+    guint min_qp, guint max_qp);
+
+G_GNUC_INTERNAL
+guint
+gst_vaapi_encoder_lookahead_get_depth (GstVaapiEncoderLookahead * la);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_encoder_lookahead_push (GstVaapiEncoderLookahead * la,
+    GstVideoCodecFrame * frame);
+
+G_GNUC_INTERNAL
+GstVideoCodecFrame *
+gst_vaapi_encoder_lookahead_pop (GstVaapiEncoderLookahead * la,
+    gboolean drain);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_encoder_lookahead_get_qp (GstVaapiEncoderLookahead * la,
+    GstVideoCodecFrame * frame, guint * qp_ptr);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_encoder_lookahead_add_coded_size (GstVaapiEncoderLookahead * la,
+    GstVideoCodecFrame * frame, gsize size);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_encoder_lookahead_fill_stats (GstVaapiEncoderLookahead * la,
+    GstStructure * stats);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_ENCODER_LOOKAHEAD_H */
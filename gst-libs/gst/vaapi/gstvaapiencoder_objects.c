@@ -33,6 +33,9 @@
 #define GET_ENCODER(obj)    GST_VAAPI_ENCODER_CAST((obj)->parent_instance.codec)
 #define GET_VA_DISPLAY(obj) GET_ENCODER(obj)->va_display
 #define GET_VA_CONTEXT(obj) GET_ENCODER(obj)->va_context
+#define GET_CONTEXT(obj)    GET_ENCODER(obj)->context
+#define GET_ARENA(obj) \
+  (GET_CONTEXT(obj) ? GET_CONTEXT(obj)->buffer_arena : NULL)
 
 /* ------------------------------------------------------------------------- */
 /* --- Encoder Packed Header                                             --- */
@@ -44,8 +47,12 @@ GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiEncPackedHeader,
 void
 gst_vaapi_enc_packed_header_destroy (GstVaapiEncPackedHeader * header)
 {
-  vaapi_destroy_buffer (GET_VA_DISPLAY (header), &header->param_id);
-  vaapi_destroy_buffer (GET_VA_DISPLAY (header), &header->data_id);
+  GstVaapiBufferArena *const arena = GET_ARENA (header);
+
+  gst_vaapi_buffer_arena_release_buffer (arena, GET_VA_DISPLAY (header),
+      &header->param_id, &header->param, VA_INVALID_SURFACE);
+  gst_vaapi_buffer_arena_release_buffer (arena, GET_VA_DISPLAY (header),
+      &header->data_id, &header->data, VA_INVALID_SURFACE);
   header->param = NULL;
   header->data = NULL;
 }
@@ -59,8 +66,8 @@ gst_vaapi_enc_packed_header_create (GstVaapiEncPackedHeader * header,
   header->param_id = VA_INVALID_ID;
   header->data_id = VA_INVALID_ID;
 
-  success = vaapi_create_buffer (GET_VA_DISPLAY (header),
-      GET_VA_CONTEXT (header),
+  success = gst_vaapi_buffer_arena_create_buffer (GET_ARENA (header),
+      GET_VA_DISPLAY (header), GET_VA_CONTEXT (header),
       VAEncPackedHeaderParameterBufferType,
       args->param_size, args->param, &header->param_id, &header->param);
   if (!success)
@@ -69,8 +76,8 @@ gst_vaapi_enc_packed_header_create (GstVaapiEncPackedHeader * header,
   if (!args->data_size)
     return TRUE;
 
-  success = vaapi_create_buffer (GET_VA_DISPLAY (header),
-      GET_VA_CONTEXT (header),
+  success = gst_vaapi_buffer_arena_create_buffer (GET_ARENA (header),
+      GET_VA_DISPLAY (header), GET_VA_CONTEXT (header),
       VAEncPackedHeaderDataBufferType,
       args->data_size, args->data, &header->data_id, &header->data);
   if (!success)
@@ -95,11 +102,13 @@ gst_vaapi_enc_packed_header_set_data (GstVaapiEncPackedHeader * header,
 {
   gboolean success;
 
-  vaapi_destroy_buffer (GET_VA_DISPLAY (header), &header->data_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (header),
+      GET_VA_DISPLAY (header), &header->data_id, &header->data,
+      VA_INVALID_SURFACE);
   header->data = NULL;
 
-  success = vaapi_create_buffer (GET_VA_DISPLAY (header),
-      GET_VA_CONTEXT (header),
+  success = gst_vaapi_buffer_arena_create_buffer (GET_ARENA (header),
+      GET_VA_DISPLAY (header), GET_VA_CONTEXT (header),
       VAEncPackedHeaderDataBufferType,
       data_size, data, &header->data_id, &header->data);
   if (!success)
@@ -116,7 +125,9 @@ GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiEncSequence, gst_vaapi_enc_sequence);
 void
 gst_vaapi_enc_sequence_destroy (GstVaapiEncSequence * sequence)
 {
-  vaapi_destroy_buffer (GET_VA_DISPLAY (sequence), &sequence->param_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (sequence),
+      GET_VA_DISPLAY (sequence), &sequence->param_id, &sequence->param,
+      VA_INVALID_SURFACE);
   sequence->param = NULL;
 }
 
@@ -127,8 +138,8 @@ gst_vaapi_enc_sequence_create (GstVaapiEncSequence * sequence,
   gboolean success;
 
   sequence->param_id = VA_INVALID_ID;
-  success = vaapi_create_buffer (GET_VA_DISPLAY (sequence),
-      GET_VA_CONTEXT (sequence),
+  success = gst_vaapi_buffer_arena_create_buffer (GET_ARENA (sequence),
+      GET_VA_DISPLAY (sequence), GET_VA_CONTEXT (sequence),
       VAEncSequenceParameterBufferType,
       args->param_size, args->param, &sequence->param_id, &sequence->param);
   if (!success)
@@ -161,7 +172,9 @@ gst_vaapi_enc_slice_destroy (GstVaapiEncSlice * slice)
     slice->packed_headers = NULL;
   }
 
-  vaapi_destroy_buffer (GET_VA_DISPLAY (slice), &slice->param_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (slice),
+      GET_VA_DISPLAY (slice), &slice->param_id, &slice->param,
+      VA_INVALID_SURFACE);
   slice->param = NULL;
 }
 
@@ -172,8 +185,8 @@ gst_vaapi_enc_slice_create (GstVaapiEncSlice * slice,
   gboolean success;
 
   slice->param_id = VA_INVALID_ID;
-  success = vaapi_create_buffer (GET_VA_DISPLAY (slice),
-      GET_VA_CONTEXT (slice),
+  success = gst_vaapi_buffer_arena_create_buffer (GET_ARENA (slice),
+      GET_VA_DISPLAY (slice), GET_VA_CONTEXT (slice),
       VAEncSliceParameterBufferType,
       args->param_size, args->param, &slice->param_id, &slice->param);
   if (!success)
@@ -207,7 +220,9 @@ GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiEncMiscParam, gst_vaapi_enc_misc_param);
 void
 gst_vaapi_enc_misc_param_destroy (GstVaapiEncMiscParam * misc)
 {
-  vaapi_destroy_buffer (GET_VA_DISPLAY (misc), &misc->param_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (misc),
+      GET_VA_DISPLAY (misc), &misc->param_id, &misc->param,
+      VA_INVALID_SURFACE);
   misc->param = NULL;
   misc->data = NULL;
 }
@@ -219,8 +234,8 @@ gst_vaapi_enc_misc_param_create (GstVaapiEncMiscParam * misc,
   gboolean success;
 
   misc->param_id = VA_INVALID_ID;
-  success = vaapi_create_buffer (GET_VA_DISPLAY (misc),
-      GET_VA_CONTEXT (misc),
+  success = gst_vaapi_buffer_arena_create_buffer (GET_ARENA (misc),
+      GET_VA_DISPLAY (misc), GET_VA_CONTEXT (misc),
       VAEncMiscParameterBufferType,
       args->param_size, args->param, &misc->param_id, &misc->param);
   if (!success)
@@ -258,7 +273,9 @@ GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiEncQMatrix, gst_vaapi_enc_q_matrix);
 void
 gst_vaapi_enc_q_matrix_destroy (GstVaapiEncQMatrix * q_matrix)
 {
-  vaapi_destroy_buffer (GET_VA_DISPLAY (q_matrix), &q_matrix->param_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (q_matrix),
+      GET_VA_DISPLAY (q_matrix), &q_matrix->param_id, &q_matrix->param,
+      VA_INVALID_SURFACE);
   q_matrix->param = NULL;
 }
 
@@ -267,9 +284,10 @@ gst_vaapi_enc_q_matrix_create (GstVaapiEncQMatrix * q_matrix,
     const GstVaapiCodecObjectConstructorArgs * args)
 {
   q_matrix->param_id = VA_INVALID_ID;
-  return vaapi_create_buffer (GET_VA_DISPLAY (q_matrix),
-      GET_VA_CONTEXT (q_matrix), VAQMatrixBufferType,
-      args->param_size, args->param, &q_matrix->param_id, &q_matrix->param);
+  return gst_vaapi_buffer_arena_create_buffer (GET_ARENA (q_matrix),
+      GET_VA_DISPLAY (q_matrix), GET_VA_CONTEXT (q_matrix),
+      VAQMatrixBufferType, args->param_size, args->param,
+      &q_matrix->param_id, &q_matrix->param);
 }
 
 GstVaapiEncQMatrix *
@@ -295,7 +313,9 @@ GST_VAAPI_CODEC_DEFINE_TYPE (GstVaapiEncHuffmanTable,
 void
 gst_vaapi_enc_huffman_table_destroy (GstVaapiEncHuffmanTable * huf_table)
 {
-  vaapi_destroy_buffer (GET_VA_DISPLAY (huf_table), &huf_table->param_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (huf_table),
+      GET_VA_DISPLAY (huf_table), &huf_table->param_id,
+      &huf_table->param, VA_INVALID_SURFACE);
   huf_table->param = NULL;
 }
 
@@ -304,9 +324,10 @@ gst_vaapi_enc_huffman_table_create (GstVaapiEncHuffmanTable * huf_table,
     const GstVaapiCodecObjectConstructorArgs * args)
 {
   huf_table->param_id = VA_INVALID_ID;
-  return vaapi_create_buffer (GET_VA_DISPLAY (huf_table),
-      GET_VA_CONTEXT (huf_table), VAHuffmanTableBufferType, args->param_size,
-      args->param, &huf_table->param_id, (void **) &huf_table->param);
+  return gst_vaapi_buffer_arena_create_buffer (GET_ARENA (huf_table),
+      GET_VA_DISPLAY (huf_table), GET_VA_CONTEXT (huf_table),
+      VAHuffmanTableBufferType, args->param_size, args->param,
+      &huf_table->param_id, (void **) &huf_table->param);
 }
 
 GstVaapiEncHuffmanTable *
@@ -362,7 +383,9 @@ gst_vaapi_enc_picture_destroy (GstVaapiEncPicture * picture)
   picture->surface_id = VA_INVALID_ID;
   picture->surface = NULL;
 
-  vaapi_destroy_buffer (GET_VA_DISPLAY (picture), &picture->param_id);
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (picture),
+      GET_VA_DISPLAY (picture), &picture->param_id, &picture->param,
+      VA_INVALID_SURFACE);
   picture->param = NULL;
 
   if (picture->frame) {
@@ -397,8 +420,8 @@ gst_vaapi_enc_picture_create (GstVaapiEncPicture * picture,
 
   picture->param_id = VA_INVALID_ID;
   picture->param_size = args->param_size;
-  success = vaapi_create_buffer (GET_VA_DISPLAY (picture),
-      GET_VA_CONTEXT (picture),
+  success = gst_vaapi_buffer_arena_create_buffer (GET_ARENA (picture),
+      GET_VA_DISPLAY (picture), GET_VA_CONTEXT (picture),
       VAEncPictureParameterBufferType,
       args->param_size, args->param, &picture->param_id, &picture->param);
   if (!success)
@@ -498,12 +521,32 @@ do_encode (VADisplay dpy, VAContextID ctx, VABufferID * buf_id, void **buf_ptr)
   status = vaRenderPicture (dpy, ctx, buf_id, 1);
   if (!vaapi_check_status (status, "vaRenderPicture()"))
     return FALSE;
-
-  /* XXX: vaRenderPicture() is meant to destroy the VA buffer implicitly */
-  vaapi_destroy_buffer (dpy, buf_id);
   return TRUE;
 }
 
+/* Gives a submitted buffer back to the context. The hardware may read
+   it until the picture is encoded, so this only happens after
+   vaEndPicture() and the buffer is not recycled before that */
+static void
+release_buffer (GstVaapiEncPicture * picture, VABufferID * buf_id)
+{
+  gst_vaapi_buffer_arena_release_buffer (GET_ARENA (picture),
+      GET_VA_DISPLAY (picture), buf_id, NULL, picture->surface_id);
+}
+
+static void
+release_packed_headers (GstVaapiEncPicture * picture, GPtrArray * headers)
+{
+  guint i;
+
+  for (i = 0; i < headers->len; i++) {
+    GstVaapiEncPackedHeader *const header = g_ptr_array_index (headers, i);
+
+    release_buffer (picture, &header->param_id);
+    release_buffer (picture, &header->data_id);
+  }
+}
+
 gboolean
 gst_vaapi_enc_picture_encode (GstVaapiEncPicture * picture)
 {
@@ -586,6 +629,28 @@ gst_vaapi_enc_picture_encode (GstVaapiEncPicture * picture)
   }
 
   status = vaEndPicture (va_display, va_context);
+
+  if (sequence)
+    release_buffer (picture, &sequence->param_id);
+  if (q_matrix)
+    release_buffer (picture, &q_matrix->param_id);
+  if (huf_table)
+    release_buffer (picture, &huf_table->param_id);
+  release_packed_headers (picture, picture->packed_headers);
+  release_buffer (picture, &picture->param_id);
+
+  for (i = 0; i < picture->misc_params->len; i++) {
+    GstVaapiEncMiscParam *const misc =
+        g_ptr_array_index (picture->misc_params, i);
+    release_buffer (picture, &misc->param_id);
+  }
+
+  for (i = 0; i < picture->slices->len; i++) {
+    GstVaapiEncSlice *const slice = g_ptr_array_index (picture->slices, i);
+    release_packed_headers (picture, slice->packed_headers);
+    release_buffer (picture, &slice->param_id);
+  }
+
   if (!vaapi_check_status (status, "vaEndPicture()"))
     return FALSE;
   return TRUE;
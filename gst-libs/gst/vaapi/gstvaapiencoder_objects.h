@@ -253,6 +253,7 @@ struct _GstVaapiEncPicture
   GstVaapiSurface *surface;
   VABufferID param_id;
   guint param_size;
+  gint64 submit_time;
 
   /* Additional data to pass down */
   GstVaapiEncSequence *sequence;
@@ -30,6 +30,7 @@
 #include <gst/vaapi/gstvaapivideopool.h>
 #include <gst/video/gstvideoutils.h>
 #include <gst/vaapi/gstvaapivalue.h>
+#include "gstvaapiencoder_lookahead.h"
 
 G_BEGIN_DECLS
 
@@ -220,6 +221,30 @@ G_BEGIN_DECLS
 
 typedef struct _GstVaapiEncoderClass GstVaapiEncoderClass;
 typedef struct _GstVaapiEncoderClassData GstVaapiEncoderClassData;
+typedef struct _GstVaapiEncoderLatency GstVaapiEncoderLatency;
+
+/* Number of latency histogram buckets. The upper bound of bucket i is
+   250 << i microseconds, and the last bucket has no upper bound */
+#define GST_VAAPI_ENCODER_LATENCY_BUCKETS 12
+
+/**
+ * GstVaapiEncoderLatency:
+ * @count: number of samples
+ * @sum: sum of all samples, in microseconds
+ * @min: smallest sample, in microseconds
+ * @max: largest sample, in microseconds
+ * @buckets: histogram of the samples
+ *
+ * Latency statistics of the coded buffers.
+ */
+struct _GstVaapiEncoderLatency
+{
+  guint64 count;
+  guint64 sum;
+  guint64 min;
+  guint64 max;
+  guint64 buckets[GST_VAAPI_ENCODER_LATENCY_BUCKETS];
+};
 
 struct _GstVaapiEncoder
 {
@@ -235,6 +260,7 @@ struct _GstVaapiEncoder
 
   VADisplay va_display;
   VAContextID va_context;
+  GstVaapiMiniObjectArena *object_arena;
   GstVideoInfo video_info;
   GstVaapiProfile profile;
   guint num_ref_frames;
@@ -257,9 +283,36 @@ struct _GstVaapiEncoder
   GCond codedbuf_free;
   guint codedbuf_size;
   GstVaapiVideoPool *codedbuf_pool;
-  GAsyncQueue *codedbuf_queue;
+  GQueue codedbuf_queue;
+  GCond codedbuf_ready;
   guint32 num_codedbuf_queued;
 
+  /* frames submitted and not retrieved yet, protected by mutex */
+  GCond inflight_free;
+  guint num_inflight;
+  guint max_inflight;
+  gboolean flushing;
+
+  /* asynchronous completion, see gst_vaapi_encoder_reaper_thread() */
+  guint async_depth;
+  GThread *reaper_thread;
+  GQueue codedbuf_done_queue;
+  GCond codedbuf_done;
+  guint num_reaping;
+  guint num_blocked;
+  gboolean draining;
+  gboolean reaper_quit;
+
+  /* submission to completion, and time blocked in vaSyncSurface() */
+  GstVaapiEncoderLatency encode_latency;
+  GstVaapiEncoderLatency sync_latency;
+
+  /* coded buffers held downstream, see gst_vaapi_encoder_set_output_hold() */
+  guint output_hold;
+
+  /* CPU-side rate control in CQP mode, NULL if disabled */
+  GstVaapiEncoderLookahead *lookahead;
+
   guint got_packed_headers:1;
   guint got_rate_control_mask:1;
 
@@ -387,6 +440,16 @@ gboolean
 gst_vaapi_encoder_ensure_max_num_ref_frames (GstVaapiEncoder * encoder,
     GstVaapiProfile profile, GstVaapiEntrypoint entrypoint);
 
+G_GNUC_INTERNAL
+void
+gst_vaapi_encoder_ensure_lookahead (GstVaapiEncoder * encoder, guint depth,
+    guint bitrate, guint init_qp, guint min_qp, guint max_qp);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_encoder_get_lookahead_qp (GstVaapiEncoder * encoder,
+    GstVaapiEncPicture * picture, guint * qp_ptr);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_ENCODER_PRIV_H */
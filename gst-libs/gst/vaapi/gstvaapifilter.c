@@ -58,6 +58,7 @@ struct _GstVaapiFilter
   VADisplay va_display;
   VAConfigID va_config;
   VAContextID va_context;
+  GMutex lock;
   GPtrArray *operations;
   GstVideoFormat format;
   GstVaapiScaleMethod scale_method;
@@ -65,6 +66,7 @@ struct _GstVaapiFilter
   GstVaapiConfigSurfaceAttributes *attribs;
   GArray *forward_references;
   GArray *backward_references;
+  GArray *pipeline_params;
   GstVaapiRectangle crop_rect;
   GstVaapiRectangle target_rect;
   guint use_crop_rect:1;
@@ -216,10 +218,24 @@ static VAProcFilterType *
 vpp_get_filters (GstVaapiFilter * filter, guint * num_filters_ptr)
 {
   VAProcFilterType *filters;
+  gsize size;
+
+  if (gst_vaapi_display_lookup_caps (filter->display, "vpp-filters",
+          (gpointer *) & filters, &size)) {
+    if (size % sizeof (*filters) == 0 && size > 0) {
+      *num_filters_ptr = size / sizeof (*filters);
+      return filters;
+    }
+    g_free (filters);
+  }
 
   GST_VAAPI_DISPLAY_LOCK (filter->display);
   filters = vpp_get_filters_unlocked (filter, num_filters_ptr);
   GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  if (filters) {
+    gst_vaapi_display_store_caps (filter->display, "vpp-filters", filters,
+        *num_filters_ptr * sizeof (*filters));
+  }
   return filters;
 }
 
@@ -267,10 +283,28 @@ vpp_get_filter_caps (GstVaapiFilter * filter, VAProcFilterType type,
     guint cap_size, guint * num_caps_ptr)
 {
   gpointer caps;
+  gsize size;
+  gchar *key;
+
+  key = g_strdup_printf ("vpp-filter-caps-%d", type);
+  if (gst_vaapi_display_lookup_caps (filter->display, key, &caps, &size)) {
+    if (size % cap_size == 0 && size > 0) {
+      *num_caps_ptr = size / cap_size;
+      goto done;
+    }
+    g_free (caps);
+  }
 
   GST_VAAPI_DISPLAY_LOCK (filter->display);
   caps = vpp_get_filter_caps_unlocked (filter, type, cap_size, num_caps_ptr);
   GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  if (caps) {
+    gst_vaapi_display_store_caps (filter->display, key, caps,
+        *num_caps_ptr * cap_size);
+  }
+
+done:
+  g_free (key);
   return caps;
 }
 
@@ -892,9 +926,9 @@ op_set_generic (GstVaapiFilter * filter, GstVaapiFilterOpData * op_data,
 {
   gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->lock);
   success = op_set_generic_unlocked (filter, op_data, value);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->lock);
   return success;
 }
 
@@ -997,9 +1031,9 @@ op_set_color_balance (GstVaapiFilter * filter, GstVaapiFilterOpData * op_data,
 {
   gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->lock);
   success = op_set_color_balance_unlocked (filter, op_data, value);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->lock);
   return success;
 }
 
@@ -1046,9 +1080,9 @@ op_set_deinterlace (GstVaapiFilter * filter, GstVaapiFilterOpData * op_data,
 {
   gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->lock);
   success = op_set_deinterlace_unlocked (filter, op_data, method, flags);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->lock);
   return success;
 }
 
@@ -1079,9 +1113,9 @@ op_set_skintone_level (GstVaapiFilter * filter,
 {
   gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->lock);
   success = op_set_skintone_level_unlocked (filter, op_data, value);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->lock);
   return success;
 }
 
@@ -1108,9 +1142,9 @@ op_set_skintone (GstVaapiFilter * filter, GstVaapiFilterOpData * op_data,
 {
   gboolean success = FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->lock);
   success = op_set_skintone_unlocked (filter, op_data, enhance);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->lock);
   return success;
 }
 #endif
@@ -1191,12 +1225,16 @@ gst_vaapi_filter_init (GstVaapiFilter * filter)
   filter->va_config = VA_INVALID_ID;
   filter->va_context = VA_INVALID_ID;
   filter->format = DEFAULT_FORMAT;
+  g_mutex_init (&filter->lock);
 
   filter->forward_references =
       g_array_sized_new (FALSE, FALSE, sizeof (VASurfaceID), 4);
 
   filter->backward_references =
       g_array_sized_new (FALSE, FALSE, sizeof (VASurfaceID), 4);
+
+  filter->pipeline_params =
+      g_array_sized_new (FALSE, FALSE, sizeof (VABufferID), 1);
 }
 
 static gboolean
@@ -1236,6 +1274,13 @@ gst_vaapi_filter_finalize (GObject * object)
     filter->operations = NULL;
   }
 
+  for (i = 0; i < filter->pipeline_params->len; i++) {
+    vaapi_destroy_buffer (filter->va_display,
+        &g_array_index (filter->pipeline_params, VABufferID, i));
+  }
+  g_array_unref (filter->pipeline_params);
+  filter->pipeline_params = NULL;
+
   if (filter->va_context != VA_INVALID_ID) {
     vaDestroyContext (filter->va_display, filter->va_context);
     filter->va_context = VA_INVALID_ID;
@@ -1247,6 +1292,7 @@ gst_vaapi_filter_finalize (GObject * object)
   }
   GST_VAAPI_DISPLAY_UNLOCK (filter->display);
   gst_vaapi_display_replace (&filter->display, NULL);
+  g_mutex_clear (&filter->lock);
 
   if (filter->forward_references) {
     g_array_unref (filter->forward_references);
@@ -1519,79 +1565,67 @@ gst_vaapi_filter_set_operation (GstVaapiFilter * filter, GstVaapiFilterOp op,
   return FALSE;
 }
 
-/**
- * gst_vaapi_filter_process:
- * @filter: a #GstVaapiFilter
- * @src_surface: the source @GstVaapiSurface
- * @dst_surface: the destination @GstVaapiSurface
- * @flags: #GstVaapiSurfaceRenderFlags that apply to @src_surface
- *
- * Applies the operations currently defined in the @filter to
- * @src_surface and return the output in @dst_surface. The order of
- * operations is determined in a way that suits best the underlying
- * hardware. i.e. the only guarantee held is the generated outcome,
- * not any specific order of operations.
- *
- * Return value: a #GstVaapiFilterStatus
- */
+/* Computes the VA region covered by @rect, or by the whole @surface if
+ * @rect is NULL */
+static gboolean
+get_surface_region (GstVaapiSurface * surface, const GstVaapiRectangle * rect,
+    VARectangle * region)
+{
+  if (rect) {
+    if ((rect->x + rect->width > GST_VAAPI_SURFACE_WIDTH (surface)) ||
+        (rect->y + rect->height > GST_VAAPI_SURFACE_HEIGHT (surface)))
+      return FALSE;
+
+    region->x = rect->x;
+    region->y = rect->y;
+    region->width = rect->width;
+    region->height = rect->height;
+  } else {
+    region->x = 0;
+    region->y = 0;
+    region->width = GST_VAAPI_SURFACE_WIDTH (surface);
+    region->height = GST_VAAPI_SURFACE_HEIGHT (surface);
+  }
+  return TRUE;
+}
+
+/* Makes sure at least @n pipeline parameter buffers can be reused */
+static gboolean
+ensure_pipeline_params (GstVaapiFilter * filter, guint n)
+{
+  VABufferID buf_id;
+
+  while (filter->pipeline_params->len < n) {
+    if (!vaapi_create_buffer (filter->va_display, filter->va_context,
+            VAProcPipelineParameterBufferType,
+            sizeof (VAProcPipelineParameterBuffer), NULL, &buf_id, NULL))
+      return FALSE;
+    g_array_append_val (filter->pipeline_params, buf_id);
+  }
+  return TRUE;
+}
+
+/* Processes @jobs, blending the nth source surface with a global alpha
+ * of alphas[n] if @alphas is not NULL */
 static GstVaapiFilterStatus
-gst_vaapi_filter_process_unlocked (GstVaapiFilter * filter,
-    GstVaapiSurface * src_surface, GstVaapiSurface * dst_surface, guint flags)
+gst_vaapi_filter_process_batch_unlocked (GstVaapiFilter * filter,
+    const GstVaapiFilterJob * jobs, guint num_jobs, guint flags,
+    gboolean use_references, const gdouble * alphas)
 {
-  VAProcPipelineParameterBuffer *pipeline_param = NULL;
-  VABufferID pipeline_param_buf_id = VA_INVALID_ID;
+  VAProcPipelineParameterBuffer *pipeline_param;
+  VABufferID pipeline_param_buf_id;
   VABufferID filters[N_PROPERTIES];
   VAProcPipelineCaps pipeline_caps;
-  guint i, num_filters = 0;
+  VARectangle *regions = NULL;
+  VABlendState *blend_states = NULL;
+  guint i, j, num_filters = 0;
   VAStatus va_status;
-  VARectangle src_rect, dst_rect;
   guint va_mirror = 0, va_rotation = 0;
+  GstVaapiFilterStatus status = GST_VAAPI_FILTER_STATUS_ERROR_OPERATION_FAILED;
 
   if (!ensure_operations (filter))
     return GST_VAAPI_FILTER_STATUS_ERROR_ALLOCATION_FAILED;
 
-  /* Build surface region (source) */
-  if (filter->use_crop_rect) {
-    const GstVaapiRectangle *const crop_rect = &filter->crop_rect;
-
-    if ((crop_rect->x + crop_rect->width >
-            GST_VAAPI_SURFACE_WIDTH (src_surface)) ||
-        (crop_rect->y + crop_rect->height >
-            GST_VAAPI_SURFACE_HEIGHT (src_surface)))
-      goto error;
-
-    src_rect.x = crop_rect->x;
-    src_rect.y = crop_rect->y;
-    src_rect.width = crop_rect->width;
-    src_rect.height = crop_rect->height;
-  } else {
-    src_rect.x = 0;
-    src_rect.y = 0;
-    src_rect.width = GST_VAAPI_SURFACE_WIDTH (src_surface);
-    src_rect.height = GST_VAAPI_SURFACE_HEIGHT (src_surface);
-  }
-
-  /* Build output region (target) */
-  if (filter->use_target_rect) {
-    const GstVaapiRectangle *const target_rect = &filter->target_rect;
-
-    if ((target_rect->x + target_rect->width >
-            GST_VAAPI_SURFACE_WIDTH (dst_surface)) ||
-        (target_rect->y + target_rect->height >
-            GST_VAAPI_SURFACE_HEIGHT (dst_surface)))
-      goto error;
-
-    dst_rect.x = target_rect->x;
-    dst_rect.y = target_rect->y;
-    dst_rect.width = target_rect->width;
-    dst_rect.height = target_rect->height;
-  } else {
-    dst_rect.x = 0;
-    dst_rect.y = 0;
-    dst_rect.width = GST_VAAPI_SURFACE_WIDTH (dst_surface);
-    dst_rect.height = GST_VAAPI_SURFACE_HEIGHT (dst_surface);
-  }
-
   for (i = 0, num_filters = 0; i < filter->operations->len; i++) {
     GstVaapiFilterOpData *const op_data =
         g_ptr_array_index (filter->operations, i);
@@ -1611,87 +1645,147 @@ gst_vaapi_filter_process_unlocked (GstVaapiFilter * filter,
   if (!vaapi_check_status (va_status, "vaQueryVideoProcPipelineCaps()"))
     goto error;
 
-  if (!vaapi_create_buffer (filter->va_display, filter->va_context,
-          VAProcPipelineParameterBufferType, sizeof (*pipeline_param),
-          NULL, &pipeline_param_buf_id, (gpointer *) & pipeline_param))
+  if (!ensure_pipeline_params (filter, num_jobs)) {
+    status = GST_VAAPI_FILTER_STATUS_ERROR_ALLOCATION_FAILED;
     goto error;
-
-  memset (pipeline_param, 0, sizeof (*pipeline_param));
-  pipeline_param->surface = GST_VAAPI_OBJECT_ID (src_surface);
-  pipeline_param->surface_region = &src_rect;
-  pipeline_param->surface_color_standard = VAProcColorStandardNone;
-  pipeline_param->output_region = &dst_rect;
-  pipeline_param->output_color_standard = VAProcColorStandardNone;
-  pipeline_param->output_background_color = 0xff000000;
-  pipeline_param->filter_flags = from_GstVaapiSurfaceRenderFlags (flags) |
-      from_GstVaapiScaleMethod (filter->scale_method);
-  pipeline_param->filters = filters;
-  pipeline_param->num_filters = num_filters;
+  }
 
   from_GstVideoOrientationMethod (filter->video_direction, &va_mirror,
       &va_rotation);
 
+  if (alphas && !(pipeline_caps.blend_flags & VA_BLEND_GLOBAL_ALPHA)) {
+    GST_ERROR ("global alpha blending is not supported");
+    status = GST_VAAPI_FILTER_STATUS_ERROR_UNSUPPORTED_OPERATION;
+    goto error;
+  }
+
+  /* The regions and blend states are referenced until vaEndPicture() */
+  regions = g_new (VARectangle, 2 * num_jobs);
+  if (alphas)
+    blend_states = g_new0 (VABlendState, num_jobs);
+
+  for (i = 0; i < num_jobs; i++) {
+    const GstVaapiFilterJob *const job = &jobs[i];
+    const GstVaapiRectangle *crop_rect = job->crop_rect;
+    const GstVaapiRectangle *target_rect = job->target_rect;
+    VARectangle *const src_rect = &regions[2 * i];
+    VARectangle *const dst_rect = &regions[2 * i + 1];
+
+    if (!crop_rect && filter->use_crop_rect)
+      crop_rect = &filter->crop_rect;
+    if (!target_rect && filter->use_target_rect)
+      target_rect = &filter->target_rect;
+
+    /* Build surface region (source) and output region (target) */
+    if (!get_surface_region (job->src_surface, crop_rect, src_rect) ||
+        !get_surface_region (job->dst_surface, target_rect, dst_rect)) {
+      status = GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER;
+      goto error;
+    }
+
+    pipeline_param_buf_id =
+        g_array_index (filter->pipeline_params, VABufferID, i);
+    pipeline_param = vaapi_map_buffer (filter->va_display,
+        pipeline_param_buf_id);
+    if (!pipeline_param)
+      goto error;
+
+    memset (pipeline_param, 0, sizeof (*pipeline_param));
+    pipeline_param->surface = GST_VAAPI_OBJECT_ID (job->src_surface);
+    pipeline_param->surface_region = src_rect;
+    pipeline_param->surface_color_standard = VAProcColorStandardNone;
+    pipeline_param->output_region = dst_rect;
+    pipeline_param->output_color_standard = VAProcColorStandardNone;
+    pipeline_param->output_background_color = 0xff000000;
+    pipeline_param->filter_flags = from_GstVaapiSurfaceRenderFlags (flags) |
+        from_GstVaapiScaleMethod (filter->scale_method);
+    pipeline_param->filters = filters;
+    pipeline_param->num_filters = num_filters;
+
 #if VA_CHECK_VERSION(1,1,0)
-  pipeline_param->mirror_state = va_mirror;
-  pipeline_param->rotation_state = va_rotation;
+    pipeline_param->mirror_state = va_mirror;
+    pipeline_param->rotation_state = va_rotation;
 #endif
 
-  // Reference frames for advanced deinterlacing
-  if (filter->forward_references->len > 0) {
-    pipeline_param->forward_references = (VASurfaceID *)
-        filter->forward_references->data;
-    pipeline_param->num_forward_references =
-        MIN (filter->forward_references->len,
-        pipeline_caps.num_forward_references);
-  } else {
-    pipeline_param->forward_references = NULL;
-    pipeline_param->num_forward_references = 0;
-  }
+    // Reference frames for advanced deinterlacing
+    if (use_references && filter->forward_references->len > 0) {
+      pipeline_param->forward_references = (VASurfaceID *)
+          filter->forward_references->data;
+      pipeline_param->num_forward_references =
+          MIN (filter->forward_references->len,
+          pipeline_caps.num_forward_references);
+    }
 
-  if (filter->backward_references->len > 0) {
-    pipeline_param->backward_references = (VASurfaceID *)
-        filter->backward_references->data;
-    pipeline_param->num_backward_references =
-        MIN (filter->backward_references->len,
-        pipeline_caps.num_backward_references);
-  } else {
-    pipeline_param->backward_references = NULL;
-    pipeline_param->num_backward_references = 0;
-  }
+    if (use_references && filter->backward_references->len > 0) {
+      pipeline_param->backward_references = (VASurfaceID *)
+          filter->backward_references->data;
+      pipeline_param->num_backward_references =
+          MIN (filter->backward_references->len,
+          pipeline_caps.num_backward_references);
+    }
 
-  vaapi_unmap_buffer (filter->va_display, pipeline_param_buf_id, NULL);
+    if (alphas && alphas[i] < 1.0) {
+      blend_states[i].flags = VA_BLEND_GLOBAL_ALPHA;
+      blend_states[i].global_alpha = alphas[i];
+      pipeline_param->blend_state = &blend_states[i];
+    }
 
-  va_status = vaBeginPicture (filter->va_display, filter->va_context,
-      GST_VAAPI_OBJECT_ID (dst_surface));
-  if (!vaapi_check_status (va_status, "vaBeginPicture()"))
-    goto error;
+    vaapi_unmap_buffer (filter->va_display, pipeline_param_buf_id, NULL);
+  }
 
-  va_status = vaRenderPicture (filter->va_display, filter->va_context,
-      &pipeline_param_buf_id, 1);
-  if (!vaapi_check_status (va_status, "vaRenderPicture()"))
-    goto error;
+  /* Consecutive jobs writing to the same target surface are submitted
+   * within a single picture */
+  for (i = 0; i < num_jobs; i = j) {
+    GstVaapiSurface *const dst_surface = jobs[i].dst_surface;
 
-  va_status = vaEndPicture (filter->va_display, filter->va_context);
-  if (!vaapi_check_status (va_status, "vaEndPicture()"))
-    goto error;
+    va_status = vaBeginPicture (filter->va_display, filter->va_context,
+        GST_VAAPI_OBJECT_ID (dst_surface));
+    if (!vaapi_check_status (va_status, "vaBeginPicture()"))
+      goto error;
 
-  deint_refs_clear_all (filter);
-  vaapi_destroy_buffer (filter->va_display, &pipeline_param_buf_id);
-  return GST_VAAPI_FILTER_STATUS_SUCCESS;
+    for (j = i; j < num_jobs && jobs[j].dst_surface == dst_surface; j++) {
+      va_status = vaRenderPicture (filter->va_display, filter->va_context,
+          &g_array_index (filter->pipeline_params, VABufferID, j), 1);
+      if (!vaapi_check_status (va_status, "vaRenderPicture()")) {
+        vaEndPicture (filter->va_display, filter->va_context);
+        goto error;
+      }
+    }
+
+    va_status = vaEndPicture (filter->va_display, filter->va_context);
+    if (!vaapi_check_status (va_status, "vaEndPicture()"))
+      goto error;
+  }
+  status = GST_VAAPI_FILTER_STATUS_SUCCESS;
 
-  /* ERRORS */
 error:
-  {
+  if (use_references)
     deint_refs_clear_all (filter);
-    vaapi_destroy_buffer (filter->va_display, &pipeline_param_buf_id);
-    return GST_VAAPI_FILTER_STATUS_ERROR_OPERATION_FAILED;
-  }
+  g_free (blend_states);
+  g_free (regions);
+  return status;
 }
 
+/**
+ * gst_vaapi_filter_process:
+ * @filter: a #GstVaapiFilter
+ * @src_surface: the source @GstVaapiSurface
+ * @dst_surface: the destination @GstVaapiSurface
+ * @flags: #GstVaapiSurfaceRenderFlags that apply to @src_surface
+ *
+ * Applies the operations currently defined in the @filter to
+ * @src_surface and return the output in @dst_surface. The order of
+ * operations is determined in a way that suits best the underlying
+ * hardware. i.e. the only guarantee held is the generated outcome,
+ * not any specific order of operations.
+ *
+ * Return value: a #GstVaapiFilterStatus
+ */
 GstVaapiFilterStatus
 gst_vaapi_filter_process (GstVaapiFilter * filter,
     GstVaapiSurface * src_surface, GstVaapiSurface * dst_surface, guint flags)
 {
+  GstVaapiFilterJob job = { src_surface, dst_surface, NULL, NULL };
   GstVaapiFilterStatus status;
 
   g_return_val_if_fail (filter != NULL,
@@ -1701,10 +1795,126 @@ gst_vaapi_filter_process (GstVaapiFilter * filter,
   g_return_val_if_fail (dst_surface != NULL,
       GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
 
-  GST_VAAPI_DISPLAY_LOCK (filter->display);
-  status = gst_vaapi_filter_process_unlocked (filter,
-      src_surface, dst_surface, flags);
-  GST_VAAPI_DISPLAY_UNLOCK (filter->display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->lock);
+  status = gst_vaapi_filter_process_batch_unlocked (filter, &job, 1, flags,
+      TRUE, NULL);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->lock);
+  return status;
+}
+
+/**
+ * gst_vaapi_filter_process_batch:
+ * @filter: a #GstVaapiFilter
+ * @jobs: (array length=num_jobs): the #GstVaapiFilterJob to process
+ * @num_jobs: the number of @jobs
+ * @flags: #GstVaapiSurfaceRenderFlags that apply to every source surface
+ *
+ * Applies the operations currently defined in the @filter to each
+ * source surface of @jobs, and returns the output in the matching
+ * destination surface. This is equivalent to calling
+ * gst_vaapi_filter_process() once per job, but the pipeline parameter
+ * buffers are shared and consecutive jobs with the same destination
+ * surface, e.g. the tiles of a mosaic, are submitted as a single
+ * picture.
+ *
+ * A job without cropping or target rectangle uses the one set with
+ * gst_vaapi_filter_set_cropping_rectangle() or
+ * gst_vaapi_filter_set_target_rectangle(), or the whole surface if
+ * there is none. Reference frames for advanced deinterlacing are not
+ * used by batches.
+ *
+ * Return value: a #GstVaapiFilterStatus
+ */
+GstVaapiFilterStatus
+gst_vaapi_filter_process_batch (GstVaapiFilter * filter,
+    const GstVaapiFilterJob * jobs, guint num_jobs, guint flags)
+{
+  GstVaapiFilterStatus status;
+  guint i;
+
+  g_return_val_if_fail (filter != NULL,
+      GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+  g_return_val_if_fail (jobs != NULL || num_jobs == 0,
+      GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+
+  for (i = 0; i < num_jobs; i++) {
+    g_return_val_if_fail (jobs[i].src_surface != NULL,
+        GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+    g_return_val_if_fail (jobs[i].dst_surface != NULL,
+        GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+  }
+
+  if (num_jobs == 0)
+    return GST_VAAPI_FILTER_STATUS_SUCCESS;
+
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->lock);
+  status = gst_vaapi_filter_process_batch_unlocked (filter, jobs, num_jobs,
+      flags, FALSE, NULL);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->lock);
+  return status;
+}
+
+/**
+ * gst_vaapi_filter_process_blend:
+ * @filter: a #GstVaapiFilter
+ * @dst_surface: the destination #GstVaapiSurface
+ * @surfaces: (array length=num_surfaces): the #GstVaapiFilterBlendSurface
+ *   to compose, from bottom to top
+ * @num_surfaces: the number of @surfaces
+ *
+ * Composes @surfaces into @dst_surface within a single picture. Each
+ * source surface is scaled into its target rectangle, and blended
+ * over the previous ones with its global alpha. The area of
+ * @dst_surface not covered by the first surface is filled with black.
+ *
+ * Cropping and target rectangles default as for
+ * gst_vaapi_filter_process_batch(), and the other operations of the
+ * @filter apply to every source surface.
+ *
+ * Return value: a #GstVaapiFilterStatus
+ */
+GstVaapiFilterStatus
+gst_vaapi_filter_process_blend (GstVaapiFilter * filter,
+    GstVaapiSurface * dst_surface, const GstVaapiFilterBlendSurface * surfaces,
+    guint num_surfaces)
+{
+  GstVaapiFilterJob *jobs;
+  gdouble *alphas;
+  gboolean has_alpha = FALSE;
+  GstVaapiFilterStatus status;
+  guint i;
+
+  g_return_val_if_fail (filter != NULL,
+      GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+  g_return_val_if_fail (dst_surface != NULL,
+      GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+  g_return_val_if_fail (surfaces != NULL && num_surfaces > 0,
+      GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+
+  jobs = g_new (GstVaapiFilterJob, num_surfaces);
+  alphas = g_new (gdouble, num_surfaces);
+  for (i = 0; i < num_surfaces; i++) {
+    if (!surfaces[i].surface) {
+      g_free (jobs);
+      g_free (alphas);
+      return GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER;
+    }
+    jobs[i].src_surface = surfaces[i].surface;
+    jobs[i].dst_surface = dst_surface;
+    jobs[i].crop_rect = surfaces[i].crop_rect;
+    jobs[i].target_rect = surfaces[i].target_rect;
+    alphas[i] = CLAMP (surfaces[i].alpha, 0.0, 1.0);
+    if (alphas[i] < 1.0)
+      has_alpha = TRUE;
+  }
+
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (filter->display, &filter->lock);
+  status = gst_vaapi_filter_process_batch_unlocked (filter, jobs,
+      num_surfaces, 0, FALSE, has_alpha ? alphas : NULL);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (filter->display, &filter->lock);
+
+  g_free (jobs);
+  g_free (alphas);
   return status;
 }
 
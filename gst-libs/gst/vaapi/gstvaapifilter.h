@@ -163,6 +163,40 @@ typedef enum {
   GST_VAAPI_DEINTERLACE_FLAG_TOPFIELD = 1 << 29,
 } GstVaapiDeinterlaceFlags;
 
+/**
+ * GstVaapiFilterJob:
+ * @src_surface: the source #GstVaapiSurface
+ * @dst_surface: the destination #GstVaapiSurface
+ * @crop_rect: the region of @src_surface to process, or %NULL
+ * @target_rect: the region of @dst_surface to write to, or %NULL
+ *
+ * A source to destination surface operation for
+ * gst_vaapi_filter_process_batch().
+ */
+typedef struct {
+  GstVaapiSurface *src_surface;
+  GstVaapiSurface *dst_surface;
+  const GstVaapiRectangle *crop_rect;
+  const GstVaapiRectangle *target_rect;
+} GstVaapiFilterJob;
+
+/**
+ * GstVaapiFilterBlendSurface:
+ * @surface: the source #GstVaapiSurface
+ * @crop_rect: the region of @surface to compose, or %NULL
+ * @target_rect: the region of the destination to compose into, or %NULL
+ * @alpha: the global alpha of @surface, from 0.0 (transparent) to
+ *   1.0 (opaque)
+ *
+ * A source surface for gst_vaapi_filter_process_blend().
+ */
+typedef struct {
+  GstVaapiSurface *surface;
+  const GstVaapiRectangle *crop_rect;
+  const GstVaapiRectangle *target_rect;
+  gdouble alpha;
+} GstVaapiFilterBlendSurface;
+
 #define GST_VAAPI_TYPE_SCALE_METHOD \
     gst_vaapi_scale_method_get_type()
 
@@ -208,6 +242,15 @@ GstVaapiFilterStatus
 gst_vaapi_filter_process (GstVaapiFilter * filter,
     GstVaapiSurface * src_surface, GstVaapiSurface * dst_surface, guint flags);
 
+GstVaapiFilterStatus
+gst_vaapi_filter_process_batch (GstVaapiFilter * filter,
+    const GstVaapiFilterJob * jobs, guint num_jobs, guint flags);
+
+GstVaapiFilterStatus
+gst_vaapi_filter_process_blend (GstVaapiFilter * filter,
+    GstVaapiSurface * dst_surface, const GstVaapiFilterBlendSurface * surfaces,
+    guint num_surfaces);
+
 GArray *
 gst_vaapi_filter_get_formats (GstVaapiFilter * filter);
 
@@ -30,6 +30,7 @@
 #include "sysdeps.h"
 #include "gstvaapicompat.h"
 #include "gstvaapiutils.h"
+#include "gstvaapiutils_copy.h"
 #include "gstvaapiimage.h"
 #include "gstvaapiimage_priv.h"
 #include "gstvaapiobject_priv.h"
@@ -558,10 +559,10 @@ _gst_vaapi_image_map (GstVaapiImage * image, GstVaapiImageRaw * raw_image)
   if (!display)
     return FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (display, NULL);
   status = vaMapBuffer (GST_VAAPI_DISPLAY_VADISPLAY (display),
       image->image.buf, (void **) &image->image_data);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (display, NULL);
   if (!vaapi_check_status (status, "vaMapBuffer()"))
     return FALSE;
 
@@ -611,10 +612,10 @@ _gst_vaapi_image_unmap (GstVaapiImage * image)
   if (!display)
     return FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (display, NULL);
   status = vaUnmapBuffer (GST_VAAPI_DISPLAY_VADISPLAY (display),
       image->image.buf);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (display, NULL);
   if (!vaapi_check_status (status, "vaUnmapBuffer()"))
     return FALSE;
 
@@ -715,21 +716,6 @@ init_image_from_buffer (GstVaapiImageRaw * raw_image, GstBuffer * buffer)
   return vmeta ? init_image_from_video_meta (raw_image, vmeta) : FALSE;
 }
 
-/* Copy N lines of an image */
-static inline void
-memcpy_pic (guchar * dst,
-    guint dst_stride,
-    const guchar * src, guint src_stride, guint len, guint height)
-{
-  guint i;
-
-  for (i = 0; i < height; i++) {
-    memcpy (dst, src, len);
-    dst += dst_stride;
-    src += src_stride;
-  }
-}
-
 /* Copy NV12 images */
 static void
 copy_image_NV12 (GstVaapiImageRaw * dst_image,
@@ -743,14 +729,16 @@ copy_image_NV12 (GstVaapiImageRaw * dst_image,
   dst = dst_image->pixels[0] + rect->y * dst_stride + rect->x;
   src_stride = src_image->stride[0];
   src = src_image->pixels[0] + rect->y * src_stride + rect->x;
-  memcpy_pic (dst, dst_stride, src, src_stride, rect->width, rect->height);
+  gst_vaapi_copy_plane (dst, dst_stride, src, src_stride, rect->width,
+      rect->height);
 
   /* UV plane */
   dst_stride = dst_image->stride[1];
   dst = dst_image->pixels[1] + (rect->y / 2) * dst_stride + (rect->x & -2);
   src_stride = src_image->stride[1];
   src = src_image->pixels[1] + (rect->y / 2) * src_stride + (rect->x & -2);
-  memcpy_pic (dst, dst_stride, src, src_stride, rect->width, rect->height / 2);
+  gst_vaapi_copy_plane (dst, dst_stride, src, src_stride, rect->width,
+      rect->height / 2);
 }
 
 /* Copy YV12 images */
@@ -767,7 +755,8 @@ copy_image_YV12 (GstVaapiImageRaw * dst_image,
   dst = dst_image->pixels[0] + rect->y * dst_stride + rect->x;
   src_stride = src_image->stride[0];
   src = src_image->pixels[0] + rect->y * src_stride + rect->x;
-  memcpy_pic (dst, dst_stride, src, src_stride, rect->width, rect->height);
+  gst_vaapi_copy_plane (dst, dst_stride, src, src_stride, rect->width,
+      rect->height);
 
   /* U/V planes */
   x = rect->x / 2;
@@ -779,7 +768,7 @@ copy_image_YV12 (GstVaapiImageRaw * dst_image,
     dst = dst_image->pixels[i] + y * dst_stride + x;
     src_stride = src_image->stride[i];
     src = src_image->pixels[i] + y * src_stride + x;
-    memcpy_pic (dst, dst_stride, src, src_stride, w, h);
+    gst_vaapi_copy_plane (dst, dst_stride, src, src_stride, w, h);
   }
 }
 
@@ -796,7 +785,8 @@ copy_image_YUY2 (GstVaapiImageRaw * dst_image,
   dst = dst_image->pixels[0] + rect->y * dst_stride + rect->x * 2;
   src_stride = src_image->stride[0];
   src = src_image->pixels[0] + rect->y * src_stride + rect->x * 2;
-  memcpy_pic (dst, dst_stride, src, src_stride, rect->width * 2, rect->height);
+  gst_vaapi_copy_plane (dst, dst_stride, src, src_stride,
+      rect->width * 2, rect->height);
 }
 
 /* Copy RGBA images */
@@ -811,7 +801,8 @@ copy_image_RGBA (GstVaapiImageRaw * dst_image,
   dst = dst_image->pixels[0] + rect->y * dst_stride + rect->x;
   src_stride = src_image->stride[0];
   src = src_image->pixels[0] + rect->y * src_stride + rect->x;
-  memcpy_pic (dst, dst_stride, src, src_stride, 4 * rect->width, rect->height);
+  gst_vaapi_copy_plane (dst, dst_stride, src, src_stride,
+      4 * rect->width, rect->height);
 }
 
 static gboolean
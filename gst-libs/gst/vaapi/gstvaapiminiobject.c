@@ -23,18 +23,232 @@
 #include <string.h>
 #include "gstvaapiminiobject.h"
 
+/* Maximum number of free objects kept per object size */
+#define MAX_FREE_OBJECTS (256)
+
+typedef struct _FreeList FreeList;
+struct _FreeList
+{
+  guint size;
+  guint length;
+  gpointer head;                /* next object is stored in the first bytes */
+};
+
+struct _GstVaapiMiniObjectArena
+{
+  volatile gint ref_count;
+  GMutex mutex;
+  GArray *free_lists;
+  guint num_free_objects;
+  guint64 num_allocs;
+  guint64 num_heap_allocs;
+  guint64 num_frames;
+  guint64 mark_heap_allocs;
+  guint last_frame_heap_allocs;
+};
+
+/* There are only a handful of object sizes in use, so a linear lookup
+   is cheaper than hashing */
+static FreeList *
+arena_get_free_list_unlocked (GstVaapiMiniObjectArena * arena, guint size)
+{
+  FreeList *list;
+  guint i;
+
+  for (i = 0; i < arena->free_lists->len; i++) {
+    list = &g_array_index (arena->free_lists, FreeList, i);
+    if (list->size == size)
+      return list;
+  }
+
+  g_array_set_size (arena->free_lists, i + 1);
+  list = &g_array_index (arena->free_lists, FreeList, i);
+  list->size = size;
+  list->length = 0;
+  list->head = NULL;
+  return list;
+}
+
+static gpointer
+arena_alloc (GstVaapiMiniObjectArena * arena, guint size)
+{
+  FreeList *list;
+  gpointer mem;
+
+  g_mutex_lock (&arena->mutex);
+  arena->num_allocs++;
+  list = arena_get_free_list_unlocked (arena, size);
+  mem = list->head;
+  if (mem) {
+    list->head = *(gpointer *) mem;
+    list->length--;
+    arena->num_free_objects--;
+  } else
+    arena->num_heap_allocs++;
+  g_mutex_unlock (&arena->mutex);
+
+  if (!mem)
+    mem = g_slice_alloc (size);
+  return mem;
+}
+
+static void
+arena_free (GstVaapiMiniObjectArena * arena, guint size, gpointer mem)
+{
+  FreeList *list;
+
+  g_mutex_lock (&arena->mutex);
+  list = arena_get_free_list_unlocked (arena, size);
+  if (list->length < MAX_FREE_OBJECTS) {
+    *(gpointer *) mem = list->head;
+    list->head = mem;
+    list->length++;
+    arena->num_free_objects++;
+    mem = NULL;
+  }
+  g_mutex_unlock (&arena->mutex);
+
+  if (mem)
+    g_slice_free1 (size, mem);
+}
+
 static void
 gst_vaapi_mini_object_free (GstVaapiMiniObject * object)
 {
   const GstVaapiMiniObjectClass *const klass = object->object_class;
+  GstVaapiMiniObjectArena *arena;
 
   g_atomic_int_inc (&object->ref_count);
 
   if (klass->finalize)
     klass->finalize (object);
 
-  if (G_LIKELY (g_atomic_int_dec_and_test (&object->ref_count)))
-    g_slice_free1 (klass->size, object);
+  if (G_LIKELY (g_atomic_int_dec_and_test (&object->ref_count))) {
+    arena = object->arena;
+    if (arena) {
+      arena_free (arena, klass->size, object);
+      gst_vaapi_mini_object_arena_unref (arena);
+    } else
+      g_slice_free1 (klass->size, object);
+  }
+}
+
+/**
+ * gst_vaapi_mini_object_arena_new:
+ *
+ * Creates a new #GstVaapiMiniObjectArena. Objects allocated from the
+ * arena with gst_vaapi_mini_object_new_from_arena() go back to it once
+ * they are destroyed, and are handed out again for the next object
+ * of the same size. This avoids hitting the heap for objects that are
+ * created and destroyed at frame or slice rate.
+ *
+ * Every live object holds a reference to its arena, so the arena may
+ * be released by its owner while objects are still around.
+ *
+ * Returns: The newly allocated #GstVaapiMiniObjectArena
+ */
+GstVaapiMiniObjectArena *
+gst_vaapi_mini_object_arena_new (void)
+{
+  GstVaapiMiniObjectArena *arena;
+
+  arena = g_slice_new0 (GstVaapiMiniObjectArena);
+  arena->ref_count = 1;
+  g_mutex_init (&arena->mutex);
+  arena->free_lists = g_array_new (FALSE, FALSE, sizeof (FreeList));
+  return arena;
+}
+
+/**
+ * gst_vaapi_mini_object_arena_ref:
+ * @arena: a #GstVaapiMiniObjectArena
+ *
+ * Atomically increases the reference count of the given @arena by one.
+ *
+ * Returns: The same @arena argument
+ */
+GstVaapiMiniObjectArena *
+gst_vaapi_mini_object_arena_ref (GstVaapiMiniObjectArena * arena)
+{
+  g_return_val_if_fail (arena != NULL, NULL);
+
+  g_atomic_int_inc (&arena->ref_count);
+  return arena;
+}
+
+/**
+ * gst_vaapi_mini_object_arena_unref:
+ * @arena: a #GstVaapiMiniObjectArena
+ *
+ * Atomically decreases the reference count of the @arena by one. If
+ * the reference count reaches zero, the arena and the objects it
+ * holds for reuse will be free'd.
+ */
+void
+gst_vaapi_mini_object_arena_unref (GstVaapiMiniObjectArena * arena)
+{
+  FreeList *list;
+  gpointer mem;
+  guint i;
+
+  g_return_if_fail (arena != NULL);
+
+  if (!g_atomic_int_dec_and_test (&arena->ref_count))
+    return;
+
+  for (i = 0; i < arena->free_lists->len; i++) {
+    list = &g_array_index (arena->free_lists, FreeList, i);
+    while ((mem = list->head)) {
+      list->head = *(gpointer *) mem;
+      g_slice_free1 (list->size, mem);
+    }
+  }
+  g_array_free (arena->free_lists, TRUE);
+  g_mutex_clear (&arena->mutex);
+  g_slice_free (GstVaapiMiniObjectArena, arena);
+}
+
+/**
+ * gst_vaapi_mini_object_arena_mark_frame:
+ * @arena: a #GstVaapiMiniObjectArena
+ *
+ * Marks the end of a frame, so that the number of heap allocations
+ * performed while processing it is accounted for in the statistics.
+ */
+void
+gst_vaapi_mini_object_arena_mark_frame (GstVaapiMiniObjectArena * arena)
+{
+  g_return_if_fail (arena != NULL);
+
+  g_mutex_lock (&arena->mutex);
+  arena->last_frame_heap_allocs =
+      arena->num_heap_allocs - arena->mark_heap_allocs;
+  arena->mark_heap_allocs = arena->num_heap_allocs;
+  arena->num_frames++;
+  g_mutex_unlock (&arena->mutex);
+}
+
+/**
+ * gst_vaapi_mini_object_arena_get_stats:
+ * @arena: a #GstVaapiMiniObjectArena
+ * @stats: return location for the #GstVaapiMiniObjectArenaStats
+ *
+ * Retrieves the usage statistics of @arena since it was created.
+ */
+void
+gst_vaapi_mini_object_arena_get_stats (GstVaapiMiniObjectArena * arena,
+    GstVaapiMiniObjectArenaStats * stats)
+{
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (stats != NULL);
+
+  g_mutex_lock (&arena->mutex);
+  stats->num_allocs = arena->num_allocs;
+  stats->num_heap_allocs = arena->num_heap_allocs;
+  stats->num_frames = arena->num_frames;
+  stats->last_frame_heap_allocs = arena->last_frame_heap_allocs;
+  stats->num_free_objects = arena->num_free_objects;
+  g_mutex_unlock (&arena->mutex);
 }
 
 /**
@@ -53,6 +267,24 @@ gst_vaapi_mini_object_free (GstVaapiMiniObject * object)
  */
 GstVaapiMiniObject *
 gst_vaapi_mini_object_new (const GstVaapiMiniObjectClass * object_class)
+{
+  return gst_vaapi_mini_object_new_from_arena (object_class, NULL);
+}
+
+/**
+ * gst_vaapi_mini_object_new_from_arena:
+ * @object_class: (optional): The object class
+ * @arena: (optional): a #GstVaapiMiniObjectArena
+ *
+ * Creates a new #GstVaapiMiniObject, as gst_vaapi_mini_object_new()
+ * does, but recycles the memory of an object of the same size that
+ * was released to @arena if there is one.
+ *
+ * Returns: The newly allocated #GstVaapiMiniObject
+ */
+GstVaapiMiniObject *
+gst_vaapi_mini_object_new_from_arena (const GstVaapiMiniObjectClass *
+    object_class, GstVaapiMiniObjectArena * arena)
 {
   GstVaapiMiniObject *object;
 
@@ -65,13 +297,17 @@ gst_vaapi_mini_object_new (const GstVaapiMiniObjectClass * object_class)
 
   g_return_val_if_fail (object_class->size >= sizeof (*object), NULL);
 
-  object = g_slice_alloc (object_class->size);
+  if (arena)
+    object = arena_alloc (arena, object_class->size);
+  else
+    object = g_slice_alloc (object_class->size);
   if (!object)
     return NULL;
 
   object->object_class = object_class;
   object->ref_count = 1;
   object->flags = 0;
+  object->arena = arena ? gst_vaapi_mini_object_arena_ref (arena) : NULL;
   return object;
 }
 
@@ -87,11 +323,29 @@ gst_vaapi_mini_object_new (const GstVaapiMiniObjectClass * object_class)
  */
 GstVaapiMiniObject *
 gst_vaapi_mini_object_new0 (const GstVaapiMiniObjectClass * object_class)
+{
+  return gst_vaapi_mini_object_new0_from_arena (object_class, NULL);
+}
+
+/**
+ * gst_vaapi_mini_object_new0_from_arena:
+ * @object_class: (optional): The object class
+ * @arena: (optional): a #GstVaapiMiniObjectArena
+ *
+ * Creates a new #GstVaapiMiniObject. This function is similar to
+ * gst_vaapi_mini_object_new_from_arena() but derived object data is
+ * initialized to zeroes.
+ *
+ * Returns: The newly allocated #GstVaapiMiniObject
+ */
+GstVaapiMiniObject *
+gst_vaapi_mini_object_new0_from_arena (const GstVaapiMiniObjectClass *
+    object_class, GstVaapiMiniObjectArena * arena)
 {
   GstVaapiMiniObject *object;
   guint sub_size;
 
-  object = gst_vaapi_mini_object_new (object_class);
+  object = gst_vaapi_mini_object_new_from_arena (object_class, arena);
   if (!object)
     return NULL;
 
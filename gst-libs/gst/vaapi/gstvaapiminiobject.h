@@ -29,6 +29,8 @@ G_BEGIN_DECLS
 
 typedef struct _GstVaapiMiniObject              GstVaapiMiniObject;
 typedef struct _GstVaapiMiniObjectClass         GstVaapiMiniObjectClass;
+typedef struct _GstVaapiMiniObjectArena         GstVaapiMiniObjectArena;
+typedef struct _GstVaapiMiniObjectArenaStats    GstVaapiMiniObjectArenaStats;
 
 /**
  * GST_VAAPI_MINI_OBJECT:
@@ -112,6 +114,8 @@ typedef struct _GstVaapiMiniObjectClass         GstVaapiMiniObjectClass;
  *   through gst_vaapi_mini_object_ref() et al. helpers
  * @flags: set of flags that should be manipulated through
  *   GST_VAAPI_MINI_OBJECT_FLAG_*() functions
+ * @arena: the #GstVaapiMiniObjectArena the object memory goes back
+ *   to, or %NULL
  *
  * A #GstVaapiMiniObject represents a minimal reference counted data
  * structure that can hold a set of flags and user-provided data.
@@ -122,6 +126,7 @@ struct _GstVaapiMiniObject
   gconstpointer object_class;
   volatile gint ref_count;
   guint flags;
+  GstVaapiMiniObjectArena *arena;
 };
 
 /**
@@ -141,9 +146,55 @@ struct _GstVaapiMiniObjectClass
   GDestroyNotify finalize;
 };
 
+/**
+ * GstVaapiMiniObjectArenaStats:
+ * @num_allocs: number of objects allocated from the arena
+ * @num_heap_allocs: number of those that had to be allocated from the
+ *   heap, i.e. that could not be recycled
+ * @num_frames: number of frames marked with
+ *   gst_vaapi_mini_object_arena_mark_frame()
+ * @last_frame_heap_allocs: number of heap allocations during the last
+ *   marked frame
+ * @num_free_objects: number of objects currently held for reuse
+ *
+ * Usage statistics of a #GstVaapiMiniObjectArena.
+ */
+struct _GstVaapiMiniObjectArenaStats
+{
+  guint64 num_allocs;
+  guint64 num_heap_allocs;
+  guint64 num_frames;
+  guint last_frame_heap_allocs;
+  guint num_free_objects;
+};
+
+GstVaapiMiniObjectArena *
+gst_vaapi_mini_object_arena_new (void);
+
+GstVaapiMiniObjectArena *
+gst_vaapi_mini_object_arena_ref (GstVaapiMiniObjectArena * arena);
+
+void
+gst_vaapi_mini_object_arena_unref (GstVaapiMiniObjectArena * arena);
+
+void
+gst_vaapi_mini_object_arena_mark_frame (GstVaapiMiniObjectArena * arena);
+
+void
+gst_vaapi_mini_object_arena_get_stats (GstVaapiMiniObjectArena * arena,
+    GstVaapiMiniObjectArenaStats * stats);
+
 GstVaapiMiniObject *
 gst_vaapi_mini_object_new (const GstVaapiMiniObjectClass * object_class);
 
+GstVaapiMiniObject *
+gst_vaapi_mini_object_new_from_arena (const GstVaapiMiniObjectClass *
+    object_class, GstVaapiMiniObjectArena * arena);
+
+GstVaapiMiniObject *
+gst_vaapi_mini_object_new0_from_arena (const GstVaapiMiniObjectClass *
+    object_class, GstVaapiMiniObjectArena * arena);
+
 GstVaapiMiniObject *
 gst_vaapi_mini_object_new0 (const GstVaapiMiniObjectClass * object_class);
 
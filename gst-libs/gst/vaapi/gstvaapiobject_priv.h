@@ -158,6 +158,30 @@ G_PASTE(t_n,_class) (void)                                      \
 #define GST_VAAPI_OBJECT_UNLOCK_DISPLAY(object) \
   GST_VAAPI_DISPLAY_UNLOCK (GST_VAAPI_OBJECT_DISPLAY (object))
 
+/**
+ * GST_VAAPI_OBJECT_LOCK_DISPLAY_SHARED:
+ * @object: a #GstVaapiObject
+ *
+ * Macro that locks the #GstVaapiDisplay contained in the @object for a
+ * VA call that only involves @object, e.g. a surface sync or a buffer
+ * map. Unlike GST_VAAPI_OBJECT_LOCK_DISPLAY(), this takes no lock in
+ * %GST_VAAPI_DISPLAY_LOCK_MODE_CONTEXT mode.
+ * This is an internal macro that does not do any run-time type check.
+ */
+#define GST_VAAPI_OBJECT_LOCK_DISPLAY_SHARED(object) \
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (GST_VAAPI_OBJECT_DISPLAY (object), NULL)
+
+/**
+ * GST_VAAPI_OBJECT_UNLOCK_DISPLAY_SHARED:
+ * @object: a #GstVaapiObject
+ *
+ * Macro that unlocks the #GstVaapiDisplay locked with
+ * GST_VAAPI_OBJECT_LOCK_DISPLAY_SHARED().
+ * This is an internal macro that does not do any run-time type check.
+ */
+#define GST_VAAPI_OBJECT_UNLOCK_DISPLAY_SHARED(object) \
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (GST_VAAPI_OBJECT_DISPLAY (object), NULL)
+
 /**
  * GstVaapiObject:
  *
@@ -170,6 +194,9 @@ struct _GstVaapiObject
 
   GstVaapiDisplay *display;
   GstVaapiID object_id;
+
+  /* The #GstVaapiVideoPool this object is checked out from, if any */
+  gpointer pool;
 };
 
 /**
@@ -69,19 +69,22 @@ free_units (GArray ** units_ptr)
  * gst_vaapi_parser_frame_new:
  * @width: frame width in pixels
  * @height: frame height in pixels
+ * @arena: (optional): a #GstVaapiMiniObjectArena to allocate from
  *
  * Creates a new #GstVaapiParserFrame object.
  *
  * Returns: The newly allocated #GstVaapiParserFrame
  */
 GstVaapiParserFrame *
-gst_vaapi_parser_frame_new (guint width, guint height)
+gst_vaapi_parser_frame_new (guint width, guint height,
+    GstVaapiMiniObjectArena * arena)
 {
   GstVaapiParserFrame *frame;
   guint num_slices;
 
   frame = (GstVaapiParserFrame *)
-      gst_vaapi_mini_object_new (gst_vaapi_parser_frame_class ());
+      gst_vaapi_mini_object_new_from_arena (gst_vaapi_parser_frame_class (),
+      arena);
   if (!frame)
     return NULL;
 
@@ -96,6 +99,12 @@ gst_vaapi_parser_frame_new (guint width, guint height)
   if (!alloc_units (&frame->post_units, 1))
     goto error;
   frame->output_offset = 0;
+  frame->parse_time = 0;
+  frame->num_decoded_pre_units = 0;
+  frame->num_decoded_units = 0;
+  frame->decode_status = 0;
+  frame->decode_time = 0;
+  frame->pending_buffer = NULL;
   return frame;
 
   /* ERRORS */
@@ -122,6 +131,7 @@ gst_vaapi_parser_frame_free (GstVaapiParserFrame * frame)
   free_units (&frame->units);
   free_units (&frame->pre_units);
   free_units (&frame->post_units);
+  gst_buffer_replace (&frame->pending_buffer, NULL);
 }
 
 /**
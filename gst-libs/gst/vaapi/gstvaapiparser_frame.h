@@ -44,6 +44,14 @@ typedef struct _GstVaapiParserFrame             GstVaapiParserFrame;
  * @units: list of #GstVaapiDecoderUnit objects (slice data)
  * @pre_units: list of units to decode before GstVaapiDecoder:start_frame()
  * @post_units: list of units to decode after GstVaapiDecoder:end_frame()
+ * @parse_time: time spent parsing the units of this frame, in ns
+ * @num_decoded_pre_units: number of @pre_units decoded while parsing
+ * @num_decoded_units: number of @units decoded while parsing
+ * @decode_status: the #GstVaapiDecoderStatus of the units decoded
+ *    while parsing
+ * @decode_time: time spent decoding units while parsing, in ns
+ * @pending_buffer: data of the last slice, until it is decoded while
+ *    parsing
  *
  * An extension to #GstVideoCodecFrame with #GstVaapiDecoder specific
  * information. Decoder frames are usually attached to codec frames as
@@ -57,11 +65,18 @@ struct _GstVaapiParserFrame {
     GArray             *units;
     GArray             *pre_units;
     GArray             *post_units;
+    GstClockTime        parse_time;
+    guint               num_decoded_pre_units;
+    guint               num_decoded_units;
+    gint                decode_status;
+    GstClockTime        decode_time;
+    GstBuffer          *pending_buffer;
 };
 
 G_GNUC_INTERNAL
 GstVaapiParserFrame *
-gst_vaapi_parser_frame_new(guint width, guint height);
+gst_vaapi_parser_frame_new(guint width, guint height,
+    GstVaapiMiniObjectArena * arena);
 
 G_GNUC_INTERNAL
 void
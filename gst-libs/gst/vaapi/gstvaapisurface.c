@@ -36,6 +36,7 @@
 #include "gstvaapiimage.h"
 #include "gstvaapiimage_priv.h"
 #include "gstvaapibufferproxy_priv.h"
+#include "gstvaapidisplay_priv.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -78,6 +79,19 @@ gst_vaapi_surface_destroy (GstVaapiSurface * surface)
 
   gst_vaapi_surface_destroy_subpictures (surface);
 
+  /* Surfaces exported or imported through a buffer proxy may still be
+     referenced outside of VA, so they cannot be recycled */
+  if (surface_id != VA_INVALID_SURFACE && surface->cacheable &&
+      !surface->extbuf_proxy &&
+      gst_vaapi_surface_cache_put (GST_VAAPI_DISPLAY_GET_PRIVATE
+          (display)->surface_cache, surface_id, surface->cache_format,
+          surface->chroma_type, surface->width, surface->height)) {
+    GST_DEBUG ("surface %" GST_VAAPI_ID_FORMAT " released to the cache",
+        GST_VAAPI_ID_ARGS (surface_id));
+    GST_VAAPI_OBJECT_ID (surface) = VA_INVALID_SURFACE;
+    surface_id = VA_INVALID_SURFACE;
+  }
+
   if (surface_id != VA_INVALID_SURFACE) {
     GST_VAAPI_DISPLAY_LOCK (display);
     status = vaDestroySurfaces (GST_VAAPI_DISPLAY_VADISPLAY (display),
@@ -104,17 +118,24 @@ gst_vaapi_surface_create (GstVaapiSurface * surface,
   if (!va_chroma_format)
     goto error_unsupported_chroma_type;
 
-  GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaCreateSurfaces (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      width, height, va_chroma_format, 1, &surface_id);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
-  if (!vaapi_check_status (status, "vaCreateSurfaces()"))
-    return FALSE;
+  surface_id = gst_vaapi_surface_cache_get (GST_VAAPI_DISPLAY_GET_PRIVATE
+      (display)->surface_cache, GST_VIDEO_FORMAT_UNKNOWN, chroma_type,
+      width, height);
+  if (surface_id == VA_INVALID_SURFACE) {
+    GST_VAAPI_DISPLAY_LOCK (display);
+    status = vaCreateSurfaces (GST_VAAPI_DISPLAY_VADISPLAY (display),
+        width, height, va_chroma_format, 1, &surface_id);
+    GST_VAAPI_DISPLAY_UNLOCK (display);
+    if (!vaapi_check_status (status, "vaCreateSurfaces()"))
+      return FALSE;
+  }
 
   surface->format = GST_VIDEO_FORMAT_UNKNOWN;
   surface->chroma_type = chroma_type;
   surface->width = width;
   surface->height = height;
+  surface->cache_format = GST_VIDEO_FORMAT_UNKNOWN;
+  surface->cacheable = TRUE;
 
   GST_DEBUG ("surface %" GST_VAAPI_ID_FORMAT, GST_VAAPI_ID_ARGS (surface_id));
   GST_VAAPI_OBJECT_ID (surface) = surface_id;
@@ -194,18 +215,29 @@ gst_vaapi_surface_create_full (GstVaapiSurface * surface,
     attrib++;
   }
 
-  GST_VAAPI_DISPLAY_LOCK (display);
-  status = vaCreateSurfaces (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      va_chroma_format, extbuf.width, extbuf.height, &surface_id, 1,
-      attribs, attrib - attribs);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
-  if (!vaapi_check_status (status, "vaCreateSurfaces()"))
-    return FALSE;
+  /* Only surfaces with the default layout are interchangeable */
+  surface_id = VA_INVALID_SURFACE;
+  if (!flags) {
+    surface_id = gst_vaapi_surface_cache_get (GST_VAAPI_DISPLAY_GET_PRIVATE
+        (display)->surface_cache, format, chroma_type, extbuf.width,
+        extbuf.height);
+  }
+  if (surface_id == VA_INVALID_SURFACE) {
+    GST_VAAPI_DISPLAY_LOCK (display);
+    status = vaCreateSurfaces (GST_VAAPI_DISPLAY_VADISPLAY (display),
+        va_chroma_format, extbuf.width, extbuf.height, &surface_id, 1,
+        attribs, attrib - attribs);
+    GST_VAAPI_DISPLAY_UNLOCK (display);
+    if (!vaapi_check_status (status, "vaCreateSurfaces()"))
+      return FALSE;
+  }
 
   surface->format = format;
   surface->chroma_type = chroma_type;
   surface->width = extbuf.width;
   surface->height = extbuf.height;
+  surface->cache_format = format;
+  surface->cacheable = !flags;
 
   GST_DEBUG ("surface %" GST_VAAPI_ID_FORMAT, GST_VAAPI_ID_ARGS (surface_id));
   GST_VAAPI_OBJECT_ID (surface) = surface_id;
@@ -945,10 +977,10 @@ gst_vaapi_surface_sync (GstVaapiSurface * surface)
   if (!display)
     return FALSE;
 
-  GST_VAAPI_DISPLAY_LOCK (display);
+  GST_VAAPI_DISPLAY_LOCK_CONTEXT (display, NULL);
   status = vaSyncSurface (GST_VAAPI_DISPLAY_VADISPLAY (display),
       GST_VAAPI_OBJECT_ID (surface));
-  GST_VAAPI_DISPLAY_UNLOCK (display);
+  GST_VAAPI_DISPLAY_UNLOCK_CONTEXT (display, NULL);
   if (!vaapi_check_status (status, "vaSyncSurface()"))
     return FALSE;
 
@@ -974,10 +1006,10 @@ gst_vaapi_surface_query_status (GstVaapiSurface * surface,
 
   g_return_val_if_fail (surface != NULL, FALSE);
 
-  GST_VAAPI_OBJECT_LOCK_DISPLAY (surface);
+  GST_VAAPI_OBJECT_LOCK_DISPLAY_SHARED (surface);
   status = vaQuerySurfaceStatus (GST_VAAPI_OBJECT_VADISPLAY (surface),
       GST_VAAPI_OBJECT_ID (surface), &surface_status);
-  GST_VAAPI_OBJECT_UNLOCK_DISPLAY (surface);
+  GST_VAAPI_OBJECT_UNLOCK_DISPLAY_SHARED (surface);
   if (!vaapi_check_status (status, "vaQuerySurfaceStatus()"))
     return FALSE;
 
@@ -47,6 +47,10 @@ struct _GstVaapiSurface
   guint height;
   GstVaapiChromaType chroma_type;
   GPtrArray *subpictures;
+
+  /* allocation format, if the surface can go to the display cache */
+  GstVideoFormat cache_format;
+  guint cacheable:1;
 };
 
 /**
@@ -0,0 +1,425 @@
+/*
+ *  gstvaapisurfacecache.c - VA surface cache
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Idle VA surfaces, kept by their allocation parameters so that they
+ * can be handed out again instead of going through vaDestroySurfaces()
+ * and vaCreateSurfaces(), e.g. when the stream resolution toggles
+ * between a few values. Only the VA surface ids are kept, so the cache
+ * does not hold any reference to the display it belongs to.
+ */
+
+#include "sysdeps.h"
+#include "gstvaapicompat.h"
+#include "gstvaapisurfacecache.h"
+#include "gstvaapidisplay_priv.h"
+#include "gstvaapiutils.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+typedef struct _CacheKey CacheKey;
+struct _CacheKey
+{
+  GstVideoFormat format;
+  GstVaapiChromaType chroma_type;
+  guint width;
+  guint height;
+};
+
+typedef struct _CacheBucket CacheBucket;
+struct _CacheBucket
+{
+  CacheKey key;
+  GQueue entries;               /* most recently released first */
+};
+
+typedef struct _CacheEntry CacheEntry;
+struct _CacheEntry
+{
+  GList lru_link;
+  GList bucket_link;
+  CacheBucket *bucket;
+  VASurfaceID surface_id;
+  gsize size;
+};
+
+struct _GstVaapiSurfaceCache
+{
+  GstVaapiDisplay *display;
+  GMutex mutex;
+  GHashTable *buckets;
+  GQueue lru;                   /* most recently released first */
+  gsize size;
+  gsize max_size;
+  guint64 hits;
+  guint64 misses;
+  guint64 evictions;
+};
+
+static guint
+cache_key_hash (gconstpointer data)
+{
+  const CacheKey *const key = data;
+
+  return (((guint) key->format << 24) ^ ((guint) key->chroma_type << 16) ^
+      (key->width << 12) ^ key->height);
+}
+
+static gboolean
+cache_key_equal (gconstpointer a, gconstpointer b)
+{
+  const CacheKey *const key_a = a;
+  const CacheKey *const key_b = b;
+
+  return key_a->format == key_b->format &&
+      key_a->chroma_type == key_b->chroma_type &&
+      key_a->width == key_b->width && key_a->height == key_b->height;
+}
+
+static void
+cache_bucket_free (CacheBucket * bucket)
+{
+  g_slice_free (CacheBucket, bucket);
+}
+
+/* Returns an estimate of the memory held by a surface, in bytes */
+static gsize
+get_surface_size (GstVideoFormat format, GstVaapiChromaType chroma_type,
+    guint width, guint height)
+{
+  guint bits_per_pixel;
+
+  if (format != GST_VIDEO_FORMAT_UNKNOWN) {
+    GstVideoInfo vi;
+
+    gst_video_info_set_format (&vi, format, width, height);
+    if (GST_VIDEO_INFO_SIZE (&vi) > 0)
+      return GST_VIDEO_INFO_SIZE (&vi);
+  }
+
+  switch (chroma_type) {
+    case GST_VAAPI_CHROMA_TYPE_YUV400:
+      bits_per_pixel = 8;
+      break;
+    case GST_VAAPI_CHROMA_TYPE_YUV420:
+    case GST_VAAPI_CHROMA_TYPE_YUV411:
+      bits_per_pixel = 12;
+      break;
+    case GST_VAAPI_CHROMA_TYPE_YUV422:
+    case GST_VAAPI_CHROMA_TYPE_RGB16:
+      bits_per_pixel = 16;
+      break;
+    case GST_VAAPI_CHROMA_TYPE_YUV444:
+    case GST_VAAPI_CHROMA_TYPE_RGBP:
+    case GST_VAAPI_CHROMA_TYPE_YUV420_10BPP:
+    case GST_VAAPI_CHROMA_TYPE_YUV420_12BPP:
+      bits_per_pixel = 24;
+      break;
+    case GST_VAAPI_CHROMA_TYPE_YUV444_12BPP:
+      bits_per_pixel = 48;
+      break;
+    default:
+      bits_per_pixel = 32;
+      break;
+  }
+  return (gsize) width * height * bits_per_pixel / 8;
+}
+
+static void
+destroy_surfaces (GstVaapiSurfaceCache * cache, GArray * surfaces)
+{
+  GstVaapiDisplay *const display = cache->display;
+  VAStatus status;
+
+  if (surfaces->len == 0)
+    return;
+
+  GST_DEBUG ("destroy %u cached surfaces", surfaces->len);
+
+  GST_VAAPI_DISPLAY_LOCK (display);
+  status = vaDestroySurfaces (GST_VAAPI_DISPLAY_VADISPLAY (display),
+      (VASurfaceID *) surfaces->data, surfaces->len);
+  GST_VAAPI_DISPLAY_UNLOCK (display);
+  if (!vaapi_check_status (status, "vaDestroySurfaces()"))
+    GST_WARNING ("failed to destroy %u cached surfaces", surfaces->len);
+}
+
+static void
+cache_entry_remove_unlocked (GstVaapiSurfaceCache * cache, CacheEntry * entry)
+{
+  g_queue_unlink (&cache->lru, &entry->lru_link);
+  g_queue_unlink (&entry->bucket->entries, &entry->bucket_link);
+  cache->size -= entry->size;
+}
+
+/* Evicts the least recently released surfaces until the cache fits
+   in max_size, and collects their ids into surfaces */
+static void
+cache_evict_unlocked (GstVaapiSurfaceCache * cache, gsize max_size,
+    GArray * surfaces)
+{
+  CacheEntry *entry;
+  GList *link;
+
+  while (cache->size > max_size) {
+    link = g_queue_peek_tail_link (&cache->lru);
+    if (!link)
+      break;
+    entry = link->data;
+    cache_entry_remove_unlocked (cache, entry);
+    g_array_append_val (surfaces, entry->surface_id);
+    g_slice_free (CacheEntry, entry);
+    cache->evictions++;
+  }
+}
+
+/**
+ * gst_vaapi_surface_cache_new:
+ * @display: a #GstVaapiDisplay
+ *
+ * Creates an empty surface cache for @display. The cache is disabled
+ * until a maximum size is set with gst_vaapi_surface_cache_set_max_size().
+ * It shall be free'd before the VA display is terminated.
+ *
+ * Return value: the newly allocated #GstVaapiSurfaceCache
+ */
+GstVaapiSurfaceCache *
+gst_vaapi_surface_cache_new (GstVaapiDisplay * display)
+{
+  GstVaapiSurfaceCache *cache;
+
+  g_return_val_if_fail (display != NULL, NULL);
+
+  cache = g_slice_new0 (GstVaapiSurfaceCache);
+  cache->display = display;
+  g_mutex_init (&cache->mutex);
+  cache->buckets = g_hash_table_new_full (cache_key_hash, cache_key_equal,
+      NULL, (GDestroyNotify) cache_bucket_free);
+  g_queue_init (&cache->lru);
+  return cache;
+}
+
+/**
+ * gst_vaapi_surface_cache_free:
+ * @cache: a #GstVaapiSurfaceCache
+ *
+ * Destroys all the cached surfaces and frees @cache.
+ */
+void
+gst_vaapi_surface_cache_free (GstVaapiSurfaceCache * cache)
+{
+  if (!cache)
+    return;
+
+  gst_vaapi_surface_cache_clear (cache);
+  g_hash_table_unref (cache->buckets);
+  g_mutex_clear (&cache->mutex);
+  g_slice_free (GstVaapiSurfaceCache, cache);
+}
+
+/**
+ * gst_vaapi_surface_cache_set_max_size:
+ * @cache: a #GstVaapiSurfaceCache
+ * @max_size: the memory budget, in bytes, or zero to disable the cache
+ *
+ * Sets the amount of surface memory @cache can hold. Surfaces beyond
+ * that are destroyed, least recently released first.
+ */
+void
+gst_vaapi_surface_cache_set_max_size (GstVaapiSurfaceCache * cache,
+    gsize max_size)
+{
+  GArray *surfaces;
+
+  g_return_if_fail (cache != NULL);
+
+  surfaces = g_array_new (FALSE, FALSE, sizeof (VASurfaceID));
+  g_mutex_lock (&cache->mutex);
+  cache->max_size = max_size;
+  cache_evict_unlocked (cache, max_size, surfaces);
+  g_mutex_unlock (&cache->mutex);
+
+  destroy_surfaces (cache, surfaces);
+  g_array_free (surfaces, TRUE);
+}
+
+/**
+ * gst_vaapi_surface_cache_get:
+ * @cache: a #GstVaapiSurfaceCache
+ * @format: the surface format, or %GST_VIDEO_FORMAT_UNKNOWN
+ * @chroma_type: the surface chroma type
+ * @width: the surface width
+ * @height: the surface height
+ *
+ * Takes the most recently released surface matching the allocation
+ * parameters out of @cache. The @format is %GST_VIDEO_FORMAT_UNKNOWN
+ * for surfaces allocated from a chroma type only.
+ *
+ * Return value: the VA surface id, or %VA_INVALID_SURFACE if there is
+ *   no such surface in @cache
+ */
+VASurfaceID
+gst_vaapi_surface_cache_get (GstVaapiSurfaceCache * cache,
+    GstVideoFormat format, GstVaapiChromaType chroma_type,
+    guint width, guint height)
+{
+  const CacheKey key = { format, chroma_type, width, height };
+  VASurfaceID surface_id = VA_INVALID_SURFACE;
+  CacheBucket *bucket;
+  CacheEntry *entry;
+  GList *link;
+
+  g_return_val_if_fail (cache != NULL, VA_INVALID_SURFACE);
+
+  g_mutex_lock (&cache->mutex);
+  if (cache->max_size == 0)
+    goto done;
+
+  bucket = g_hash_table_lookup (cache->buckets, &key);
+  link = bucket ? g_queue_peek_head_link (&bucket->entries) : NULL;
+  if (!link) {
+    cache->misses++;
+    goto done;
+  }
+
+  entry = link->data;
+  cache_entry_remove_unlocked (cache, entry);
+  surface_id = entry->surface_id;
+  g_slice_free (CacheEntry, entry);
+  cache->hits++;
+
+done:
+  g_mutex_unlock (&cache->mutex);
+  return surface_id;
+}
+
+/**
+ * gst_vaapi_surface_cache_put:
+ * @cache: a #GstVaapiSurfaceCache
+ * @surface_id: the VA surface id
+ * @format: the surface format, or %GST_VIDEO_FORMAT_UNKNOWN
+ * @chroma_type: the surface chroma type
+ * @width: the surface width
+ * @height: the surface height
+ *
+ * Hands an idle surface over to @cache, which then owns it. This may
+ * destroy older surfaces to stay within the memory budget.
+ *
+ * Return value: %TRUE if @cache took the surface, %FALSE if the cache
+ *   is disabled or the surface alone exceeds the budget, in which case
+ *   the caller still owns the surface
+ */
+gboolean
+gst_vaapi_surface_cache_put (GstVaapiSurfaceCache * cache,
+    VASurfaceID surface_id, GstVideoFormat format,
+    GstVaapiChromaType chroma_type, guint width, guint height)
+{
+  const CacheKey key = { format, chroma_type, width, height };
+  const gsize size = get_surface_size (format, chroma_type, width, height);
+  CacheBucket *bucket;
+  CacheEntry *entry;
+  GArray *surfaces;
+
+  g_return_val_if_fail (cache != NULL, FALSE);
+  g_return_val_if_fail (surface_id != VA_INVALID_SURFACE, FALSE);
+
+  g_mutex_lock (&cache->mutex);
+  if (size > cache->max_size) {
+    g_mutex_unlock (&cache->mutex);
+    return FALSE;
+  }
+
+  bucket = g_hash_table_lookup (cache->buckets, &key);
+  if (!bucket) {
+    bucket = g_slice_new (CacheBucket);
+    bucket->key = key;
+    g_queue_init (&bucket->entries);
+    g_hash_table_insert (cache->buckets, &bucket->key, bucket);
+  }
+
+  entry = g_slice_new (CacheEntry);
+  entry->lru_link.data = entry;
+  entry->bucket_link.data = entry;
+  entry->bucket = bucket;
+  entry->surface_id = surface_id;
+  entry->size = size;
+  g_queue_push_head_link (&cache->lru, &entry->lru_link);
+  g_queue_push_head_link (&bucket->entries, &entry->bucket_link);
+  cache->size += size;
+
+  surfaces = g_array_new (FALSE, FALSE, sizeof (VASurfaceID));
+  cache_evict_unlocked (cache, cache->max_size, surfaces);
+  g_mutex_unlock (&cache->mutex);
+
+  destroy_surfaces (cache, surfaces);
+  g_array_free (surfaces, TRUE);
+  return TRUE;
+}
+
+/**
+ * gst_vaapi_surface_cache_clear:
+ * @cache: a #GstVaapiSurfaceCache
+ *
+ * Destroys all the surfaces held in @cache. The memory budget and the
+ * statistics are preserved.
+ */
+void
+gst_vaapi_surface_cache_clear (GstVaapiSurfaceCache * cache)
+{
+  GArray *surfaces;
+  guint64 evictions;
+
+  g_return_if_fail (cache != NULL);
+
+  surfaces = g_array_new (FALSE, FALSE, sizeof (VASurfaceID));
+  g_mutex_lock (&cache->mutex);
+  evictions = cache->evictions;
+  cache_evict_unlocked (cache, 0, surfaces);
+  cache->evictions = evictions;
+  g_hash_table_remove_all (cache->buckets);
+  g_mutex_unlock (&cache->mutex);
+
+  destroy_surfaces (cache, surfaces);
+  g_array_free (surfaces, TRUE);
+}
+
+/**
+ * gst_vaapi_surface_cache_get_stats:
+ * @cache: a #GstVaapiSurfaceCache
+ * @stats: return location for the statistics
+ *
+ * Fills in @stats with the current state of @cache.
+ */
+void
+gst_vaapi_surface_cache_get_stats (GstVaapiSurfaceCache * cache,
+    GstVaapiSurfaceCacheStats * stats)
+{
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (stats != NULL);
+
+  g_mutex_lock (&cache->mutex);
+  stats->size = cache->size;
+  stats->max_size = cache->max_size;
+  stats->num_surfaces = cache->lru.length;
+  stats->hits = cache->hits;
+  stats->misses = cache->misses;
+  stats->evictions = cache->evictions;
+  g_mutex_unlock (&cache->mutex);
+}
@@ -0,0 +1,67 @@
+/*
+ *  gstvaapisurfacecache.h - VA surface cache
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_SURFACE_CACHE_H
+#define GST_VAAPI_SURFACE_CACHE_H
+
+#include <gst/vaapi/gstvaapidisplay.h>
+#include <gst/vaapi/gstvaapisurface.h>
+#include <va/va.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiSurfaceCache GstVaapiSurfaceCache;
+
+G_GNUC_INTERNAL
+GstVaapiSurfaceCache *
+gst_vaapi_surface_cache_new (GstVaapiDisplay * display);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_surface_cache_free (GstVaapiSurfaceCache * cache);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_surface_cache_set_max_size (GstVaapiSurfaceCache * cache,
+    gsize max_size);
+
+G_GNUC_INTERNAL
+VASurfaceID
+gst_vaapi_surface_cache_get (GstVaapiSurfaceCache * cache,
+    GstVideoFormat format, GstVaapiChromaType chroma_type,
+    guint width, guint height);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_surface_cache_put (GstVaapiSurfaceCache * cache,
+    VASurfaceID surface_id, GstVideoFormat format,
+    GstVaapiChromaType chroma_type, guint width, guint height);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_surface_cache_clear (GstVaapiSurfaceCache * cache);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_surface_cache_get_stats (GstVaapiSurfaceCache * cache,
+    GstVaapiSurfaceCacheStats * stats);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_SURFACE_CACHE_H */
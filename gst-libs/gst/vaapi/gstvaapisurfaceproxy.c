@@ -152,13 +152,31 @@ error:
  */
 GstVaapiSurfaceProxy *
 gst_vaapi_surface_proxy_new_from_pool (GstVaapiSurfacePool * pool)
+{
+  return gst_vaapi_surface_proxy_new_from_pool_with_arena (pool, NULL);
+}
+
+/**
+ * gst_vaapi_surface_proxy_new_from_pool_with_arena:
+ * @pool: a #GstVaapiSurfacePool
+ * @arena: (optional): a #GstVaapiMiniObjectArena
+ *
+ * Acts as gst_vaapi_surface_proxy_new_from_pool(), but allocates the
+ * proxy object from @arena.
+ *
+ * Returns: The same newly allocated @proxy object, or %NULL on error
+ */
+GstVaapiSurfaceProxy *
+gst_vaapi_surface_proxy_new_from_pool_with_arena (GstVaapiSurfacePool * pool,
+    GstVaapiMiniObjectArena * arena)
 {
   GstVaapiSurfaceProxy *proxy;
 
   g_return_val_if_fail (pool != NULL, NULL);
 
   proxy = (GstVaapiSurfaceProxy *)
-      gst_vaapi_mini_object_new (gst_vaapi_surface_proxy_class ());
+      gst_vaapi_mini_object_new_from_arena (gst_vaapi_surface_proxy_class (),
+      arena);
   if (!proxy)
     return NULL;
 
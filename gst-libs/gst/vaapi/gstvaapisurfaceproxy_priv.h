@@ -140,4 +140,9 @@ struct _GstVaapiSurfaceProxy
   (GST_VAAPI_SURFACE_PROXY (proxy)->has_crop_rect ? \
      &GST_VAAPI_SURFACE_PROXY (proxy)->crop_rect : NULL)
 
+G_GNUC_INTERNAL
+GstVaapiSurfaceProxy *
+gst_vaapi_surface_proxy_new_from_pool_with_arena (GstVaapiSurfacePool * pool,
+    GstVaapiMiniObjectArena * arena);
+
 #endif /* GST_VAAPI_SURFACE_PROXY_PRIV_H */
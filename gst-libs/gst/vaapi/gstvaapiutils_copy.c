@@ -0,0 +1,325 @@
+/*
+ *  gstvaapiutils_copy.c - Optimized plane copy kernels
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Images mapped through vaDeriveImage() usually live in uncached,
+ * write-combined (USWC) memory, where regular loads are extremely
+ * slow. On x86, MOVNTDQA streaming loads fetch a full cache line into
+ * a fill buffer at once, which is an order of magnitude faster on
+ * such memory and harmless on regular memory. The kernels below are
+ * compiled with per-function target attributes and picked at runtime
+ * from the CPU features, so that no global compiler flags are needed.
+ *
+ * The GST_VAAPI_COPY_KERNEL environment variable forces a kernel by
+ * name ("scalar", "neon", "sse4.1", "avx2"), if it is supported. */
+
+#include "sysdeps.h"
+#include "gstvaapiutils_copy.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_vaapi_copy);
+#define GST_CAT_DEFAULT gst_debug_vaapi_copy
+
+#if (defined (__x86_64__) || defined (__i386__)) && \
+    (defined (__clang__) || (defined (__GNUC__) && __GNUC__ >= 5))
+# define HAVE_COPY_KERNELS_X86 1
+# include <immintrin.h>
+#endif
+
+#if defined (__aarch64__) || (defined (__ARM_NEON) && defined (__ARM_NEON__))
+# define HAVE_COPY_KERNELS_NEON 1
+# include <arm_neon.h>
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* --- Scalar                                                            --- */
+/* ------------------------------------------------------------------------- */
+
+static void
+copy_plane_scalar (guint8 * dst, guint dst_stride, const guint8 * src,
+    guint src_stride, guint len, guint height)
+{
+  guint i;
+
+  if (dst_stride == src_stride && dst_stride == len) {
+    memcpy (dst, src, (gsize) len * height);
+    return;
+  }
+
+  for (i = 0; i < height; i++) {
+    memcpy (dst, src, len);
+    dst += dst_stride;
+    src += src_stride;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- x86 (SSE4.1, AVX2)                                                --- */
+/* ------------------------------------------------------------------------- */
+
+#if HAVE_COPY_KERNELS_X86
+__attribute__ ((target ("sse4.1")))
+static inline void
+copy_row_sse4_1 (guint8 * dst, const guint8 * src, guint len)
+{
+  guint i, head;
+
+  /* Streaming loads require 16-byte aligned addresses */
+  head = (16 - ((guintptr) src & 15)) & 15;
+  head = MIN (head, len);
+  memcpy (dst, src, head);
+
+  for (i = head; i + 64 <= len; i += 64) {
+    const __m128i x0 = _mm_stream_load_si128 ((__m128i *) (src + i));
+    const __m128i x1 = _mm_stream_load_si128 ((__m128i *) (src + i + 16));
+    const __m128i x2 = _mm_stream_load_si128 ((__m128i *) (src + i + 32));
+    const __m128i x3 = _mm_stream_load_si128 ((__m128i *) (src + i + 48));
+    _mm_storeu_si128 ((__m128i *) (dst + i), x0);
+    _mm_storeu_si128 ((__m128i *) (dst + i + 16), x1);
+    _mm_storeu_si128 ((__m128i *) (dst + i + 32), x2);
+    _mm_storeu_si128 ((__m128i *) (dst + i + 48), x3);
+  }
+  for (; i + 16 <= len; i += 16)
+    _mm_storeu_si128 ((__m128i *) (dst + i),
+        _mm_stream_load_si128 ((__m128i *) (src + i)));
+  memcpy (dst + i, src + i, len - i);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void
+copy_plane_sse4_1 (guint8 * dst, guint dst_stride, const guint8 * src,
+    guint src_stride, guint len, guint height)
+{
+  guint i;
+
+  for (i = 0; i < height; i++) {
+    copy_row_sse4_1 (dst, src, len);
+    dst += dst_stride;
+    src += src_stride;
+  }
+}
+
+__attribute__ ((target ("avx2")))
+static inline void
+copy_row_avx2 (guint8 * dst, const guint8 * src, guint len)
+{
+  guint i, head;
+
+  /* Streaming loads require 32-byte aligned addresses */
+  head = (32 - ((guintptr) src & 31)) & 31;
+  head = MIN (head, len);
+  memcpy (dst, src, head);
+
+  for (i = head; i + 128 <= len; i += 128) {
+    const __m256i y0 = _mm256_stream_load_si256 ((__m256i *) (src + i));
+    const __m256i y1 = _mm256_stream_load_si256 ((__m256i *) (src + i + 32));
+    const __m256i y2 = _mm256_stream_load_si256 ((__m256i *) (src + i + 64));
+    const __m256i y3 = _mm256_stream_load_si256 ((__m256i *) (src + i + 96));
+    _mm256_storeu_si256 ((__m256i *) (dst + i), y0);
+    _mm256_storeu_si256 ((__m256i *) (dst + i + 32), y1);
+    _mm256_storeu_si256 ((__m256i *) (dst + i + 64), y2);
+    _mm256_storeu_si256 ((__m256i *) (dst + i + 96), y3);
+  }
+  for (; i + 32 <= len; i += 32)
+    _mm256_storeu_si256 ((__m256i *) (dst + i),
+        _mm256_stream_load_si256 ((__m256i *) (src + i)));
+  memcpy (dst + i, src + i, len - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+copy_plane_avx2 (guint8 * dst, guint dst_stride, const guint8 * src,
+    guint src_stride, guint len, guint height)
+{
+  guint i;
+
+  for (i = 0; i < height; i++) {
+    copy_row_avx2 (dst, src, len);
+    dst += dst_stride;
+    src += src_stride;
+  }
+  /* Avoid AVX-SSE transition penalties in the caller */
+  _mm256_zeroupper ();
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* --- ARM (NEON)                                                        --- */
+/* ------------------------------------------------------------------------- */
+
+#if HAVE_COPY_KERNELS_NEON
+static void
+copy_plane_neon (guint8 * dst, guint dst_stride, const guint8 * src,
+    guint src_stride, guint len, guint height)
+{
+  guint i, x;
+
+  for (i = 0; i < height; i++) {
+    for (x = 0; x + 64 <= len; x += 64) {
+      const uint8x16_t q0 = vld1q_u8 (src + x);
+      const uint8x16_t q1 = vld1q_u8 (src + x + 16);
+      const uint8x16_t q2 = vld1q_u8 (src + x + 32);
+      const uint8x16_t q3 = vld1q_u8 (src + x + 48);
+      vst1q_u8 (dst + x, q0);
+      vst1q_u8 (dst + x + 16, q1);
+      vst1q_u8 (dst + x + 32, q2);
+      vst1q_u8 (dst + x + 48, q3);
+    }
+    for (; x + 16 <= len; x += 16)
+      vst1q_u8 (dst + x, vld1q_u8 (src + x));
+    memcpy (dst + x, src + x, len - x);
+    dst += dst_stride;
+    src += src_stride;
+  }
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* --- Dispatch                                                          --- */
+/* ------------------------------------------------------------------------- */
+
+static const gchar *const g_kernel_names[GST_VAAPI_COPY_KERNEL_COUNT] = {
+  [GST_VAAPI_COPY_KERNEL_SCALAR] = "scalar",
+  [GST_VAAPI_COPY_KERNEL_NEON] = "neon",
+  [GST_VAAPI_COPY_KERNEL_SSE4_1] = "sse4.1",
+  [GST_VAAPI_COPY_KERNEL_AVX2] = "avx2",
+};
+
+static GstVaapiCopyPlaneFunc g_copy_plane_func;
+
+/**
+ * gst_vaapi_copy_kernel_get_name:
+ * @kernel: a #GstVaapiCopyKernel
+ *
+ * Return value: the name of @kernel
+ */
+const gchar *
+gst_vaapi_copy_kernel_get_name (GstVaapiCopyKernel kernel)
+{
+  g_return_val_if_fail (kernel < GST_VAAPI_COPY_KERNEL_COUNT, NULL);
+
+  return g_kernel_names[kernel];
+}
+
+/**
+ * gst_vaapi_copy_kernel_get_func:
+ * @kernel: a #GstVaapiCopyKernel
+ *
+ * Return value: the plane copy function implementing @kernel, or
+ *   %NULL if it is not supported by the compiler or the CPU
+ */
+GstVaapiCopyPlaneFunc
+gst_vaapi_copy_kernel_get_func (GstVaapiCopyKernel kernel)
+{
+  switch (kernel) {
+    case GST_VAAPI_COPY_KERNEL_SCALAR:
+      return copy_plane_scalar;
+#if HAVE_COPY_KERNELS_NEON
+    case GST_VAAPI_COPY_KERNEL_NEON:
+      return copy_plane_neon;
+#endif
+#if HAVE_COPY_KERNELS_X86
+    case GST_VAAPI_COPY_KERNEL_SSE4_1:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("sse4.1") ? copy_plane_sse4_1 : NULL;
+    case GST_VAAPI_COPY_KERNEL_AVX2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("avx2") ? copy_plane_avx2 : NULL;
+#endif
+    default:
+      break;
+  }
+  return NULL;
+}
+
+static GstVaapiCopyKernel
+find_kernel_by_name (const gchar * name)
+{
+  guint i;
+
+  for (i = 0; i < GST_VAAPI_COPY_KERNEL_COUNT; i++) {
+    if (g_ascii_strcasecmp (name, g_kernel_names[i]) == 0)
+      return i;
+  }
+  return GST_VAAPI_COPY_KERNEL_COUNT;
+}
+
+/**
+ * gst_vaapi_copy_get_default_kernel:
+ *
+ * Determines the plane copy kernel used by gst_vaapi_copy_plane(),
+ * i.e. the one named by GST_VAAPI_COPY_KERNEL if supported, or the
+ * most efficient one the CPU supports.
+ *
+ * Return value: the default #GstVaapiCopyKernel
+ */
+GstVaapiCopyKernel
+gst_vaapi_copy_get_default_kernel (void)
+{
+  static gsize g_kernel = 0;
+
+  if (g_once_init_enter (&g_kernel)) {
+    const gchar *const env = g_getenv ("GST_VAAPI_COPY_KERNEL");
+    GstVaapiCopyKernel kernel = GST_VAAPI_COPY_KERNEL_COUNT;
+    gint i;
+
+    GST_DEBUG_CATEGORY_INIT (gst_debug_vaapi_copy, "vaapicopy", 0,
+        "VA-API plane copy kernels");
+
+    if (env) {
+      kernel = find_kernel_by_name (env);
+      if (kernel == GST_VAAPI_COPY_KERNEL_COUNT ||
+          !gst_vaapi_copy_kernel_get_func (kernel)) {
+        GST_WARNING ("unsupported copy kernel '%s'", env);
+        kernel = GST_VAAPI_COPY_KERNEL_COUNT;
+      }
+    }
+
+    for (i = GST_VAAPI_COPY_KERNEL_COUNT - 1;
+        kernel == GST_VAAPI_COPY_KERNEL_COUNT && i >= 0; i--) {
+      if (gst_vaapi_copy_kernel_get_func (i))
+        kernel = i;
+    }
+
+    GST_INFO ("using %s plane copy kernel", g_kernel_names[kernel]);
+    g_copy_plane_func = gst_vaapi_copy_kernel_get_func (kernel);
+    g_once_init_leave (&g_kernel, kernel + 1);
+  }
+  return g_kernel - 1;
+}
+
+/**
+ * gst_vaapi_copy_plane:
+ * @dst: destination pixels
+ * @dst_stride: destination stride, in bytes
+ * @src: source pixels
+ * @src_stride: source stride, in bytes
+ * @len: number of bytes to copy per line
+ * @height: number of lines to copy
+ *
+ * Copies @height lines of @len bytes from @src to @dst, using the
+ * best kernel available, see gst_vaapi_copy_get_default_kernel().
+ */
+void
+gst_vaapi_copy_plane (guint8 * dst, guint dst_stride,
+    const guint8 * src, guint src_stride, guint len, guint height)
+{
+  if (G_UNLIKELY (!g_copy_plane_func))
+    gst_vaapi_copy_get_default_kernel ();
+
+  g_copy_plane_func (dst, dst_stride, src, src_stride, len, height);
+}
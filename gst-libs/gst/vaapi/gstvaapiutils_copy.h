@@ -0,0 +1,59 @@
+/*
+ *  gstvaapiutils_copy.h - Optimized plane copy kernels
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_UTILS_COPY_H
+#define GST_VAAPI_UTILS_COPY_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef void (*GstVaapiCopyPlaneFunc) (guint8 * dst, guint dst_stride,
+    const guint8 * src, guint src_stride, guint len, guint height);
+
+/* Plane copy implementations, in increasing order of preference */
+typedef enum
+{
+  GST_VAAPI_COPY_KERNEL_SCALAR = 0,
+  GST_VAAPI_COPY_KERNEL_NEON,
+  GST_VAAPI_COPY_KERNEL_SSE4_1,
+  GST_VAAPI_COPY_KERNEL_AVX2,
+  GST_VAAPI_COPY_KERNEL_COUNT
+} GstVaapiCopyKernel;
+
+G_GNUC_INTERNAL
+const gchar *
+gst_vaapi_copy_kernel_get_name (GstVaapiCopyKernel kernel);
+
+G_GNUC_INTERNAL
+GstVaapiCopyPlaneFunc
+gst_vaapi_copy_kernel_get_func (GstVaapiCopyKernel kernel);
+
+G_GNUC_INTERNAL
+GstVaapiCopyKernel
+gst_vaapi_copy_get_default_kernel (void);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_copy_plane (guint8 * dst, guint dst_stride,
+    const guint8 * src, guint src_stride, guint len, guint height);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_UTILS_COPY_H */
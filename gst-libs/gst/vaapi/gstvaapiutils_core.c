@@ -59,16 +59,33 @@ gst_vaapi_get_config_attribute (GstVaapiDisplay * display, VAProfile profile,
 {
   VAConfigAttrib attrib;
   VAStatus status;
+  gpointer data = NULL;
+  gsize size;
+  gchar *key;
 
   g_return_val_if_fail (display != NULL, FALSE);
 
-  GST_VAAPI_DISPLAY_LOCK (display);
   attrib.type = type;
-  status = vaGetConfigAttributes (GST_VAAPI_DISPLAY_VADISPLAY (display),
-      profile, entrypoint, &attrib, 1);
-  GST_VAAPI_DISPLAY_UNLOCK (display);
-  if (!vaapi_check_status (status, "vaGetConfigAttributes()"))
-    return FALSE;
+  key = g_strdup_printf ("config-attrib-%d-%d-%d", profile, entrypoint, type);
+  if (gst_vaapi_display_lookup_caps (display, key, &data, &size) &&
+      size == sizeof (attrib.value)) {
+    attrib.value = *(guint32 *) data;
+    g_free (data);
+  } else {
+    g_clear_pointer (&data, g_free);
+    GST_VAAPI_DISPLAY_LOCK (display);
+    status = vaGetConfigAttributes (GST_VAAPI_DISPLAY_VADISPLAY (display),
+        profile, entrypoint, &attrib, 1);
+    GST_VAAPI_DISPLAY_UNLOCK (display);
+    if (!vaapi_check_status (status, "vaGetConfigAttributes()")) {
+      g_free (key);
+      return FALSE;
+    }
+    gst_vaapi_display_store_caps (display, key, &attrib.value,
+        sizeof (attrib.value));
+  }
+  g_free (key);
+
   if (attrib.value == VA_ATTRIB_NOT_SUPPORTED)
     return FALSE;
 
@@ -0,0 +1,2022 @@
+/*
+ *  gstvaapiutils_null.c - Software VA driver stand-in
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* This is a VA driver living entirely in host memory. It is not
+ * loaded through vaInitialize() but wired directly into a hand-built
+ * VADisplayContext, so that the regular libva entry points dispatch
+ * into the functions below. Surfaces, images and buffers are plain
+ * system memory allocations; pictures complete after a configurable
+ * latency, which is enforced in vaSyncSurface(). Encoders produce a
+ * bitstream made of the packed headers they submitted followed by a
+ * filler payload whose size depends on the picture QP. */
+
+#include "sysdeps.h"
+#include <va/va_backend.h>
+#include <va/va_backend_vpp.h>
+#include "gstvaapicompat.h"
+#include "gstvaapiutils_null.h"
+
+#define DEBUG 1
+#include "gstvaapidebug.h"
+
+#define NULL_MAX_PROFILES               32
+#define NULL_MAX_ENTRYPOINTS            4
+#define NULL_MAX_ATTRIBUTES             16
+#define NULL_MAX_IMAGE_FORMATS          16
+#define NULL_MAX_SUBPIC_FORMATS         4
+#define NULL_MAX_DISPLAY_ATTRIBUTES     4
+#define NULL_MAX_WIDTH                  8192
+#define NULL_MAX_HEIGHT                 8192
+
+typedef enum
+{
+  NULL_OBJECT_CONFIG = 1,
+  NULL_OBJECT_CONTEXT,
+  NULL_OBJECT_SURFACE,
+  NULL_OBJECT_BUFFER,
+  NULL_OBJECT_IMAGE,
+  NULL_OBJECT_SUBPICTURE,
+} NullObjectType;
+
+typedef struct _NullObject NullObject;
+typedef struct _NullConfig NullConfig;
+typedef struct _NullLayout NullLayout;
+typedef struct _NullSurface NullSurface;
+typedef struct _NullBuffer NullBuffer;
+typedef struct _NullContext NullContext;
+typedef struct _NullImage NullImage;
+typedef struct _NullSubpicture NullSubpicture;
+typedef struct _NullFormatInfo NullFormatInfo;
+typedef struct _NullConfigMap NullConfigMap;
+typedef struct _NullDriver NullDriver;
+
+struct _NullObject
+{
+  NullObjectType type;
+  VAGenericID id;
+};
+
+struct _NullConfig
+{
+  NullObject base;
+  VAProfile profile;
+  VAEntrypoint entrypoint;
+  guint rt_format;
+  guint rc_mode;
+};
+
+struct _NullFormatInfo
+{
+  guint32 fourcc;
+  guint num_planes;
+  guint bpu[3];                 /* bytes per horizontal unit */
+  guint hshift[3];              /* log2 (pixels per unit) */
+  guint vshift[3];              /* log2 (vertical subsampling) */
+};
+
+struct _NullLayout
+{
+  const NullFormatInfo *info;
+  guint width;
+  guint height;
+  guint pitches[3];
+  guint offsets[3];
+  guint data_size;
+};
+
+struct _NullSurface
+{
+  NullObject base;
+  NullLayout layout;
+  guint8 *data;
+  gint64 ready_time;
+  guint num_derived;
+};
+
+struct _NullBuffer
+{
+  NullObject base;
+  VABufferType type;
+  guint size;
+  guint num_elements;
+  guint8 *data;
+  gboolean borrowed;
+  VACodedBufferSegment segment;
+};
+
+struct _NullContext
+{
+  NullObject base;
+  VAProfile profile;
+  VAEntrypoint entrypoint;
+  guint width;
+  guint height;
+  VASurfaceID render_target;
+  gint64 busy_until;
+
+  /* encoder state for the current picture */
+  GByteArray *bitstream;
+  GArray *slice_marks;
+  VABufferID coded_buf;
+  guint packed_header_type;
+  gint pic_qp;
+  gint slice_qp_delta;
+  gboolean has_slice_qp;
+};
+
+struct _NullImage
+{
+  NullObject base;
+  VAImage image;
+  VASurfaceID derived_surface;
+};
+
+struct _NullSubpicture
+{
+  NullObject base;
+  VAImageID image;
+};
+
+struct _NullConfigMap
+{
+  VAProfile profile;
+  VAEntrypoint entrypoint;
+  guint rt_formats;
+};
+
+struct _NullDriver
+{
+  GMutex lock;
+  GHashTable *objects;
+  VAGenericID next_id;
+  guint latency;
+
+  /* statistics */
+  guint64 num_surfaces;
+  guint64 num_buffers;
+  guint64 num_pictures;
+  guint64 num_render_calls;
+  guint64 num_syncs;
+  guint64 sync_wait_time;
+  guint64 coded_bytes;
+};
+
+#define NULL_DRIVER(ctx) ((NullDriver *)(ctx)->pDriverData)
+
+#define FOURCC(a, b, c, d) VA_FOURCC (a, b, c, d)
+
+#define RT_420     VA_RT_FORMAT_YUV420
+#define RT_420_10  VA_RT_FORMAT_YUV420_10BPP
+#define RT_ALL     (VA_RT_FORMAT_YUV420 | VA_RT_FORMAT_YUV422 | \
+                    VA_RT_FORMAT_YUV444 | VA_RT_FORMAT_YUV400 | \
+                    VA_RT_FORMAT_RGB32)
+
+/* *INDENT-OFF* */
+static const NullConfigMap null_configs[] = {
+  { VAProfileMPEG2Simple, VAEntrypointVLD, RT_420 },
+  { VAProfileMPEG2Main, VAEntrypointVLD, RT_420 },
+  { VAProfileMPEG4Simple, VAEntrypointVLD, RT_420 },
+  { VAProfileMPEG4AdvancedSimple, VAEntrypointVLD, RT_420 },
+  { VAProfileMPEG4Main, VAEntrypointVLD, RT_420 },
+  { VAProfileH264ConstrainedBaseline, VAEntrypointVLD, RT_420 },
+  { VAProfileH264Main, VAEntrypointVLD, RT_420 },
+  { VAProfileH264High, VAEntrypointVLD, RT_420 },
+  { VAProfileVC1Simple, VAEntrypointVLD, RT_420 },
+  { VAProfileVC1Main, VAEntrypointVLD, RT_420 },
+  { VAProfileVC1Advanced, VAEntrypointVLD, RT_420 },
+  { VAProfileJPEGBaseline, VAEntrypointVLD, RT_ALL },
+  { VAProfileVP8Version0_3, VAEntrypointVLD, RT_420 },
+  { VAProfileHEVCMain, VAEntrypointVLD, RT_420 },
+  { VAProfileHEVCMain10, VAEntrypointVLD, RT_420 | RT_420_10 },
+  { VAProfileVP9Profile0, VAEntrypointVLD, RT_420 },
+  { VAProfileVP9Profile2, VAEntrypointVLD, RT_420 | RT_420_10 },
+
+  { VAProfileMPEG2Simple, VAEntrypointEncSlice, RT_420 },
+  { VAProfileMPEG2Main, VAEntrypointEncSlice, RT_420 },
+  { VAProfileH264ConstrainedBaseline, VAEntrypointEncSlice, RT_420 },
+  { VAProfileH264Main, VAEntrypointEncSlice, RT_420 },
+  { VAProfileH264High, VAEntrypointEncSlice, RT_420 },
+  { VAProfileJPEGBaseline, VAEntrypointEncPicture, RT_420 },
+  { VAProfileVP8Version0_3, VAEntrypointEncSlice, RT_420 },
+  { VAProfileHEVCMain, VAEntrypointEncSlice, RT_420 },
+  { VAProfileVP9Profile0, VAEntrypointEncSlice, RT_420 },
+
+  { VAProfileNone, VAEntrypointVideoProc, RT_ALL | RT_420_10 },
+};
+
+static const NullFormatInfo null_formats[] = {
+  { FOURCC ('N','V','1','2'), 2, { 1, 2, }, { 0, 1, }, { 0, 1, } },
+  { FOURCC ('I','4','2','0'), 3, { 1, 1, 1 }, { 0, 1, 1 }, { 0, 1, 1 } },
+  { FOURCC ('Y','V','1','2'), 3, { 1, 1, 1 }, { 0, 1, 1 }, { 0, 1, 1 } },
+  { FOURCC ('Y','U','Y','2'), 1, { 4, }, { 1, }, { 0, } },
+  { FOURCC ('U','Y','V','Y'), 1, { 4, }, { 1, }, { 0, } },
+  { FOURCC ('P','0','1','0'), 2, { 2, 4, }, { 0, 1, }, { 0, 1, } },
+  { FOURCC ('4','4','4','P'), 3, { 1, 1, 1 }, { 0, 0, 0 }, { 0, 0, 0 } },
+  { FOURCC ('Y','8','0','0'), 1, { 1, }, { 0, }, { 0, } },
+  { FOURCC ('R','G','B','A'), 1, { 4, }, { 0, }, { 0, } },
+  { FOURCC ('R','G','B','X'), 1, { 4, }, { 0, }, { 0, } },
+  { FOURCC ('B','G','R','A'), 1, { 4, }, { 0, }, { 0, } },
+  { FOURCC ('B','G','R','X'), 1, { 4, }, { 0, }, { 0, } },
+};
+
+static const VAImageFormat null_image_formats[] = {
+  { FOURCC ('N','V','1','2'), VA_LSB_FIRST, 12, },
+  { FOURCC ('I','4','2','0'), VA_LSB_FIRST, 12, },
+  { FOURCC ('Y','V','1','2'), VA_LSB_FIRST, 12, },
+  { FOURCC ('Y','U','Y','2'), VA_LSB_FIRST, 16, },
+  { FOURCC ('U','Y','V','Y'), VA_LSB_FIRST, 16, },
+  { FOURCC ('P','0','1','0'), VA_LSB_FIRST, 24, },
+  { FOURCC ('4','4','4','P'), VA_LSB_FIRST, 24, },
+  { FOURCC ('Y','8','0','0'), VA_LSB_FIRST, 8, },
+  { FOURCC ('R','G','B','A'), VA_LSB_FIRST, 32, 32,
+    0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 },
+  { FOURCC ('R','G','B','X'), VA_LSB_FIRST, 32, 24,
+    0x000000ff, 0x0000ff00, 0x00ff0000, 0x00000000 },
+  { FOURCC ('B','G','R','A'), VA_LSB_FIRST, 32, 32,
+    0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 },
+  { FOURCC ('B','G','R','X'), VA_LSB_FIRST, 32, 24,
+    0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000 },
+};
+/* *INDENT-ON* */
+
+/* ------------------------------------------------------------------------- */
+/* --- Helpers                                                           --- */
+/* ------------------------------------------------------------------------- */
+
+static const NullFormatInfo *
+null_format_info (guint32 fourcc)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (null_formats); i++) {
+    if (null_formats[i].fourcc == fourcc)
+      return &null_formats[i];
+  }
+  return NULL;
+}
+
+static guint32
+null_fourcc_from_rt_format (guint rt_format)
+{
+  if (rt_format & VA_RT_FORMAT_YUV420)
+    return FOURCC ('N', 'V', '1', '2');
+  if (rt_format & VA_RT_FORMAT_YUV420_10BPP)
+    return FOURCC ('P', '0', '1', '0');
+  if (rt_format & VA_RT_FORMAT_YUV422)
+    return FOURCC ('Y', 'U', 'Y', '2');
+  if (rt_format & VA_RT_FORMAT_YUV444)
+    return FOURCC ('4', '4', '4', 'P');
+  if (rt_format & VA_RT_FORMAT_YUV400)
+    return FOURCC ('Y', '8', '0', '0');
+  if (rt_format & VA_RT_FORMAT_RGB32)
+    return FOURCC ('B', 'G', 'R', 'X');
+  return 0;
+}
+
+static inline guint
+null_plane_units (const NullFormatInfo * info, guint plane, guint width)
+{
+  return (width + (1U << info->hshift[plane]) - 1) >> info->hshift[plane];
+}
+
+static inline guint
+null_plane_rows (const NullFormatInfo * info, guint plane, guint height)
+{
+  return (height + (1U << info->vshift[plane]) - 1) >> info->vshift[plane];
+}
+
+static gboolean
+null_layout_init (NullLayout * layout, guint32 fourcc, guint width,
+    guint height)
+{
+  const NullFormatInfo *const info = null_format_info (fourcc);
+  guint i, offset = 0;
+
+  if (!info || width == 0 || height == 0)
+    return FALSE;
+
+  memset (layout, 0, sizeof (*layout));
+  layout->info = info;
+  layout->width = width;
+  layout->height = height;
+  for (i = 0; i < info->num_planes; i++) {
+    layout->pitches[i] =
+        GST_ROUND_UP_64 (null_plane_units (info, i, width) * info->bpu[i]);
+    layout->offsets[i] = offset;
+    offset += layout->pitches[i] * null_plane_rows (info, i, height);
+  }
+  layout->data_size = offset;
+  return TRUE;
+}
+
+/* Copies a rectangle between two buffers of the same format */
+static void
+null_copy_rect (const NullLayout * dst_layout, guint8 * dst, guint dst_x,
+    guint dst_y, const NullLayout * src_layout, const guint8 * src,
+    guint src_x, guint src_y, guint width, guint height)
+{
+  const NullFormatInfo *const info = src_layout->info;
+  guint i, y;
+
+  for (i = 0; i < info->num_planes; i++) {
+    const guint bpu = info->bpu[i];
+    const guint hs = info->hshift[i], vs = info->vshift[i];
+    const guint units = null_plane_units (info, i, width);
+    const guint rows = null_plane_rows (info, i, height);
+    const guint8 *s = src + src_layout->offsets[i] +
+        (src_y >> vs) * src_layout->pitches[i] + (src_x >> hs) * bpu;
+    guint8 *d = dst + dst_layout->offsets[i] +
+        (dst_y >> vs) * dst_layout->pitches[i] + (dst_x >> hs) * bpu;
+
+    for (y = 0; y < rows; y++) {
+      memcpy (d, s, units * bpu);
+      s += src_layout->pitches[i];
+      d += dst_layout->pitches[i];
+    }
+  }
+}
+
+/* Converts between NV12 and I420/YV12, the only conversion we need
+ * for the common download/upload paths */
+static gboolean
+null_convert_rect (const NullLayout * dst_layout, guint8 * dst, guint dst_x,
+    guint dst_y, const NullLayout * src_layout, const guint8 * src,
+    guint src_x, guint src_y, guint width, guint height)
+{
+  const guint32 nv12 = FOURCC ('N', 'V', '1', '2');
+  const guint32 yv12 = FOURCC ('Y', 'V', '1', '2');
+  const guint32 i420 = FOURCC ('I', '4', '2', '0');
+  const guint32 src_fourcc = src_layout->info->fourcc;
+  const guint32 dst_fourcc = dst_layout->info->fourcc;
+  const guint cw = (width + 1) / 2, ch = (height + 1) / 2;
+  guint u_plane, v_plane, x, y;
+
+  if (src_fourcc == nv12 && (dst_fourcc == i420 || dst_fourcc == yv12)) {
+    u_plane = dst_fourcc == i420 ? 1 : 2;
+    v_plane = dst_fourcc == i420 ? 2 : 1;
+    for (y = 0; y < height; y++)
+      memcpy (dst + dst_layout->offsets[0] + (dst_y + y) *
+          dst_layout->pitches[0] + dst_x, src + src_layout->offsets[0] +
+          (src_y + y) * src_layout->pitches[0] + src_x, width);
+    for (y = 0; y < ch; y++) {
+      const guint8 *s = src + src_layout->offsets[1] +
+          (src_y / 2 + y) * src_layout->pitches[1] + (src_x / 2) * 2;
+      guint8 *du = dst + dst_layout->offsets[u_plane] +
+          (dst_y / 2 + y) * dst_layout->pitches[u_plane] + dst_x / 2;
+      guint8 *dv = dst + dst_layout->offsets[v_plane] +
+          (dst_y / 2 + y) * dst_layout->pitches[v_plane] + dst_x / 2;
+      for (x = 0; x < cw; x++) {
+        du[x] = s[2 * x];
+        dv[x] = s[2 * x + 1];
+      }
+    }
+    return TRUE;
+  }
+
+  if (dst_fourcc == nv12 && (src_fourcc == i420 || src_fourcc == yv12)) {
+    u_plane = src_fourcc == i420 ? 1 : 2;
+    v_plane = src_fourcc == i420 ? 2 : 1;
+    for (y = 0; y < height; y++)
+      memcpy (dst + dst_layout->offsets[0] + (dst_y + y) *
+          dst_layout->pitches[0] + dst_x, src + src_layout->offsets[0] +
+          (src_y + y) * src_layout->pitches[0] + src_x, width);
+    for (y = 0; y < ch; y++) {
+      const guint8 *su = src + src_layout->offsets[u_plane] +
+          (src_y / 2 + y) * src_layout->pitches[u_plane] + src_x / 2;
+      const guint8 *sv = src + src_layout->offsets[v_plane] +
+          (src_y / 2 + y) * src_layout->pitches[v_plane] + src_x / 2;
+      guint8 *d = dst + dst_layout->offsets[1] +
+          (dst_y / 2 + y) * dst_layout->pitches[1] + (dst_x / 2) * 2;
+      for (x = 0; x < cw; x++) {
+        d[2 * x] = su[x];
+        d[2 * x + 1] = sv[x];
+      }
+    }
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* Nearest-neighbour scaling between two buffers of the same format */
+static void
+null_scale_rect (const NullLayout * dst_layout, guint8 * dst,
+    const VARectangle * dst_rect, const NullLayout * src_layout,
+    const guint8 * src, const VARectangle * src_rect)
+{
+  const NullFormatInfo *const info = src_layout->info;
+  guint i, x, y, b;
+
+  if (dst_rect->width == 0 || dst_rect->height == 0)
+    return;
+
+  for (i = 0; i < info->num_planes; i++) {
+    const guint bpu = info->bpu[i];
+    const guint hs = info->hshift[i], vs = info->vshift[i];
+    const guint dst_units = null_plane_units (info, i, dst_rect->width);
+    const guint dst_rows = null_plane_rows (info, i, dst_rect->height);
+    const guint src_units = null_plane_units (info, i, src_rect->width);
+    const guint src_rows = null_plane_rows (info, i, src_rect->height);
+
+    for (y = 0; y < dst_rows; y++) {
+      const guint sy = (y * src_rows) / dst_rows;
+      const guint8 *s = src + src_layout->offsets[i] +
+          ((src_rect->y >> vs) + sy) * src_layout->pitches[i] +
+          (src_rect->x >> hs) * bpu;
+      guint8 *d = dst + dst_layout->offsets[i] +
+          ((dst_rect->y >> vs) + y) * dst_layout->pitches[i] +
+          (dst_rect->x >> hs) * bpu;
+
+      for (x = 0; x < dst_units; x++) {
+        const guint sx = (x * src_units) / dst_units;
+        for (b = 0; b < bpu; b++)
+          d[x * bpu + b] = s[sx * bpu + b];
+      }
+    }
+  }
+}
+
+static void
+null_object_free (gpointer data)
+{
+  NullObject *const object = data;
+
+  switch (object->type) {
+    case NULL_OBJECT_SURFACE:{
+      NullSurface *const surface = data;
+      g_free (surface->data);
+      g_slice_free (NullSurface, surface);
+      break;
+    }
+    case NULL_OBJECT_BUFFER:{
+      NullBuffer *const buffer = data;
+      if (!buffer->borrowed)
+        g_free (buffer->data);
+      g_slice_free (NullBuffer, buffer);
+      break;
+    }
+    case NULL_OBJECT_CONTEXT:{
+      NullContext *const context = data;
+      g_byte_array_unref (context->bitstream);
+      g_array_unref (context->slice_marks);
+      g_slice_free (NullContext, context);
+      break;
+    }
+    case NULL_OBJECT_CONFIG:
+      g_slice_free (NullConfig, data);
+      break;
+    case NULL_OBJECT_IMAGE:
+      g_slice_free (NullImage, data);
+      break;
+    case NULL_OBJECT_SUBPICTURE:
+      g_slice_free (NullSubpicture, data);
+      break;
+  }
+}
+
+/* Registers a new object. Called with the driver lock held */
+static VAGenericID
+null_object_add (NullDriver * drv, gpointer data, NullObjectType type)
+{
+  NullObject *const object = data;
+
+  object->type = type;
+  object->id = drv->next_id++;
+  g_hash_table_insert (drv->objects, GUINT_TO_POINTER (object->id), object);
+  return object->id;
+}
+
+/* Looks up an object. Called with the driver lock held */
+static gpointer
+null_object_lookup (NullDriver * drv, VAGenericID id, NullObjectType type)
+{
+  NullObject *const object =
+      g_hash_table_lookup (drv->objects, GUINT_TO_POINTER (id));
+
+  if (!object || object->type != type)
+    return NULL;
+  return object;
+}
+
+static gboolean
+null_object_remove (NullDriver * drv, VAGenericID id, NullObjectType type)
+{
+  if (!null_object_lookup (drv, id, type))
+    return FALSE;
+  return g_hash_table_remove (drv->objects, GUINT_TO_POINTER (id));
+}
+
+static const NullConfigMap *
+null_find_config (VAProfile profile, VAEntrypoint entrypoint)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (null_configs); i++) {
+    if (null_configs[i].profile == profile &&
+        null_configs[i].entrypoint == entrypoint)
+      return &null_configs[i];
+  }
+  return NULL;
+}
+
+static inline gboolean
+null_is_encode_entrypoint (VAEntrypoint entrypoint)
+{
+  return entrypoint == VAEntrypointEncSlice ||
+      entrypoint == VAEntrypointEncPicture;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Configs                                                           --- */
+/* ------------------------------------------------------------------------- */
+
+static VAStatus
+null_Terminate (VADriverContextP ctx)
+{
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_QueryConfigProfiles (VADriverContextP ctx, VAProfile * profile_list,
+    int *num_profiles)
+{
+  guint i, j;
+  int n = 0;
+
+  for (i = 0; i < G_N_ELEMENTS (null_configs); i++) {
+    for (j = 0; j < i; j++) {
+      if (null_configs[j].profile == null_configs[i].profile)
+        break;
+    }
+    if (j == i)
+      profile_list[n++] = null_configs[i].profile;
+  }
+  *num_profiles = n;
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_QueryConfigEntrypoints (VADriverContextP ctx, VAProfile profile,
+    VAEntrypoint * entrypoint_list, int *num_entrypoints)
+{
+  guint i;
+  int n = 0;
+
+  for (i = 0; i < G_N_ELEMENTS (null_configs); i++) {
+    if (null_configs[i].profile == profile)
+      entrypoint_list[n++] = null_configs[i].entrypoint;
+  }
+  *num_entrypoints = n;
+  return n > 0 ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+}
+
+static guint
+null_get_config_attribute (const NullConfigMap * m, VAConfigAttribType type)
+{
+  const gboolean is_encoder = null_is_encode_entrypoint (m->entrypoint);
+
+  switch (type) {
+    case VAConfigAttribRTFormat:
+      return m->rt_formats;
+    case VAConfigAttribRateControl:
+      if (!is_encoder)
+        break;
+      if (m->profile == VAProfileJPEGBaseline)
+        return VA_RC_NONE | VA_RC_CQP;
+      return VA_RC_CQP | VA_RC_CBR | VA_RC_VBR;
+    case VAConfigAttribEncPackedHeaders:
+      if (!is_encoder)
+        break;
+      switch (m->profile) {
+        case VAProfileVP8Version0_3:
+        case VAProfileVP9Profile0:
+          return VA_ENC_PACKED_HEADER_NONE;
+        case VAProfileMPEG2Simple:
+        case VAProfileMPEG2Main:
+          return VA_ENC_PACKED_HEADER_SEQUENCE | VA_ENC_PACKED_HEADER_PICTURE;
+        default:
+          return VA_ENC_PACKED_HEADER_SEQUENCE | VA_ENC_PACKED_HEADER_PICTURE |
+              VA_ENC_PACKED_HEADER_SLICE | VA_ENC_PACKED_HEADER_MISC |
+              VA_ENC_PACKED_HEADER_RAW_DATA;
+      }
+    case VAConfigAttribEncMaxRefFrames:
+      if (!is_encoder)
+        break;
+      return 4 | (2 << 16);
+    case VAConfigAttribEncMaxSlices:
+      if (!is_encoder)
+        break;
+      return 32;
+    case VAConfigAttribEncQualityRange:
+      if (!is_encoder)
+        break;
+      return 7;
+    default:
+      break;
+  }
+  return VA_ATTRIB_NOT_SUPPORTED;
+}
+
+static VAStatus
+null_GetConfigAttributes (VADriverContextP ctx, VAProfile profile,
+    VAEntrypoint entrypoint, VAConfigAttrib * attrib_list, int num_attribs)
+{
+  const NullConfigMap *const m = null_find_config (profile, entrypoint);
+  int i;
+
+  if (!m)
+    return VA_STATUS_ERROR_UNSUPPORTED_ENTRYPOINT;
+
+  for (i = 0; i < num_attribs; i++)
+    attrib_list[i].value = null_get_config_attribute (m, attrib_list[i].type);
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_CreateConfig (VADriverContextP ctx, VAProfile profile,
+    VAEntrypoint entrypoint, VAConfigAttrib * attrib_list, int num_attribs,
+    VAConfigID * config_id)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  const NullConfigMap *const m = null_find_config (profile, entrypoint);
+  NullConfig *config;
+  int i;
+
+  if (!m)
+    return VA_STATUS_ERROR_UNSUPPORTED_ENTRYPOINT;
+
+  config = g_slice_new0 (NullConfig);
+  config->profile = profile;
+  config->entrypoint = entrypoint;
+  config->rt_format = m->rt_formats;
+  config->rc_mode = null_get_config_attribute (m, VAConfigAttribRateControl);
+
+  for (i = 0; i < num_attribs; i++) {
+    switch (attrib_list[i].type) {
+      case VAConfigAttribRTFormat:
+        if (!(attrib_list[i].value & m->rt_formats))
+          goto error_unsupported_rt_format;
+        config->rt_format = attrib_list[i].value;
+        break;
+      case VAConfigAttribRateControl:
+        config->rc_mode = attrib_list[i].value;
+        break;
+      default:
+        break;
+    }
+  }
+
+  g_mutex_lock (&drv->lock);
+  *config_id = null_object_add (drv, config, NULL_OBJECT_CONFIG);
+  g_mutex_unlock (&drv->lock);
+  return VA_STATUS_SUCCESS;
+
+  /* ERRORS */
+error_unsupported_rt_format:
+  {
+    g_slice_free (NullConfig, config);
+    return VA_STATUS_ERROR_UNSUPPORTED_RT_FORMAT;
+  }
+}
+
+static VAStatus
+null_DestroyConfig (VADriverContextP ctx, VAConfigID config_id)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  gboolean success;
+
+  g_mutex_lock (&drv->lock);
+  success = null_object_remove (drv, config_id, NULL_OBJECT_CONFIG);
+  g_mutex_unlock (&drv->lock);
+  return success ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_CONFIG;
+}
+
+static VAStatus
+null_QueryConfigAttributes (VADriverContextP ctx, VAConfigID config_id,
+    VAProfile * profile, VAEntrypoint * entrypoint,
+    VAConfigAttrib * attrib_list, int *num_attribs)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullConfig *config;
+
+  g_mutex_lock (&drv->lock);
+  config = null_object_lookup (drv, config_id, NULL_OBJECT_CONFIG);
+  if (config) {
+    *profile = config->profile;
+    *entrypoint = config->entrypoint;
+    attrib_list[0].type = VAConfigAttribRTFormat;
+    attrib_list[0].value = config->rt_format;
+    *num_attribs = 1;
+  }
+  g_mutex_unlock (&drv->lock);
+  return config ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_CONFIG;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Surfaces                                                          --- */
+/* ------------------------------------------------------------------------- */
+
+static VAStatus
+null_CreateSurfaces2 (VADriverContextP ctx, unsigned int format,
+    unsigned int width, unsigned int height, VASurfaceID * surfaces,
+    unsigned int num_surfaces, VASurfaceAttrib * attrib_list,
+    unsigned int num_attribs)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  guint32 fourcc = null_fourcc_from_rt_format (format);
+  NullLayout layout;
+  guint i;
+
+  for (i = 0; i < num_attribs; i++) {
+    const VASurfaceAttrib *const attrib = &attrib_list[i];
+
+    if (!(attrib->flags & VA_SURFACE_ATTRIB_SETTABLE))
+      continue;
+
+    switch (attrib->type) {
+      case VASurfaceAttribPixelFormat:
+        fourcc = attrib->value.value.i;
+        break;
+      case VASurfaceAttribMemoryType:
+        if (attrib->value.value.i != VA_SURFACE_ATTRIB_MEM_TYPE_VA)
+          return VA_STATUS_ERROR_UNSUPPORTED_MEMORY_TYPE;
+        break;
+      case VASurfaceAttribExternalBufferDescriptor:
+        return VA_STATUS_ERROR_UNSUPPORTED_MEMORY_TYPE;
+      default:
+        break;
+    }
+  }
+
+  if (width > NULL_MAX_WIDTH || height > NULL_MAX_HEIGHT)
+    return VA_STATUS_ERROR_RESOLUTION_NOT_SUPPORTED;
+  if (!null_layout_init (&layout, fourcc, width, height))
+    return VA_STATUS_ERROR_UNSUPPORTED_RT_FORMAT;
+
+  g_mutex_lock (&drv->lock);
+  for (i = 0; i < num_surfaces; i++) {
+    NullSurface *const surface = g_slice_new0 (NullSurface);
+
+    surface->layout = layout;
+    surface->data = g_malloc0 (layout.data_size);
+    surfaces[i] = null_object_add (drv, surface, NULL_OBJECT_SURFACE);
+  }
+  drv->num_surfaces += num_surfaces;
+  g_mutex_unlock (&drv->lock);
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_CreateSurfaces (VADriverContextP ctx, int width, int height, int format,
+    int num_surfaces, VASurfaceID * surfaces)
+{
+  return null_CreateSurfaces2 (ctx, format, width, height, surfaces,
+      num_surfaces, NULL, 0);
+}
+
+static VAStatus
+null_DestroySurfaces (VADriverContextP ctx, VASurfaceID * surface_list,
+    int num_surfaces)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  VAStatus status = VA_STATUS_SUCCESS;
+  int i;
+
+  g_mutex_lock (&drv->lock);
+  for (i = 0; i < num_surfaces; i++) {
+    NullSurface *const surface =
+        null_object_lookup (drv, surface_list[i], NULL_OBJECT_SURFACE);
+
+    if (!surface)
+      status = VA_STATUS_ERROR_INVALID_SURFACE;
+    /* Derived images map the surface data directly, so keep it alive */
+    else if (surface->num_derived > 0)
+      status = VA_STATUS_ERROR_SURFACE_BUSY;
+    else
+      null_object_remove (drv, surface_list[i], NULL_OBJECT_SURFACE);
+  }
+  g_mutex_unlock (&drv->lock);
+  return status;
+}
+
+static VAStatus
+null_QuerySurfaceAttributes (VADriverContextP ctx, VAConfigID config_id,
+    VASurfaceAttrib * attrib_list, unsigned int *num_attribs)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  VASurfaceAttrib attribs[G_N_ELEMENTS (null_formats) + 5];
+  NullConfig *config;
+  guint i, n = 0;
+
+  g_mutex_lock (&drv->lock);
+  config = null_object_lookup (drv, config_id, NULL_OBJECT_CONFIG);
+  if (!config) {
+    g_mutex_unlock (&drv->lock);
+    return VA_STATUS_ERROR_INVALID_CONFIG;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (null_formats); i++) {
+    const guint32 fourcc = null_formats[i].fourcc;
+    guint rt_format;
+
+    switch (fourcc) {
+      case FOURCC ('P', '0', '1', '0'):
+        rt_format = VA_RT_FORMAT_YUV420_10BPP;
+        break;
+      case FOURCC ('Y', 'U', 'Y', '2'):
+      case FOURCC ('U', 'Y', 'V', 'Y'):
+        rt_format = VA_RT_FORMAT_YUV422;
+        break;
+      case FOURCC ('4', '4', '4', 'P'):
+        rt_format = VA_RT_FORMAT_YUV444;
+        break;
+      case FOURCC ('Y', '8', '0', '0'):
+        rt_format = VA_RT_FORMAT_YUV400;
+        break;
+      case FOURCC ('R', 'G', 'B', 'A'):
+      case FOURCC ('R', 'G', 'B', 'X'):
+      case FOURCC ('B', 'G', 'R', 'A'):
+      case FOURCC ('B', 'G', 'R', 'X'):
+        rt_format = VA_RT_FORMAT_RGB32;
+        break;
+      default:
+        rt_format = VA_RT_FORMAT_YUV420;
+        break;
+    }
+    if (!(config->rt_format & rt_format))
+      continue;
+
+    attribs[n].type = VASurfaceAttribPixelFormat;
+    attribs[n].flags = VA_SURFACE_ATTRIB_GETTABLE | VA_SURFACE_ATTRIB_SETTABLE;
+    attribs[n].value.type = VAGenericValueTypeInteger;
+    attribs[n].value.value.i = fourcc;
+    n++;
+  }
+  g_mutex_unlock (&drv->lock);
+
+#define ADD_INT_ATTRIB(TYPE, FLAGS, VALUE) do {         \
+    attribs[n].type = G_PASTE (VASurfaceAttrib, TYPE);  \
+    attribs[n].flags = FLAGS;                           \
+    attribs[n].value.type = VAGenericValueTypeInteger;  \
+    attribs[n].value.value.i = VALUE;                   \
+    n++;                                                \
+  } while (0)
+
+  ADD_INT_ATTRIB (MinWidth, VA_SURFACE_ATTRIB_GETTABLE, 1);
+  ADD_INT_ATTRIB (MinHeight, VA_SURFACE_ATTRIB_GETTABLE, 1);
+  ADD_INT_ATTRIB (MaxWidth, VA_SURFACE_ATTRIB_GETTABLE, NULL_MAX_WIDTH);
+  ADD_INT_ATTRIB (MaxHeight, VA_SURFACE_ATTRIB_GETTABLE, NULL_MAX_HEIGHT);
+  ADD_INT_ATTRIB (MemoryType,
+      VA_SURFACE_ATTRIB_GETTABLE | VA_SURFACE_ATTRIB_SETTABLE,
+      VA_SURFACE_ATTRIB_MEM_TYPE_VA);
+#undef ADD_INT_ATTRIB
+
+  if (attrib_list) {
+    if (*num_attribs < n)
+      return VA_STATUS_ERROR_MAX_NUM_EXCEEDED;
+    memcpy (attrib_list, attribs, n * sizeof (*attribs));
+  }
+  *num_attribs = n;
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_SyncSurface (VADriverContextP ctx, VASurfaceID render_target)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullSurface *surface;
+  gint64 ready_time, now;
+
+  g_mutex_lock (&drv->lock);
+  surface = null_object_lookup (drv, render_target, NULL_OBJECT_SURFACE);
+  ready_time = surface ? surface->ready_time : 0;
+  drv->num_syncs++;
+  g_mutex_unlock (&drv->lock);
+  if (!surface)
+    return VA_STATUS_ERROR_INVALID_SURFACE;
+
+  now = g_get_monotonic_time ();
+  if (ready_time > now) {
+    g_usleep (ready_time - now);
+    g_mutex_lock (&drv->lock);
+    drv->sync_wait_time += ready_time - now;
+    g_mutex_unlock (&drv->lock);
+  }
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_QuerySurfaceStatus (VADriverContextP ctx, VASurfaceID render_target,
+    VASurfaceStatus * status)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullSurface *surface;
+
+  g_mutex_lock (&drv->lock);
+  surface = null_object_lookup (drv, render_target, NULL_OBJECT_SURFACE);
+  if (surface) {
+    *status = surface->ready_time > g_get_monotonic_time ()?
+        VASurfaceRendering : VASurfaceReady;
+  }
+  g_mutex_unlock (&drv->lock);
+  return surface ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_SURFACE;
+}
+
+static VAStatus
+null_QuerySurfaceError (VADriverContextP ctx, VASurfaceID render_target,
+    VAStatus error_status, void **error_info)
+{
+  return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Buffers                                                           --- */
+/* ------------------------------------------------------------------------- */
+
+static VAStatus
+null_CreateBuffer (VADriverContextP ctx, VAContextID context,
+    VABufferType type, unsigned int size, unsigned int num_elements,
+    void *data, VABufferID * buf_id)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullBuffer *buffer;
+
+  if (size == 0 || num_elements == 0)
+    return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+  buffer = g_slice_new0 (NullBuffer);
+  buffer->type = type;
+  buffer->size = size;
+  buffer->num_elements = num_elements;
+  buffer->data = g_malloc (size * num_elements);
+  if (data)
+    memcpy (buffer->data, data, size * num_elements);
+  if (type == VAEncCodedBufferType)
+    buffer->segment.buf = buffer->data;
+
+  g_mutex_lock (&drv->lock);
+  *buf_id = null_object_add (drv, buffer, NULL_OBJECT_BUFFER);
+  drv->num_buffers++;
+  g_mutex_unlock (&drv->lock);
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_BufferSetNumElements (VADriverContextP ctx, VABufferID buf_id,
+    unsigned int num_elements)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullBuffer *buffer;
+  VAStatus status = VA_STATUS_SUCCESS;
+
+  g_mutex_lock (&drv->lock);
+  buffer = null_object_lookup (drv, buf_id, NULL_OBJECT_BUFFER);
+  if (!buffer)
+    status = VA_STATUS_ERROR_INVALID_BUFFER;
+  else if (num_elements > buffer->num_elements)
+    status = VA_STATUS_ERROR_INVALID_PARAMETER;
+  else
+    buffer->num_elements = num_elements;
+  g_mutex_unlock (&drv->lock);
+  return status;
+}
+
+static VAStatus
+null_MapBuffer (VADriverContextP ctx, VABufferID buf_id, void **pbuf)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullBuffer *buffer;
+
+  g_mutex_lock (&drv->lock);
+  buffer = null_object_lookup (drv, buf_id, NULL_OBJECT_BUFFER);
+  if (buffer) {
+    *pbuf = buffer->type == VAEncCodedBufferType ?
+        (void *) &buffer->segment : (void *) buffer->data;
+  }
+  g_mutex_unlock (&drv->lock);
+  return buffer ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_BUFFER;
+}
+
+static VAStatus
+null_UnmapBuffer (VADriverContextP ctx, VABufferID buf_id)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullBuffer *buffer;
+
+  g_mutex_lock (&drv->lock);
+  buffer = null_object_lookup (drv, buf_id, NULL_OBJECT_BUFFER);
+  g_mutex_unlock (&drv->lock);
+  return buffer ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_BUFFER;
+}
+
+static VAStatus
+null_DestroyBuffer (VADriverContextP ctx, VABufferID buf_id)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  gboolean success;
+
+  g_mutex_lock (&drv->lock);
+  success = null_object_remove (drv, buf_id, NULL_OBJECT_BUFFER);
+  g_mutex_unlock (&drv->lock);
+  return success ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_BUFFER;
+}
+
+static VAStatus
+null_BufferInfo (VADriverContextP ctx, VABufferID buf_id, VABufferType * type,
+    unsigned int *size, unsigned int *num_elements)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullBuffer *buffer;
+
+  g_mutex_lock (&drv->lock);
+  buffer = null_object_lookup (drv, buf_id, NULL_OBJECT_BUFFER);
+  if (buffer) {
+    *type = buffer->type;
+    *size = buffer->size;
+    *num_elements = buffer->num_elements;
+  }
+  g_mutex_unlock (&drv->lock);
+  return buffer ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_BUFFER;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Contexts and picture submission                                   --- */
+/* ------------------------------------------------------------------------- */
+
+static VAStatus
+null_CreateContext (VADriverContextP ctx, VAConfigID config_id,
+    int picture_width, int picture_height, int flag,
+    VASurfaceID * render_targets, int num_render_targets,
+    VAContextID * context_id)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullContext *context;
+  NullConfig *config;
+
+  g_mutex_lock (&drv->lock);
+  config = null_object_lookup (drv, config_id, NULL_OBJECT_CONFIG);
+  if (!config) {
+    g_mutex_unlock (&drv->lock);
+    return VA_STATUS_ERROR_INVALID_CONFIG;
+  }
+
+  context = g_slice_new0 (NullContext);
+  context->profile = config->profile;
+  context->entrypoint = config->entrypoint;
+  context->width = picture_width;
+  context->height = picture_height;
+  context->render_target = VA_INVALID_ID;
+  context->coded_buf = VA_INVALID_ID;
+  context->bitstream = g_byte_array_new ();
+  context->slice_marks = g_array_new (FALSE, FALSE, sizeof (guint));
+  *context_id = null_object_add (drv, context, NULL_OBJECT_CONTEXT);
+  g_mutex_unlock (&drv->lock);
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_DestroyContext (VADriverContextP ctx, VAContextID context_id)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  gboolean success;
+
+  g_mutex_lock (&drv->lock);
+  success = null_object_remove (drv, context_id, NULL_OBJECT_CONTEXT);
+  g_mutex_unlock (&drv->lock);
+  return success ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_CONTEXT;
+}
+
+static VAStatus
+null_BeginPicture (VADriverContextP ctx, VAContextID context_id,
+    VASurfaceID render_target)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullContext *context;
+  VAStatus status = VA_STATUS_SUCCESS;
+
+  g_mutex_lock (&drv->lock);
+  context = null_object_lookup (drv, context_id, NULL_OBJECT_CONTEXT);
+  if (!context)
+    status = VA_STATUS_ERROR_INVALID_CONTEXT;
+  else if (!null_object_lookup (drv, render_target, NULL_OBJECT_SURFACE))
+    status = VA_STATUS_ERROR_INVALID_SURFACE;
+  else {
+    context->render_target = render_target;
+    context->coded_buf = VA_INVALID_ID;
+    context->packed_header_type = 0;
+    context->pic_qp = 26;
+    context->slice_qp_delta = 0;
+    context->has_slice_qp = FALSE;
+    g_byte_array_set_size (context->bitstream, 0);
+    g_array_set_size (context->slice_marks, 0);
+  }
+  g_mutex_unlock (&drv->lock);
+  return status;
+}
+
+/* Extracts the coded buffer and base QP from an encoder picture
+ * parameter buffer */
+static void
+null_parse_enc_picture_param (NullContext * context, NullBuffer * buffer)
+{
+  switch (context->profile) {
+    case VAProfileH264ConstrainedBaseline:
+    case VAProfileH264Main:
+    case VAProfileH264High:{
+      const VAEncPictureParameterBufferH264 *const param =
+          (VAEncPictureParameterBufferH264 *) buffer->data;
+      context->coded_buf = param->coded_buf;
+      context->pic_qp = param->pic_init_qp;
+      break;
+    }
+    case VAProfileHEVCMain:{
+      const VAEncPictureParameterBufferHEVC *const param =
+          (VAEncPictureParameterBufferHEVC *) buffer->data;
+      context->coded_buf = param->coded_buf;
+      context->pic_qp = param->pic_init_qp;
+      break;
+    }
+    case VAProfileMPEG2Simple:
+    case VAProfileMPEG2Main:
+      context->coded_buf =
+          ((VAEncPictureParameterBufferMPEG2 *) buffer->data)->coded_buf;
+      break;
+    case VAProfileJPEGBaseline:
+      context->coded_buf =
+          ((VAEncPictureParameterBufferJPEG *) buffer->data)->coded_buf;
+      break;
+    case VAProfileVP8Version0_3:
+      context->coded_buf =
+          ((VAEncPictureParameterBufferVP8 *) buffer->data)->coded_buf;
+      break;
+#if USE_VP9_ENCODER
+    case VAProfileVP9Profile0:
+      context->coded_buf =
+          ((VAEncPictureParameterBufferVP9 *) buffer->data)->coded_buf;
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+static void
+null_parse_enc_slice_param (NullContext * context, NullBuffer * buffer)
+{
+  if (context->has_slice_qp)
+    return;
+
+  switch (context->profile) {
+    case VAProfileH264ConstrainedBaseline:
+    case VAProfileH264Main:
+    case VAProfileH264High:
+      context->slice_qp_delta =
+          ((VAEncSliceParameterBufferH264 *) buffer->data)->slice_qp_delta;
+      context->has_slice_qp = TRUE;
+      break;
+    case VAProfileHEVCMain:
+      context->slice_qp_delta =
+          ((VAEncSliceParameterBufferHEVC *) buffer->data)->slice_qp_delta;
+      context->has_slice_qp = TRUE;
+      break;
+    default:
+      break;
+  }
+}
+
+/* Processes one buffer submitted to an encoder context. Called with
+ * the driver lock held */
+static void
+null_render_encode_buffer (NullContext * context, NullBuffer * buffer)
+{
+  switch (buffer->type) {
+    case VAEncPictureParameterBufferType:
+      null_parse_enc_picture_param (context, buffer);
+      break;
+    case VAEncSliceParameterBufferType:
+      null_parse_enc_slice_param (context, buffer);
+      break;
+    case VAEncPackedHeaderParameterBufferType:
+      context->packed_header_type =
+          ((VAEncPackedHeaderParameterBuffer *) buffer->data)->type;
+      break;
+    case VAEncPackedHeaderDataBufferType:
+      g_byte_array_append (context->bitstream, buffer->data,
+          buffer->size * buffer->num_elements);
+      if (context->packed_header_type == VAEncPackedHeaderSlice) {
+        const guint mark = context->bitstream->len;
+        g_array_append_val (context->slice_marks, mark);
+      }
+      context->packed_header_type = 0;
+      break;
+    default:
+      break;
+  }
+}
+
+/* Processes a video processing pipeline. Called with the driver lock
+ * held */
+static void
+null_render_proc_buffer (NullDriver * drv, NullContext * context,
+    NullBuffer * buffer)
+{
+  const VAProcPipelineParameterBuffer *const param =
+      (VAProcPipelineParameterBuffer *) buffer->data;
+  NullSurface *src, *dst;
+  VARectangle src_rect, dst_rect;
+
+  src = null_object_lookup (drv, param->surface, NULL_OBJECT_SURFACE);
+  dst = null_object_lookup (drv, context->render_target, NULL_OBJECT_SURFACE);
+  if (!src || !dst)
+    return;
+
+  if (param->surface_region)
+    src_rect = *param->surface_region;
+  else {
+    src_rect.x = src_rect.y = 0;
+    src_rect.width = src->layout.width;
+    src_rect.height = src->layout.height;
+  }
+  if (param->output_region)
+    dst_rect = *param->output_region;
+  else {
+    dst_rect.x = dst_rect.y = 0;
+    dst_rect.width = dst->layout.width;
+    dst_rect.height = dst->layout.height;
+  }
+
+  /* Clamp to the actual surface bounds */
+  if (src_rect.x < 0 || src_rect.y < 0 ||
+      src_rect.x >= src->layout.width || src_rect.y >= src->layout.height ||
+      dst_rect.x < 0 || dst_rect.y < 0 ||
+      dst_rect.x >= dst->layout.width || dst_rect.y >= dst->layout.height)
+    return;
+  src_rect.width = MIN (src_rect.width, src->layout.width - src_rect.x);
+  src_rect.height = MIN (src_rect.height, src->layout.height - src_rect.y);
+  dst_rect.width = MIN (dst_rect.width, dst->layout.width - dst_rect.x);
+  dst_rect.height = MIN (dst_rect.height, dst->layout.height - dst_rect.y);
+
+  if (src->layout.info == dst->layout.info)
+    null_scale_rect (&dst->layout, dst->data, &dst_rect, &src->layout,
+        src->data, &src_rect);
+  else if (src_rect.width == dst_rect.width &&
+      src_rect.height == dst_rect.height)
+    null_convert_rect (&dst->layout, dst->data, dst_rect.x, dst_rect.y,
+        &src->layout, src->data, src_rect.x, src_rect.y, src_rect.width,
+        src_rect.height);
+}
+
+static VAStatus
+null_RenderPicture (VADriverContextP ctx, VAContextID context_id,
+    VABufferID * buffers, int num_buffers)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullContext *context;
+  NullBuffer *buffer;
+  VAStatus status = VA_STATUS_SUCCESS;
+  int i;
+
+  g_mutex_lock (&drv->lock);
+  context = null_object_lookup (drv, context_id, NULL_OBJECT_CONTEXT);
+  if (!context) {
+    status = VA_STATUS_ERROR_INVALID_CONTEXT;
+    goto done;
+  }
+
+  drv->num_render_calls++;
+  for (i = 0; i < num_buffers; i++) {
+    buffer = null_object_lookup (drv, buffers[i], NULL_OBJECT_BUFFER);
+    if (!buffer) {
+      status = VA_STATUS_ERROR_INVALID_BUFFER;
+      break;
+    }
+
+    if (null_is_encode_entrypoint (context->entrypoint))
+      null_render_encode_buffer (context, buffer);
+    else if (context->entrypoint == VAEntrypointVideoProc &&
+        buffer->type == VAProcPipelineParameterBufferType)
+      null_render_proc_buffer (drv, context, buffer);
+  }
+
+done:
+  g_mutex_unlock (&drv->lock);
+  return status;
+}
+
+/* Synthetic payload size, roughly halving every 6 QP steps like a
+ * real encoder would */
+static guint
+null_estimate_payload_size (NullContext * context)
+{
+  const gint qp = CLAMP (context->pic_qp + context->slice_qp_delta, 0, 51);
+  const guint size = (context->width * context->height / 8) >> (qp / 6);
+
+  return MAX (size, 16);
+}
+
+/* Writes the coded bitstream for the current picture. Called with the
+ * driver lock held */
+static void
+null_end_encode_picture (NullDriver * drv, NullContext * context)
+{
+  NullBuffer *const coded_buf =
+      null_object_lookup (drv, context->coded_buf, NULL_OBJECT_BUFFER);
+  const guint8 *const headers = context->bitstream->data;
+  const guint num_slices = MAX (context->slice_marks->len, 1);
+  const guint payload_size = null_estimate_payload_size (context);
+  const guint slice_size = MAX (payload_size / num_slices, 1);
+  const guint capacity = coded_buf ? coded_buf->size : 0;
+  guint i, pos = 0, prev = 0, next, len;
+
+#define APPEND(src, n) do {                             \
+    len = MIN ((n), capacity - pos);                    \
+    if (src)                                            \
+      memcpy (coded_buf->data + pos, (src), len);       \
+    else                                                \
+      memset (coded_buf->data + pos, 0xaa, len);        \
+    pos += len;                                         \
+  } while (0)
+
+  if (!coded_buf)
+    return;
+
+  for (i = 0; i < context->slice_marks->len; i++) {
+    next = g_array_index (context->slice_marks, guint, i);
+    APPEND (headers + prev, next - prev);
+    APPEND (NULL, slice_size);
+    prev = next;
+  }
+  APPEND (headers + prev, context->bitstream->len - prev);
+  if (context->slice_marks->len == 0)
+    APPEND (NULL, slice_size);
+#undef APPEND
+
+  coded_buf->segment.size = pos;
+  coded_buf->segment.bit_offset = 0;
+  coded_buf->segment.status = 0;
+  coded_buf->segment.next = NULL;
+  drv->coded_bytes += pos;
+}
+
+static VAStatus
+null_EndPicture (VADriverContextP ctx, VAContextID context_id)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullContext *context;
+  NullSurface *surface;
+  gint64 now;
+
+  g_mutex_lock (&drv->lock);
+  context = null_object_lookup (drv, context_id, NULL_OBJECT_CONTEXT);
+  if (!context) {
+    g_mutex_unlock (&drv->lock);
+    return VA_STATUS_ERROR_INVALID_CONTEXT;
+  }
+
+  if (null_is_encode_entrypoint (context->entrypoint))
+    null_end_encode_picture (drv, context);
+
+  /* Each context behaves like a serial engine: a picture completes
+   * one latency period after the previous one, or after now */
+  now = g_get_monotonic_time ();
+  context->busy_until = MAX (context->busy_until, now) + drv->latency;
+  surface = null_object_lookup (drv, context->render_target,
+      NULL_OBJECT_SURFACE);
+  if (surface)
+    surface->ready_time = context->busy_until;
+  context->render_target = VA_INVALID_ID;
+  drv->num_pictures++;
+  g_mutex_unlock (&drv->lock);
+  return VA_STATUS_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Images and subpictures                                            --- */
+/* ------------------------------------------------------------------------- */
+
+static VAStatus
+null_QueryImageFormats (VADriverContextP ctx, VAImageFormat * format_list,
+    int *num_formats)
+{
+  memcpy (format_list, null_image_formats, sizeof (null_image_formats));
+  *num_formats = G_N_ELEMENTS (null_image_formats);
+  return VA_STATUS_SUCCESS;
+}
+
+/* Creates the image and its backing buffer. Called with the driver
+ * lock held */
+static void
+null_image_add (NullDriver * drv, const VAImageFormat * format,
+    const NullLayout * layout, guint8 * data, VASurfaceID derived_surface,
+    VAImage * out_image)
+{
+  NullImage *const image = g_slice_new0 (NullImage);
+  NullBuffer *const buffer = g_slice_new0 (NullBuffer);
+  guint i;
+
+  buffer->type = VAImageBufferType;
+  buffer->size = layout->data_size;
+  buffer->num_elements = 1;
+  buffer->borrowed = data != NULL;
+  buffer->data = data ? data : g_malloc0 (layout->data_size);
+
+  image->derived_surface = derived_surface;
+  image->image.format = *format;
+  image->image.buf = null_object_add (drv, buffer, NULL_OBJECT_BUFFER);
+  image->image.width = layout->width;
+  image->image.height = layout->height;
+  image->image.data_size = layout->data_size;
+  image->image.num_planes = layout->info->num_planes;
+  for (i = 0; i < layout->info->num_planes; i++) {
+    image->image.pitches[i] = layout->pitches[i];
+    image->image.offsets[i] = layout->offsets[i];
+  }
+  image->image.image_id = null_object_add (drv, image, NULL_OBJECT_IMAGE);
+  *out_image = image->image;
+}
+
+static const VAImageFormat *
+null_find_image_format (guint32 fourcc)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (null_image_formats); i++) {
+    if (null_image_formats[i].fourcc == fourcc)
+      return &null_image_formats[i];
+  }
+  return NULL;
+}
+
+static VAStatus
+null_CreateImage (VADriverContextP ctx, VAImageFormat * format, int width,
+    int height, VAImage * image)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullLayout layout;
+
+  if (!null_layout_init (&layout, format->fourcc, width, height))
+    return VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
+
+  g_mutex_lock (&drv->lock);
+  null_image_add (drv, format, &layout, NULL, VA_INVALID_ID, image);
+  g_mutex_unlock (&drv->lock);
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_DeriveImage (VADriverContextP ctx, VASurfaceID surface_id,
+    VAImage * image)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  const VAImageFormat *format;
+  NullSurface *surface;
+
+  g_mutex_lock (&drv->lock);
+  surface = null_object_lookup (drv, surface_id, NULL_OBJECT_SURFACE);
+  if (!surface) {
+    g_mutex_unlock (&drv->lock);
+    return VA_STATUS_ERROR_INVALID_SURFACE;
+  }
+
+  format = null_find_image_format (surface->layout.info->fourcc);
+  null_image_add (drv, format, &surface->layout, surface->data, surface_id,
+      image);
+  surface->num_derived++;
+  g_mutex_unlock (&drv->lock);
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_DestroyImage (VADriverContextP ctx, VAImageID image_id)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullImage *image;
+  NullSurface *surface;
+
+  g_mutex_lock (&drv->lock);
+  image = null_object_lookup (drv, image_id, NULL_OBJECT_IMAGE);
+  if (!image) {
+    g_mutex_unlock (&drv->lock);
+    return VA_STATUS_ERROR_INVALID_IMAGE;
+  }
+
+  surface = null_object_lookup (drv, image->derived_surface,
+      NULL_OBJECT_SURFACE);
+  if (surface && surface->num_derived > 0)
+    surface->num_derived--;
+  null_object_remove (drv, image->image.buf, NULL_OBJECT_BUFFER);
+  null_object_remove (drv, image_id, NULL_OBJECT_IMAGE);
+  g_mutex_unlock (&drv->lock);
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_SetImagePalette (VADriverContextP ctx, VAImageID image,
+    unsigned char *palette)
+{
+  return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+/* Transfers a rectangle between a surface and an image */
+static VAStatus
+null_transfer_image (NullDriver * drv, VASurfaceID surface_id,
+    VAImageID image_id, gboolean to_image, guint x, guint y, guint width,
+    guint height, guint image_x, guint image_y)
+{
+  NullSurface *surface;
+  NullImage *image;
+  NullBuffer *buffer;
+  NullLayout layout;
+  VAStatus status = VA_STATUS_SUCCESS;
+  gboolean success;
+
+  g_mutex_lock (&drv->lock);
+  surface = null_object_lookup (drv, surface_id, NULL_OBJECT_SURFACE);
+  image = null_object_lookup (drv, image_id, NULL_OBJECT_IMAGE);
+  buffer = image ? null_object_lookup (drv, image->image.buf,
+      NULL_OBJECT_BUFFER) : NULL;
+  if (!surface) {
+    status = VA_STATUS_ERROR_INVALID_SURFACE;
+    goto done;
+  }
+  if (!image || !buffer) {
+    status = VA_STATUS_ERROR_INVALID_IMAGE;
+    goto done;
+  }
+  if (buffer->data == surface->data)
+    goto done;
+
+  null_layout_init (&layout, image->image.format.fourcc, image->image.width,
+      image->image.height);
+
+  if (x >= surface->layout.width || y >= surface->layout.height ||
+      image_x >= layout.width || image_y >= layout.height) {
+    status = VA_STATUS_ERROR_INVALID_PARAMETER;
+    goto done;
+  }
+  width = MIN (width, MIN (surface->layout.width - x, layout.width - image_x));
+  height = MIN (height,
+      MIN (surface->layout.height - y, layout.height - image_y));
+
+  if (layout.info == surface->layout.info) {
+    if (to_image)
+      null_copy_rect (&layout, buffer->data, image_x, image_y,
+          &surface->layout, surface->data, x, y, width, height);
+    else
+      null_copy_rect (&surface->layout, surface->data, x, y, &layout,
+          buffer->data, image_x, image_y, width, height);
+    goto done;
+  }
+
+  if (to_image)
+    success = null_convert_rect (&layout, buffer->data, image_x, image_y,
+        &surface->layout, surface->data, x, y, width, height);
+  else
+    success = null_convert_rect (&surface->layout, surface->data, x, y,
+        &layout, buffer->data, image_x, image_y, width, height);
+  if (!success)
+    status = VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
+
+done:
+  g_mutex_unlock (&drv->lock);
+  return status;
+}
+
+static VAStatus
+null_GetImage (VADriverContextP ctx, VASurfaceID surface, int x, int y,
+    unsigned int width, unsigned int height, VAImageID image)
+{
+  return null_transfer_image (NULL_DRIVER (ctx), surface, image, TRUE,
+      x, y, width, height, 0, 0);
+}
+
+static VAStatus
+null_PutImage (VADriverContextP ctx, VASurfaceID surface, VAImageID image,
+    int src_x, int src_y, unsigned int src_width, unsigned int src_height,
+    int dest_x, int dest_y, unsigned int dest_width, unsigned int dest_height)
+{
+  /* No scaling on upload, like most hardware drivers */
+  if (src_width != dest_width || src_height != dest_height)
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+  return null_transfer_image (NULL_DRIVER (ctx), surface, image, FALSE,
+      dest_x, dest_y, src_width, src_height, src_x, src_y);
+}
+
+static VAStatus
+null_QuerySubpictureFormats (VADriverContextP ctx,
+    VAImageFormat * format_list, unsigned int *flags,
+    unsigned int *num_formats)
+{
+  const guint32 fourccs[] = {
+    FOURCC ('B', 'G', 'R', 'A'), FOURCC ('R', 'G', 'B', 'A'),
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (fourccs); i++) {
+    format_list[i] = *null_find_image_format (fourccs[i]);
+    if (flags)
+      flags[i] = VA_SUBPICTURE_GLOBAL_ALPHA;
+  }
+  *num_formats = G_N_ELEMENTS (fourccs);
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_CreateSubpicture (VADriverContextP ctx, VAImageID image,
+    VASubpictureID * subpicture)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullSubpicture *subpic;
+
+  g_mutex_lock (&drv->lock);
+  if (!null_object_lookup (drv, image, NULL_OBJECT_IMAGE)) {
+    g_mutex_unlock (&drv->lock);
+    return VA_STATUS_ERROR_INVALID_IMAGE;
+  }
+  subpic = g_slice_new0 (NullSubpicture);
+  subpic->image = image;
+  *subpicture = null_object_add (drv, subpic, NULL_OBJECT_SUBPICTURE);
+  g_mutex_unlock (&drv->lock);
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_DestroySubpicture (VADriverContextP ctx, VASubpictureID subpicture)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  gboolean success;
+
+  g_mutex_lock (&drv->lock);
+  success = null_object_remove (drv, subpicture, NULL_OBJECT_SUBPICTURE);
+  g_mutex_unlock (&drv->lock);
+  return success ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_SUBPICTURE;
+}
+
+static VAStatus
+null_SetSubpictureImage (VADriverContextP ctx, VASubpictureID subpicture,
+    VAImageID image)
+{
+  NullDriver *const drv = NULL_DRIVER (ctx);
+  NullSubpicture *subpic;
+
+  g_mutex_lock (&drv->lock);
+  subpic = null_object_lookup (drv, subpicture, NULL_OBJECT_SUBPICTURE);
+  if (subpic)
+    subpic->image = image;
+  g_mutex_unlock (&drv->lock);
+  return subpic ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_SUBPICTURE;
+}
+
+static VAStatus
+null_SetSubpictureChromakey (VADriverContextP ctx, VASubpictureID subpicture,
+    unsigned int chromakey_min, unsigned int chromakey_max,
+    unsigned int chromakey_mask)
+{
+  return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+null_SetSubpictureGlobalAlpha (VADriverContextP ctx,
+    VASubpictureID subpicture, float global_alpha)
+{
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_AssociateSubpicture (VADriverContextP ctx, VASubpictureID subpicture,
+    VASurfaceID * target_surfaces, int num_surfaces, short src_x,
+    short src_y, unsigned short src_width, unsigned short src_height,
+    short dest_x, short dest_y, unsigned short dest_width,
+    unsigned short dest_height, unsigned int flags)
+{
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_DeassociateSubpicture (VADriverContextP ctx, VASubpictureID subpicture,
+    VASurfaceID * target_surfaces, int num_surfaces)
+{
+  return VA_STATUS_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Display attributes and video processing                           --- */
+/* ------------------------------------------------------------------------- */
+
+static VAStatus
+null_QueryDisplayAttributes (VADriverContextP ctx,
+    VADisplayAttribute * attr_list, int *num_attributes)
+{
+  *num_attributes = 0;
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_GetDisplayAttributes (VADriverContextP ctx,
+    VADisplayAttribute * attr_list, int num_attributes)
+{
+  return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+null_SetDisplayAttributes (VADriverContextP ctx,
+    VADisplayAttribute * attr_list, int num_attributes)
+{
+  return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus
+null_QueryVideoProcFilters (VADriverContextP ctx, VAContextID context,
+    VAProcFilterType * filters, unsigned int *num_filters)
+{
+  *num_filters = 0;
+  return VA_STATUS_SUCCESS;
+}
+
+static VAStatus
+null_QueryVideoProcFilterCaps (VADriverContextP ctx, VAContextID context,
+    VAProcFilterType type, void *filter_caps, unsigned int *num_filter_caps)
+{
+  *num_filter_caps = 0;
+  return VA_STATUS_ERROR_UNSUPPORTED_FILTER;
+}
+
+static VAStatus
+null_QueryVideoProcPipelineCaps (VADriverContextP ctx, VAContextID context,
+    VABufferID * filters, unsigned int num_filters,
+    VAProcPipelineCaps * pipeline_caps)
+{
+  memset (pipeline_caps, 0, sizeof (*pipeline_caps));
+  return VA_STATUS_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- Display context                                                   --- */
+/* ------------------------------------------------------------------------- */
+
+static int
+null_display_is_valid (VADisplayContextP dpy_ctx)
+{
+  return dpy_ctx && dpy_ctx->pDriverContext &&
+      dpy_ctx->pDriverContext->pDriverData;
+}
+
+static void
+null_display_destroy (VADisplayContextP dpy_ctx)
+{
+  VADriverContextP const ctx = dpy_ctx->pDriverContext;
+  NullDriver *const drv = NULL_DRIVER (ctx);
+
+  if (drv) {
+    g_hash_table_unref (drv->objects);
+    g_mutex_clear (&drv->lock);
+    g_slice_free (NullDriver, drv);
+  }
+
+  /* vaTerminate() frees the vtables and resets them to NULL, this only
+   * matters if the display was never initialized */
+  free (ctx->vtable);
+  free (ctx->vtable_vpp);
+  free (ctx);
+  free (dpy_ctx);
+}
+
+static VAStatus
+null_display_get_driver_name (VADisplayContextP dpy_ctx, char **driver_name)
+{
+  *driver_name = strdup ("null");
+  return VA_STATUS_SUCCESS;
+}
+
+/**
+ * gst_vaapi_null_driver_open:
+ *
+ * Allocates a #VADisplay whose driver context dispatches into the
+ * software VA driver. The display must be initialized with
+ * gst_vaapi_null_driver_initialize() instead of vaInitialize(), and
+ * is released with vaTerminate() as usual.
+ *
+ * Return value: the newly allocated #VADisplay, or %NULL on error
+ */
+VADisplay
+gst_vaapi_null_driver_open (void)
+{
+  VADisplayContextP dpy_ctx;
+  VADriverContextP ctx;
+
+  dpy_ctx = calloc (1, sizeof (*dpy_ctx));
+  if (!dpy_ctx)
+    return NULL;
+
+  ctx = calloc (1, sizeof (*ctx));
+  if (!ctx) {
+    free (dpy_ctx);
+    return NULL;
+  }
+
+  dpy_ctx->vadpy_magic = VA_DISPLAY_MAGIC;
+  dpy_ctx->pDriverContext = ctx;
+  dpy_ctx->vaIsValid = null_display_is_valid;
+  dpy_ctx->vaDestroy = null_display_destroy;
+  dpy_ctx->vaGetDriverName = null_display_get_driver_name;
+  return (VADisplay) dpy_ctx;
+}
+
+/**
+ * gst_vaapi_null_driver_initialize:
+ * @dpy: a #VADisplay from gst_vaapi_null_driver_open()
+ *
+ * Binds the software driver to @dpy, i.e. does what vaInitialize()
+ * would have done after loading a regular driver module.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_vaapi_null_driver_initialize (VADisplay dpy)
+{
+  VADisplayContextP const dpy_ctx = (VADisplayContextP) dpy;
+  VADriverContextP const ctx = dpy_ctx->pDriverContext;
+  struct VADriverVTable *vtable;
+  struct VADriverVTableVPP *vtable_vpp;
+  NullDriver *drv;
+
+  if (ctx->pDriverData)
+    return TRUE;
+
+  /* libva releases the vtables with free() in vaTerminate() */
+  vtable = calloc (1, sizeof (*vtable));
+  vtable_vpp = calloc (1, sizeof (*vtable_vpp));
+  if (!vtable || !vtable_vpp) {
+    free (vtable);
+    free (vtable_vpp);
+    return FALSE;
+  }
+
+  vtable->vaTerminate = null_Terminate;
+  vtable->vaQueryConfigProfiles = null_QueryConfigProfiles;
+  vtable->vaQueryConfigEntrypoints = null_QueryConfigEntrypoints;
+  vtable->vaGetConfigAttributes = null_GetConfigAttributes;
+  vtable->vaCreateConfig = null_CreateConfig;
+  vtable->vaDestroyConfig = null_DestroyConfig;
+  vtable->vaQueryConfigAttributes = null_QueryConfigAttributes;
+  vtable->vaCreateSurfaces = null_CreateSurfaces;
+  vtable->vaDestroySurfaces = null_DestroySurfaces;
+  vtable->vaCreateContext = null_CreateContext;
+  vtable->vaDestroyContext = null_DestroyContext;
+  vtable->vaCreateBuffer = null_CreateBuffer;
+  vtable->vaBufferSetNumElements = null_BufferSetNumElements;
+  vtable->vaMapBuffer = null_MapBuffer;
+  vtable->vaUnmapBuffer = null_UnmapBuffer;
+  vtable->vaDestroyBuffer = null_DestroyBuffer;
+  vtable->vaBeginPicture = null_BeginPicture;
+  vtable->vaRenderPicture = null_RenderPicture;
+  vtable->vaEndPicture = null_EndPicture;
+  vtable->vaSyncSurface = null_SyncSurface;
+  vtable->vaQuerySurfaceStatus = null_QuerySurfaceStatus;
+  vtable->vaQuerySurfaceError = null_QuerySurfaceError;
+  vtable->vaQueryImageFormats = null_QueryImageFormats;
+  vtable->vaCreateImage = null_CreateImage;
+  vtable->vaDeriveImage = null_DeriveImage;
+  vtable->vaDestroyImage = null_DestroyImage;
+  vtable->vaSetImagePalette = null_SetImagePalette;
+  vtable->vaGetImage = null_GetImage;
+  vtable->vaPutImage = null_PutImage;
+  vtable->vaQuerySubpictureFormats = null_QuerySubpictureFormats;
+  vtable->vaCreateSubpicture = null_CreateSubpicture;
+  vtable->vaDestroySubpicture = null_DestroySubpicture;
+  vtable->vaSetSubpictureImage = null_SetSubpictureImage;
+  vtable->vaSetSubpictureChromakey = null_SetSubpictureChromakey;
+  vtable->vaSetSubpictureGlobalAlpha = null_SetSubpictureGlobalAlpha;
+  vtable->vaAssociateSubpicture = null_AssociateSubpicture;
+  vtable->vaDeassociateSubpicture = null_DeassociateSubpicture;
+  vtable->vaQueryDisplayAttributes = null_QueryDisplayAttributes;
+  vtable->vaGetDisplayAttributes = null_GetDisplayAttributes;
+  vtable->vaSetDisplayAttributes = null_SetDisplayAttributes;
+  vtable->vaBufferInfo = null_BufferInfo;
+  vtable->vaCreateSurfaces2 = null_CreateSurfaces2;
+  vtable->vaQuerySurfaceAttributes = null_QuerySurfaceAttributes;
+
+  vtable_vpp->version = VA_DRIVER_VTABLE_VPP_VERSION;
+  vtable_vpp->vaQueryVideoProcFilters = null_QueryVideoProcFilters;
+  vtable_vpp->vaQueryVideoProcFilterCaps = null_QueryVideoProcFilterCaps;
+  vtable_vpp->vaQueryVideoProcPipelineCaps = null_QueryVideoProcPipelineCaps;
+
+  drv = g_slice_new0 (NullDriver);
+  g_mutex_init (&drv->lock);
+  drv->objects = g_hash_table_new_full (NULL, NULL, NULL, null_object_free);
+  drv->next_id = 1;
+
+  ctx->vtable = vtable;
+  ctx->vtable_vpp = vtable_vpp;
+  ctx->version_major = VA_MAJOR_VERSION;
+  ctx->version_minor = VA_MINOR_VERSION;
+  ctx->max_profiles = NULL_MAX_PROFILES;
+  ctx->max_entrypoints = NULL_MAX_ENTRYPOINTS;
+  ctx->max_attributes = NULL_MAX_ATTRIBUTES;
+  ctx->max_image_formats = NULL_MAX_IMAGE_FORMATS;
+  ctx->max_subpic_formats = NULL_MAX_SUBPIC_FORMATS;
+  ctx->max_display_attributes = NULL_MAX_DISPLAY_ATTRIBUTES;
+  ctx->str_vendor = GST_VAAPI_NULL_DRIVER_VENDOR;
+  ctx->pDriverData = drv;
+
+  GST_INFO ("software VA driver initialized (VA-API version %d.%d)",
+      VA_MAJOR_VERSION, VA_MINOR_VERSION);
+  return TRUE;
+}
+
+static inline NullDriver *
+get_driver (VADisplay dpy)
+{
+  VADisplayContextP const dpy_ctx = (VADisplayContextP) dpy;
+
+  if (!dpy_ctx || dpy_ctx->vadpy_magic != VA_DISPLAY_MAGIC ||
+      dpy_ctx->vaIsValid != null_display_is_valid)
+    return NULL;
+  return NULL_DRIVER (dpy_ctx->pDriverContext);
+}
+
+/**
+ * gst_vaapi_null_driver_set_latency:
+ * @dpy: a #VADisplay bound to the software driver
+ * @latency: the per-picture completion latency, in microseconds
+ *
+ * Sets the time a submitted picture takes to complete. Pictures
+ * submitted to the same context are processed one after another.
+ */
+void
+gst_vaapi_null_driver_set_latency (VADisplay dpy, guint latency)
+{
+  NullDriver *const drv = get_driver (dpy);
+
+  g_return_if_fail (drv != NULL);
+
+  g_mutex_lock (&drv->lock);
+  drv->latency = latency;
+  g_mutex_unlock (&drv->lock);
+}
+
+/**
+ * gst_vaapi_null_driver_get_latency:
+ * @dpy: a #VADisplay bound to the software driver
+ *
+ * Return value: the per-picture completion latency, in microseconds
+ */
+guint
+gst_vaapi_null_driver_get_latency (VADisplay dpy)
+{
+  NullDriver *const drv = get_driver (dpy);
+  guint latency;
+
+  g_return_val_if_fail (drv != NULL, 0);
+
+  g_mutex_lock (&drv->lock);
+  latency = drv->latency;
+  g_mutex_unlock (&drv->lock);
+  return latency;
+}
+
+/**
+ * gst_vaapi_null_driver_get_statistics:
+ * @dpy: a #VADisplay bound to the software driver
+ *
+ * Collects the driver call counters, so that tests can check how many
+ * driver round-trips a given workload costs.
+ *
+ * Return value: (transfer full): a newly allocated #GstStructure
+ */
+GstStructure *
+gst_vaapi_null_driver_get_statistics (VADisplay dpy)
+{
+  NullDriver *const drv = get_driver (dpy);
+  GstStructure *stats;
+
+  g_return_val_if_fail (drv != NULL, NULL);
+
+  g_mutex_lock (&drv->lock);
+  stats = gst_structure_new ("null-driver-stats",
+      "surfaces", G_TYPE_UINT64, drv->num_surfaces,
+      "buffers", G_TYPE_UINT64, drv->num_buffers,
+      "pictures", G_TYPE_UINT64, drv->num_pictures,
+      "render-calls", G_TYPE_UINT64, drv->num_render_calls,
+      "syncs", G_TYPE_UINT64, drv->num_syncs,
+      "sync-wait-time", G_TYPE_UINT64, drv->sync_wait_time,
+      "coded-bytes", G_TYPE_UINT64, drv->coded_bytes,
+      "live-objects", G_TYPE_UINT, g_hash_table_size (drv->objects), NULL);
+  g_mutex_unlock (&drv->lock);
+  return stats;
+}
@@ -0,0 +1,53 @@
+/*
+ *  gstvaapiutils_null.h - Software VA driver stand-in
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_UTILS_NULL_H
+#define GST_VAAPI_UTILS_NULL_H
+
+#include <va/va.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Vendor string reported by the software VA driver */
+#define GST_VAAPI_NULL_DRIVER_VENDOR "GStreamer VA-API null driver"
+
+G_GNUC_INTERNAL
+VADisplay
+gst_vaapi_null_driver_open (void);
+
+G_GNUC_INTERNAL
+gboolean
+gst_vaapi_null_driver_initialize (VADisplay dpy);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_null_driver_set_latency (VADisplay dpy, guint latency);
+
+G_GNUC_INTERNAL
+guint
+gst_vaapi_null_driver_get_latency (VADisplay dpy);
+
+G_GNUC_INTERNAL
+GstStructure *
+gst_vaapi_null_driver_get_statistics (VADisplay dpy);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_UTILS_NULL_H */
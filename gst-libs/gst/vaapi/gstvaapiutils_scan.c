@@ -0,0 +1,412 @@
+/*
+ *  gstvaapiutils_scan.c - Start code scanning kernels
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* H.264, H.265, MPEG-2 and VC-1 byte streams delimit their units with
+ * a 00 00 01 start code. Intra pictures of high bitrate streams are
+ * megabytes of payload where the start code is looked for, which
+ * gst_adapter_masked_scan_uint32_peek() does one byte at a time. The
+ * vector kernels below compare 16 or 32 positions at once, and are
+ * picked at runtime the same way as the plane copy kernels.
+ *
+ * The GST_VAAPI_SCAN_KERNEL environment variable forces a kernel by
+ * name ("scalar", "neon", "sse2", "avx2"), if it is supported. */
+
+#include "sysdeps.h"
+#include "gstvaapiutils_scan.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_vaapi_scan);
+#define GST_CAT_DEFAULT gst_debug_vaapi_scan
+
+#if (defined (__x86_64__) || defined (__i386__)) && \
+    (defined (__clang__) || (defined (__GNUC__) && __GNUC__ >= 5))
+# define HAVE_SCAN_KERNELS_X86 1
+# include <immintrin.h>
+#endif
+
+#if defined (__aarch64__) || (defined (__ARM_NEON) && defined (__ARM_NEON__))
+# define HAVE_SCAN_KERNELS_NEON 1
+# include <arm_neon.h>
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* --- Scalar                                                            --- */
+/* ------------------------------------------------------------------------- */
+
+static gint
+scan_scalar (const guint8 * data, guint size)
+{
+  guint i = 0;
+
+  /* Skip as many bytes as the last one checked rules out */
+  while (i + 3 <= size) {
+    if (data[i + 2] > 1)
+      i += 3;
+    else if (data[i + 1])
+      i += 2;
+    else if (data[i] || data[i + 2] != 1)
+      i++;
+    else
+      return i;
+  }
+  return -1;
+}
+
+/* Finishes the scan of a block where a vector kernel stopped */
+static inline gint
+scan_tail (const guint8 * data, guint size, guint i)
+{
+  const gint ret = scan_scalar (data + i, size - i);
+
+  return ret < 0 ? -1 : (gint) i + ret;
+}
+
+/* ------------------------------------------------------------------------- */
+/* --- x86 (SSE2, AVX2)                                                  --- */
+/* ------------------------------------------------------------------------- */
+
+#if HAVE_SCAN_KERNELS_X86
+__attribute__ ((target ("sse2")))
+static gint
+scan_sse2 (const guint8 * data, guint size)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i one = _mm_set1_epi8 (1);
+  guint i, mask;
+
+  /* Each iteration checks the 16 start code positions i .. i + 15 */
+  for (i = 0; i + 18 <= size; i += 16) {
+    const __m128i b0 = _mm_loadu_si128 ((const __m128i *) (data + i));
+    const __m128i b1 = _mm_loadu_si128 ((const __m128i *) (data + i + 1));
+    const __m128i b2 = _mm_loadu_si128 ((const __m128i *) (data + i + 2));
+
+    mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (b2, one),
+            _mm_and_si128 (_mm_cmpeq_epi8 (b0, zero),
+                _mm_cmpeq_epi8 (b1, zero))));
+    if (mask)
+      return i + __builtin_ctz (mask);
+  }
+  return scan_tail (data, size, i);
+}
+
+__attribute__ ((target ("avx2")))
+static gint
+scan_avx2 (const guint8 * data, guint size)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i one = _mm256_set1_epi8 (1);
+  guint i, mask;
+
+  for (i = 0; i + 34 <= size; i += 32) {
+    const __m256i b0 = _mm256_loadu_si256 ((const __m256i *) (data + i));
+    const __m256i b1 = _mm256_loadu_si256 ((const __m256i *) (data + i + 1));
+    const __m256i b2 = _mm256_loadu_si256 ((const __m256i *) (data + i + 2));
+
+    mask = _mm256_movemask_epi8 (_mm256_and_si256 (_mm256_cmpeq_epi8 (b2, one),
+            _mm256_and_si256 (_mm256_cmpeq_epi8 (b0, zero),
+                _mm256_cmpeq_epi8 (b1, zero))));
+    if (mask)
+      return i + __builtin_ctz (mask);
+  }
+  return scan_tail (data, size, i);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* --- ARM (NEON)                                                        --- */
+/* ------------------------------------------------------------------------- */
+
+#if HAVE_SCAN_KERNELS_NEON
+static gint
+scan_neon (const guint8 * data, guint size)
+{
+  const uint8x16_t zero = vdupq_n_u8 (0);
+  const uint8x16_t one = vdupq_n_u8 (1);
+  guint i;
+
+  /* NEON has no movemask, so find the matching block, then the match
+     within the block with the scalar kernel */
+  for (i = 0; i + 18 <= size; i += 16) {
+    const uint8x16_t b0 = vld1q_u8 (data + i);
+    const uint8x16_t b1 = vld1q_u8 (data + i + 1);
+    const uint8x16_t b2 = vld1q_u8 (data + i + 2);
+    const uint64x2_t m = vreinterpretq_u64_u8 (vandq_u8 (vceqq_u8 (b2, one),
+            vandq_u8 (vceqq_u8 (b0, zero), vceqq_u8 (b1, zero))));
+
+    if (vgetq_lane_u64 (m, 0) | vgetq_lane_u64 (m, 1))
+      break;
+  }
+  return scan_tail (data, size, i);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* --- Dispatch                                                          --- */
+/* ------------------------------------------------------------------------- */
+
+static const gchar *const g_kernel_names[GST_VAAPI_SCAN_KERNEL_COUNT] = {
+  [GST_VAAPI_SCAN_KERNEL_SCALAR] = "scalar",
+  [GST_VAAPI_SCAN_KERNEL_NEON] = "neon",
+  [GST_VAAPI_SCAN_KERNEL_SSE2] = "sse2",
+  [GST_VAAPI_SCAN_KERNEL_AVX2] = "avx2",
+};
+
+static GstVaapiScanFunc g_scan_func;
+
+/**
+ * gst_vaapi_scan_kernel_get_name:
+ * @kernel: a #GstVaapiScanKernel
+ *
+ * Return value: the name of @kernel
+ */
+const gchar *
+gst_vaapi_scan_kernel_get_name (GstVaapiScanKernel kernel)
+{
+  g_return_val_if_fail (kernel < GST_VAAPI_SCAN_KERNEL_COUNT, NULL);
+
+  return g_kernel_names[kernel];
+}
+
+/**
+ * gst_vaapi_scan_kernel_get_func:
+ * @kernel: a #GstVaapiScanKernel
+ *
+ * Return value: the start code scan function implementing @kernel, or
+ *   %NULL if it is not supported by the compiler or the CPU
+ */
+GstVaapiScanFunc
+gst_vaapi_scan_kernel_get_func (GstVaapiScanKernel kernel)
+{
+  switch (kernel) {
+    case GST_VAAPI_SCAN_KERNEL_SCALAR:
+      return scan_scalar;
+#if HAVE_SCAN_KERNELS_NEON
+    case GST_VAAPI_SCAN_KERNEL_NEON:
+      return scan_neon;
+#endif
+#if HAVE_SCAN_KERNELS_X86
+    case GST_VAAPI_SCAN_KERNEL_SSE2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("sse2") ? scan_sse2 : NULL;
+    case GST_VAAPI_SCAN_KERNEL_AVX2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("avx2") ? scan_avx2 : NULL;
+#endif
+    default:
+      break;
+  }
+  return NULL;
+}
+
+static GstVaapiScanKernel
+find_kernel_by_name (const gchar * name)
+{
+  guint i;
+
+  for (i = 0; i < GST_VAAPI_SCAN_KERNEL_COUNT; i++) {
+    if (g_ascii_strcasecmp (name, g_kernel_names[i]) == 0)
+      return i;
+  }
+  return GST_VAAPI_SCAN_KERNEL_COUNT;
+}
+
+/**
+ * gst_vaapi_scan_get_default_kernel:
+ *
+ * Determines the kernel used by gst_vaapi_scan_for_start_code(), i.e.
+ * the one named by GST_VAAPI_SCAN_KERNEL if supported, or the most
+ * efficient one the CPU supports.
+ *
+ * Return value: the default #GstVaapiScanKernel
+ */
+GstVaapiScanKernel
+gst_vaapi_scan_get_default_kernel (void)
+{
+  static gsize g_kernel = 0;
+
+  if (g_once_init_enter (&g_kernel)) {
+    const gchar *const env = g_getenv ("GST_VAAPI_SCAN_KERNEL");
+    GstVaapiScanKernel kernel = GST_VAAPI_SCAN_KERNEL_COUNT;
+    gint i;
+
+    GST_DEBUG_CATEGORY_INIT (gst_debug_vaapi_scan, "vaapiscan", 0,
+        "VA-API start code scanning kernels");
+
+    if (env) {
+      kernel = find_kernel_by_name (env);
+      if (kernel == GST_VAAPI_SCAN_KERNEL_COUNT ||
+          !gst_vaapi_scan_kernel_get_func (kernel)) {
+        GST_WARNING ("unsupported scan kernel '%s'", env);
+        kernel = GST_VAAPI_SCAN_KERNEL_COUNT;
+      }
+    }
+
+    for (i = GST_VAAPI_SCAN_KERNEL_COUNT - 1;
+        kernel == GST_VAAPI_SCAN_KERNEL_COUNT && i >= 0; i--) {
+      if (gst_vaapi_scan_kernel_get_func (i))
+        kernel = i;
+    }
+
+    GST_INFO ("using %s start code scan kernel", g_kernel_names[kernel]);
+    g_scan_func = gst_vaapi_scan_kernel_get_func (kernel);
+    g_once_init_leave (&g_kernel, kernel + 1);
+  }
+  return g_kernel - 1;
+}
+
+/**
+ * gst_vaapi_scan_for_start_code:
+ * @data: the bytes to scan
+ * @size: the number of bytes in @data
+ *
+ * Looks for the first 00 00 01 start code in @data that is followed
+ * by at least one byte, i.e. the unit type, with the default kernel.
+ *
+ * Return value: the offset of the start code, or -1 if none was found
+ */
+gint
+gst_vaapi_scan_for_start_code (const guint8 * data, guint size)
+{
+  if (G_UNLIKELY (!g_scan_func))
+    gst_vaapi_scan_get_default_kernel ();
+
+  if (size < 4)
+    return -1;
+  return g_scan_func (data, size - 1);
+}
+
+/* Scans the @size bytes of @data found at offset @pos of an adapter,
+ * preceded by the @tail_size bytes of @tail, i.e. the last ones of the
+ * previous chunk, then keeps the last 3 bytes in @tail for the next */
+static gint
+scan_chunk (const guint8 * data, guint size, guint pos, guint8 * tail,
+    guint * tail_size_ptr, guint32 * scp)
+{
+  const guint tail_size = *tail_size_ptr;
+  guint8 seam[6];
+  guint n;
+  gint ret;
+
+  /* Start codes straddling the chunk boundary */
+  n = MIN (size, 3);
+  memcpy (seam, tail, tail_size);
+  memcpy (seam + tail_size, data, n);
+  ret = gst_vaapi_scan_for_start_code (seam, tail_size + n);
+  if (ret >= 0) {
+    if (scp)
+      *scp = GST_READ_UINT32_BE (seam + ret);
+    return pos - tail_size + ret;
+  }
+
+  ret = gst_vaapi_scan_for_start_code (data, size);
+  if (ret >= 0) {
+    if (scp)
+      *scp = GST_READ_UINT32_BE (data + ret);
+    return pos + ret;
+  }
+
+  if (size >= 3) {
+    memcpy (tail, data + size - 3, 3);
+    *tail_size_ptr = 3;
+  } else {
+    n = MIN (tail_size + size, 3);
+    memcpy (tail, seam + tail_size + size - n, n);
+    *tail_size_ptr = n;
+  }
+  return -1;
+}
+
+/**
+ * gst_vaapi_adapter_scan_for_start_code:
+ * @adapter: a #GstAdapter
+ * @ofs: the offset to start scanning from
+ * @size: the number of bytes to scan
+ * @scp: (out) (allow-none): the start code and unit type found
+ *
+ * Drop-in replacement for gst_adapter_masked_scan_uint32_peek() with
+ * a 0xffffff00 mask and a 0x00000100 pattern. Each memory chunk held
+ * by @adapter is scanned in place with the vector kernel, and the last
+ * bytes of one are carried over to the next, so that start codes split
+ * across chunks are found too.
+ *
+ * Return value: the offset of the start code, or -1 if none was found
+ */
+gint
+gst_vaapi_adapter_scan_for_start_code (GstAdapter * adapter, guint ofs,
+    guint size, guint32 * scp)
+{
+  GstBufferList *list;
+  const guint8 *data;
+  guint8 tail[3];
+  guint i, j, num_buffers, pos, skip, tail_size = 0;
+  gint ret = -1;
+
+  if (size < 4)
+    return -1;
+
+  /* All the bytes are in the first buffer, i.e. aligned input */
+  if (ofs + size <= gst_adapter_available_fast (adapter)) {
+    data = gst_adapter_map (adapter, ofs + size);
+    if (!data)
+      return -1;
+
+    ret = gst_vaapi_scan_for_start_code (data + ofs, size);
+    if (ret >= 0 && scp)
+      *scp = GST_READ_UINT32_BE (data + ofs + ret);
+    gst_adapter_unmap (adapter);
+    return ret >= 0 ? ofs + ret : -1;
+  }
+
+  list = gst_adapter_get_buffer_list (adapter, ofs + size);
+  if (!list)
+    return -1;
+
+  num_buffers = gst_buffer_list_length (list);
+  for (i = 0, pos = 0; ret < 0 && i < num_buffers; i++) {
+    GstBuffer *const buffer = gst_buffer_list_get (list, i);
+    const guint num_memories = gst_buffer_n_memory (buffer);
+
+    for (j = 0; ret < 0 && j < num_memories; j++) {
+      GstMemory *const mem = gst_buffer_peek_memory (buffer, j);
+      GstMapInfo map;
+
+      if (pos + mem->size <= ofs) {
+        pos += mem->size;
+        continue;
+      }
+      if (!gst_memory_map (mem, &map, GST_MAP_READ))
+        goto error_map_memory;
+
+      skip = pos < ofs ? ofs - pos : 0;
+      ret = scan_chunk (map.data + skip, map.size - skip, pos + skip, tail,
+          &tail_size, scp);
+      pos += map.size;
+      gst_memory_unmap (mem, &map);
+    }
+  }
+  gst_buffer_list_unref (list);
+  return ret;
+
+  /* ERRORS */
+error_map_memory:
+  {
+    GST_ERROR ("failed to map adapter memory");
+    gst_buffer_list_unref (list);
+    return -1;
+  }
+}
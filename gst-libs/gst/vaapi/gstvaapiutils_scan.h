@@ -0,0 +1,64 @@
+/*
+ *  gstvaapiutils_scan.h - Start code scanning kernels
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_UTILS_SCAN_H
+#define GST_VAAPI_UTILS_SCAN_H
+
+#include <glib.h>
+#include <gst/base/gstadapter.h>
+
+G_BEGIN_DECLS
+
+/* Returns the offset of the first 00 00 01 sequence in data, or -1 */
+typedef gint (*GstVaapiScanFunc) (const guint8 * data, guint size);
+
+/* Start code scan implementations, in increasing order of preference */
+typedef enum
+{
+  GST_VAAPI_SCAN_KERNEL_SCALAR = 0,
+  GST_VAAPI_SCAN_KERNEL_NEON,
+  GST_VAAPI_SCAN_KERNEL_SSE2,
+  GST_VAAPI_SCAN_KERNEL_AVX2,
+  GST_VAAPI_SCAN_KERNEL_COUNT
+} GstVaapiScanKernel;
+
+G_GNUC_INTERNAL
+const gchar *
+gst_vaapi_scan_kernel_get_name (GstVaapiScanKernel kernel);
+
+G_GNUC_INTERNAL
+GstVaapiScanFunc
+gst_vaapi_scan_kernel_get_func (GstVaapiScanKernel kernel);
+
+G_GNUC_INTERNAL
+GstVaapiScanKernel
+gst_vaapi_scan_get_default_kernel (void);
+
+G_GNUC_INTERNAL
+gint
+gst_vaapi_scan_for_start_code (const guint8 * data, guint size);
+
+G_GNUC_INTERNAL
+gint
+gst_vaapi_adapter_scan_for_start_code (GstAdapter * adapter, guint ofs,
+    guint size, guint32 * scp);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_UTILS_SCAN_H */
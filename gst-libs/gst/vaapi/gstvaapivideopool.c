@@ -31,6 +31,7 @@
 #include "gstvaapivideopool.h"
 #include "gstvaapivideopool_priv.h"
 #include "gstvaapiobject.h"
+#include "gstvaapiobject_priv.h"
 
 #define DEBUG 1
 #include "gstvaapidebug.h"
@@ -56,20 +57,24 @@ gst_vaapi_video_pool_init (GstVaapiVideoPool * pool, GstVaapiDisplay * display,
 {
   pool->object_type = object_type;
   pool->display = gst_object_ref (display);
-  pool->used_objects = NULL;
+  pool->free_objects = gst_atomic_queue_new (16);
   pool->used_count = 0;
   pool->capacity = 0;
 
-  g_queue_init (&pool->free_objects);
   g_mutex_init (&pool->mutex);
 }
 
 void
 gst_vaapi_video_pool_finalize (GstVaapiVideoPool * pool)
 {
-  g_list_free_full (pool->used_objects, gst_vaapi_object_unref);
-  g_queue_foreach (&pool->free_objects, (GFunc) gst_vaapi_object_unref, NULL);
-  g_queue_clear (&pool->free_objects);
+  gpointer object;
+
+  /* Objects still in use keep the reference the pool holds on them,
+     since they are not tracked. Every user of an object also holds a
+     reference to the pool, so this only happens for leaked objects */
+  while ((object = gst_atomic_queue_pop (pool->free_objects)))
+    gst_vaapi_object_unref (object);
+  gst_atomic_queue_unref (pool->free_objects);
   gst_vaapi_display_replace (&pool->display, NULL);
   g_mutex_clear (&pool->mutex);
 }
@@ -164,41 +169,37 @@ gst_vaapi_video_pool_get_object_type (GstVaapiVideoPool * pool)
  *
  * Return value: a possibly newly allocated object, or %NULL on error
  */
-static gpointer
-gst_vaapi_video_pool_get_object_unlocked (GstVaapiVideoPool * pool)
+gpointer
+gst_vaapi_video_pool_get_object (GstVaapiVideoPool * pool)
 {
   gpointer object;
+  gint used_count, capacity;
 
-  if (pool->capacity && pool->used_count >= pool->capacity)
-    return NULL;
+  g_return_val_if_fail (pool != NULL, NULL);
 
-  object = g_queue_pop_head (&pool->free_objects);
+  /* Account for the new object first, so that concurrent callers
+     cannot exceed the capacity */
+  do {
+    used_count = g_atomic_int_get (&pool->used_count);
+    capacity = g_atomic_int_get (&pool->capacity);
+    if (capacity && used_count >= capacity)
+      return NULL;
+  } while (!g_atomic_int_compare_and_exchange (&pool->used_count, used_count,
+          used_count + 1));
+
+  object = gst_atomic_queue_pop (pool->free_objects);
   if (!object) {
-    g_mutex_unlock (&pool->mutex);
     object = gst_vaapi_video_pool_alloc_object (pool);
-    g_mutex_lock (&pool->mutex);
-    if (!object)
+    if (!object) {
+      g_atomic_int_add (&pool->used_count, -1);
       return NULL;
+    }
   }
 
-  ++pool->used_count;
-  pool->used_objects = g_list_prepend (pool->used_objects, object);
+  g_atomic_pointer_set (&GST_VAAPI_OBJECT (object)->pool, pool);
   return gst_vaapi_object_ref (object);
 }
 
-gpointer
-gst_vaapi_video_pool_get_object (GstVaapiVideoPool * pool)
-{
-  gpointer object;
-
-  g_return_val_if_fail (pool != NULL, NULL);
-
-  g_mutex_lock (&pool->mutex);
-  object = gst_vaapi_video_pool_get_object_unlocked (pool);
-  g_mutex_unlock (&pool->mutex);
-  return object;
-}
-
 /**
  * gst_vaapi_video_pool_put_object:
  * @pool: a #GstVaapiVideoPool
@@ -209,31 +210,20 @@ gst_vaapi_video_pool_get_object (GstVaapiVideoPool * pool)
  * Calling this function with an arbitrary object yields undefined
  * behaviour.
  */
-static void
-gst_vaapi_video_pool_put_object_unlocked (GstVaapiVideoPool * pool,
-    gpointer object)
-{
-  GList *elem;
-
-  elem = g_list_find (pool->used_objects, object);
-  if (!elem)
-    return;
-
-  gst_vaapi_object_unref (object);
-  --pool->used_count;
-  pool->used_objects = g_list_delete_link (pool->used_objects, elem);
-  g_queue_push_tail (&pool->free_objects, object);
-}
-
 void
 gst_vaapi_video_pool_put_object (GstVaapiVideoPool * pool, gpointer object)
 {
   g_return_if_fail (pool != NULL);
   g_return_if_fail (object != NULL);
 
-  g_mutex_lock (&pool->mutex);
-  gst_vaapi_video_pool_put_object_unlocked (pool, object);
-  g_mutex_unlock (&pool->mutex);
+  /* Ignore objects that are not in use from this pool */
+  if (!g_atomic_pointer_compare_and_exchange (&GST_VAAPI_OBJECT (object)->pool,
+          pool, NULL))
+    return;
+
+  gst_vaapi_object_unref (object);
+  g_atomic_int_add (&pool->used_count, -1);
+  gst_atomic_queue_push (pool->free_objects, object);
 }
 
 /**
@@ -247,26 +237,14 @@ gst_vaapi_video_pool_put_object (GstVaapiVideoPool * pool, gpointer object)
  *
  * Return value: %TRUE on success.
  */
-static inline gboolean
-gst_vaapi_video_pool_add_object_unlocked (GstVaapiVideoPool * pool,
-    gpointer object)
-{
-  g_queue_push_tail (&pool->free_objects, gst_vaapi_object_ref (object));
-  return TRUE;
-}
-
 gboolean
 gst_vaapi_video_pool_add_object (GstVaapiVideoPool * pool, gpointer object)
 {
-  gboolean success;
-
   g_return_val_if_fail (pool != NULL, FALSE);
   g_return_val_if_fail (object != NULL, FALSE);
 
-  g_mutex_lock (&pool->mutex);
-  success = gst_vaapi_video_pool_add_object_unlocked (pool, object);
-  g_mutex_unlock (&pool->mutex);
-  return success;
+  gst_atomic_queue_push (pool->free_objects, gst_vaapi_object_ref (object));
+  return TRUE;
 }
 
 /**
@@ -280,33 +258,21 @@ gst_vaapi_video_pool_add_object (GstVaapiVideoPool * pool, gpointer object)
  *
  * Return value: %TRUE on success.
  */
-static gboolean
-gst_vaapi_video_pool_add_objects_unlocked (GstVaapiVideoPool * pool,
-    GPtrArray * objects)
+gboolean
+gst_vaapi_video_pool_add_objects (GstVaapiVideoPool * pool, GPtrArray * objects)
 {
   guint i;
 
+  g_return_val_if_fail (pool != NULL, FALSE);
+
   for (i = 0; i < objects->len; i++) {
     gpointer const object = g_ptr_array_index (objects, i);
-    if (!gst_vaapi_video_pool_add_object_unlocked (pool, object))
+    if (!gst_vaapi_video_pool_add_object (pool, object))
       return FALSE;
   }
   return TRUE;
 }
 
-gboolean
-gst_vaapi_video_pool_add_objects (GstVaapiVideoPool * pool, GPtrArray * objects)
-{
-  gboolean success;
-
-  g_return_val_if_fail (pool != NULL, FALSE);
-
-  g_mutex_lock (&pool->mutex);
-  success = gst_vaapi_video_pool_add_objects_unlocked (pool, objects);
-  g_mutex_unlock (&pool->mutex);
-  return success;
-}
-
 /**
  * gst_vaapi_video_pool_get_size:
  * @pool: a #GstVaapiVideoPool
@@ -318,14 +284,9 @@ gst_vaapi_video_pool_add_objects (GstVaapiVideoPool * pool, GPtrArray * objects)
 guint
 gst_vaapi_video_pool_get_size (GstVaapiVideoPool * pool)
 {
-  guint size;
-
   g_return_val_if_fail (pool != NULL, 0);
 
-  g_mutex_lock (&pool->mutex);
-  size = g_queue_get_length (&pool->free_objects);
-  g_mutex_unlock (&pool->mutex);
-  return size;
+  return gst_atomic_queue_length (pool->free_objects);
 }
 
 static gboolean
@@ -333,20 +294,17 @@ gst_vaapi_video_pool_reserve_unlocked (GstVaapiVideoPool * pool, guint n)
 {
   guint i, num_allocated;
 
-  num_allocated = g_queue_get_length (&pool->free_objects) + pool->used_count;
+  num_allocated = gst_atomic_queue_length (pool->free_objects) +
+      g_atomic_int_get (&pool->used_count);
   if (n <= num_allocated)
     return TRUE;
 
-  n = MIN (n, pool->capacity);
+  n = MIN (n, (guint) g_atomic_int_get (&pool->capacity));
   for (i = num_allocated; i < n; i++) {
-    gpointer object;
-
-    g_mutex_unlock (&pool->mutex);
-    object = gst_vaapi_video_pool_alloc_object (pool);
-    g_mutex_lock (&pool->mutex);
+    gpointer const object = gst_vaapi_video_pool_alloc_object (pool);
     if (!object)
       return FALSE;
-    g_queue_push_tail (&pool->free_objects, object);
+    gst_atomic_queue_push (pool->free_objects, object);
   }
   return TRUE;
 }
@@ -388,15 +346,9 @@ gst_vaapi_video_pool_reserve (GstVaapiVideoPool * pool, guint n)
 guint
 gst_vaapi_video_pool_get_capacity (GstVaapiVideoPool * pool)
 {
-  guint capacity;
-
   g_return_val_if_fail (pool != NULL, 0);
 
-  g_mutex_lock (&pool->mutex);
-  capacity = pool->capacity;
-  g_mutex_unlock (&pool->mutex);
-
-  return capacity;
+  return g_atomic_int_get (&pool->capacity);
 }
 
 /**
@@ -411,7 +363,5 @@ gst_vaapi_video_pool_set_capacity (GstVaapiVideoPool * pool, guint capacity)
 {
   g_return_if_fail (pool != NULL);
 
-  g_mutex_lock (&pool->mutex);
-  pool->capacity = capacity;
-  g_mutex_unlock (&pool->mutex);
+  g_atomic_int_set (&pool->capacity, capacity);
 }
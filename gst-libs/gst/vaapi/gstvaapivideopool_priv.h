@@ -40,6 +40,12 @@ typedef struct _GstVaapiVideoPoolClass GstVaapiVideoPoolClass;
  * GstVaapiVideoPool:
  *
  * A pool of lazily allocated video objects. e.g. surfaces, images.
+ *
+ * Free objects are kept in a lock-free FIFO queue and the number of
+ * objects in use is an atomic counter, so that getting and putting
+ * back objects never contends on a lock. Objects in use record the
+ * pool they were checked out from, which makes it possible to reject
+ * foreign objects in O(1). The mutex only serializes reservations.
  */
 struct _GstVaapiVideoPool
 {
@@ -48,10 +54,9 @@ struct _GstVaapiVideoPool
 
   guint object_type;
   GstVaapiDisplay *display;
-  GQueue free_objects;
-  GList *used_objects;
-  guint used_count;
-  guint capacity;
+  GstAtomicQueue *free_objects;
+  volatile gint used_count;
+  volatile gint capacity;
   GMutex mutex;
 };
 
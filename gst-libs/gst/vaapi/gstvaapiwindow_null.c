@@ -0,0 +1,135 @@
+/*
+ *  gstvaapiwindow_null.c - VA/null dummy window abstraction
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:gstvaapiwindow_null
+ * @short_description: VA/null dummy window abstraction
+ */
+
+#include "sysdeps.h"
+#include "gstvaapiwindow_null.h"
+#include "gstvaapiwindow_priv.h"
+#include "gstvaapidisplay_null_priv.h"
+
+GST_DEBUG_CATEGORY_EXTERN (gst_debug_vaapi_window);
+#define GST_CAT_DEFAULT gst_debug_vaapi_window
+
+typedef struct _GstVaapiWindowNullClass GstVaapiWindowNullClass;
+
+/**
+ * GstVaapiWindowNull:
+ *
+ * A dummy null display window abstraction.
+ */
+struct _GstVaapiWindowNull
+{
+  /*< private > */
+  GstVaapiWindow parent_instance;
+};
+
+/**
+ * GstVaapiWindowNullClass:
+ *
+ * A dummy null display window abstraction class.
+ */
+struct _GstVaapiWindowNullClass
+{
+  /*< private > */
+  GstVaapiWindowClass parent_instance;
+};
+
+G_DEFINE_TYPE (GstVaapiWindowNull, gst_vaapi_window_null, GST_TYPE_VAAPI_WINDOW);
+
+static gboolean
+gst_vaapi_window_null_show (GstVaapiWindow * window)
+{
+  return TRUE;
+}
+
+static gboolean
+gst_vaapi_window_null_hide (GstVaapiWindow * window)
+{
+  return TRUE;
+}
+
+static gboolean
+gst_vaapi_window_null_create (GstVaapiWindow * window,
+    guint * width, guint * height)
+{
+  return TRUE;
+}
+
+static gboolean
+gst_vaapi_window_null_resize (GstVaapiWindow * window, guint width, guint height)
+{
+  return TRUE;
+}
+
+static gboolean
+gst_vaapi_window_null_render (GstVaapiWindow * window,
+    GstVaapiSurface * surface,
+    const GstVaapiRectangle * src_rect,
+    const GstVaapiRectangle * dst_rect, guint flags)
+{
+  return TRUE;
+}
+
+static void
+gst_vaapi_window_null_class_init (GstVaapiWindowNullClass * klass)
+{
+  GstVaapiWindowClass *const window_class = GST_VAAPI_WINDOW_CLASS (klass);
+
+  window_class->create = gst_vaapi_window_null_create;
+  window_class->show = gst_vaapi_window_null_show;
+  window_class->hide = gst_vaapi_window_null_hide;
+  window_class->resize = gst_vaapi_window_null_resize;
+  window_class->render = gst_vaapi_window_null_render;
+}
+
+static void
+gst_vaapi_window_null_init (GstVaapiWindowNull * window)
+{
+}
+
+/**
+ * gst_vaapi_window_null_new:
+ * @display: a #GstVaapiDisplay
+ * @width: the requested window width, in pixels (unused)
+ * @height: the requested window height, in pixels (unused)
+ *
+ * Creates a dummy window. The window will be attached to the @display.
+ * All rendering functions will return success since the null display has
+ * no output at all.
+ *
+ * Note: this dummy window object is only necessary to fulfill cases
+ * where the client application wants to automatically determine the
+ * best display to use for the current system. As such, it provides
+ * utility functions with the same API (function arguments) to help
+ * implement uniform function tables.
+ *
+ * Return value: the newly allocated #GstVaapiWindow object
+ */
+GstVaapiWindow *
+gst_vaapi_window_null_new (GstVaapiDisplay * display, guint width, guint height)
+{
+  g_return_val_if_fail (GST_VAAPI_IS_DISPLAY_NULL (display), NULL);
+
+  return gst_vaapi_window_new_internal (GST_TYPE_VAAPI_WINDOW_NULL, display,
+      GST_VAAPI_ID_INVALID, width, height);
+}
@@ -25,6 +25,7 @@
 #include "gstcompat.h"
 #include "gstvaapidecode.h"
 #include "gstvaapipostproc.h"
+#include "gstvaapicompositor.h"
 #include "gstvaapisink.h"
 #include "gstvaapidecodebin.h"
 
@@ -34,6 +35,7 @@
 #include "gstvaapiencode_jpeg.h"
 #include "gstvaapiencode_vp8.h"
 #include "gstvaapiencode_h265.h"
+#include "gstvaapiladderenc.h"
 
 #if USE_VP9_ENCODER
 #include "gstvaapiencode_vp9.h"
@@ -178,6 +180,15 @@ gst_vaapiencode_register (GstPlugin * plugin, GstVaapiDisplay * display)
     }
   }
 
+  /* The ladder encoder scales every rung with VPP */
+  for (i = 0; i < codecs->len && _gst_vaapi_has_video_processing; i++) {
+    if (g_array_index (codecs, GstVaapiCodec, i) == GST_VAAPI_CODEC_H264) {
+      gst_element_register (plugin, "vaapiladderenc",
+          GST_RANK_NONE, GST_TYPE_VAAPILADDERENC);
+      break;
+    }
+  }
+
 #if USE_H264_FEI_ENCODER
   if (gst_vaapi_display_has_encoder (display,
           GST_VAAPI_PROFILE_H264_MAIN, GST_VAAPI_ENTRYPOINT_SLICE_ENCODE_FEI)) {
@@ -217,6 +228,10 @@ plugin_init (GstPlugin * plugin)
   gst_element_register (plugin, "vaapipostproc",
       GST_RANK_PRIMARY, GST_TYPE_VAAPIPOSTPROC);
 
+  if (_gst_vaapi_has_video_processing)
+    gst_element_register (plugin, "vaapicompositor",
+        GST_RANK_NONE, GST_TYPE_VAAPICOMPOSITOR);
+
   gst_element_register (plugin, "vaapidecodebin",
       GST_RANK_PRIMARY + 2, GST_TYPE_VAAPI_DECODE_BIN);
 
@@ -0,0 +1,258 @@
+/*
+ *  gstvaapicodedmemory.c - Gstreamer/VA coded buffer memory
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "gstcompat.h"
+#include "gstvaapicodedmemory.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_vaapicodedmemory);
+#define GST_CAT_DEFAULT gst_debug_vaapicodedmemory
+
+static void
+_init_vaapi_coded_memory_debug (void)
+{
+#ifndef GST_DISABLE_GST_DEBUG
+  static volatile gsize _init = 0;
+
+  if (g_once_init_enter (&_init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_debug_vaapicodedmemory, "vaapicodedmemory", 0,
+        "VA-API coded buffer memory allocator");
+    g_once_init_leave (&_init, 1);
+  }
+#endif
+}
+
+/* ------------------------------------------------------------------------ */
+/* --- GstVaapiCodedMemory                                              --- */
+/* ------------------------------------------------------------------------ */
+
+static GstVaapiCodedMemory *
+coded_memory_new (GstAllocator * allocator, GstMemory * parent,
+    gsize maxsize, gsize offset, gsize size, guint8 * data)
+{
+  GstVaapiCodedMemory *mem;
+  GstMemoryFlags flags = 0;
+
+  if (parent)
+    flags = GST_MINI_OBJECT_FLAGS (parent) | GST_MINI_OBJECT_FLAG_LOCK_READONLY;
+
+  mem = g_slice_new (GstVaapiCodedMemory);
+  gst_memory_init (&mem->parent_instance, flags, gst_object_ref (allocator),
+      parent, maxsize, 0, offset, size);
+
+  mem->proxy = NULL;
+  mem->encoder = NULL;
+  mem->data = data;
+  return mem;
+}
+
+/**
+ * gst_vaapi_coded_memory_new:
+ * @allocator: a #GstVaapiCodedAllocator
+ * @encoder: the #GstVaapiEncoder that produced @proxy
+ * @proxy: a #GstVaapiCodedBufferProxy
+ *
+ * Wraps the coded data of @proxy into a new #GstMemory, without
+ * copying it. Both @proxy and @encoder are kept alive until the
+ * memory is released, so that the coded buffer can be returned to the
+ * @encoder pool at that time.
+ *
+ * Return value: the new #GstMemory, or %NULL if the coded data is not
+ *   held in a single segment
+ */
+GstMemory *
+gst_vaapi_coded_memory_new (GstAllocator * allocator,
+    GstVaapiEncoder * encoder, GstVaapiCodedBufferProxy * proxy)
+{
+  GstVaapiCodedAllocator *const coded_allocator =
+      GST_VAAPI_CODED_ALLOCATOR_CAST (allocator);
+  GstVaapiCodedMemory *mem;
+  guint8 *data;
+  gsize size;
+
+  g_return_val_if_fail (GST_VAAPI_IS_CODED_ALLOCATOR (allocator), NULL);
+  g_return_val_if_fail (encoder != NULL, NULL);
+  g_return_val_if_fail (proxy != NULL, NULL);
+
+  if (!gst_vaapi_coded_buffer_get_data (GST_VAAPI_CODED_BUFFER_PROXY_BUFFER
+          (proxy), &data, &size)) {
+    GST_DEBUG ("coded buffer cannot be wrapped, it needs to be copied");
+    return NULL;
+  }
+
+  mem = coded_memory_new (allocator, NULL, size, 0, size, data);
+  mem->proxy = gst_vaapi_coded_buffer_proxy_ref (proxy);
+  mem->encoder = gst_object_ref (encoder);
+  g_atomic_int_inc (&coded_allocator->num_outstanding);
+  return GST_MEMORY_CAST (mem);
+}
+
+static gpointer
+gst_vaapi_coded_memory_map (GstMemory * base_mem, gsize maxsize, guint flags)
+{
+  return GST_VAAPI_CODED_MEMORY_CAST (base_mem)->data;
+}
+
+static void
+gst_vaapi_coded_memory_unmap (GstMemory * base_mem)
+{
+}
+
+static GstMemory *
+gst_vaapi_coded_memory_copy (GstMemory * base_mem, gssize offset, gssize size)
+{
+  GstVaapiCodedMemory *const mem = GST_VAAPI_CODED_MEMORY_CAST (base_mem);
+  GstMemory *out_mem;
+  GstMapInfo info;
+
+  if (size == -1)
+    size = base_mem->size > (gsize) offset ? base_mem->size - offset : 0;
+
+  /* The copy lives in system memory, so that the coded buffer can be
+     returned to the encoder right away */
+  out_mem = gst_allocator_alloc (NULL, size, NULL);
+  if (!out_mem)
+    return NULL;
+  if (!gst_memory_map (out_mem, &info, GST_MAP_WRITE)) {
+    gst_memory_unref (out_mem);
+    return NULL;
+  }
+  memcpy (info.data, mem->data + base_mem->offset + offset, size);
+  gst_memory_unmap (out_mem, &info);
+  return out_mem;
+}
+
+static GstMemory *
+gst_vaapi_coded_memory_share (GstMemory * base_mem, gssize offset, gssize size)
+{
+  GstVaapiCodedMemory *const mem = GST_VAAPI_CODED_MEMORY_CAST (base_mem);
+  GstMemory *parent;
+
+  if (size == -1)
+    size = base_mem->size - offset;
+
+  /* Sub-memories keep the root memory, hence the coded buffer, alive */
+  parent = base_mem->parent ? base_mem->parent : base_mem;
+  return GST_MEMORY_CAST (coded_memory_new (base_mem->allocator, parent,
+          base_mem->maxsize, base_mem->offset + offset, size, mem->data));
+}
+
+static gboolean
+gst_vaapi_coded_memory_is_span (GstMemory * mem1, GstMemory * mem2,
+    gsize * offset_ptr)
+{
+  GstVaapiCodedMemory *const parent =
+      GST_VAAPI_CODED_MEMORY_CAST (mem1->parent);
+
+  if (GST_VAAPI_CODED_MEMORY_CAST (mem1)->data !=
+      GST_VAAPI_CODED_MEMORY_CAST (mem2)->data)
+    return FALSE;
+
+  if (offset_ptr)
+    *offset_ptr = mem1->offset - GST_MEMORY_CAST (parent)->offset;
+  return mem1->offset + mem1->size == mem2->offset;
+}
+
+/* ------------------------------------------------------------------------ */
+/* --- GstVaapiCodedAllocator                                           --- */
+/* ------------------------------------------------------------------------ */
+
+G_DEFINE_TYPE (GstVaapiCodedAllocator, gst_vaapi_coded_allocator,
+    GST_TYPE_ALLOCATOR);
+
+static GstMemory *
+gst_vaapi_coded_allocator_alloc (GstAllocator * allocator, gsize size,
+    GstAllocationParams * params)
+{
+  /* Coded memories only wrap existing coded buffers */
+  return NULL;
+}
+
+static void
+gst_vaapi_coded_allocator_free (GstAllocator * allocator, GstMemory * base_mem)
+{
+  GstVaapiCodedMemory *const mem = GST_VAAPI_CODED_MEMORY_CAST (base_mem);
+
+  if (mem->proxy) {
+    /* This unmaps the coded buffer and returns it to the encoder pool */
+    gst_vaapi_coded_buffer_proxy_replace (&mem->proxy, NULL);
+    gst_object_replace ((GstObject **) & mem->encoder, NULL);
+    g_atomic_int_add (&GST_VAAPI_CODED_ALLOCATOR_CAST (allocator)->
+        num_outstanding, -1);
+  }
+  gst_object_unref (GST_MEMORY_CAST (mem)->allocator);
+  g_slice_free (GstVaapiCodedMemory, mem);
+}
+
+static void
+gst_vaapi_coded_allocator_class_init (GstVaapiCodedAllocatorClass * klass)
+{
+  GstAllocatorClass *const allocator_class = GST_ALLOCATOR_CLASS (klass);
+
+  _init_vaapi_coded_memory_debug ();
+
+  allocator_class->alloc = gst_vaapi_coded_allocator_alloc;
+  allocator_class->free = gst_vaapi_coded_allocator_free;
+}
+
+static void
+gst_vaapi_coded_allocator_init (GstVaapiCodedAllocator * allocator)
+{
+  GstAllocator *const base_allocator = GST_ALLOCATOR_CAST (allocator);
+
+  base_allocator->mem_type = GST_VAAPI_CODED_MEMORY_NAME;
+  base_allocator->mem_map = gst_vaapi_coded_memory_map;
+  base_allocator->mem_unmap = gst_vaapi_coded_memory_unmap;
+  base_allocator->mem_copy = gst_vaapi_coded_memory_copy;
+  base_allocator->mem_share = gst_vaapi_coded_memory_share;
+  base_allocator->mem_is_span = gst_vaapi_coded_memory_is_span;
+
+  GST_OBJECT_FLAG_SET (allocator, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+}
+
+/**
+ * gst_vaapi_coded_allocator_new:
+ *
+ * Creates an allocator for #GstVaapiCodedMemory objects. It does not
+ * allocate anything itself, see gst_vaapi_coded_memory_new().
+ *
+ * Return value: a new #GstAllocator
+ */
+GstAllocator *
+gst_vaapi_coded_allocator_new (void)
+{
+  return g_object_new (GST_VAAPI_TYPE_CODED_ALLOCATOR, NULL);
+}
+
+/**
+ * gst_vaapi_coded_allocator_get_num_outstanding:
+ * @allocator: a #GstVaapiCodedAllocator
+ *
+ * Returns the number of coded buffers wrapped by @allocator and not
+ * released yet, i.e. the number of coded buffers held downstream.
+ *
+ * Return value: the number of outstanding coded memories
+ */
+guint
+gst_vaapi_coded_allocator_get_num_outstanding (GstAllocator * allocator)
+{
+  g_return_val_if_fail (GST_VAAPI_IS_CODED_ALLOCATOR (allocator), 0);
+
+  return g_atomic_int_get (&GST_VAAPI_CODED_ALLOCATOR_CAST (allocator)->
+      num_outstanding);
+}
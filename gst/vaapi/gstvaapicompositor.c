@@ -0,0 +1,691 @@
+/*
+ *  gstvaapicompositor.c - VA-API video compositor
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:element-vaapicompositor
+ * @short_description: A VA-API based video compositor
+ *
+ * vaapicompositor composes several video streams into a single output
+ * stream with the video processing pipeline. Each input is scaled into
+ * the rectangle defined by the xpos, ypos, width and height properties
+ * of its sink pad, and blended with its alpha over the inputs of lower
+ * zorder. Inputs and output stay in VA surfaces: no frame is
+ * downloaded to, or uploaded from, system memory. The area not covered
+ * by any input is black.
+ *
+ * Inputs in system memory need to be uploaded first, e.g. with
+ * vaapipostproc.
+ *
+ * ## Example launch line
+ *
+ * |[
+ * gst-launch-1.0 vaapicompositor name=comp \
+ *     sink_1::xpos=960 sink_1::ypos=540 sink_1::width=320 \
+ *     sink_1::height=180 sink_1::alpha=0.8 ! vaapisink \
+ *   filesrc location=main.mp4 ! qtdemux ! vaapih264dec ! comp.sink_0 \
+ *   filesrc location=pip.mp4 ! qtdemux ! vaapih264dec ! comp.sink_1
+ * ]|
+ */
+
+#include "gstcompat.h"
+#include "gstvaapicompositor.h"
+#include "gstvaapipluginutil.h"
+#include "gstvaapivideometa.h"
+#include "gstvaapivideobufferpool.h"
+
+#define GST_PLUGIN_NAME "vaapicompositor"
+#define GST_PLUGIN_DESC "A VA-API based video compositor"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_vaapicompositor);
+#ifndef GST_DISABLE_GST_DEBUG
+#define GST_CAT_DEFAULT gst_debug_vaapicompositor
+#else
+#define GST_CAT_DEFAULT NULL
+#endif
+
+#define DEFAULT_PAD_XPOS        0
+#define DEFAULT_PAD_YPOS        0
+#define DEFAULT_PAD_WIDTH       0
+#define DEFAULT_PAD_HEIGHT      0
+#define DEFAULT_PAD_ALPHA       1.0
+
+/* Size of the surface scaled over the output when no input is visible */
+#define BLACK_SURFACE_SIZE      64
+
+/* *INDENT-OFF* */
+static const char gst_vaapicompositor_caps_str[] =
+  GST_VAAPI_MAKE_SURFACE_CAPS ", "
+  GST_CAPS_INTERLACED_FALSE;
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+static GstStaticPadTemplate gst_vaapicompositor_sink_factory =
+  GST_STATIC_PAD_TEMPLATE ("sink_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (gst_vaapicompositor_caps_str));
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+static GstStaticPadTemplate gst_vaapicompositor_src_factory =
+  GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (gst_vaapicompositor_caps_str));
+/* *INDENT-ON* */
+
+/* ------------------------------------------------------------------------ */
+/* --- Sink pad                                                         --- */
+/* ------------------------------------------------------------------------ */
+
+G_DEFINE_TYPE (GstVaapiCompositorPad, gst_vaapicompositor_pad,
+    GST_TYPE_VIDEO_AGGREGATOR_PAD);
+
+enum
+{
+  PROP_PAD_0,
+
+  PROP_PAD_XPOS,
+  PROP_PAD_YPOS,
+  PROP_PAD_WIDTH,
+  PROP_PAD_HEIGHT,
+  PROP_PAD_ALPHA,
+};
+
+static void
+gst_vaapicompositor_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVaapiCompositorPad *const pad = GST_VAAPICOMPOSITOR_PAD (object);
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_XPOS:
+      pad->xpos = g_value_get_int (value);
+      break;
+    case PROP_PAD_YPOS:
+      pad->ypos = g_value_get_int (value);
+      break;
+    case PROP_PAD_WIDTH:
+      pad->width = g_value_get_int (value);
+      break;
+    case PROP_PAD_HEIGHT:
+      pad->height = g_value_get_int (value);
+      break;
+    case PROP_PAD_ALPHA:
+      pad->alpha = g_value_get_double (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (pad);
+}
+
+static void
+gst_vaapicompositor_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVaapiCompositorPad *const pad = GST_VAAPICOMPOSITOR_PAD (object);
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_XPOS:
+      g_value_set_int (value, pad->xpos);
+      break;
+    case PROP_PAD_YPOS:
+      g_value_set_int (value, pad->ypos);
+      break;
+    case PROP_PAD_WIDTH:
+      g_value_set_int (value, pad->width);
+      break;
+    case PROP_PAD_HEIGHT:
+      g_value_set_int (value, pad->height);
+      break;
+    case PROP_PAD_ALPHA:
+      g_value_set_double (value, pad->alpha);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (pad);
+}
+
+/* Computes the size of the pad in the output frame. The object lock
+ * shall be held */
+static void
+pad_get_output_size (GstVaapiCompositorPad * pad, gint * width_ptr,
+    gint * height_ptr)
+{
+  const GstVideoInfo *const vip = &GST_VIDEO_AGGREGATOR_PAD (pad)->info;
+
+  *width_ptr = pad->width > 0 ? pad->width : GST_VIDEO_INFO_WIDTH (vip);
+  *height_ptr = pad->height > 0 ? pad->height : GST_VIDEO_INFO_HEIGHT (vip);
+}
+
+static void
+gst_vaapicompositor_pad_class_init (GstVaapiCompositorPadClass * klass)
+{
+  GObjectClass *const object_class = G_OBJECT_CLASS (klass);
+  GstVideoAggregatorPadClass *const vagg_pad_class =
+      GST_VIDEO_AGGREGATOR_PAD_CLASS (klass);
+
+  object_class->set_property = gst_vaapicompositor_pad_set_property;
+  object_class->get_property = gst_vaapicompositor_pad_get_property;
+
+  /* The input frames are VA surfaces: never map them to system memory */
+  vagg_pad_class->prepare_frame = NULL;
+  vagg_pad_class->clean_frame = NULL;
+
+  g_object_class_install_property (object_class, PROP_PAD_XPOS,
+      g_param_spec_int ("xpos", "X Position",
+          "X coordinate of the picture in the output frame",
+          G_MININT, G_MAXINT, DEFAULT_PAD_XPOS,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_PAD_YPOS,
+      g_param_spec_int ("ypos", "Y Position",
+          "Y coordinate of the picture in the output frame",
+          G_MININT, G_MAXINT, DEFAULT_PAD_YPOS,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_PAD_WIDTH,
+      g_param_spec_int ("width", "Width",
+          "Width of the picture in the output frame (0: input width)",
+          0, G_MAXINT, DEFAULT_PAD_WIDTH,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_PAD_HEIGHT,
+      g_param_spec_int ("height", "Height",
+          "Height of the picture in the output frame (0: input height)",
+          0, G_MAXINT, DEFAULT_PAD_HEIGHT,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_PAD_ALPHA,
+      g_param_spec_double ("alpha", "Alpha",
+          "Alpha of the picture", 0.0, 1.0, DEFAULT_PAD_ALPHA,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+          G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_vaapicompositor_pad_init (GstVaapiCompositorPad * pad)
+{
+  pad->xpos = DEFAULT_PAD_XPOS;
+  pad->ypos = DEFAULT_PAD_YPOS;
+  pad->width = DEFAULT_PAD_WIDTH;
+  pad->height = DEFAULT_PAD_HEIGHT;
+  pad->alpha = DEFAULT_PAD_ALPHA;
+}
+
+/* ------------------------------------------------------------------------ */
+/* --- Compositor                                                       --- */
+/* ------------------------------------------------------------------------ */
+
+G_DEFINE_TYPE_WITH_CODE (GstVaapiCompositor, gst_vaapicompositor,
+    GST_TYPE_VIDEO_AGGREGATOR, GST_VAAPI_PLUGIN_BASE_INIT_INTERFACES);
+
+GST_VAAPI_PLUGIN_BASE_DEFINE_SET_CONTEXT (gst_vaapicompositor_parent_class);
+
+typedef struct
+{
+  GstVaapiRectangle crop_rect;
+  GstVaapiRectangle target_rect;
+} GstVaapiCompositorLayer;
+
+/* Clips @target_rect to the output frame, and shrinks @crop_rect in
+ * the same proportion. Returns FALSE if nothing remains visible */
+static gboolean
+clip_layer (GstVaapiCompositorLayer * layer, gint out_width, gint out_height)
+{
+  GstVaapiRectangle *const crop = &layer->crop_rect;
+  GstVaapiRectangle *const target = &layer->target_rect;
+  gint64 x0, y0, x1, y1;
+
+  if (crop->width == 0 || crop->height == 0 ||
+      target->width == 0 || target->height == 0)
+    return FALSE;
+
+  x0 = MAX (target->x, 0);
+  y0 = MAX (target->y, 0);
+  x1 = MIN ((gint64) target->x + target->width, out_width);
+  y1 = MIN ((gint64) target->y + target->height, out_height);
+  if (x1 <= x0 || y1 <= y0)
+    return FALSE;
+
+  crop->x += (x0 - target->x) * crop->width / target->width;
+  crop->y += (y0 - target->y) * crop->height / target->height;
+  crop->width = (x1 - x0) * crop->width / target->width;
+  crop->height = (y1 - y0) * crop->height / target->height;
+  if (crop->width == 0 || crop->height == 0)
+    return FALSE;
+
+  target->x = x0;
+  target->y = y0;
+  target->width = x1 - x0;
+  target->height = y1 - y0;
+  return TRUE;
+}
+
+/* Determines the visible region of the input surface */
+static void
+get_input_crop_rect (GstVideoAggregatorPad * vagg_pad, GstBuffer * buffer,
+    GstVaapiVideoMeta * meta, GstVaapiRectangle * crop_rect)
+{
+  const GstVaapiRectangle *render_rect;
+  GstVideoCropMeta *crop_meta;
+
+  render_rect = gst_vaapi_video_meta_get_render_rect (meta);
+  if (render_rect) {
+    *crop_rect = *render_rect;
+    return;
+  }
+
+  crop_meta = gst_buffer_get_video_crop_meta (buffer);
+  if (crop_meta) {
+    crop_rect->x = crop_meta->x;
+    crop_rect->y = crop_meta->y;
+    crop_rect->width = crop_meta->width;
+    crop_rect->height = crop_meta->height;
+    return;
+  }
+
+  crop_rect->x = 0;
+  crop_rect->y = 0;
+  crop_rect->width = GST_VIDEO_INFO_WIDTH (&vagg_pad->info);
+  crop_rect->height = GST_VIDEO_INFO_HEIGHT (&vagg_pad->info);
+}
+
+/* Returns a black NV12 surface, created on first use */
+static GstVaapiSurface *
+ensure_black_surface (GstVaapiCompositor * compositor)
+{
+  GstVaapiDisplay *const display = GST_VAAPI_PLUGIN_BASE_DISPLAY (compositor);
+  GstVaapiSurface *surface;
+  GstVaapiImage *image;
+  gboolean success;
+
+  if (compositor->black_surface)
+    return compositor->black_surface;
+
+  image = gst_vaapi_image_new (display, GST_VIDEO_FORMAT_NV12,
+      BLACK_SURFACE_SIZE, BLACK_SURFACE_SIZE);
+  if (!image)
+    return NULL;
+  if (!gst_vaapi_image_map (image)) {
+    gst_vaapi_object_unref (image);
+    return NULL;
+  }
+  memset (gst_vaapi_image_get_plane (image, 0), 16,
+      gst_vaapi_image_get_pitch (image, 0) * BLACK_SURFACE_SIZE);
+  memset (gst_vaapi_image_get_plane (image, 1), 128,
+      gst_vaapi_image_get_pitch (image, 1) * BLACK_SURFACE_SIZE / 2);
+  gst_vaapi_image_unmap (image);
+
+  surface = gst_vaapi_surface_new_with_format (display, GST_VIDEO_FORMAT_NV12,
+      BLACK_SURFACE_SIZE, BLACK_SURFACE_SIZE);
+  success = surface && gst_vaapi_surface_put_image (surface, image);
+  gst_vaapi_object_unref (image);
+  if (!success) {
+    if (surface)
+      gst_vaapi_object_unref (surface);
+    return NULL;
+  }
+  compositor->black_surface = surface;
+  return surface;
+}
+
+static GstFlowReturn
+gst_vaapicompositor_aggregate_frames (GstVideoAggregator * vagg,
+    GstBuffer * outbuf)
+{
+  GstVaapiCompositor *const compositor = GST_VAAPICOMPOSITOR (vagg);
+  GstVaapiCompositorLayer *layers;
+  GstVaapiFilterBlendSurface *surfaces;
+  GstVaapiVideoMeta *meta;
+  GstVaapiSurface *dst_surface;
+  GstVaapiFilterStatus status;
+  const gint out_width = GST_VIDEO_INFO_WIDTH (&vagg->info);
+  const gint out_height = GST_VIDEO_INFO_HEIGHT (&vagg->info);
+  guint n = 0;
+  GList *l;
+
+  meta = gst_buffer_get_vaapi_video_meta (outbuf);
+  if (!meta)
+    goto error_no_surface;
+  dst_surface = gst_vaapi_video_meta_get_surface (meta);
+  if (!dst_surface)
+    goto error_no_surface;
+
+  /* The sink pads are sorted by increasing zorder */
+  GST_OBJECT_LOCK (vagg);
+  layers = g_newa (GstVaapiCompositorLayer, GST_ELEMENT (vagg)->numsinkpads);
+  surfaces = g_newa (GstVaapiFilterBlendSurface,
+      MAX (GST_ELEMENT (vagg)->numsinkpads, 1));
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *const vagg_pad = l->data;
+    GstVaapiCompositorPad *const pad = GST_VAAPICOMPOSITOR_PAD (vagg_pad);
+    GstVaapiCompositorLayer *const layer = &layers[n];
+    GstBuffer *const inbuf =
+        gst_video_aggregator_pad_get_current_buffer (vagg_pad);
+    GstVaapiSurface *surface;
+    gint width, height;
+    gdouble alpha;
+
+    if (!inbuf)
+      continue;
+
+    meta = gst_buffer_get_vaapi_video_meta (inbuf);
+    surface = meta ? gst_vaapi_video_meta_get_surface (meta) : NULL;
+    if (!surface) {
+      GST_WARNING_OBJECT (pad, "input buffer is not a VA surface");
+      continue;
+    }
+    get_input_crop_rect (vagg_pad, inbuf, meta, &layer->crop_rect);
+
+    GST_OBJECT_LOCK (pad);
+    pad_get_output_size (pad, &width, &height);
+    layer->target_rect.x = pad->xpos;
+    layer->target_rect.y = pad->ypos;
+    layer->target_rect.width = width;
+    layer->target_rect.height = height;
+    alpha = pad->alpha;
+    GST_OBJECT_UNLOCK (pad);
+
+    if (alpha <= 0.0 || !clip_layer (layer, out_width, out_height))
+      continue;
+
+    surfaces[n].surface = surface;
+    surfaces[n].crop_rect = &layer->crop_rect;
+    surfaces[n].target_rect = &layer->target_rect;
+    surfaces[n].alpha = alpha;
+    n++;
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  /* Clear the output to black, the VPP background colour, by scaling
+     a black surface over it */
+  if (n == 0) {
+    GST_LOG_OBJECT (compositor, "no visible input");
+    surfaces[0].surface = ensure_black_surface (compositor);
+    if (!surfaces[0].surface)
+      goto error_no_black_surface;
+    surfaces[0].crop_rect = NULL;
+    surfaces[0].target_rect = NULL;
+    surfaces[0].alpha = 1.0;
+    GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_GAP);
+    n = 1;
+  }
+
+  status = gst_vaapi_filter_process_blend (compositor->filter, dst_surface,
+      surfaces, n);
+  if (status != GST_VAAPI_FILTER_STATUS_SUCCESS)
+    goto error_process_vpp;
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+error_no_surface:
+  {
+    GST_ERROR_OBJECT (compositor, "output buffer is not a VA surface");
+    return GST_FLOW_ERROR;
+  }
+error_no_black_surface:
+  {
+    GST_ERROR_OBJECT (compositor, "failed to create black surface");
+    return GST_FLOW_ERROR;
+  }
+error_process_vpp:
+  {
+    GST_ELEMENT_ERROR (compositor, STREAM, FAILED,
+        ("Failed to compose the input surfaces."),
+        ("VPP blend failed (status %d)", status));
+    return GST_FLOW_ERROR;
+  }
+}
+
+/* The output frame is as large as needed to show every input */
+static GstCaps *
+gst_vaapicompositor_fixate_src_caps (GstAggregator * agg, GstCaps * caps)
+{
+  GstVideoAggregator *const vagg = GST_VIDEO_AGGREGATOR (agg);
+  GstStructure *structure;
+  gint best_width = 0, best_height = 0;
+  gint best_fps_n = 0, best_fps_d = 1;
+  gdouble best_fps = 0.0;
+  GList *l;
+
+  GST_OBJECT_LOCK (vagg);
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *const vagg_pad = l->data;
+    GstVaapiCompositorPad *const pad = GST_VAAPICOMPOSITOR_PAD (vagg_pad);
+    const GstVideoInfo *const vip = &vagg_pad->info;
+    gint width, height, fps_n, fps_d;
+    gdouble fps;
+
+    if (GST_VIDEO_INFO_FORMAT (vip) == GST_VIDEO_FORMAT_UNKNOWN)
+      continue;
+
+    GST_OBJECT_LOCK (pad);
+    pad_get_output_size (pad, &width, &height);
+    best_width = MAX (best_width, width + MAX (pad->xpos, 0));
+    best_height = MAX (best_height, height + MAX (pad->ypos, 0));
+    GST_OBJECT_UNLOCK (pad);
+
+    fps_n = GST_VIDEO_INFO_FPS_N (vip);
+    fps_d = GST_VIDEO_INFO_FPS_D (vip);
+    if (fps_n > 0 && fps_d > 0) {
+      gst_util_fraction_to_double (fps_n, fps_d, &fps);
+      if (fps > best_fps) {
+        best_fps = fps;
+        best_fps_n = fps_n;
+        best_fps_d = fps_d;
+      }
+    }
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (best_fps_n <= 0) {
+    best_fps_n = 25;
+    best_fps_d = 1;
+  }
+
+  caps = gst_caps_make_writable (caps);
+  structure = gst_caps_get_structure (caps, 0);
+  if (best_width > 0 && best_height > 0) {
+    gst_structure_fixate_field_nearest_int (structure, "width", best_width);
+    gst_structure_fixate_field_nearest_int (structure, "height", best_height);
+  }
+  gst_structure_fixate_field_nearest_fraction (structure, "framerate",
+      best_fps_n, best_fps_d);
+  return gst_caps_fixate (caps);
+}
+
+static gboolean
+gst_vaapicompositor_negotiated_src_caps (GstAggregator * agg, GstCaps * caps)
+{
+  GstVaapiCompositor *const compositor = GST_VAAPICOMPOSITOR (agg);
+  GstVaapiPluginBase *const plugin = GST_VAAPI_PLUGIN_BASE (compositor);
+
+  if (!gst_vaapi_plugin_base_set_caps (plugin, NULL, caps))
+    return FALSE;
+  if (!gst_vaapi_filter_set_format (compositor->filter,
+          GST_VIDEO_INFO_FORMAT (GST_VAAPI_PLUGIN_BASE_SRC_PAD_INFO (plugin))))
+    goto error_unsupported_format;
+
+  return GST_AGGREGATOR_CLASS (gst_vaapicompositor_parent_class)->
+      negotiated_src_caps (agg, caps);
+
+  /* ERRORS */
+error_unsupported_format:
+  {
+    GST_ERROR_OBJECT (compositor, "unsupported output caps %" GST_PTR_FORMAT,
+        caps);
+    return FALSE;
+  }
+}
+
+static gboolean
+gst_vaapicompositor_decide_allocation (GstAggregator * agg, GstQuery * query)
+{
+  return gst_vaapi_plugin_base_decide_allocation (GST_VAAPI_PLUGIN_BASE (agg),
+      query);
+}
+
+static gboolean
+gst_vaapicompositor_propose_allocation (GstAggregator * agg,
+    GstAggregatorPad * pad, GstQuery * decide_query, GstQuery * query)
+{
+  gst_query_add_allocation_meta (query, GST_VAAPI_VIDEO_META_API_TYPE, NULL);
+  return TRUE;
+}
+
+static gboolean
+gst_vaapicompositor_sink_query (GstAggregator * agg, GstAggregatorPad * pad,
+    GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_CONTEXT &&
+      gst_vaapi_handle_context_query (GST_ELEMENT_CAST (agg), query))
+    return TRUE;
+
+  return GST_AGGREGATOR_CLASS (gst_vaapicompositor_parent_class)->sink_query
+      (agg, pad, query);
+}
+
+static gboolean
+gst_vaapicompositor_src_query (GstAggregator * agg, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_CONTEXT &&
+      gst_vaapi_handle_context_query (GST_ELEMENT_CAST (agg), query))
+    return TRUE;
+
+  return GST_AGGREGATOR_CLASS (gst_vaapicompositor_parent_class)->src_query
+      (agg, query);
+}
+
+static gboolean
+gst_vaapicompositor_start (GstAggregator * agg)
+{
+  GstVaapiCompositor *const compositor = GST_VAAPICOMPOSITOR (agg);
+  GstVaapiPluginBase *const plugin = GST_VAAPI_PLUGIN_BASE (compositor);
+
+  if (!gst_vaapi_plugin_base_open (plugin))
+    return FALSE;
+  if (!gst_vaapi_plugin_base_ensure_display (plugin))
+    goto error_no_display;
+
+  compositor->filter =
+      gst_vaapi_filter_new (GST_VAAPI_PLUGIN_BASE_DISPLAY (compositor));
+  if (!compositor->filter)
+    goto error_no_filter;
+  return TRUE;
+
+  /* ERRORS */
+error_no_display:
+  {
+    GST_ELEMENT_ERROR (compositor, RESOURCE, NOT_FOUND,
+        ("Failed to create VA display."), (NULL));
+    gst_vaapi_plugin_base_close (plugin);
+    return FALSE;
+  }
+error_no_filter:
+  {
+    GST_ELEMENT_ERROR (compositor, RESOURCE, NOT_FOUND,
+        ("Failed to create VPP filter."), (NULL));
+    gst_vaapi_plugin_base_close (plugin);
+    return FALSE;
+  }
+}
+
+static gboolean
+gst_vaapicompositor_stop (GstAggregator * agg)
+{
+  GstVaapiCompositor *const compositor = GST_VAAPICOMPOSITOR (agg);
+
+  gst_vaapi_object_replace (&compositor->black_surface, NULL);
+  gst_vaapi_filter_replace (&compositor->filter, NULL);
+  gst_vaapi_plugin_base_close (GST_VAAPI_PLUGIN_BASE (compositor));
+  return TRUE;
+}
+
+static void
+gst_vaapicompositor_finalize (GObject * object)
+{
+  GstVaapiCompositor *const compositor = GST_VAAPICOMPOSITOR (object);
+
+  gst_vaapi_object_replace (&compositor->black_surface, NULL);
+  gst_vaapi_filter_replace (&compositor->filter, NULL);
+  gst_vaapi_plugin_base_finalize (GST_VAAPI_PLUGIN_BASE (compositor));
+  G_OBJECT_CLASS (gst_vaapicompositor_parent_class)->finalize (object);
+}
+
+static void
+gst_vaapicompositor_class_init (GstVaapiCompositorClass * klass)
+{
+  GObjectClass *const object_class = G_OBJECT_CLASS (klass);
+  GstElementClass *const element_class = GST_ELEMENT_CLASS (klass);
+  GstAggregatorClass *const agg_class = GST_AGGREGATOR_CLASS (klass);
+  GstVideoAggregatorClass *const vagg_class =
+      GST_VIDEO_AGGREGATOR_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_debug_vaapicompositor,
+      GST_PLUGIN_NAME, 0, GST_PLUGIN_DESC);
+
+  gst_vaapi_plugin_base_class_init (GST_VAAPI_PLUGIN_BASE_CLASS (klass));
+
+  object_class->finalize = gst_vaapicompositor_finalize;
+
+  agg_class->start = GST_DEBUG_FUNCPTR (gst_vaapicompositor_start);
+  agg_class->stop = GST_DEBUG_FUNCPTR (gst_vaapicompositor_stop);
+  agg_class->sink_query = GST_DEBUG_FUNCPTR (gst_vaapicompositor_sink_query);
+  agg_class->src_query = GST_DEBUG_FUNCPTR (gst_vaapicompositor_src_query);
+  agg_class->fixate_src_caps =
+      GST_DEBUG_FUNCPTR (gst_vaapicompositor_fixate_src_caps);
+  agg_class->negotiated_src_caps =
+      GST_DEBUG_FUNCPTR (gst_vaapicompositor_negotiated_src_caps);
+  agg_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_vaapicompositor_decide_allocation);
+  agg_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_vaapicompositor_propose_allocation);
+
+  vagg_class->aggregate_frames =
+      GST_DEBUG_FUNCPTR (gst_vaapicompositor_aggregate_frames);
+
+  element_class->set_context = gst_vaapi_base_set_context;
+  gst_element_class_set_static_metadata (element_class,
+      "VA-API video compositor",
+      "Filter/Editor/Video/Compositor/Hardware",
+      GST_PLUGIN_DESC, "The gstreamer-vaapi developers");
+
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &gst_vaapicompositor_sink_factory, GST_TYPE_VAAPICOMPOSITOR_PAD);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &gst_vaapicompositor_src_factory, GST_TYPE_AGGREGATOR_PAD);
+}
+
+static void
+gst_vaapicompositor_init (GstVaapiCompositor * compositor)
+{
+  gst_vaapi_plugin_base_init (GST_VAAPI_PLUGIN_BASE (compositor),
+      GST_CAT_DEFAULT);
+}
@@ -0,0 +1,96 @@
+/*
+ *  gstvaapicompositor.h - VA-API video compositor
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPICOMPOSITOR_H
+#define GST_VAAPICOMPOSITOR_H
+
+#include "gstvaapipluginbase.h"
+#include <gst/vaapi/gstvaapifilter.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VAAPICOMPOSITOR \
+  (gst_vaapicompositor_get_type ())
+#define GST_VAAPICOMPOSITOR(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_VAAPICOMPOSITOR, \
+       GstVaapiCompositor))
+#define GST_VAAPICOMPOSITOR_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), GST_TYPE_VAAPICOMPOSITOR, \
+       GstVaapiCompositorClass))
+#define GST_IS_VAAPICOMPOSITOR(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_VAAPICOMPOSITOR))
+#define GST_IS_VAAPICOMPOSITOR_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), GST_TYPE_VAAPICOMPOSITOR))
+
+#define GST_TYPE_VAAPICOMPOSITOR_PAD \
+  (gst_vaapicompositor_pad_get_type ())
+#define GST_VAAPICOMPOSITOR_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_VAAPICOMPOSITOR_PAD, \
+       GstVaapiCompositorPad))
+#define GST_IS_VAAPICOMPOSITOR_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_VAAPICOMPOSITOR_PAD))
+
+typedef struct _GstVaapiCompositor GstVaapiCompositor;
+typedef struct _GstVaapiCompositorClass GstVaapiCompositorClass;
+typedef struct _GstVaapiCompositorPad GstVaapiCompositorPad;
+typedef struct _GstVaapiCompositorPadClass GstVaapiCompositorPadClass;
+
+struct _GstVaapiCompositorPad
+{
+  /*< private >*/
+  GstVideoAggregatorPad parent_instance;
+
+  /* properties, protected by the object lock */
+  gint xpos;
+  gint ypos;
+  gint width;
+  gint height;
+  gdouble alpha;
+};
+
+struct _GstVaapiCompositorPadClass
+{
+  /*< private >*/
+  GstVideoAggregatorPadClass parent_class;
+};
+
+struct _GstVaapiCompositor
+{
+  /*< private >*/
+  GstVaapiPluginBase parent_instance;
+
+  GstVaapiFilter *filter;
+  GstVaapiSurface *black_surface;
+};
+
+struct _GstVaapiCompositorClass
+{
+  /*< private >*/
+  GstVaapiPluginBaseClass parent_class;
+};
+
+GType
+gst_vaapicompositor_get_type (void) G_GNUC_CONST;
+
+GType
+gst_vaapicompositor_pad_get_type (void) G_GNUC_CONST;
+
+G_END_DECLS
+
+#endif /* GST_VAAPICOMPOSITOR_H */
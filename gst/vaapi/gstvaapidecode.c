@@ -117,11 +117,49 @@ static const GstVaapiDecoderMap vaapi_decode_map[] = {
       "video/x-wmv, wmvversion=3, format={WMV3,WVC1}", NULL},
   {GST_VAAPI_CODEC_VP8, GST_RANK_PRIMARY, "vp8", "video/x-vp8", NULL},
   {GST_VAAPI_CODEC_VP9, GST_RANK_PRIMARY, "vp9", "video/x-vp9", NULL},
-  {GST_VAAPI_CODEC_H265, GST_RANK_PRIMARY, "h265", "video/x-h265", NULL},
+  {GST_VAAPI_CODEC_H265, GST_RANK_PRIMARY, "h265", "video/x-h265",
+      gst_vaapi_decode_h265_install_properties},
   {0 /* the rest */ , GST_RANK_PRIMARY + 1, NULL,
       gst_vaapidecode_sink_caps_str, NULL},
 };
 
+/* Codec specific properties, see gstvaapidecode_props.c, use the
+   lower ids */
+enum
+{
+  PROP_STATS = 0x100,
+  PROP_COPY_THREADS,
+  PROP_QOS_SKIP,
+  PROP_DECODE_MODE,
+  PROP_KEYFRAME_INTERVAL,
+};
+
+#define DEFAULT_DECODE_MODE             GST_VAAPI_DECODE_MODE_ALL
+#define DEFAULT_KEYFRAME_INTERVAL       1
+
+#define GST_VAAPI_TYPE_DECODE_MODE \
+    gst_vaapi_decode_mode_get_type()
+
+static GType
+gst_vaapi_decode_mode_get_type (void)
+{
+  static GType decode_mode_type = 0;
+
+  static const GEnumValue mode_types[] = {
+    {GST_VAAPI_DECODE_MODE_ALL,
+        "Decode all frames", "all"},
+    {GST_VAAPI_DECODE_MODE_KEYFRAMES,
+        "Decode keyframes only", "keyframes"},
+    {0, NULL, NULL},
+  };
+
+  if (!decode_mode_type) {
+    decode_mode_type =
+        g_enum_register_static ("GstVaapiDecodeMode", mode_types);
+  }
+  return decode_mode_type;
+}
+
 static GstElementClass *parent_class = NULL;
 GST_VAAPI_PLUGIN_BASE_DEFINE_SET_CONTEXT (parent_class);
 
@@ -596,9 +634,7 @@ gst_vaapidecode_push_decoded_frame (GstVideoDecoder * vdec,
       GstBuffer *sys_buf, *va_buf;
 
       va_buf = out_frame->output_buffer;
-      sys_buf = gst_buffer_new_allocate (plugin->other_srcpad_allocator,
-          GST_VIDEO_INFO_SIZE (&plugin->srcpad_info),
-          &plugin->other_allocator_params);
+      sys_buf = gst_vaapi_plugin_base_alloc_system_buffer (plugin);
       if (!sys_buf)
         goto error_no_sys_buffer;
 
@@ -700,6 +736,28 @@ gst_vaapidecode_push_all_decoded_frames (GstVaapiDecode * decode)
   g_assert_not_reached ();
 }
 
+/* Only decodes keyframes when asked to, or in reverse playback where
+   the other frames would be dropped once decoded */
+static void
+gst_vaapidecode_update_keyframe_interval (GstVaapiDecode * decode)
+{
+  guint interval = 0;
+
+  if (g_atomic_int_get (&decode->decode_mode) ==
+      GST_VAAPI_DECODE_MODE_KEYFRAMES)
+    interval = g_atomic_int_get (&decode->keyframe_interval);
+  else if (decode->in_segment.rate < 0.0
+      && !GST_VAAPI_PLUGIN_BASE_COPY_OUTPUT_FRAME (decode))
+    interval = 1;
+
+  if (interval == decode->active_keyframe_interval)
+    return;
+  GST_INFO_OBJECT (decode, "decoding %s", interval > 0 ? "keyframes only" :
+      "all frames");
+  gst_vaapi_decoder_set_keyframe_interval (decode->decoder, interval);
+  decode->active_keyframe_interval = interval;
+}
+
 static GstFlowReturn
 gst_vaapidecode_handle_frame (GstVideoDecoder * vdec,
     GstVideoCodecFrame * frame)
@@ -710,6 +768,17 @@ gst_vaapidecode_handle_frame (GstVideoDecoder * vdec,
   if (!decode->input_state)
     goto not_negotiated;
 
+  gst_vaapidecode_update_keyframe_interval (decode);
+
+  /* Skip late frames that no other frame depends on */
+  if (g_atomic_int_get (&decode->qos_skip)
+      && gst_video_decoder_get_max_decode_time (vdec, frame) < 0
+      && gst_vaapi_decoder_skip (decode->decoder, frame)) {
+    GST_DEBUG_OBJECT (decode, "skipped late non-reference frame %u",
+        frame->system_frame_number);
+    return gst_video_decoder_drop_frame (vdec, frame);
+  }
+
   /* Decode current frame */
   for (;;) {
     status = gst_vaapi_decoder_decode (decode->decoder, frame);
@@ -861,10 +930,28 @@ gst_vaapi_codec_from_caps (GstCaps * caps)
   return gst_vaapi_profile_get_codec (gst_vaapi_profile_from_caps (caps));
 }
 
+/* Takes ownership of @decoder. The pointer is swapped under the object
+   lock so that the "stats" getter never sees a released decoder */
+static void
+gst_vaapidecode_replace_decoder (GstVaapiDecode * decode,
+    GstVaapiDecoder * decoder)
+{
+  GstVaapiDecoder *old_decoder;
+
+  GST_OBJECT_LOCK (decode);
+  old_decoder = decode->decoder;
+  decode->decoder = decoder;
+  GST_OBJECT_UNLOCK (decode);
+
+  if (old_decoder)
+    gst_object_unref (old_decoder);
+}
+
 static gboolean
 gst_vaapidecode_create (GstVaapiDecode * decode, GstCaps * caps)
 {
   GstVaapiDisplay *dpy;
+  GstVaapiDecoder *decoder;
 
   if (!gst_vaapidecode_ensure_display (decode))
     return FALSE;
@@ -872,17 +959,17 @@ gst_vaapidecode_create (GstVaapiDecode * decode, GstCaps * caps)
 
   switch (gst_vaapi_codec_from_caps (caps)) {
     case GST_VAAPI_CODEC_MPEG2:
-      decode->decoder = gst_vaapi_decoder_mpeg2_new (dpy, caps);
+      decoder = gst_vaapi_decoder_mpeg2_new (dpy, caps);
       break;
     case GST_VAAPI_CODEC_MPEG4:
     case GST_VAAPI_CODEC_H263:
-      decode->decoder = gst_vaapi_decoder_mpeg4_new (dpy, caps);
+      decoder = gst_vaapi_decoder_mpeg4_new (dpy, caps);
       break;
     case GST_VAAPI_CODEC_H264:
-      decode->decoder = gst_vaapi_decoder_h264_new (dpy, caps);
+      decoder = gst_vaapi_decoder_h264_new (dpy, caps);
 
       /* Set the stream buffer alignment for better optimizations */
-      if (decode->decoder && caps) {
+      if (decoder && caps) {
         GstVaapiDecodeH264Private *priv =
             gst_vaapi_decode_h264_get_instance_private (decode);
         GstStructure *const structure = gst_caps_get_structure (caps, 0);
@@ -900,22 +987,26 @@ gst_vaapidecode_create (GstVaapiDecode * decode, GstCaps * caps)
           else
             alignment = GST_VAAPI_STREAM_ALIGN_H264_NONE;
           gst_vaapi_decoder_h264_set_alignment (GST_VAAPI_DECODER_H264
-              (decode->decoder), alignment);
+              (decoder), alignment);
         }
 
         if (priv) {
           gst_vaapi_decoder_h264_set_low_latency (GST_VAAPI_DECODER_H264
-              (decode->decoder), priv->is_low_latency);
+              (decoder), priv->is_low_latency);
           gst_vaapi_decoder_h264_set_base_only (GST_VAAPI_DECODER_H264
-              (decode->decoder), priv->base_only);
+              (decoder), priv->base_only);
+          gst_vaapi_decoder_set_subframe_decode (decoder,
+              priv->subframe_decode);
         }
       }
       break;
     case GST_VAAPI_CODEC_H265:
-      decode->decoder = gst_vaapi_decoder_h265_new (dpy, caps);
+      decoder = gst_vaapi_decoder_h265_new (dpy, caps);
 
       /* Set the stream buffer alignment for better optimizations */
-      if (decode->decoder && caps) {
+      if (decoder && caps) {
+        GstVaapiDecodeH265Private *priv =
+            gst_vaapi_decode_h265_get_instance_private (decode);
         GstStructure *const structure = gst_caps_get_structure (caps, 0);
         const gchar *str = NULL;
 
@@ -931,32 +1022,41 @@ gst_vaapidecode_create (GstVaapiDecode * decode, GstCaps * caps)
           else
             alignment = GST_VAAPI_STREAM_ALIGN_H265_NONE;
           gst_vaapi_decoder_h265_set_alignment (GST_VAAPI_DECODER_H265
-              (decode->decoder), alignment);
+              (decoder), alignment);
+        }
+
+        if (priv) {
+          gst_vaapi_decoder_h265_set_low_latency (GST_VAAPI_DECODER_H265
+              (decoder), priv->is_low_latency);
+          gst_vaapi_decoder_set_subframe_decode (decoder,
+              priv->subframe_decode);
         }
       }
       break;
     case GST_VAAPI_CODEC_WMV3:
     case GST_VAAPI_CODEC_VC1:
-      decode->decoder = gst_vaapi_decoder_vc1_new (dpy, caps);
+      decoder = gst_vaapi_decoder_vc1_new (dpy, caps);
       break;
     case GST_VAAPI_CODEC_JPEG:
-      decode->decoder = gst_vaapi_decoder_jpeg_new (dpy, caps);
+      decoder = gst_vaapi_decoder_jpeg_new (dpy, caps);
       break;
     case GST_VAAPI_CODEC_VP8:
-      decode->decoder = gst_vaapi_decoder_vp8_new (dpy, caps);
+      decoder = gst_vaapi_decoder_vp8_new (dpy, caps);
       break;
     case GST_VAAPI_CODEC_VP9:
-      decode->decoder = gst_vaapi_decoder_vp9_new (dpy, caps);
+      decoder = gst_vaapi_decoder_vp9_new (dpy, caps);
       break;
     default:
-      decode->decoder = NULL;
+      decoder = NULL;
       break;
   }
-  if (!decode->decoder)
+  if (!decoder)
     return FALSE;
 
-  gst_vaapi_decoder_set_codec_state_changed_func (decode->decoder,
+  gst_vaapi_decoder_set_codec_state_changed_func (decoder,
       gst_vaapi_decoder_state_changed, decode);
+  gst_vaapidecode_replace_decoder (decode, decoder);
+  decode->active_keyframe_interval = 0;
 
   return TRUE;
 }
@@ -993,7 +1093,7 @@ gst_vaapidecode_destroy (GstVaapiDecode * decode)
 {
   gst_vaapidecode_purge (decode);
 
-  gst_vaapi_decoder_replace (&decode->decoder, NULL);
+  gst_vaapidecode_replace_decoder (decode, NULL);
 
   gst_vaapidecode_release (gst_object_ref (decode));
 }
@@ -1032,6 +1132,82 @@ gst_vaapidecode_finalize (GObject * object)
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_vaapidecode_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVaapiDecodeClass *const klass = GST_VAAPIDECODE_GET_CLASS (object);
+
+  switch (prop_id) {
+    case PROP_COPY_THREADS:
+      g_atomic_int_set (&GST_VAAPI_PLUGIN_BASE (object)->copy_threads,
+          g_value_get_uint (value));
+      break;
+    case PROP_QOS_SKIP:
+      g_atomic_int_set (&GST_VAAPIDECODE (object)->qos_skip,
+          g_value_get_boolean (value));
+      break;
+    case PROP_DECODE_MODE:
+      g_atomic_int_set (&GST_VAAPIDECODE (object)->decode_mode,
+          g_value_get_enum (value));
+      break;
+    case PROP_KEYFRAME_INTERVAL:
+      g_atomic_int_set (&GST_VAAPIDECODE (object)->keyframe_interval,
+          g_value_get_uint (value));
+      break;
+    default:
+      if (klass->codec_set_property)
+        klass->codec_set_property (object, prop_id, value, pspec);
+      else
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vaapidecode_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVaapiDecode *const decode = GST_VAAPIDECODE (object);
+  GstVaapiDecodeClass *const klass = GST_VAAPIDECODE_GET_CLASS (object);
+
+  switch (prop_id) {
+    case PROP_STATS:{
+      GstVaapiDecoder *decoder = NULL;
+
+      GST_OBJECT_LOCK (decode);
+      if (decode->decoder)
+        decoder = gst_object_ref (decode->decoder);
+      GST_OBJECT_UNLOCK (decode);
+
+      g_value_take_boxed (value, decoder ?
+          gst_vaapi_decoder_get_stats (decoder) : NULL);
+      if (decoder)
+        gst_object_unref (decoder);
+      break;
+    }
+    case PROP_COPY_THREADS:
+      g_value_set_uint (value,
+          g_atomic_int_get (&GST_VAAPI_PLUGIN_BASE (decode)->copy_threads));
+      break;
+    case PROP_QOS_SKIP:
+      g_value_set_boolean (value, g_atomic_int_get (&decode->qos_skip));
+      break;
+    case PROP_DECODE_MODE:
+      g_value_set_enum (value, g_atomic_int_get (&decode->decode_mode));
+      break;
+    case PROP_KEYFRAME_INTERVAL:
+      g_value_set_uint (value, g_atomic_int_get (&decode->keyframe_interval));
+      break;
+    default:
+      if (klass->codec_get_property)
+        klass->codec_get_property (object, prop_id, value, pspec);
+      else
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static gboolean
 gst_vaapidecode_open (GstVideoDecoder * vdec)
 {
@@ -1090,7 +1266,7 @@ gst_vaapidecode_stop (GstVideoDecoder * vdec)
 
   gst_vaapidecode_purge (decode);
   gst_vaapi_decode_input_state_replace (decode, NULL);
-  gst_vaapi_decoder_replace (&decode->decoder, NULL);
+  gst_vaapidecode_replace_decoder (decode, NULL);
   gst_caps_replace (&decode->sinkpad_caps, NULL);
   gst_caps_replace (&decode->srcpad_caps, NULL);
   return TRUE;
@@ -1513,8 +1689,79 @@ gst_vaapidecode_class_init (GstVaapiDecodeClass * klass)
   g_free (longname);
   g_free (description);
 
-  if (map->install_properties)
+  if (map->install_properties) {
     map->install_properties (object_class);
+    klass->codec_get_property = object_class->get_property;
+    klass->codec_set_property = object_class->set_property;
+  }
+  object_class->get_property = gst_vaapidecode_get_property;
+  object_class->set_property = gst_vaapidecode_set_property;
+
+  /**
+   * GstVaapiDecode:stats:
+   *
+   * Decoder statistics: per-frame parse and decode times, VA picture
+   * submission times, DPB occupancy, and queue depths, as rolling
+   * percentiles. See gst_vaapi_decoder_get_stats() for the fields.
+   */
+  g_object_class_install_property (object_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Decoder timings and queue depths", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVaapiDecode:copy-threads:
+   *
+   * Number of threads copying the decoded frames into system memory
+   * when downstream doesn't support GstVideoMeta. 0 uses one thread
+   * per processor.
+   */
+  g_object_class_install_property (object_class, PROP_COPY_THREADS,
+      g_param_spec_uint ("copy-threads", "Copy threads",
+          "Threads copying frames to system memory (0 = auto)",
+          0, G_MAXINT, 1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVaapiDecode:qos-skip:
+   *
+   * When the frames reach the decoder past their QoS deadline, skip
+   * the decoding of those that are not used for reference (H.264,
+   * H.265 and MPEG-2 only) instead of dropping them once decoded.
+   * The skipped frames are counted in the "frames-skipped" field of
+   * the #GstVaapiDecode:stats property.
+   */
+  g_object_class_install_property (object_class, PROP_QOS_SKIP,
+      g_param_spec_boolean ("qos-skip", "QoS skip",
+          "Skip decoding late non-reference frames", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVaapiDecode:decode-mode:
+   *
+   * Which frames to decode. In keyframes mode, only the pictures that
+   * don't depend on other ones are decoded (H.264, H.265, MPEG-2, VP8
+   * and VP9 only), one out of every #GstVaapiDecode:keyframe-interval,
+   * e.g. for thumbnails or trick modes. The other frames are dropped
+   * before any VA submission and counted in the "frames-skipped" field
+   * of the #GstVaapiDecode:stats property. Keyframes are also decoded
+   * only in reverse playback, where the other frames are not output.
+   */
+  g_object_class_install_property (object_class, PROP_DECODE_MODE,
+      g_param_spec_enum ("decode-mode", "Decode mode",
+          "Which frames to decode", GST_VAAPI_TYPE_DECODE_MODE,
+          DEFAULT_DECODE_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVaapiDecode:keyframe-interval:
+   *
+   * In keyframes #GstVaapiDecode:decode-mode, decode the first keyframe
+   * out of every keyframe-interval ones.
+   */
+  g_object_class_install_property (object_class, PROP_KEYFRAME_INTERVAL,
+      g_param_spec_uint ("keyframe-interval", "Keyframe interval",
+          "Decode one keyframe out of this many in keyframes mode",
+          1, G_MAXINT, DEFAULT_KEYFRAME_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   /* sink pad */
   caps = gst_caps_from_string (map->caps_str);
@@ -1538,6 +1785,9 @@ gst_vaapidecode_init (GstVaapiDecode * decode)
   g_mutex_init (&decode->surface_ready_mutex);
   g_cond_init (&decode->surface_ready);
 
+  decode->decode_mode = DEFAULT_DECODE_MODE;
+  decode->keyframe_interval = DEFAULT_KEYFRAME_INTERVAL;
+
   gst_video_decoder_set_packetized (vdec, FALSE);
 }
 
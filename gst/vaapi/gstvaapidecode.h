@@ -31,10 +31,23 @@
 G_BEGIN_DECLS
 
 #define GST_VAAPIDECODE(obj) ((GstVaapiDecode *)(obj))
+#define GST_VAAPIDECODE_GET_CLASS(obj) \
+    ((GstVaapiDecodeClass *) G_OBJECT_GET_CLASS (obj))
 
 typedef struct _GstVaapiDecode                  GstVaapiDecode;
 typedef struct _GstVaapiDecodeClass             GstVaapiDecodeClass;
 
+/**
+ * GstVaapiDecodeMode:
+ * @GST_VAAPI_DECODE_MODE_ALL: Decode all the frames.
+ * @GST_VAAPI_DECODE_MODE_KEYFRAMES: Only decode keyframes.
+ */
+typedef enum
+{
+  GST_VAAPI_DECODE_MODE_ALL = 0,
+  GST_VAAPI_DECODE_MODE_KEYFRAMES,
+} GstVaapiDecodeMode;
+
 struct _GstVaapiDecode {
     /*< private >*/
     GstVaapiPluginBase  parent_instance;
@@ -57,11 +70,23 @@ struct _GstVaapiDecode {
     GstSegment          in_segment;
 
     gboolean            do_renego;
+
+    /* skip the decoding of late non-reference frames */
+    gboolean            qos_skip;
+
+    /* decode the first keyframe out of every keyframe_interval ones */
+    GstVaapiDecodeMode  decode_mode;
+    guint               keyframe_interval;
+    guint               active_keyframe_interval;
 };
 
 struct _GstVaapiDecodeClass {
     /*< private >*/
     GstVaapiPluginBaseClass parent_class;
+
+    /* accessors of the codec specific properties, if any */
+    GObjectGetPropertyFunc codec_get_property;
+    GObjectSetPropertyFunc codec_set_property;
 };
 
 gboolean gst_vaapidecode_register (GstPlugin * plugin, GArray * decoders);
@@ -25,14 +25,23 @@
 #include "gstvaapidecode.h"
 
 #include <gst/vaapi/gstvaapidecoder_h264.h>
+#include <gst/vaapi/gstvaapidecoder_h265.h>
 
 enum
 {
   GST_VAAPI_DECODER_H264_PROP_FORCE_LOW_LATENCY = 1,
-  GST_VAAPI_DECODER_H264_PROP_BASE_ONLY
+  GST_VAAPI_DECODER_H264_PROP_BASE_ONLY,
+  GST_VAAPI_DECODER_H264_PROP_SUBFRAME_DECODE
+};
+
+enum
+{
+  GST_VAAPI_DECODER_H265_PROP_FORCE_LOW_LATENCY = 1,
+  GST_VAAPI_DECODER_H265_PROP_SUBFRAME_DECODE
 };
 
 static gint h264_private_offset;
+static gint h265_private_offset;
 
 static void
 gst_vaapi_decode_h264_get_property (GObject * object, guint prop_id,
@@ -49,6 +58,9 @@ gst_vaapi_decode_h264_get_property (GObject * object, guint prop_id,
     case GST_VAAPI_DECODER_H264_PROP_BASE_ONLY:
       g_value_set_boolean (value, priv->base_only);
       break;
+    case GST_VAAPI_DECODER_H264_PROP_SUBFRAME_DECODE:
+      g_value_set_boolean (value, priv->subframe_decode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -77,6 +89,13 @@ gst_vaapi_decode_h264_set_property (GObject * object, guint prop_id,
       if (decoder)
         gst_vaapi_decoder_h264_set_base_only (decoder, priv->base_only);
       break;
+    case GST_VAAPI_DECODER_H264_PROP_SUBFRAME_DECODE:
+      priv->subframe_decode = g_value_get_boolean (value);
+      decoder = GST_VAAPI_DECODER_H264 (GST_VAAPIDECODE (object)->decoder);
+      if (decoder)
+        gst_vaapi_decoder_set_subframe_decode (GST_VAAPI_DECODER (decoder),
+            priv->subframe_decode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -103,6 +122,14 @@ gst_vaapi_decode_h264_install_properties (GObjectClass * klass)
       g_param_spec_boolean ("base-only", "Decode base view only",
           "Drop any NAL unit not defined in Annex.A", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (klass,
+      GST_VAAPI_DECODER_H264_PROP_SUBFRAME_DECODE,
+      g_param_spec_boolean ("subframe-decode", "Sub-frame decoding",
+          "Submit slices to the hardware as they are received instead of "
+          "waiting for the whole frame. Ignored in keyframes decode-mode",
+          FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 GstVaapiDecodeH264Private *
@@ -112,3 +139,86 @@ gst_vaapi_decode_h264_get_instance_private (gpointer self)
     return NULL;
   return (G_STRUCT_MEMBER_P (self, h264_private_offset));
 }
+
+static void
+gst_vaapi_decode_h265_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVaapiDecodeH265Private *priv;
+
+  priv = gst_vaapi_decode_h265_get_instance_private (object);
+
+  switch (prop_id) {
+    case GST_VAAPI_DECODER_H265_PROP_FORCE_LOW_LATENCY:
+      g_value_set_boolean (value, priv->is_low_latency);
+      break;
+    case GST_VAAPI_DECODER_H265_PROP_SUBFRAME_DECODE:
+      g_value_set_boolean (value, priv->subframe_decode);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vaapi_decode_h265_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVaapiDecodeH265Private *priv;
+  GstVaapiDecoderH265 *decoder;
+
+  priv = gst_vaapi_decode_h265_get_instance_private (object);
+
+  switch (prop_id) {
+    case GST_VAAPI_DECODER_H265_PROP_FORCE_LOW_LATENCY:
+      priv->is_low_latency = g_value_get_boolean (value);
+      decoder = GST_VAAPI_DECODER_H265 (GST_VAAPIDECODE (object)->decoder);
+      if (decoder)
+        gst_vaapi_decoder_h265_set_low_latency (decoder, priv->is_low_latency);
+      break;
+    case GST_VAAPI_DECODER_H265_PROP_SUBFRAME_DECODE:
+      priv->subframe_decode = g_value_get_boolean (value);
+      decoder = GST_VAAPI_DECODER_H265 (GST_VAAPIDECODE (object)->decoder);
+      if (decoder)
+        gst_vaapi_decoder_set_subframe_decode (GST_VAAPI_DECODER (decoder),
+            priv->subframe_decode);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+void
+gst_vaapi_decode_h265_install_properties (GObjectClass * klass)
+{
+  h265_private_offset = sizeof (GstVaapiDecodeH265Private);
+  g_type_class_adjust_private_offset (klass, &h265_private_offset);
+
+  klass->get_property = gst_vaapi_decode_h265_get_property;
+  klass->set_property = gst_vaapi_decode_h265_set_property;
+
+  g_object_class_install_property (klass,
+      GST_VAAPI_DECODER_H265_PROP_FORCE_LOW_LATENCY,
+      g_param_spec_boolean ("low-latency", "Force low latency mode",
+          "When enabled, frames will be pushed as soon as the POC order "
+          "allows. It might violate the H.265 spec.", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT));
+
+  g_object_class_install_property (klass,
+      GST_VAAPI_DECODER_H265_PROP_SUBFRAME_DECODE,
+      g_param_spec_boolean ("subframe-decode", "Sub-frame decoding",
+          "Submit slices to the hardware as they are received instead of "
+          "waiting for the whole frame. Ignored in keyframes decode-mode",
+          FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+GstVaapiDecodeH265Private *
+gst_vaapi_decode_h265_get_instance_private (gpointer self)
+{
+  if (h265_private_offset == 0)
+    return NULL;
+  return (G_STRUCT_MEMBER_P (self, h265_private_offset));
+}
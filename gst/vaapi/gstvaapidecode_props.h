@@ -29,11 +29,19 @@
 G_BEGIN_DECLS
 
 typedef struct _GstVaapiDecodeH264Private GstVaapiDecodeH264Private;
+typedef struct _GstVaapiDecodeH265Private GstVaapiDecodeH265Private;
 
 struct _GstVaapiDecodeH264Private
 {
   gboolean is_low_latency;
   gboolean base_only;
+  gboolean subframe_decode;
+};
+
+struct _GstVaapiDecodeH265Private
+{
+  gboolean is_low_latency;
+  gboolean subframe_decode;
 };
 
 void
@@ -42,6 +50,12 @@ gst_vaapi_decode_h264_install_properties (GObjectClass * klass);
 GstVaapiDecodeH264Private *
 gst_vaapi_decode_h264_get_instance_private (gpointer self);
 
+void
+gst_vaapi_decode_h265_install_properties (GObjectClass * klass);
+
+GstVaapiDecodeH265Private *
+gst_vaapi_decode_h265_get_instance_private (gpointer self);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_DECODE_PROPS_H */
@@ -0,0 +1,317 @@
+/*
+ *  gstvaapidmabufcache.c - Cache of VA surfaces imported from dma-bufs
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Upstream elements commonly recycle the same set of dma-bufs while
+ * wrapping them into fresh GstMemory objects (or passing them over a
+ * socket, which yields a new file descriptor each time). The memory
+ * qdata is then lost and every frame would be imported again through
+ * vaCreateSurfaces(). This cache identifies a dma-buf by the device
+ * and inode of its file, which are stable across dup()s and process
+ * boundaries, together with the plane layout it was imported with.
+ *
+ * An imported surface keeps the dma-buf alive, so its inode cannot be
+ * recycled for another buffer while the cache entry exists.
+ */
+
+#include "gstcompat.h"
+#include <string.h>
+#include <sys/stat.h>
+#include "gstvaapidmabufcache.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_vaapi_dmabuf_cache);
+#define GST_CAT_DEFAULT gst_debug_vaapi_dmabuf_cache
+
+typedef struct _DmaBufKey DmaBufKey;
+typedef struct _DmaBufEntry DmaBufEntry;
+
+struct _DmaBufKey
+{
+  guint64 dev;
+  guint64 ino;
+  GstVideoFormat format;
+  guint width;
+  guint height;
+  guint n_planes;
+  guint64 offset[GST_VIDEO_MAX_PLANES];
+  gint stride[GST_VIDEO_MAX_PLANES];
+};
+
+struct _DmaBufEntry
+{
+  DmaBufKey key;
+  GstVaapiSurface *surface;
+  GList link;
+};
+
+struct _GstVaapiDmaBufCache
+{
+  guint capacity;
+  GHashTable *entries;
+  /* most recently used entry first */
+  GQueue lru;
+
+  guint64 hits;
+  guint64 misses;
+  guint64 evictions;
+};
+
+static void
+_init_dmabuf_cache_debug (void)
+{
+#ifndef GST_DISABLE_GST_DEBUG
+  static volatile gsize _init = 0;
+
+  if (g_once_init_enter (&_init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_debug_vaapi_dmabuf_cache, "vaapidmabufcache",
+        0, "VA-API dma-buf import cache");
+    g_once_init_leave (&_init, 1);
+  }
+#endif
+}
+
+static guint
+dmabuf_key_hash (gconstpointer data)
+{
+  const guint8 *p = data;
+  guint32 h = 2166136261u;
+  gsize i;
+
+  /* FNV-1a over the whole key, padding is always zeroed */
+  for (i = 0; i < sizeof (DmaBufKey); i++) {
+    h ^= p[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static gboolean
+dmabuf_key_equal (gconstpointer a, gconstpointer b)
+{
+  return memcmp (a, b, sizeof (DmaBufKey)) == 0;
+}
+
+static gboolean
+dmabuf_key_init (DmaBufKey * key, gint fd, const GstVideoInfo * vip)
+{
+  struct stat st;
+  guint i;
+
+  if (fstat (fd, &st) < 0)
+    return FALSE;
+
+  memset (key, 0, sizeof (*key));
+  key->dev = st.st_dev;
+  key->ino = st.st_ino;
+  key->format = GST_VIDEO_INFO_FORMAT (vip);
+  key->width = GST_VIDEO_INFO_WIDTH (vip);
+  key->height = GST_VIDEO_INFO_HEIGHT (vip);
+  key->n_planes = GST_VIDEO_INFO_N_PLANES (vip);
+  for (i = 0; i < key->n_planes; i++) {
+    key->offset[i] = GST_VIDEO_INFO_PLANE_OFFSET (vip, i);
+    key->stride[i] = GST_VIDEO_INFO_PLANE_STRIDE (vip, i);
+  }
+  return TRUE;
+}
+
+static void
+dmabuf_entry_free (DmaBufEntry * entry)
+{
+  gst_vaapi_object_unref (entry->surface);
+  g_slice_free (DmaBufEntry, entry);
+}
+
+static void
+dmabuf_cache_remove (GstVaapiDmaBufCache * cache, DmaBufEntry * entry)
+{
+  g_queue_unlink (&cache->lru, &entry->link);
+  /* frees the entry */
+  g_hash_table_remove (cache->entries, &entry->key);
+}
+
+/**
+ * gst_vaapi_dmabuf_cache_new:
+ * @capacity: the maximum number of imported surfaces to keep
+ *
+ * Creates a new cache of VA surfaces imported from dma-buf handles.
+ * Once @capacity surfaces are held, the least recently used one is
+ * released to make room for a new import.
+ *
+ * The cache is not thread-safe; it is meant to be used from the
+ * sink pad streaming thread only.
+ *
+ * Returns: a new #GstVaapiDmaBufCache
+ */
+GstVaapiDmaBufCache *
+gst_vaapi_dmabuf_cache_new (guint capacity)
+{
+  GstVaapiDmaBufCache *cache;
+
+  g_return_val_if_fail (capacity > 0, NULL);
+
+  _init_dmabuf_cache_debug ();
+
+  cache = g_slice_new0 (GstVaapiDmaBufCache);
+  cache->capacity = capacity;
+  cache->entries = g_hash_table_new_full (dmabuf_key_hash, dmabuf_key_equal,
+      NULL, (GDestroyNotify) dmabuf_entry_free);
+  g_queue_init (&cache->lru);
+  return cache;
+}
+
+/**
+ * gst_vaapi_dmabuf_cache_free:
+ * @cache: a #GstVaapiDmaBufCache
+ *
+ * Releases all the cached surfaces and frees @cache.
+ */
+void
+gst_vaapi_dmabuf_cache_free (GstVaapiDmaBufCache * cache)
+{
+  if (!cache)
+    return;
+
+  gst_vaapi_dmabuf_cache_clear (cache);
+  g_hash_table_unref (cache->entries);
+  g_slice_free (GstVaapiDmaBufCache, cache);
+}
+
+/**
+ * gst_vaapi_dmabuf_cache_lookup:
+ * @cache: a #GstVaapiDmaBufCache
+ * @fd: a dma-buf file descriptor
+ * @vip: the #GstVideoInfo describing the layout of @fd
+ *
+ * Looks up a surface previously imported from the same dma-buf with
+ * the same layout. @fd does not need to be the descriptor that was
+ * used for the import.
+ *
+ * Returns: (transfer full): a new reference to the cached surface, or
+ *   %NULL if there is none
+ */
+GstVaapiSurface *
+gst_vaapi_dmabuf_cache_lookup (GstVaapiDmaBufCache * cache, gint fd,
+    const GstVideoInfo * vip)
+{
+  DmaBufEntry *entry;
+  DmaBufKey key;
+
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (vip != NULL, NULL);
+
+  if (!dmabuf_key_init (&key, fd, vip)) {
+    cache->misses++;
+    return NULL;
+  }
+
+  entry = g_hash_table_lookup (cache->entries, &key);
+  if (!entry) {
+    cache->misses++;
+    GST_LOG ("miss for dma-buf %" G_GUINT64_FORMAT ":%" G_GUINT64_FORMAT,
+        key.dev, key.ino);
+    return NULL;
+  }
+
+  cache->hits++;
+  g_queue_unlink (&cache->lru, &entry->link);
+  g_queue_push_head_link (&cache->lru, &entry->link);
+  return gst_vaapi_object_ref (entry->surface);
+}
+
+/**
+ * gst_vaapi_dmabuf_cache_insert:
+ * @cache: a #GstVaapiDmaBufCache
+ * @fd: the dma-buf file descriptor @surface was imported from
+ * @vip: the #GstVideoInfo used for the import
+ * @surface: the imported #GstVaapiSurface
+ *
+ * Adds @surface to @cache, evicting the least recently used entry if
+ * @cache is full. The cache holds its own reference to @surface.
+ */
+void
+gst_vaapi_dmabuf_cache_insert (GstVaapiDmaBufCache * cache, gint fd,
+    const GstVideoInfo * vip, GstVaapiSurface * surface)
+{
+  DmaBufEntry *entry;
+  DmaBufKey key;
+
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (vip != NULL);
+  g_return_if_fail (surface != NULL);
+
+  if (!dmabuf_key_init (&key, fd, vip))
+    return;
+
+  entry = g_hash_table_lookup (cache->entries, &key);
+  if (entry) {
+    dmabuf_cache_remove (cache, entry);
+  } else if (g_hash_table_size (cache->entries) >= cache->capacity) {
+    GList *const tail = g_queue_peek_tail_link (&cache->lru);
+
+    dmabuf_cache_remove (cache, tail->data);
+    cache->evictions++;
+  }
+
+  entry = g_slice_new0 (DmaBufEntry);
+  entry->key = key;
+  entry->surface = gst_vaapi_object_ref (surface);
+  entry->link.data = entry;
+  g_hash_table_insert (cache->entries, &entry->key, entry);
+  g_queue_push_head_link (&cache->lru, &entry->link);
+}
+
+/**
+ * gst_vaapi_dmabuf_cache_clear:
+ * @cache: a #GstVaapiDmaBufCache
+ *
+ * Releases all the cached surfaces, e.g. because upstream is going to
+ * allocate a new set of dma-bufs. Statistics are preserved.
+ */
+void
+gst_vaapi_dmabuf_cache_clear (GstVaapiDmaBufCache * cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_queue_init (&cache->lru);
+  g_hash_table_remove_all (cache->entries);
+}
+
+/**
+ * gst_vaapi_dmabuf_cache_get_stats:
+ * @cache: a #GstVaapiDmaBufCache
+ * @hits: (out) (allow-none): number of lookups served from the cache
+ * @misses: (out) (allow-none): number of lookups that required an import
+ * @evictions: (out) (allow-none): number of surfaces released because
+ *   the cache was full
+ *
+ * Retrieves the usage statistics of @cache.
+ */
+void
+gst_vaapi_dmabuf_cache_get_stats (GstVaapiDmaBufCache * cache,
+    guint64 * hits, guint64 * misses, guint64 * evictions)
+{
+  g_return_if_fail (cache != NULL);
+
+  if (hits)
+    *hits = cache->hits;
+  if (misses)
+    *misses = cache->misses;
+  if (evictions)
+    *evictions = cache->evictions;
+}
@@ -0,0 +1,59 @@
+/*
+ *  gstvaapidmabufcache.h - Cache of VA surfaces imported from dma-bufs
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPI_DMABUF_CACHE_H
+#define GST_VAAPI_DMABUF_CACHE_H
+
+#include <gst/video/video.h>
+#include <gst/vaapi/gstvaapisurface.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVaapiDmaBufCache GstVaapiDmaBufCache;
+
+G_GNUC_INTERNAL
+GstVaapiDmaBufCache *
+gst_vaapi_dmabuf_cache_new (guint capacity);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_dmabuf_cache_free (GstVaapiDmaBufCache * cache);
+
+G_GNUC_INTERNAL
+GstVaapiSurface *
+gst_vaapi_dmabuf_cache_lookup (GstVaapiDmaBufCache * cache, gint fd,
+    const GstVideoInfo * vip);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_dmabuf_cache_insert (GstVaapiDmaBufCache * cache, gint fd,
+    const GstVideoInfo * vip, GstVaapiSurface * surface);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_dmabuf_cache_clear (GstVaapiDmaBufCache * cache);
+
+G_GNUC_INTERNAL
+void
+gst_vaapi_dmabuf_cache_get_stats (GstVaapiDmaBufCache * cache,
+    guint64 * hits, guint64 * misses, guint64 * evictions);
+
+G_END_DECLS
+
+#endif /* GST_VAAPI_DMABUF_CACHE_H */
@@ -30,6 +30,7 @@
 #include "gstvaapivideometa.h"
 #include "gstvaapivideomemory.h"
 #include "gstvaapivideobufferpool.h"
+#include "gstvaapicodedmemory.h"
 
 #define GST_PLUGIN_NAME "vaapiencode"
 #define GST_PLUGIN_DESC "A VA-API based video encoder"
@@ -38,6 +39,9 @@
 #define GST_VAAPI_ENCODE_FLOW_MEM_ERROR         GST_FLOW_CUSTOM_ERROR
 #define GST_VAAPI_ENCODE_FLOW_CONVERT_ERROR     GST_FLOW_CUSTOM_ERROR_1
 
+/* Maximum number of coded buffers held downstream in zero-copy mode */
+#define GST_VAAPI_ENCODE_MAX_OUTPUT_HOLD        32
+
 GST_DEBUG_CATEGORY_STATIC (gst_vaapiencode_debug);
 #ifndef GST_DISABLE_GST_DEBUG
 #define GST_CAT_DEFAULT gst_vaapiencode_debug
@@ -55,6 +59,8 @@ enum
 {
   PROP_0,
 
+  PROP_STATS,
+  PROP_ZERO_COPY,
   PROP_BASE,
 };
 
@@ -165,16 +171,66 @@ prop_value_lookup_entry (GPtrArray * prop_values, guint prop_id)
   return NULL;
 }
 
+/* Wraps the coded buffer into a GstBuffer, without copying it. The
+   coded buffer pool is enlarged by the number of coded buffers held
+   downstream, i.e. the output rate times the downstream hold time, so
+   that the encoder does not starve. Past the limit, this returns NULL
+   and the coded buffer is copied */
+static GstBuffer *
+gst_vaapiencode_wrap_buffer (GstVaapiEncode * encode,
+    GstVaapiCodedBufferProxy * proxy)
+{
+  GstMemory *mem;
+  GstBuffer *buf;
+  guint num_held;
+
+  if (!encode->coded_allocator)
+    encode->coded_allocator = gst_vaapi_coded_allocator_new ();
+
+  num_held =
+      gst_vaapi_coded_allocator_get_num_outstanding (encode->coded_allocator)
+      + 1;
+  if (num_held > encode->output_hold) {
+    if (num_held > GST_VAAPI_ENCODE_MAX_OUTPUT_HOLD) {
+      GST_DEBUG_OBJECT (encode, "downstream holds too many coded buffers, "
+          "copying");
+      return NULL;
+    }
+    GST_DEBUG_OBJECT (encode, "downstream holds %u coded buffers", num_held);
+    encode->output_hold = num_held;
+    gst_vaapi_encoder_set_output_hold (encode->encoder, num_held);
+  }
+
+  mem = gst_vaapi_coded_memory_new (encode->coded_allocator, encode->encoder,
+      proxy);
+  if (!mem)
+    return NULL;
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf, mem);
+  return buf;
+}
+
 static GstFlowReturn
 gst_vaapiencode_default_alloc_buffer (GstVaapiEncode * encode,
-    GstVaapiCodedBuffer * coded_buf, GstBuffer ** outbuf_ptr)
+    GstVaapiCodedBufferProxy * proxy, GstBuffer ** outbuf_ptr)
 {
+  GstVaapiCodedBuffer *coded_buf;
   GstBuffer *buf;
   gint32 buf_size;
 
-  g_return_val_if_fail (coded_buf != NULL, GST_FLOW_ERROR);
+  g_return_val_if_fail (proxy != NULL, GST_FLOW_ERROR);
   g_return_val_if_fail (outbuf_ptr != NULL, GST_FLOW_ERROR);
 
+  if (encode->zero_copy) {
+    buf = gst_vaapiencode_wrap_buffer (encode, proxy);
+    if (buf) {
+      *outbuf_ptr = buf;
+      return GST_FLOW_OK;
+    }
+  }
+
+  coded_buf = GST_VAAPI_CODED_BUFFER_PROXY_BUFFER (proxy);
   buf_size = gst_vaapi_coded_buffer_get_size (coded_buf);
   if (buf_size <= 0)
     goto error_invalid_buffer;
@@ -244,7 +300,7 @@ ensure_output_state (GstVaapiEncode * encode)
 }
 
 static GstFlowReturn
-gst_vaapiencode_push_frame (GstVaapiEncode * encode, gint64 timeout)
+gst_vaapiencode_push_frame (GstVaapiEncode * encode, guint64 timeout)
 {
   GstVideoEncoder *const venc = GST_VIDEO_ENCODER_CAST (encode);
   GstVaapiEncodeClass *const klass = GST_VAAPIENCODE_GET_CLASS (encode);
@@ -270,16 +326,18 @@ gst_vaapiencode_push_frame (GstVaapiEncode * encode, gint64 timeout)
   gst_video_codec_frame_ref (out_frame);
   gst_video_codec_frame_set_user_data (out_frame, NULL, NULL);
 
+  /* The output buffer may keep the coded buffer alive, but not the frame */
+  gst_vaapi_coded_buffer_proxy_set_user_data (codedbuf_proxy, NULL, NULL);
+
   /* Update output state */
   GST_VIDEO_ENCODER_STREAM_LOCK (encode);
   if (!ensure_output_state (encode))
     goto error_output_state;
   GST_VIDEO_ENCODER_STREAM_UNLOCK (encode);
 
-  /* Allocate and copy buffer into system memory */
+  /* Allocate and copy buffer into system memory, or wrap it */
   out_buffer = NULL;
-  ret = klass->alloc_buffer (encode,
-      GST_VAAPI_CODED_BUFFER_PROXY_BUFFER (codedbuf_proxy), &out_buffer);
+  ret = klass->alloc_buffer (encode, codedbuf_proxy, &out_buffer);
 
 #if USE_H264_FEI_ENCODER
   if (klass->save_stats_to_meta) {
@@ -330,9 +388,10 @@ static void
 gst_vaapiencode_buffer_loop (GstVaapiEncode * encode)
 {
   GstFlowReturn ret;
-  const gint64 timeout = 50000; /* microseconds */
 
-  ret = gst_vaapiencode_push_frame (encode, timeout);
+  /* Block until the next coded buffer is completed, or until the
+     encoder is set flushing by gst_vaapiencode_stop_task() */
+  ret = gst_vaapiencode_push_frame (encode, G_MAXUINT64);
   if (ret == GST_FLOW_OK || ret == GST_VAAPI_ENCODE_FLOW_TIMEOUT)
     return;
 
@@ -340,6 +399,23 @@ gst_vaapiencode_buffer_loop (GstVaapiEncode * encode)
   gst_pad_pause_task (GST_VAAPI_PLUGIN_BASE_SRC_PAD (encode));
 }
 
+/* Pauses or stops the srcpad task, waking it up if it is waiting for
+   a coded buffer */
+static void
+gst_vaapiencode_stop_task (GstVaapiEncode * encode, gboolean pause)
+{
+  GstPad *const srcpad = GST_VAAPI_PLUGIN_BASE_SRC_PAD (encode);
+
+  if (encode->encoder)
+    gst_vaapi_encoder_set_flushing (encode->encoder, TRUE);
+  if (pause)
+    gst_pad_pause_task (srcpad);
+  else
+    gst_pad_stop_task (srcpad);
+  if (encode->encoder)
+    gst_vaapi_encoder_set_flushing (encode->encoder, FALSE);
+}
+
 static GstVaapiProfile
 get_profile (GstVaapiEncode * encode)
 {
@@ -469,6 +545,23 @@ gst_vaapiencode_get_caps (GstVideoEncoder * venc, GstCaps * filter)
   return result;
 }
 
+/* Takes ownership of @encoder. The pointer is swapped under the object
+   lock so that the "stats" getter never sees a released encoder */
+static void
+gst_vaapiencode_replace_encoder (GstVaapiEncode * encode,
+    GstVaapiEncoder * encoder)
+{
+  GstVaapiEncoder *old_encoder;
+
+  GST_OBJECT_LOCK (encode);
+  old_encoder = encode->encoder;
+  encode->encoder = encoder;
+  GST_OBJECT_UNLOCK (encode);
+
+  if (old_encoder)
+    gst_object_unref (old_encoder);
+}
+
 static gboolean
 gst_vaapiencode_destroy (GstVaapiEncode * encode)
 {
@@ -483,7 +576,7 @@ gst_vaapiencode_destroy (GstVaapiEncode * encode)
   }
 
   gst_caps_replace (&encode->allowed_sinkpad_caps, NULL);
-  gst_vaapi_encoder_replace (&encode->encoder, NULL);
+  gst_vaapiencode_replace_encoder (encode, NULL);
   return TRUE;
 }
 
@@ -518,10 +611,11 @@ ensure_encoder (GstVaapiEncode * encode)
   if (encode->encoder)
     return FALSE;
 
-  encode->encoder = klass->alloc_encoder (encode,
-      GST_VAAPI_PLUGIN_BASE_DISPLAY (encode));
+  gst_vaapiencode_replace_encoder (encode, klass->alloc_encoder (encode,
+          GST_VAAPI_PLUGIN_BASE_DISPLAY (encode)));
   if (!encode->encoder)
     return FALSE;
+  encode->output_hold = 0;
 
   if (encode->prop_values && encode->prop_values->len) {
     for (i = 0; i < encode->prop_values->len; i++) {
@@ -770,7 +864,7 @@ gst_vaapiencode_finish (GstVideoEncoder * venc)
   status = gst_vaapi_encoder_flush (encode->encoder);
 
   GST_VIDEO_ENCODER_STREAM_UNLOCK (encode);
-  gst_pad_stop_task (GST_VAAPI_PLUGIN_BASE_SRC_PAD (encode));
+  gst_vaapiencode_stop_task (encode, FALSE);
   GST_VIDEO_ENCODER_STREAM_LOCK (encode);
 
   while (status == GST_VAAPI_ENCODER_STATUS_SUCCESS && ret == GST_FLOW_OK)
@@ -788,7 +882,7 @@ gst_vaapiencode_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
-      gst_pad_stop_task (GST_VAAPI_PLUGIN_BASE_SRC_PAD (encode));
+      gst_vaapiencode_stop_task (encode, FALSE);
 
       if (!gst_vaapiencode_drain (encode))
         goto drain_error;
@@ -831,7 +925,7 @@ gst_vaapiencode_sink_event (GstVideoEncoder * venc, GstEvent * event)
 
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_FLUSH_START:
-      gst_pad_pause_task (srcpad);
+      gst_vaapiencode_stop_task (encode, TRUE);
       break;
     case GST_EVENT_FLUSH_STOP:
       ret = gst_pad_start_task (srcpad,
@@ -857,7 +951,7 @@ gst_vaapiencode_flush (GstVideoEncoder * venc)
   if (!gst_vaapiencode_drain (encode))
     return FALSE;
 
-  gst_vaapi_encoder_replace (&encode->encoder, NULL);
+  gst_vaapiencode_replace_encoder (encode, NULL);
   if (!ensure_encoder (encode))
     return FALSE;
   if (!set_codec_state (encode, encode->input_state))
@@ -878,10 +972,58 @@ gst_vaapiencode_finalize (GObject * object)
     encode->prop_values = NULL;
   }
 
+  gst_object_replace ((GstObject **) & encode->coded_allocator, NULL);
+
   gst_vaapi_plugin_base_finalize (GST_VAAPI_PLUGIN_BASE (object));
   G_OBJECT_CLASS (gst_vaapiencode_parent_class)->finalize (object);
 }
 
+static void
+gst_vaapiencode_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVaapiEncode *const encode = GST_VAAPIENCODE_CAST (object);
+
+  switch (prop_id) {
+    case PROP_ZERO_COPY:
+      encode->zero_copy = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vaapiencode_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVaapiEncode *const encode = GST_VAAPIENCODE_CAST (object);
+
+  switch (prop_id) {
+    case PROP_STATS:{
+      GstVaapiEncoder *encoder = NULL;
+
+      GST_OBJECT_LOCK (encode);
+      if (encode->encoder)
+        encoder = gst_object_ref (encode->encoder);
+      GST_OBJECT_UNLOCK (encode);
+
+      g_value_take_boxed (value, encoder ?
+          gst_vaapi_encoder_get_stats (encoder) : NULL);
+      if (encoder)
+        gst_object_unref (encoder);
+      break;
+    }
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, encode->zero_copy);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_vaapiencode_init (GstVaapiEncode * encode)
 {
@@ -904,6 +1046,35 @@ gst_vaapiencode_class_init (GstVaapiEncodeClass * klass)
   gst_vaapi_plugin_base_class_init (GST_VAAPI_PLUGIN_BASE_CLASS (klass));
 
   object_class->finalize = gst_vaapiencode_finalize;
+  object_class->set_property = gst_vaapiencode_set_property;
+  object_class->get_property = gst_vaapiencode_get_property;
+
+  /**
+   * GstVaapiEncode:stats:
+   *
+   * Output statistics of the encoder: number of coded frames, frames
+   * currently in flight, and histograms of the encode latency and of
+   * the time spent waiting for surface completion. See
+   * gst_vaapi_encoder_get_stats() for the fields.
+   */
+  g_object_class_install_property (object_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Encoder output statistics", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVaapiEncode:zero-copy:
+   *
+   * Output buffers wrap the mapped VA coded buffers instead of copies
+   * of them. A coded buffer goes back to the encoder when downstream
+   * releases the output buffer, and the coded buffer pool grows with
+   * the number of buffers downstream holds, up to 32. Coded buffers
+   * split into several segments are still copied.
+   */
+  g_object_class_install_property (object_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero Copy",
+          "Output the coded buffers without copying them", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   element_class->set_context = gst_vaapi_base_set_context;
   element_class->change_state =
@@ -26,10 +26,10 @@
 
 #include "gstvaapipluginbase.h"
 #include <gst/vaapi/gstvaapiencoder.h>
+#include <gst/vaapi/gstvaapicodedbufferproxy.h>
 
 #if USE_H264_FEI_ENCODER
 #include <gst/vaapi/gstvaapisurface.h>
-#include <gst/vaapi/gstvaapicodedbufferproxy.h>
 #include "gstvaapifeivideometa.h"
 #endif
 
@@ -66,6 +66,11 @@ struct _GstVaapiEncode
   GstVideoCodecState *output_state;
   GPtrArray *prop_values;
   GstCaps *allowed_sinkpad_caps;
+
+  /* output coded buffers without copying, see gst_vaapiencode_wrap_buffer() */
+  gboolean zero_copy;
+  GstAllocator *coded_allocator;
+  guint output_hold;
 };
 
 struct _GstVaapiEncodeClass
@@ -79,7 +84,7 @@ struct _GstVaapiEncodeClass
   GstVaapiEncoder *   (*alloc_encoder)  (GstVaapiEncode * encode,
                                          GstVaapiDisplay * display);
   GstFlowReturn       (*alloc_buffer)   (GstVaapiEncode * encode,
-                                         GstVaapiCodedBuffer * coded_buf,
+                                         GstVaapiCodedBufferProxy * proxy,
                                          GstBuffer ** outbuf_ptr);
   GstVaapiProfile     (*get_profile)    (GstCaps * caps);
 
@@ -509,7 +509,7 @@ error:
 
 static GstFlowReturn
 gst_vaapiencode_h264_alloc_buffer (GstVaapiEncode * base_encode,
-    GstVaapiCodedBuffer * coded_buf, GstBuffer ** out_buffer_ptr)
+    GstVaapiCodedBufferProxy * proxy, GstBuffer ** out_buffer_ptr)
 {
   GstVaapiEncodeH264 *const encode = GST_VAAPIENCODE_H264_CAST (base_encode);
   GstVaapiEncoderH264 *const encoder =
@@ -520,7 +520,7 @@ gst_vaapiencode_h264_alloc_buffer (GstVaapiEncode * base_encode,
 
   ret =
       GST_VAAPIENCODE_CLASS (gst_vaapiencode_h264_parent_class)->alloc_buffer
-      (base_encode, coded_buf, out_buffer_ptr);
+      (base_encode, proxy, out_buffer_ptr);
   if (ret != GST_FLOW_OK)
     return ret;
 
@@ -328,10 +328,12 @@ error:
 
 static GstFlowReturn
 alloc_buffer (GstVaapiEncode * encode,
-    GstVaapiCodedBuffer * coded_buf, GstBuffer ** outbuf_ptr)
+    GstVaapiCodedBufferProxy * proxy, GstBuffer ** outbuf_ptr)
 {
   GstVaapiEncoderH264Fei *const encoder =
       GST_VAAPI_ENCODER_H264_FEI (encode->encoder);
+  GstVaapiCodedBuffer *const coded_buf =
+      GST_VAAPI_CODED_BUFFER_PROXY_BUFFER (proxy);
   GstBuffer *buf;
   gint32 buf_size;
   GstVaapiFeiMode fei_mode;
@@ -385,7 +387,7 @@ error_copy_buffer:
 
 static GstFlowReturn
 gst_vaapiencode_h264_fei_alloc_buffer (GstVaapiEncode * base_encode,
-    GstVaapiCodedBuffer * coded_buf, GstBuffer ** out_buffer_ptr)
+    GstVaapiCodedBufferProxy * proxy, GstBuffer ** out_buffer_ptr)
 {
   GstVaapiEncodeH264Fei *const encode =
       GST_VAAPIENCODE_H264_FEI_CAST (base_encode);
@@ -395,7 +397,7 @@ gst_vaapiencode_h264_fei_alloc_buffer (GstVaapiEncode * base_encode,
 
   g_return_val_if_fail (encoder != NULL, GST_FLOW_ERROR);
 
-  ret = alloc_buffer (base_encode, coded_buf, out_buffer_ptr);
+  ret = alloc_buffer (base_encode, proxy, out_buffer_ptr);
   if (ret != GST_FLOW_OK)
     return ret;
 
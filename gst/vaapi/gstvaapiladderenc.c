@@ -0,0 +1,1312 @@
+/*
+ *  gstvaapiladderenc.c - VA-API multi-resolution H.264 encoder
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:element-vaapiladderenc
+ * @short_description: A VA-API based H.264 encoder for ABR ladders
+ *
+ * vaapiladderenc encodes one input video stream into several H.264
+ * streams of different resolutions and bitrates, as needed for
+ * adaptive bitrate streaming. Every input frame is uploaded once and
+ * scaled into each rung of the ladder from the same VA surface. The
+ * encoders of all rungs are run from a single pool of worker threads.
+ *
+ * Keyframe decisions are taken once for the whole ladder: the
+ * #GstVaapiLadderEnc:keyframe-period is shared by all the rungs, and
+ * scene cuts detected on the smallest rung, as well as force-key-unit
+ * events, make every rung start a new GOP on the same frame. Hence the
+ * IDR frames of all the output streams are aligned. Rate control is
+ * not shared: each rung is encoded in CBR mode at its own bitrate.
+ *
+ * Each rung is exposed through a "src_%u" request pad, where the
+ * number is the index of the rung in #GstVaapiLadderEnc:rungs.
+ *
+ * ## Example launch line
+ *
+ * |[
+ *  gst-launch-1.0 -e filesrc location=input.mp4 ! decodebin ! \
+ *    vaapiladderenc name=ladder rungs="1280x720:3000,640x360:1000" \
+ *    ladder.src_0 ! h264parse ! mp4mux ! filesink location=720p.mp4 \
+ *    ladder.src_1 ! h264parse ! mp4mux ! filesink location=360p.mp4
+ * ]|
+ */
+
+#include "gstcompat.h"
+#include <gst/vaapi/gstvaapiencoder_h264.h>
+#include <gst/vaapi/gstvaapisurfacepool.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include <gst/vaapi/gstvaapiimage.h>
+#include "gstvaapiladderenc.h"
+#include "gstvaapipluginutil.h"
+#include "gstvaapivideometa.h"
+#include "gstvaapivideobufferpool.h"
+
+#define GST_PLUGIN_NAME "vaapiladderenc"
+#define GST_PLUGIN_DESC "A VA-API based H.264 encoder for ABR ladders"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_vaapiladderenc);
+#ifndef GST_DISABLE_GST_DEBUG
+#define GST_CAT_DEFAULT gst_debug_vaapiladderenc
+#else
+#define GST_CAT_DEFAULT NULL
+#endif
+
+#define DEFAULT_RUNGS                   "1280x720:3000,640x360:1000"
+#define DEFAULT_KEYFRAME_PERIOD         30
+#define DEFAULT_SCENE_CUT_THRESHOLD     40
+#define DEFAULT_MAX_THREADS             0
+
+/* Number of frames a rung may have queued before the input waits */
+#define LADDER_MAX_QUEUED_FRAMES        4
+
+/* Subsampling factor of the luma compared for scene cut detection */
+#define SCENE_CUT_STEP                  4
+
+/* *INDENT-OFF* */
+static const char gst_vaapiladderenc_sink_caps_str[] =
+  GST_VAAPI_MAKE_SURFACE_CAPS ", "
+  GST_CAPS_INTERLACED_FALSE "; "
+  GST_VIDEO_CAPS_MAKE (GST_VIDEO_FORMATS_ALL) ", "
+  GST_CAPS_INTERLACED_FALSE;
+
+static const char gst_vaapiladderenc_src_caps_str[] =
+  "video/x-h264, "
+  "stream-format = (string) byte-stream, "
+  "alignment = (string) au";
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+static GstStaticPadTemplate gst_vaapiladderenc_sink_factory =
+  GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (gst_vaapiladderenc_sink_caps_str));
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+static GstStaticPadTemplate gst_vaapiladderenc_src_factory =
+  GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (gst_vaapiladderenc_src_caps_str));
+/* *INDENT-ON* */
+
+typedef struct
+{
+  guint width;
+  guint height;
+  guint bitrate;
+} GstVaapiLadderEncRungSpec;
+
+struct _GstVaapiLadderEncRung
+{
+  GstVaapiLadderEnc *ladder;
+  GstPad *srcpad;
+  guint index;
+  GstVaapiLadderEncRungSpec spec;
+
+  GstVaapiEncoder *encoder;
+  GstVaapiVideoPool *pool;
+
+  /* protected by the ladder lock */
+  GQueue frames;
+  gboolean scheduled;
+};
+
+G_DEFINE_TYPE_WITH_CODE (GstVaapiLadderEnc, gst_vaapiladderenc,
+    GST_TYPE_ELEMENT, GST_VAAPI_PLUGIN_BASE_INIT_INTERFACES);
+
+GST_VAAPI_PLUGIN_BASE_DEFINE_SET_CONTEXT (gst_vaapiladderenc_parent_class);
+
+enum
+{
+  PROP_0,
+
+  PROP_RUNGS,
+  PROP_KEYFRAME_PERIOD,
+  PROP_SCENE_CUT_THRESHOLD,
+  PROP_MAX_THREADS,
+};
+
+/* Parses a comma separated list of WIDTHxHEIGHT:KBPS rungs */
+static gboolean
+parse_rungs (const gchar * str, GArray * specs)
+{
+  GstVaapiLadderEncRungSpec spec;
+  gchar **tokens;
+  guint i;
+  gboolean success = TRUE;
+
+  g_array_set_size (specs, 0);
+  if (!str)
+    return FALSE;
+
+  tokens = g_strsplit (str, ",", -1);
+  for (i = 0; tokens[i] && success; i++) {
+    gchar *const token = g_strstrip (tokens[i]);
+    gchar dummy;
+
+    if (sscanf (token, "%ux%u:%u%c", &spec.width, &spec.height,
+            &spec.bitrate, &dummy) != 3 || spec.width == 0 || spec.height == 0
+        || spec.bitrate == 0)
+      success = FALSE;
+    else
+      g_array_append_val (specs, spec);
+  }
+  g_strfreev (tokens);
+
+  if (!success || specs->len == 0) {
+    g_array_set_size (specs, 0);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static GstVaapiLadderEncRung *
+rung_new (GstVaapiLadderEnc * ladder, GstPad * srcpad, guint index)
+{
+  GstVaapiLadderEncRung *const rung = g_slice_new0 (GstVaapiLadderEncRung);
+
+  rung->ladder = ladder;
+  rung->srcpad = srcpad;
+  rung->index = index;
+  g_queue_init (&rung->frames);
+  return rung;
+}
+
+static void
+rung_reset (GstVaapiLadderEncRung * rung)
+{
+  g_queue_clear_full (&rung->frames,
+      (GDestroyNotify) gst_video_codec_frame_unref);
+  gst_vaapi_encoder_replace (&rung->encoder, NULL);
+  gst_vaapi_video_pool_replace (&rung->pool, NULL);
+}
+
+static void
+rung_free (GstVaapiLadderEncRung * rung)
+{
+  rung_reset (rung);
+  g_slice_free (GstVaapiLadderEncRung, rung);
+}
+
+static GstVaapiLadderEncRung *
+find_rung_by_pad (GstVaapiLadderEnc * ladder, GstPad * pad)
+{
+  guint i;
+
+  for (i = 0; i < ladder->rungs->len; i++) {
+    GstVaapiLadderEncRung *const rung = g_ptr_array_index (ladder->rungs, i);
+    if (rung->srcpad == pad)
+      return rung;
+  }
+  return NULL;
+}
+
+/* Returns the index of the rung with the smallest picture, for scene
+ * cut analysis */
+static guint
+find_smallest_rung (GstVaapiLadderEnc * ladder)
+{
+  GstVaapiLadderEncRung *rung, *smallest = NULL;
+  guint i, index = 0;
+
+  for (i = 0; i < ladder->rungs->len; i++) {
+    rung = g_ptr_array_index (ladder->rungs, i);
+    if (!smallest || rung->spec.width * rung->spec.height <
+        smallest->spec.width * smallest->spec.height) {
+      smallest = rung;
+      index = i;
+    }
+  }
+  return index;
+}
+
+/* Waits until the workers are done with every queued frame. The lock
+ * shall be held */
+static void
+ladder_wait_idle_unlocked (GstVaapiLadderEnc * ladder)
+{
+  guint i;
+
+  for (i = 0; i < ladder->rungs->len; i++) {
+    GstVaapiLadderEncRung *const rung = g_ptr_array_index (ladder->rungs, i);
+    while (rung->scheduled)
+      g_cond_wait (&ladder->cond, &ladder->lock);
+  }
+}
+
+static void
+ladder_wait_idle (GstVaapiLadderEnc * ladder)
+{
+  g_mutex_lock (&ladder->lock);
+  ladder_wait_idle_unlocked (ladder);
+  g_mutex_unlock (&ladder->lock);
+}
+
+static void
+ladder_update_flow (GstVaapiLadderEnc * ladder, GstVaapiLadderEncRung * rung,
+    GstFlowReturn ret)
+{
+  g_mutex_lock (&ladder->lock);
+  ladder->flow_ret = gst_flow_combiner_update_pad_flow (ladder->flow_combiner,
+      rung->srcpad, ret);
+  g_mutex_unlock (&ladder->lock);
+}
+
+/* Pushes downstream the coded buffers the encoder of @rung completed */
+static GstFlowReturn
+rung_push_coded_buffers (GstVaapiLadderEnc * ladder,
+    GstVaapiLadderEncRung * rung)
+{
+  GstVaapiCodedBufferProxy *codedbuf_proxy;
+  GstVaapiCodedBuffer *codedbuf;
+  GstVaapiEncoderStatus status;
+  GstVideoCodecFrame *frame;
+  GstBuffer *buf;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  while (ret == GST_FLOW_OK) {
+    codedbuf_proxy = NULL;
+    status = gst_vaapi_encoder_get_buffer_with_timeout (rung->encoder,
+        &codedbuf_proxy, 0);
+    if (status == GST_VAAPI_ENCODER_STATUS_NO_BUFFER)
+      break;
+    if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+      goto error_get_buffer;
+
+    frame = gst_vaapi_coded_buffer_proxy_get_user_data (codedbuf_proxy);
+    codedbuf = GST_VAAPI_CODED_BUFFER_PROXY_BUFFER (codedbuf_proxy);
+    buf = gst_buffer_new_allocate (NULL,
+        gst_vaapi_coded_buffer_get_size (codedbuf), NULL);
+    if (!buf || !frame || !gst_vaapi_coded_buffer_copy_into (buf, codedbuf)) {
+      gst_buffer_replace (&buf, NULL);
+      gst_vaapi_coded_buffer_proxy_unref (codedbuf_proxy);
+      goto error_copy_buffer;
+    }
+
+    /* B-frames are disabled, so the decoding order is the display order */
+    GST_BUFFER_PTS (buf) = frame->pts;
+    GST_BUFFER_DTS (buf) = frame->pts;
+    GST_BUFFER_DURATION (buf) = frame->duration;
+    if (!GST_VIDEO_CODEC_FRAME_IS_SYNC_POINT (frame))
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    gst_vaapi_coded_buffer_proxy_unref (codedbuf_proxy);
+
+    GST_TRACE_OBJECT (rung->srcpad, "output:%" GST_TIME_FORMAT ", size:%zu",
+        GST_TIME_ARGS (GST_BUFFER_PTS (buf)), gst_buffer_get_size (buf));
+
+    ret = gst_pad_push (rung->srcpad, buf);
+    ladder_update_flow (ladder, rung, ret);
+  }
+  return ret;
+
+  /* ERRORS */
+error_get_buffer:
+  {
+    GST_ERROR_OBJECT (rung->srcpad, "failed to get encoded buffer (status %d)",
+        status);
+    if (codedbuf_proxy)
+      gst_vaapi_coded_buffer_proxy_unref (codedbuf_proxy);
+    ladder_update_flow (ladder, rung, GST_FLOW_ERROR);
+    return GST_FLOW_ERROR;
+  }
+error_copy_buffer:
+  {
+    GST_ERROR_OBJECT (rung->srcpad, "failed to copy encoded buffer");
+    ladder_update_flow (ladder, rung, GST_FLOW_ERROR);
+    return GST_FLOW_ERROR;
+  }
+}
+
+static void
+rung_encode_frame (GstVaapiLadderEnc * ladder, GstVaapiLadderEncRung * rung,
+    GstVideoCodecFrame * frame)
+{
+  GstVaapiEncoderStatus status;
+
+  status = gst_vaapi_encoder_put_frame (rung->encoder, frame);
+  if (status < GST_VAAPI_ENCODER_STATUS_SUCCESS) {
+    GST_ERROR_OBJECT (rung->srcpad, "failed to encode frame %d (status %d)",
+        frame->system_frame_number, status);
+    ladder_update_flow (ladder, rung, GST_FLOW_ERROR);
+    return;
+  }
+  rung_push_coded_buffers (ladder, rung);
+}
+
+/* Worker pool function: encodes the queued frames of one rung. A rung
+ * is only ever scheduled once at a time, so that its frames are
+ * submitted in order */
+static void
+rung_process (gpointer data, gpointer user_data)
+{
+  GstVaapiLadderEncRung *const rung = data;
+  GstVaapiLadderEnc *const ladder = user_data;
+  GstVideoCodecFrame *frame;
+  gboolean flushing;
+
+  for (;;) {
+    g_mutex_lock (&ladder->lock);
+    frame = g_queue_pop_head (&rung->frames);
+    if (!frame)
+      rung->scheduled = FALSE;
+    flushing = ladder->flushing;
+    g_cond_broadcast (&ladder->cond);
+    g_mutex_unlock (&ladder->lock);
+
+    if (!frame)
+      break;
+    if (!flushing)
+      rung_encode_frame (ladder, rung, frame);
+    gst_video_codec_frame_unref (frame);
+  }
+}
+
+/* Hands @frame over to the workers, waiting for room in the queue */
+static void
+rung_queue_frame (GstVaapiLadderEnc * ladder, GstVaapiLadderEncRung * rung,
+    GstVideoCodecFrame * frame)
+{
+  g_mutex_lock (&ladder->lock);
+  while (g_queue_get_length (&rung->frames) >= LADDER_MAX_QUEUED_FRAMES &&
+      !ladder->flushing)
+    g_cond_wait (&ladder->cond, &ladder->lock);
+  if (ladder->flushing) {
+    g_mutex_unlock (&ladder->lock);
+    gst_video_codec_frame_unref (frame);
+    return;
+  }
+
+  g_queue_push_tail (&rung->frames, frame);
+  if (!rung->scheduled) {
+    rung->scheduled = TRUE;
+    g_thread_pool_push (ladder->workers, rung, NULL);
+  }
+  g_mutex_unlock (&ladder->lock);
+}
+
+/* Encodes the frames still held by the encoders, e.g. on EOS */
+static void
+ladder_drain (GstVaapiLadderEnc * ladder)
+{
+  guint i;
+
+  ladder_wait_idle (ladder);
+  for (i = 0; i < ladder->rungs->len; i++) {
+    GstVaapiLadderEncRung *const rung = g_ptr_array_index (ladder->rungs, i);
+
+    if (!rung->encoder)
+      continue;
+    if (gst_vaapi_encoder_flush (rung->encoder) !=
+        GST_VAAPI_ENCODER_STATUS_SUCCESS)
+      GST_WARNING_OBJECT (rung->srcpad, "failed to flush encoder");
+    rung_push_coded_buffers (ladder, rung);
+  }
+}
+
+/* Returns the surface pool of a rung of the same size configured
+ * before @rung, if any. Rungs that only differ by bitrate scale the
+ * input into the same pool */
+static GstVaapiVideoPool *
+find_surface_pool (GstVaapiLadderEnc * ladder, GstVaapiLadderEncRung * rung)
+{
+  guint i;
+
+  for (i = 0; i < ladder->rungs->len; i++) {
+    GstVaapiLadderEncRung *const other = g_ptr_array_index (ladder->rungs, i);
+
+    if (other == rung)
+      break;
+    if (other->pool && other->spec.width == rung->spec.width &&
+        other->spec.height == rung->spec.height)
+      return other->pool;
+  }
+  return NULL;
+}
+
+static gboolean
+rung_configure (GstVaapiLadderEnc * ladder, GstVaapiLadderEncRung * rung)
+{
+  GstVaapiVideoPool *pool;
+  GstVaapiDisplay *const display = GST_VAAPI_PLUGIN_BASE_DISPLAY (ladder);
+  const GstVideoInfo *const vip = GST_VAAPI_PLUGIN_BASE_SINK_PAD_INFO (ladder);
+  GstVideoCodecState *state;
+  GstVaapiEncoderStatus status;
+  GstCaps *caps;
+
+  rung_reset (rung);
+
+  pool = find_surface_pool (ladder, rung);
+  if (pool)
+    gst_vaapi_video_pool_replace (&rung->pool, pool);
+  else {
+    rung->pool = gst_vaapi_surface_pool_new (display, GST_VIDEO_FORMAT_NV12,
+        rung->spec.width, rung->spec.height);
+    if (!rung->pool)
+      goto error_create_pool;
+  }
+
+  rung->encoder = gst_vaapi_encoder_h264_new (display);
+  if (!rung->encoder)
+    goto error_create_encoder;
+  g_object_set (rung->encoder, "rate-control", GST_VAAPI_RATECONTROL_CBR,
+      "keyframe-period", ladder->keyframe_period, "max-bframes", 0, NULL);
+  gst_vaapi_encoder_set_bitrate (rung->encoder, rung->spec.bitrate);
+
+  state = g_slice_new0 (GstVideoCodecState);
+  state->ref_count = 1;
+  gst_video_info_set_format (&state->info, GST_VIDEO_FORMAT_NV12,
+      rung->spec.width, rung->spec.height);
+  state->info.fps_n = GST_VIDEO_INFO_FPS_N (vip);
+  state->info.fps_d = GST_VIDEO_INFO_FPS_D (vip);
+  status = gst_vaapi_encoder_set_codec_state (rung->encoder, state);
+  gst_video_codec_state_unref (state);
+  if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS)
+    goto error_codec_state;
+
+  caps = gst_caps_from_string (gst_vaapiladderenc_src_caps_str);
+  gst_caps_set_simple (caps, "width", G_TYPE_INT, rung->spec.width,
+      "height", G_TYPE_INT, rung->spec.height,
+      "framerate", GST_TYPE_FRACTION, GST_VIDEO_INFO_FPS_N (vip),
+      GST_VIDEO_INFO_FPS_D (vip), NULL);
+  GST_DEBUG_OBJECT (rung->srcpad, "output caps %" GST_PTR_FORMAT, caps);
+  gst_pad_push_event (rung->srcpad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+  return TRUE;
+
+  /* ERRORS */
+error_create_pool:
+  {
+    GST_ERROR_OBJECT (rung->srcpad, "failed to create surface pool");
+    return FALSE;
+  }
+error_create_encoder:
+  {
+    GST_ERROR_OBJECT (rung->srcpad, "failed to create encoder");
+    return FALSE;
+  }
+error_codec_state:
+  {
+    GST_ERROR_OBJECT (rung->srcpad, "failed to set codec state (status %d)",
+        status);
+    return FALSE;
+  }
+}
+
+static gboolean
+ladder_configure (GstVaapiLadderEnc * ladder)
+{
+  guint i;
+
+  ladder->configured = FALSE;
+  ladder->has_scene_luma = FALSE;
+
+  for (i = 0; i < ladder->rungs->len; i++) {
+    if (!rung_configure (ladder, g_ptr_array_index (ladder->rungs, i)))
+      return FALSE;
+  }
+  ladder->configured = TRUE;
+  return TRUE;
+}
+
+static gboolean
+ladder_set_caps (GstVaapiLadderEnc * ladder, GstCaps * caps)
+{
+  GstVaapiPluginBase *const plugin = GST_VAAPI_PLUGIN_BASE (ladder);
+
+  if (ladder->rungs->len == 0)
+    goto error_no_rungs;
+
+  ladder_drain (ladder);
+
+  if (!gst_vaapi_plugin_base_set_caps (plugin, caps, NULL))
+    return FALSE;
+  return ladder_configure (ladder);
+
+  /* ERRORS */
+error_no_rungs:
+  {
+    GST_ELEMENT_ERROR (ladder, CORE, NEGOTIATION,
+        ("No source pad was requested."), (NULL));
+    return FALSE;
+  }
+}
+
+/* Compares the subsampled luma of @surface with that of the previous
+ * frame, and reports a scene cut if the mean absolute difference
+ * reaches the scene-cut-threshold */
+static gboolean
+ladder_detect_scene_cut (GstVaapiLadderEnc * ladder,
+    GstVaapiSurface * surface)
+{
+  GstVaapiImage *image;
+  const guint8 *plane;
+  guint width, height, pitch, x, y, size;
+  guint64 sad = 0;
+  gboolean is_scene_cut;
+
+  image = gst_vaapi_surface_derive_image (surface);
+  if (!image) {
+    gst_vaapi_surface_get_size (surface, &width, &height);
+    image = gst_vaapi_image_new (gst_vaapi_object_get_display
+        (GST_VAAPI_OBJECT (surface)), GST_VIDEO_FORMAT_NV12, width, height);
+    if (!image)
+      return FALSE;
+    if (!gst_vaapi_surface_get_image (surface, image)) {
+      gst_vaapi_object_unref (image);
+      return FALSE;
+    }
+  }
+  if (GST_VAAPI_IMAGE_FORMAT (image) != GST_VIDEO_FORMAT_NV12 ||
+      !gst_vaapi_image_map (image)) {
+    gst_vaapi_object_unref (image);
+    return FALSE;
+  }
+
+  gst_vaapi_image_get_size (image, &width, &height);
+  width /= SCENE_CUT_STEP;
+  height /= SCENE_CUT_STEP;
+  size = width * height;
+  if (size != ladder->scene_luma_size) {
+    g_free (ladder->scene_luma);
+    ladder->scene_luma = g_malloc (size);
+    ladder->scene_luma_size = size;
+    ladder->has_scene_luma = FALSE;
+  }
+
+  plane = gst_vaapi_image_get_plane (image, 0);
+  pitch = gst_vaapi_image_get_pitch (image, 0);
+  for (y = 0; y < height; y++) {
+    const guint8 *const src = plane + y * SCENE_CUT_STEP * pitch;
+    guint8 *const dst = ladder->scene_luma + y * width;
+
+    for (x = 0; x < width; x++) {
+      const guint8 luma = src[x * SCENE_CUT_STEP];
+      sad += ABS ((gint) luma - (gint) dst[x]);
+      dst[x] = luma;
+    }
+  }
+
+  gst_vaapi_image_unmap (image);
+  gst_vaapi_object_unref (image);
+
+  is_scene_cut = ladder->has_scene_luma && size > 0 &&
+      sad >= (guint64) ladder->scene_cut_threshold * size;
+  ladder->has_scene_luma = TRUE;
+  return is_scene_cut;
+}
+
+static GstVideoCodecFrame *
+ladder_frame_new (GstVaapiLadderEnc * ladder, GstBuffer * buf,
+    GstVaapiSurfaceProxy * proxy)
+{
+  GstVideoCodecFrame *const frame = g_slice_new0 (GstVideoCodecFrame);
+
+  frame->ref_count = 1;
+  frame->system_frame_number = ladder->frame_number;
+  frame->pts = GST_BUFFER_PTS (buf);
+  frame->dts = GST_BUFFER_DTS (buf);
+  frame->duration = GST_BUFFER_DURATION (buf);
+  gst_video_codec_frame_set_user_data (frame, proxy,
+      (GDestroyNotify) gst_vaapi_surface_proxy_unref);
+  return frame;
+}
+
+static GstFlowReturn
+gst_vaapiladderenc_chain (GstPad * pad, GstObject * parent, GstBuffer * inbuf)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (parent);
+  GstVideoCodecFrame **frames;
+  GstVaapiVideoMeta *meta;
+  GstVaapiSurface *src_surface;
+  GstVaapiSurfaceProxy *proxy;
+  GstVaapiFilterStatus status;
+  GstBuffer *buf;
+  GstFlowReturn ret;
+  gboolean keyframe;
+  guint i, n_rungs;
+
+  if (!ladder->configured)
+    goto error_not_negotiated;
+
+  ret = gst_vaapi_plugin_base_get_input_buffer (GST_VAAPI_PLUGIN_BASE (ladder),
+      inbuf, &buf);
+  gst_buffer_unref (inbuf);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  meta = gst_buffer_get_vaapi_video_meta (buf);
+  if (!meta)
+    goto error_no_meta;
+  src_surface = gst_vaapi_video_meta_get_surface (meta);
+  if (!src_surface)
+    goto error_no_meta;
+
+  /* Scale the input once per rung, from the same source surface */
+  n_rungs = ladder->rungs->len;
+  frames = g_newa (GstVideoCodecFrame *, n_rungs);
+  for (i = 0; i < n_rungs; i++) {
+    GstVaapiLadderEncRung *const rung = g_ptr_array_index (ladder->rungs, i);
+
+    proxy = gst_vaapi_surface_proxy_new_from_pool
+        (GST_VAAPI_SURFACE_POOL (rung->pool));
+    if (!proxy)
+      goto error_create_proxy;
+    status = gst_vaapi_filter_process (ladder->filter, src_surface,
+        GST_VAAPI_SURFACE_PROXY_SURFACE (proxy), 0);
+    if (status != GST_VAAPI_FILTER_STATUS_SUCCESS) {
+      gst_vaapi_surface_proxy_unref (proxy);
+      goto error_process_vpp;
+    }
+    frames[i] = ladder_frame_new (ladder, buf, proxy);
+  }
+  gst_buffer_unref (buf);
+
+  /* Take the keyframe decision once, for all the rungs */
+  g_mutex_lock (&ladder->lock);
+  keyframe = ladder->force_keyframe;
+  ladder->force_keyframe = FALSE;
+  g_mutex_unlock (&ladder->lock);
+
+  if (ladder->scene_cut_threshold > 0) {
+    proxy = frames[find_smallest_rung (ladder)]->user_data;
+    if (ladder_detect_scene_cut (ladder,
+            GST_VAAPI_SURFACE_PROXY_SURFACE (proxy))) {
+      GST_DEBUG_OBJECT (ladder, "scene cut at frame %u", ladder->frame_number);
+      keyframe = TRUE;
+    }
+  }
+
+  for (i = 0; i < n_rungs; i++) {
+    if (keyframe)
+      GST_VIDEO_CODEC_FRAME_SET_FORCE_KEYFRAME (frames[i]);
+    rung_queue_frame (ladder, g_ptr_array_index (ladder->rungs, i), frames[i]);
+  }
+  ladder->frame_number++;
+
+  g_mutex_lock (&ladder->lock);
+  ret = ladder->flow_ret;
+  g_mutex_unlock (&ladder->lock);
+  return ret;
+
+  /* ERRORS */
+error_not_negotiated:
+  {
+    GST_ELEMENT_ERROR (ladder, CORE, NEGOTIATION, (NULL),
+        ("format wasn't negotiated before chain function"));
+    gst_buffer_unref (inbuf);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+error_no_meta:
+  {
+    GST_ERROR_OBJECT (ladder, "failed to get VA surface from input buffer");
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+error_create_proxy:
+  {
+    GST_ERROR_OBJECT (ladder, "failed to create surface proxy from pool");
+    goto error_free_frames;
+  }
+error_process_vpp:
+  {
+    GST_ERROR_OBJECT (ladder, "failed to scale surface (status %d)", status);
+    goto error_free_frames;
+  }
+error_free_frames:
+  {
+    while (i-- > 0)
+      gst_video_codec_frame_unref (frames[i]);
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+}
+
+static void
+ladder_set_flushing (GstVaapiLadderEnc * ladder, gboolean flushing)
+{
+  guint i;
+
+  g_mutex_lock (&ladder->lock);
+  ladder->flushing = flushing;
+  g_cond_broadcast (&ladder->cond);
+  g_mutex_unlock (&ladder->lock);
+
+  for (i = 0; i < ladder->rungs->len; i++) {
+    GstVaapiLadderEncRung *const rung = g_ptr_array_index (ladder->rungs, i);
+    if (rung->encoder)
+      gst_vaapi_encoder_set_flushing (rung->encoder, flushing);
+  }
+}
+
+static gboolean
+gst_vaapiladderenc_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (parent);
+  gboolean success;
+
+  GST_DEBUG_OBJECT (ladder, "handling %s event", GST_EVENT_TYPE_NAME (event));
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:{
+      GstCaps *caps;
+
+      gst_event_parse_caps (event, &caps);
+      success = ladder_set_caps (ladder, caps);
+      gst_event_unref (event);
+      return success;
+    }
+    case GST_EVENT_EOS:
+      ladder_drain (ladder);
+      break;
+    case GST_EVENT_FLUSH_START:
+      ladder_set_flushing (ladder, TRUE);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      /* Restart every encoder from a clean state */
+      g_mutex_lock (&ladder->lock);
+      ladder_wait_idle_unlocked (ladder);
+      gst_flow_combiner_reset (ladder->flow_combiner);
+      ladder->flow_ret = GST_FLOW_OK;
+      g_mutex_unlock (&ladder->lock);
+      ladder_set_flushing (ladder, FALSE);
+      success = gst_pad_event_default (pad, parent, event);
+      if (ladder->configured && !ladder_configure (ladder))
+        return FALSE;
+      return success;
+    default:
+      if (gst_video_event_is_force_key_unit (event)) {
+        g_mutex_lock (&ladder->lock);
+        ladder->force_keyframe = TRUE;
+        g_mutex_unlock (&ladder->lock);
+      }
+      /* Keep serialized events in order with the queued frames */
+      if (GST_EVENT_IS_SERIALIZED (event))
+        ladder_wait_idle (ladder);
+      break;
+  }
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static gboolean
+gst_vaapiladderenc_src_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (parent);
+
+  /* A key unit requested on any rung is produced on all of them */
+  if (gst_video_event_is_force_key_unit (event)) {
+    g_mutex_lock (&ladder->lock);
+    ladder->force_keyframe = TRUE;
+    g_mutex_unlock (&ladder->lock);
+    gst_event_unref (event);
+    return TRUE;
+  }
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static gboolean
+gst_vaapiladderenc_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (parent);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CONTEXT:
+      if (gst_vaapi_handle_context_query (GST_ELEMENT_CAST (ladder), query))
+        return TRUE;
+      break;
+    case GST_QUERY_ALLOCATION:
+      return gst_vaapi_plugin_base_propose_allocation
+          (GST_VAAPI_PLUGIN_BASE (ladder), query);
+    case GST_QUERY_CAPS:{
+      GstCaps *caps, *filter;
+
+      gst_query_parse_caps (query, &filter);
+      caps = gst_pad_get_pad_template_caps (pad);
+      if (filter) {
+        GstCaps *const tmp = caps;
+        caps = gst_caps_intersect_full (filter, tmp,
+            GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref (tmp);
+      }
+      gst_query_set_caps_result (query, caps);
+      gst_caps_unref (caps);
+      return TRUE;
+    }
+    default:
+      break;
+  }
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static gboolean
+gst_vaapiladderenc_src_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (parent);
+
+  if (GST_QUERY_TYPE (query) == GST_QUERY_CONTEXT &&
+      gst_vaapi_handle_context_query (GST_ELEMENT_CAST (ladder), query))
+    return TRUE;
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static GstPad *
+gst_vaapiladderenc_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (element);
+  GstVaapiLadderEncRung *rung;
+  GstPad *srcpad;
+  gchar *pad_name;
+  guint i, index;
+
+  if (GST_STATE (element) > GST_STATE_READY)
+    goto error_wrong_state;
+
+  if (name) {
+    if (sscanf (name, "src_%u", &index) != 1)
+      return NULL;
+  } else {
+    /* Pick the first rung without a source pad */
+    for (index = 0; index < ladder->rung_specs->len; index++) {
+      for (i = 0; i < ladder->rungs->len; i++) {
+        rung = g_ptr_array_index (ladder->rungs, i);
+        if (rung->index == index)
+          break;
+      }
+      if (i == ladder->rungs->len)
+        break;
+    }
+  }
+  if (index >= ladder->rung_specs->len)
+    goto error_no_rung;
+
+  for (i = 0; i < ladder->rungs->len; i++) {
+    rung = g_ptr_array_index (ladder->rungs, i);
+    if (rung->index == index)
+      goto error_pad_exists;
+    if (rung->index > index)
+      break;
+  }
+
+  pad_name = g_strdup_printf ("src_%u", index);
+  srcpad = gst_pad_new_from_template (templ, pad_name);
+  g_free (pad_name);
+  gst_pad_set_event_function (srcpad,
+      GST_DEBUG_FUNCPTR (gst_vaapiladderenc_src_event));
+  gst_pad_set_query_function (srcpad,
+      GST_DEBUG_FUNCPTR (gst_vaapiladderenc_src_query));
+  gst_pad_use_fixed_caps (srcpad);
+
+  rung = rung_new (ladder, srcpad, index);
+  rung->spec = g_array_index (ladder->rung_specs,
+      GstVaapiLadderEncRungSpec, index);
+  g_ptr_array_insert (ladder->rungs, i, rung);
+  gst_flow_combiner_add_pad (ladder->flow_combiner, srcpad);
+
+  GST_DEBUG_OBJECT (ladder, "rung %u: %ux%u at %u kbps", index,
+      rung->spec.width, rung->spec.height, rung->spec.bitrate);
+
+  gst_pad_set_active (srcpad, TRUE);
+  gst_element_add_pad (element, srcpad);
+  return srcpad;
+
+  /* ERRORS */
+error_wrong_state:
+  {
+    GST_WARNING_OBJECT (ladder, "source pads can only be requested in the "
+        "NULL or READY states");
+    return NULL;
+  }
+error_no_rung:
+  {
+    GST_WARNING_OBJECT (ladder, "no rung left for a new source pad");
+    return NULL;
+  }
+error_pad_exists:
+  {
+    GST_WARNING_OBJECT (ladder, "source pad src_%u already exists", index);
+    return NULL;
+  }
+}
+
+static void
+gst_vaapiladderenc_release_pad (GstElement * element, GstPad * pad)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (element);
+  GstVaapiLadderEncRung *rung;
+
+  /* Keep the streaming thread from queuing frames for this rung */
+  GST_PAD_STREAM_LOCK (GST_VAAPI_PLUGIN_BASE_SINK_PAD (ladder));
+  g_mutex_lock (&ladder->lock);
+  ladder_wait_idle_unlocked (ladder);
+  rung = find_rung_by_pad (ladder, pad);
+  if (rung) {
+    g_ptr_array_remove (ladder->rungs, rung);
+    gst_flow_combiner_remove_pad (ladder->flow_combiner, pad);
+  }
+  g_mutex_unlock (&ladder->lock);
+  GST_PAD_STREAM_UNLOCK (GST_VAAPI_PLUGIN_BASE_SINK_PAD (ladder));
+
+  if (!rung)
+    return;
+  rung_free (rung);
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+}
+
+static gboolean
+ladder_start (GstVaapiLadderEnc * ladder)
+{
+  GError *error = NULL;
+  guint max_threads;
+
+  max_threads = ladder->max_threads;
+  if (max_threads == 0)
+    max_threads = MAX (ladder->rungs->len, 1);
+
+  ladder->workers = g_thread_pool_new (rung_process, ladder, max_threads,
+      FALSE, &error);
+  if (!ladder->workers)
+    goto error_thread_pool;
+
+  gst_flow_combiner_reset (ladder->flow_combiner);
+  ladder->flow_ret = GST_FLOW_OK;
+  ladder->flushing = FALSE;
+  ladder->force_keyframe = FALSE;
+  ladder->frame_number = 0;
+  return TRUE;
+
+  /* ERRORS */
+error_thread_pool:
+  {
+    GST_ELEMENT_ERROR (ladder, RESOURCE, FAILED,
+        ("Failed to create encoding threads."), ("%s", error->message));
+    g_clear_error (&error);
+    return FALSE;
+  }
+}
+
+static void
+ladder_stop (GstVaapiLadderEnc * ladder)
+{
+  guint i;
+
+  ladder_set_flushing (ladder, TRUE);
+  if (ladder->workers) {
+    g_thread_pool_free (ladder->workers, FALSE, TRUE);
+    ladder->workers = NULL;
+  }
+
+  for (i = 0; i < ladder->rungs->len; i++)
+    rung_reset (g_ptr_array_index (ladder->rungs, i));
+  ladder->configured = FALSE;
+  ladder->has_scene_luma = FALSE;
+}
+
+static gboolean
+ladder_open (GstVaapiLadderEnc * ladder)
+{
+  GstVaapiPluginBase *const plugin = GST_VAAPI_PLUGIN_BASE (ladder);
+
+  if (!gst_vaapi_plugin_base_open (plugin))
+    return FALSE;
+  if (!gst_vaapi_plugin_base_ensure_display (plugin))
+    goto error_no_display;
+
+  ladder->filter =
+      gst_vaapi_filter_new (GST_VAAPI_PLUGIN_BASE_DISPLAY (ladder));
+  if (!ladder->filter)
+    goto error_no_filter;
+  if (!gst_vaapi_filter_set_format (ladder->filter, GST_VIDEO_FORMAT_NV12))
+    goto error_no_filter;
+  return TRUE;
+
+  /* ERRORS */
+error_no_display:
+  {
+    GST_ELEMENT_ERROR (ladder, RESOURCE, NOT_FOUND,
+        ("Failed to create VA display."), (NULL));
+    gst_vaapi_plugin_base_close (plugin);
+    return FALSE;
+  }
+error_no_filter:
+  {
+    GST_ELEMENT_ERROR (ladder, RESOURCE, NOT_FOUND,
+        ("Failed to create VPP filter."), (NULL));
+    gst_vaapi_filter_replace (&ladder->filter, NULL);
+    gst_vaapi_plugin_base_close (plugin);
+    return FALSE;
+  }
+}
+
+static void
+ladder_close (GstVaapiLadderEnc * ladder)
+{
+  gst_vaapi_filter_replace (&ladder->filter, NULL);
+  gst_vaapi_plugin_base_close (GST_VAAPI_PLUGIN_BASE (ladder));
+}
+
+static GstStateChangeReturn
+gst_vaapiladderenc_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      if (!ladder_open (ladder))
+        return GST_STATE_CHANGE_FAILURE;
+      break;
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (!ladder_start (ladder))
+        return GST_STATE_CHANGE_FAILURE;
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* Unblock the streaming thread before the pads get deactivated */
+      ladder_set_flushing (ladder, TRUE);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (gst_vaapiladderenc_parent_class)->change_state
+      (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      ladder_stop (ladder);
+      break;
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      ladder_close (ladder);
+      break;
+    default:
+      break;
+  }
+  return ret;
+}
+
+static void
+gst_vaapiladderenc_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (object);
+
+  switch (prop_id) {
+    case PROP_RUNGS:
+      GST_OBJECT_LOCK (ladder);
+      if (ladder->rungs->len > 0) {
+        GST_OBJECT_UNLOCK (ladder);
+        GST_WARNING_OBJECT (ladder, "cannot change rungs once source pads "
+            "were requested");
+        break;
+      }
+      if (!parse_rungs (g_value_get_string (value), ladder->rung_specs)) {
+        GST_WARNING_OBJECT (ladder, "invalid rungs \"%s\"",
+            g_value_get_string (value));
+        parse_rungs (ladder->rungs_str, ladder->rung_specs);
+      } else {
+        g_free (ladder->rungs_str);
+        ladder->rungs_str = g_value_dup_string (value);
+      }
+      GST_OBJECT_UNLOCK (ladder);
+      break;
+    case PROP_KEYFRAME_PERIOD:
+      ladder->keyframe_period = g_value_get_uint (value);
+      break;
+    case PROP_SCENE_CUT_THRESHOLD:
+      ladder->scene_cut_threshold = g_value_get_uint (value);
+      break;
+    case PROP_MAX_THREADS:
+      ladder->max_threads = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vaapiladderenc_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (object);
+
+  switch (prop_id) {
+    case PROP_RUNGS:
+      GST_OBJECT_LOCK (ladder);
+      g_value_set_string (value, ladder->rungs_str);
+      GST_OBJECT_UNLOCK (ladder);
+      break;
+    case PROP_KEYFRAME_PERIOD:
+      g_value_set_uint (value, ladder->keyframe_period);
+      break;
+    case PROP_SCENE_CUT_THRESHOLD:
+      g_value_set_uint (value, ladder->scene_cut_threshold);
+      break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, ladder->max_threads);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vaapiladderenc_finalize (GObject * object)
+{
+  GstVaapiLadderEnc *const ladder = GST_VAAPILADDERENC (object);
+
+  g_ptr_array_unref (ladder->rungs);
+  g_array_unref (ladder->rung_specs);
+  g_free (ladder->rungs_str);
+  g_free (ladder->scene_luma);
+  gst_flow_combiner_free (ladder->flow_combiner);
+  g_mutex_clear (&ladder->lock);
+  g_cond_clear (&ladder->cond);
+
+  gst_vaapi_plugin_base_finalize (GST_VAAPI_PLUGIN_BASE (ladder));
+  G_OBJECT_CLASS (gst_vaapiladderenc_parent_class)->finalize (object);
+}
+
+static void
+gst_vaapiladderenc_class_init (GstVaapiLadderEncClass * klass)
+{
+  GObjectClass *const object_class = G_OBJECT_CLASS (klass);
+  GstElementClass *const element_class = GST_ELEMENT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_debug_vaapiladderenc,
+      GST_PLUGIN_NAME, 0, GST_PLUGIN_DESC);
+
+  gst_vaapi_plugin_base_class_init (GST_VAAPI_PLUGIN_BASE_CLASS (klass));
+
+  object_class->finalize = gst_vaapiladderenc_finalize;
+  object_class->set_property = gst_vaapiladderenc_set_property;
+  object_class->get_property = gst_vaapiladderenc_get_property;
+
+  element_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_vaapiladderenc_change_state);
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_vaapiladderenc_request_new_pad);
+  element_class->release_pad =
+      GST_DEBUG_FUNCPTR (gst_vaapiladderenc_release_pad);
+  element_class->set_context = gst_vaapi_base_set_context;
+
+  gst_element_class_set_static_metadata (element_class,
+      "VA-API H.264 ladder encoder",
+      "Codec/Encoder/Video/Hardware", GST_PLUGIN_DESC,
+      "The gstreamer-vaapi developers");
+
+  gst_element_class_add_static_pad_template (element_class,
+      &gst_vaapiladderenc_sink_factory);
+  gst_element_class_add_static_pad_template (element_class,
+      &gst_vaapiladderenc_src_factory);
+
+  /**
+   * GstVaapiLadderEnc:rungs:
+   *
+   * The comma separated list of rungs to encode, each one given as
+   * WIDTHxHEIGHT:KBPS. The Nth rung is output on the "src_N" pad.
+   */
+  g_object_class_install_property (object_class,
+      PROP_RUNGS,
+      g_param_spec_string ("rungs", "Rungs",
+          "Resolution and bitrate of each rung, as WxH:kbps[,WxH:kbps...]",
+          DEFAULT_RUNGS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstVaapiLadderEnc:keyframe-period:
+   *
+   * The maximal distance between two keyframes, shared by all the
+   * rungs so that their IDR frames stay aligned.
+   */
+  g_object_class_install_property (object_class,
+      PROP_KEYFRAME_PERIOD,
+      g_param_spec_uint ("keyframe-period", "Keyframe Period",
+          "Maximal distance between two keyframes (0: auto-calculate)",
+          0, G_MAXUINT32, DEFAULT_KEYFRAME_PERIOD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstVaapiLadderEnc:scene-cut-threshold:
+   *
+   * The mean absolute luma difference between two frames of the
+   * smallest rung from which a keyframe is inserted in every rung.
+   */
+  g_object_class_install_property (object_class,
+      PROP_SCENE_CUT_THRESHOLD,
+      g_param_spec_uint ("scene-cut-threshold", "Scene Cut Threshold",
+          "Mean luma difference starting a new GOP on all rungs "
+          "(0: disabled)", 0, 255, DEFAULT_SCENE_CUT_THRESHOLD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVaapiLadderEnc:max-threads:
+   *
+   * The number of worker threads encoding the rungs.
+   */
+  g_object_class_install_property (object_class,
+      PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum Threads",
+          "Number of encoding threads (0: one per rung)",
+          0, 64, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+}
+
+static void
+gst_vaapiladderenc_init (GstVaapiLadderEnc * ladder)
+{
+  GstPad *sinkpad;
+
+  sinkpad = gst_pad_new_from_static_template (&gst_vaapiladderenc_sink_factory,
+      "sink");
+  gst_pad_set_chain_function (sinkpad,
+      GST_DEBUG_FUNCPTR (gst_vaapiladderenc_chain));
+  gst_pad_set_event_function (sinkpad,
+      GST_DEBUG_FUNCPTR (gst_vaapiladderenc_sink_event));
+  gst_pad_set_query_function (sinkpad,
+      GST_DEBUG_FUNCPTR (gst_vaapiladderenc_sink_query));
+  gst_element_add_pad (GST_ELEMENT (ladder), sinkpad);
+
+  gst_vaapi_plugin_base_init (GST_VAAPI_PLUGIN_BASE (ladder), GST_CAT_DEFAULT);
+
+  g_mutex_init (&ladder->lock);
+  g_cond_init (&ladder->cond);
+  ladder->flow_combiner = gst_flow_combiner_new ();
+  ladder->rungs = g_ptr_array_new_with_free_func ((GDestroyNotify) rung_free);
+  ladder->rung_specs = g_array_new (FALSE, FALSE,
+      sizeof (GstVaapiLadderEncRungSpec));
+  ladder->rungs_str = g_strdup (DEFAULT_RUNGS);
+  parse_rungs (ladder->rungs_str, ladder->rung_specs);
+  ladder->keyframe_period = DEFAULT_KEYFRAME_PERIOD;
+  ladder->scene_cut_threshold = DEFAULT_SCENE_CUT_THRESHOLD;
+  ladder->max_threads = DEFAULT_MAX_THREADS;
+}
@@ -0,0 +1,92 @@
+/*
+ *  gstvaapiladderenc.h - VA-API multi-resolution H.264 encoder
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_VAAPILADDERENC_H
+#define GST_VAAPILADDERENC_H
+
+#include "gstvaapipluginbase.h"
+#include <gst/base/gstflowcombiner.h>
+#include <gst/vaapi/gstvaapifilter.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VAAPILADDERENC \
+  (gst_vaapiladderenc_get_type ())
+#define GST_VAAPILADDERENC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_VAAPILADDERENC, \
+       GstVaapiLadderEnc))
+#define GST_VAAPILADDERENC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), GST_TYPE_VAAPILADDERENC, \
+       GstVaapiLadderEncClass))
+#define GST_IS_VAAPILADDERENC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_VAAPILADDERENC))
+#define GST_IS_VAAPILADDERENC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), GST_TYPE_VAAPILADDERENC))
+
+typedef struct _GstVaapiLadderEnc GstVaapiLadderEnc;
+typedef struct _GstVaapiLadderEncClass GstVaapiLadderEncClass;
+typedef struct _GstVaapiLadderEncRung GstVaapiLadderEncRung;
+
+struct _GstVaapiLadderEnc
+{
+  /*< private >*/
+  GstVaapiPluginBase parent_instance;
+
+  /* properties */
+  gchar *rungs_str;
+  guint keyframe_period;
+  guint scene_cut_threshold;
+  guint max_threads;
+
+  /* one entry per rung of the "rungs" property */
+  GArray *rung_specs;
+  /* one rung per requested source pad, sorted by index */
+  GPtrArray *rungs;
+
+  gboolean configured;
+  GstVaapiFilter *filter;
+  GThreadPool *workers;
+  guint32 frame_number;
+
+  /* scene cut analysis, on the smallest rung */
+  guint8 *scene_luma;
+  guint scene_luma_size;
+  gboolean has_scene_luma;
+
+  /* rung queues and flow state, protected by lock */
+  GMutex lock;
+  GCond cond;
+  GstFlowCombiner *flow_combiner;
+  GstFlowReturn flow_ret;
+  gboolean flushing;
+  gboolean force_keyframe;
+};
+
+struct _GstVaapiLadderEncClass
+{
+  /*< private >*/
+  GstVaapiPluginBaseClass parent_class;
+};
+
+GType
+gst_vaapiladderenc_get_type (void) G_GNUC_CONST;
+
+G_END_DECLS
+
+#endif /* GST_VAAPILADDERENC_H */
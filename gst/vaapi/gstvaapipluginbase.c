@@ -40,6 +40,9 @@ GST_DEBUG_CATEGORY_STATIC (CAT_PERFORMANCE);
 
 #define BUFFER_POOL_SINK_MIN_BUFFERS 2
 
+/* enough for the buffer pools of usual camera sources */
+#define DMABUF_CACHE_SIZE 32
+
 /* GstVideoContext interface */
 static void
 plugin_set_display (GstVaapiPluginBase * plugin, GstVaapiDisplay * display)
@@ -184,11 +187,21 @@ plugin_bind_dma_to_vaapi_buffer (GstVaapiPluginBase * plugin,
   /* Check for a VASurface cached in the buffer */
   surface = _get_cached_surface (inbuf);
   if (!surface) {
-    /* otherwise create one and cache it */
-    surface =
-        gst_vaapi_surface_new_with_dma_buf_handle (plugin->display, fd, vip);
-    if (!surface)
-      goto error_create_surface;
+    /* then for a surface imported from the same dma-buf, which
+     * upstream may have wrapped into a new memory */
+    if (!plugin->dmabuf_cache)
+      plugin->dmabuf_cache = gst_vaapi_dmabuf_cache_new (DMABUF_CACHE_SIZE);
+    surface = gst_vaapi_dmabuf_cache_lookup (plugin->dmabuf_cache, fd, vip);
+    if (!surface) {
+      /* otherwise create one and cache it */
+      surface =
+          gst_vaapi_surface_new_with_dma_buf_handle (plugin->display, fd, vip);
+      if (!surface)
+        goto error_create_surface;
+      GST_CAT_DEBUG_OBJECT (CAT_PERFORMANCE, plugin,
+          "imported new VA surface from dma_buf handle %d", fd);
+      gst_vaapi_dmabuf_cache_insert (plugin->dmabuf_cache, fd, vip, surface);
+    }
     _set_cached_surface (inbuf, surface);
   }
 
@@ -221,6 +234,37 @@ error_create_proxy:
   }
 }
 
+static void
+plugin_reset_dmabuf_cache (GstVaapiPluginBase * plugin)
+{
+  guint64 hits, misses, evictions;
+
+  if (!plugin->dmabuf_cache)
+    return;
+
+  gst_vaapi_dmabuf_cache_get_stats (plugin->dmabuf_cache, &hits, &misses,
+      &evictions);
+  GST_CAT_INFO_OBJECT (CAT_PERFORMANCE, plugin, "dma_buf import cache: "
+      "%" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses, "
+      "%" G_GUINT64_FORMAT " evictions (hit rate %.1f%%)", hits, misses,
+      evictions, hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0);
+  gst_vaapi_dmabuf_cache_free (plugin->dmabuf_cache);
+  plugin->dmabuf_cache = NULL;
+}
+
+static void
+plugin_reset_system_copy (GstVaapiPluginBase * plugin)
+{
+  if (plugin->other_srcpad_buffer_pool) {
+    gst_buffer_pool_set_active (plugin->other_srcpad_buffer_pool, FALSE);
+    g_clear_object (&plugin->other_srcpad_buffer_pool);
+  }
+  if (plugin->copy_converter) {
+    gst_video_converter_free (plugin->copy_converter);
+    plugin->copy_converter = NULL;
+  }
+}
+
 static void
 plugin_reset_texture_map (GstVaapiPluginBase * plugin)
 {
@@ -254,6 +298,8 @@ gst_vaapi_plugin_base_init (GstVaapiPluginBase * plugin,
 
   plugin->enable_direct_rendering =
       (g_getenv ("GST_VAAPI_ENABLE_DIRECT_RENDERING") != NULL);
+
+  plugin->copy_threads = 1;
 }
 
 void
@@ -294,6 +340,7 @@ gst_vaapi_plugin_base_close (GstVaapiPluginBase * plugin)
 {
   /* Release vaapi textures first if exist, which refs display object */
   plugin_reset_texture_map (plugin);
+  plugin_reset_dmabuf_cache (plugin);
 
   gst_vaapi_display_replace (&plugin->display, NULL);
   gst_object_replace (&plugin->gl_context, NULL);
@@ -309,6 +356,7 @@ gst_vaapi_plugin_base_close (GstVaapiPluginBase * plugin)
   g_clear_object (&plugin->sinkpad_allocator);
   g_clear_object (&plugin->srcpad_allocator);
   g_clear_object (&plugin->other_srcpad_allocator);
+  plugin_reset_system_copy (plugin);
 
   gst_caps_replace (&plugin->srcpad_caps, NULL);
   gst_video_info_init (&plugin->srcpad_info);
@@ -757,6 +805,9 @@ gst_vaapi_plugin_base_set_caps (GstVaapiPluginBase * plugin, GstCaps * incaps,
       return FALSE;
     gst_caps_replace (&plugin->sinkpad_caps, incaps);
     plugin->sinkpad_caps_is_raw = !gst_caps_has_vaapi_surface (incaps);
+    /* upstream usually allocates a new set of dma-bufs */
+    if (plugin->dmabuf_cache)
+      gst_vaapi_dmabuf_cache_clear (plugin->dmabuf_cache);
   }
 
   if (outcaps && outcaps != plugin->srcpad_caps) {
@@ -771,9 +822,12 @@ gst_vaapi_plugin_base_set_caps (GstVaapiPluginBase * plugin, GstCaps * incaps,
       plugin_reset_texture_map (plugin);
     }
     gst_caps_replace (&plugin->srcpad_caps, outcaps);
+    plugin_reset_system_copy (plugin);
   }
 
-  if (!ensure_sinkpad_buffer_pool (plugin, plugin->sinkpad_caps))
+  /* elements with request sink pads only configure their source pad */
+  if (plugin->sinkpad_caps
+      && !ensure_sinkpad_buffer_pool (plugin, plugin->sinkpad_caps))
     return FALSE;
   return TRUE;
 }
@@ -1007,6 +1061,8 @@ gst_vaapi_plugin_base_decide_allocation (GstVaapiPluginBase * plugin,
    * caps are raw video, and the used allocator is the VA-API one, we
    * should copy the VA-API frame into a dumb buffer */
   plugin->copy_output_frame = gst_vaapi_video_buffer_pool_copy_buffer (pool);
+  /* the system memory allocator might have changed */
+  plugin_reset_system_copy (plugin);
 
   return TRUE;
 
@@ -1441,6 +1497,91 @@ _init_performance_debug (void)
 #endif
 }
 
+static gboolean
+ensure_other_srcpad_buffer_pool (GstVaapiPluginBase * plugin)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+
+  if (plugin->other_srcpad_buffer_pool)
+    return TRUE;
+  if (!plugin->srcpad_caps)
+    return FALSE;
+
+  pool = gst_video_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, plugin->srcpad_caps,
+      GST_VIDEO_INFO_SIZE (&plugin->srcpad_info), 0, 0);
+  gst_buffer_pool_config_set_allocator (config,
+      plugin->other_srcpad_allocator, &plugin->other_allocator_params);
+  if (!gst_buffer_pool_set_config (pool, config))
+    goto error_pool_config;
+  if (!gst_buffer_pool_set_active (pool, TRUE))
+    goto error_pool_config;
+
+  plugin->other_srcpad_buffer_pool = pool;
+  return TRUE;
+
+  /* ERRORS */
+error_pool_config:
+  {
+    GST_WARNING_OBJECT (plugin, "failed to configure system memory pool");
+    gst_object_unref (pool);
+    return FALSE;
+  }
+}
+
+/**
+ * gst_vaapi_plugin_base_alloc_system_buffer:
+ * @plugin: a #GstVaapiPluginBase
+ *
+ * Allocates a system memory buffer able to hold a frame described by
+ * the src pad caps, to be filled by gst_vaapi_plugin_copy_va_buffer()
+ * when downstream doesn't support GstVideoMeta. The buffers are
+ * recycled through a pool, created with the allocator that was
+ * proposed by downstream.
+ *
+ * Returns: (transfer full): a new #GstBuffer, or %NULL on error
+ **/
+GstBuffer *
+gst_vaapi_plugin_base_alloc_system_buffer (GstVaapiPluginBase * plugin)
+{
+  GstBuffer *buf = NULL;
+
+  if (ensure_other_srcpad_buffer_pool (plugin)
+      && gst_buffer_pool_acquire_buffer (plugin->other_srcpad_buffer_pool,
+          &buf, NULL) == GST_FLOW_OK)
+    return buf;
+
+  /* fallback to a one-shot allocation */
+  return gst_buffer_new_allocate (plugin->other_srcpad_allocator,
+      GST_VIDEO_INFO_SIZE (&plugin->srcpad_info),
+      &plugin->other_allocator_params);
+}
+
+static gboolean
+ensure_copy_converter (GstVaapiPluginBase * plugin, guint n_threads)
+{
+  GstStructure *config;
+
+  if (plugin->copy_converter && plugin->copy_converter_threads == n_threads)
+    return TRUE;
+
+  if (plugin->copy_converter)
+    gst_video_converter_free (plugin->copy_converter);
+
+  /* same input and output info, so the converter only copies the
+   * planes, splitting the lines among its threads */
+  config = gst_structure_new ("GstVideoConverterConfig",
+      GST_VIDEO_CONVERTER_OPT_DITHER_METHOD, GST_TYPE_VIDEO_DITHER_METHOD,
+      GST_VIDEO_DITHER_NONE,
+      GST_VIDEO_CONVERTER_OPT_THREADS, G_TYPE_UINT, n_threads, NULL);
+  plugin->copy_converter = gst_video_converter_new (&plugin->srcpad_info,
+      &plugin->srcpad_info, config);
+  plugin->copy_converter_threads = n_threads;
+  return plugin->copy_converter != NULL;
+}
+
 /**
  * gst_vaapi_plugin_copy_va_buffer:
  * @plugin: a #GstVaapiPluginBase
@@ -1451,6 +1592,9 @@ _init_performance_debug (void)
  * support GstVideoMeta, and since VA memory may have custom strides a
  * frame copy is required.
  *
+ * With more than one copy thread configured, the planes are copied
+ * by a #GstVideoConverter splitting the lines among the threads.
+ *
  * Returns: %FALSE if the copy failed, otherwise %TRUE. Also returns
  *          %TRUE if it is not required to do the copy
  **/
@@ -1461,6 +1605,7 @@ gst_vaapi_plugin_copy_va_buffer (GstVaapiPluginBase * plugin,
   GstVideoMeta *vmeta;
   GstVideoFrame src_frame, dst_frame;
   gboolean success;
+  guint n_threads;
 
   if (!plugin->copy_output_frame)
     return TRUE;
@@ -1481,7 +1626,18 @@ gst_vaapi_plugin_copy_va_buffer (GstVaapiPluginBase * plugin,
     gst_video_frame_unmap (&src_frame);
     return FALSE;
   }
-  success = gst_video_frame_copy (&dst_frame, &src_frame);
+
+  n_threads = g_atomic_int_get (&plugin->copy_threads);
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  if (n_threads > 1 && ensure_copy_converter (plugin, n_threads)) {
+    gst_video_converter_frame (plugin->copy_converter, &src_frame,
+        &dst_frame);
+    success = TRUE;
+  } else {
+    success = gst_video_frame_copy (&dst_frame, &src_frame);
+  }
   gst_video_frame_unmap (&dst_frame);
   gst_video_frame_unmap (&src_frame);
 
@@ -29,7 +29,9 @@
 #include <gst/video/gstvideodecoder.h>
 #include <gst/video/gstvideoencoder.h>
 #include <gst/video/gstvideosink.h>
+#include <gst/video/gstvideoaggregator.h>
 #include <gst/vaapi/gstvaapidisplay.h>
+#include "gstvaapidmabufcache.h"
 
 G_BEGIN_DECLS
 
@@ -118,6 +120,7 @@ struct _GstVaapiPluginBase
     GstVideoEncoder encoder;
     GstBaseTransform transform;
     GstVideoSink sink;
+    GstVideoAggregator aggregator;
   } parent_instance;
 
   GstDebugCategory *debug_category;
@@ -150,9 +153,18 @@ struct _GstVaapiPluginBase
 
   gboolean enable_direct_rendering;
 
+  /* surfaces imported from upstream dma-bufs */
+  GstVaapiDmaBufCache *dmabuf_cache;
+
   GstAllocator *other_srcpad_allocator;
   GstAllocationParams other_allocator_params;
+  GstBufferPool *other_srcpad_buffer_pool;
   gboolean copy_output_frame;
+
+  /* number of threads copying frames to system memory, 0 for auto */
+  guint copy_threads;
+  GstVideoConverter *copy_converter;
+  guint copy_converter_threads;
 };
 
 struct _GstVaapiPluginBaseClass
@@ -165,6 +177,7 @@ struct _GstVaapiPluginBaseClass
     GstVideoEncoderClass encoder;
     GstBaseTransformClass transform;
     GstVideoSinkClass sink;
+    GstVideoAggregatorClass aggregator;
   } parent_class;
 
   gboolean  (*has_interface) (GstVaapiPluginBase * plugin, GType type);
@@ -263,6 +276,10 @@ void
 gst_vaapi_plugin_base_set_srcpad_can_dmabuf (GstVaapiPluginBase * plugin,
     GstObject * object);
 
+G_GNUC_INTERNAL
+GstBuffer *
+gst_vaapi_plugin_base_alloc_system_buffer (GstVaapiPluginBase * plugin);
+
 G_GNUC_INTERNAL
 gboolean
 gst_vaapi_plugin_copy_va_buffer (GstVaapiPluginBase * plugin,
@@ -39,6 +39,9 @@
 #if USE_WAYLAND
 # include <gst/vaapi/gstvaapidisplay_wayland.h>
 #endif
+#if USE_NULL
+# include <gst/vaapi/gstvaapidisplay_null.h>
+#endif
 #if USE_GST_GL_HELPERS
 # include <gst/gl/gl.h>
 #if USE_EGL && GST_GL_HAVE_PLATFORM_EGL
@@ -51,6 +54,9 @@
 /* Environment variable for disable driver white-list */
 #define GST_VAAPI_ALL_DRIVERS_ENV "GST_VAAPI_ALL_DRIVERS"
 
+/* Environment variable for forcing the software VA display */
+#define GST_VAAPI_NULL_DISPLAY_ENV "GST_VAAPI_USE_NULL_DISPLAY"
+
 typedef GstVaapiDisplay *(*GstVaapiDisplayCreateFunc) (const gchar *);
 typedef GstVaapiDisplay *(*GstVaapiDisplayCreateFromHandleFunc) (gpointer);
 
@@ -89,6 +95,11 @@ static const DisplayMap g_display_map[] = {
   {"drm",
    GST_VAAPI_DISPLAY_TYPE_DRM,
    gst_vaapi_display_drm_new},
+#endif
+#if USE_NULL
+  {"null",
+   GST_VAAPI_DISPLAY_TYPE_NULL,
+   gst_vaapi_display_null_new},
 #endif
   {NULL,}
 };
@@ -101,9 +112,21 @@ gst_vaapi_create_display (GstVaapiDisplayType display_type,
   GstVaapiDisplay *display = NULL;
   const DisplayMap *m;
 
+#if USE_NULL
+  if (display_type == GST_VAAPI_DISPLAY_TYPE_ANY &&
+      g_getenv (GST_VAAPI_NULL_DISPLAY_ENV))
+    display_type = GST_VAAPI_DISPLAY_TYPE_NULL;
+#endif
+
   for (m = g_display_map; m->type_str != NULL; m++) {
     if (display_type != GST_VAAPI_DISPLAY_TYPE_ANY && display_type != m->type)
       continue;
+#if USE_NULL
+    /* The software display is never picked by auto-detection */
+    if (m->type == GST_VAAPI_DISPLAY_TYPE_NULL &&
+        display_type == GST_VAAPI_DISPLAY_TYPE_ANY)
+      continue;
+#endif
 
     display = m->create_display (display_name);
     if (display || display_type != GST_VAAPI_DISPLAY_TYPE_ANY)
@@ -931,6 +954,11 @@ gst_vaapi_create_test_display (void)
 #endif
   };
 
+#if USE_NULL
+  if (g_getenv (GST_VAAPI_NULL_DISPLAY_ENV))
+    return gst_vaapi_create_display (GST_VAAPI_DISPLAY_TYPE_NULL, NULL);
+#endif
+
   for (i = 0; i < G_N_ELEMENTS (test_display_map); i++) {
     display = gst_vaapi_create_display (test_display_map[i], NULL);
     if (display)
@@ -954,6 +982,9 @@ gst_vaapi_driver_is_whitelisted (GstVaapiDisplay * display)
   guint i;
   static const gchar *whitelist[] = {
     "Intel i965 driver",
+#if USE_NULL
+    "GStreamer VA-API null driver",
+#endif
     NULL
   };
 
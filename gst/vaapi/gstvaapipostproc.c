@@ -131,6 +131,7 @@ enum
   PROP_SKIN_TONE_ENHANCEMENT,
 #endif
   PROP_SKIN_TONE_ENHANCEMENT_LEVEL,
+  PROP_COPY_THREADS,
 };
 
 #define GST_VAAPI_TYPE_DEINTERLACE_MODE \
@@ -412,9 +413,7 @@ create_output_dump_buffer (GstVaapiPostproc * postproc)
 {
   GstVaapiPluginBase *const plugin = GST_VAAPI_PLUGIN_BASE (postproc);
 
-  return gst_buffer_new_allocate (plugin->other_srcpad_allocator,
-      GST_VIDEO_INFO_SIZE (&plugin->srcpad_info),
-      &plugin->other_allocator_params);
+  return gst_vaapi_plugin_base_alloc_system_buffer (plugin);
 }
 
 static void
@@ -2018,6 +2017,10 @@ gst_vaapipostproc_set_property (GObject * object,
       postproc->crop_bottom = g_value_get_uint (value);
       postproc->flags |= GST_VAAPI_POSTPROC_FLAG_CROP;
       break;
+    case PROP_COPY_THREADS:
+      g_atomic_int_set (&GST_VAAPI_PLUGIN_BASE (postproc)->copy_threads,
+          g_value_get_uint (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2098,6 +2101,10 @@ gst_vaapipostproc_get_property (GObject * object,
     case PROP_CROP_BOTTOM:
       g_value_set_uint (value, postproc->crop_bottom);
       break;
+    case PROP_COPY_THREADS:
+      g_value_set_uint (value,
+          g_atomic_int_get (&GST_VAAPI_PLUGIN_BASE (postproc)->copy_threads));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2294,6 +2301,21 @@ gst_vaapipostproc_class_init (GstVaapiPostprocClass * klass)
           "When enabled, scaling will respect original aspect ratio",
           TRUE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstVaapiPostproc:copy-threads:
+   *
+   * Number of threads copying the output frames into system memory
+   * when downstream doesn't support GstVideoMeta. 0 uses one thread
+   * per processor.
+   */
+  g_object_class_install_property
+      (object_class,
+      PROP_COPY_THREADS,
+      g_param_spec_uint ("copy-threads",
+          "Copy threads",
+          "Threads copying frames to system memory (0 = auto)",
+          0, G_MAXINT, 1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstVaapiPostproc:denoise:
    *
@@ -0,0 +1,378 @@
+/*
+ *  bench-contention.c - Benchmark of many decode sessions on one display
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This benchmark decodes the same elementary stream from several
+ * threads, each with its own decoder, all sharing one VA display, and
+ * syncs every output surface as a sink or download would. It reports
+ * the aggregate throughput, so that display lock modes can be compared,
+ * e.g.:
+ *
+ *   bench-contention --sessions 16 --lock-mode global stream.264
+ *   bench-contention --sessions 16 --lock-mode context stream.264
+ *
+ * Only byte-stream formats (H.264, H.265, MPEG-2, MPEG-4, VC-1, JPEG)
+ * are supported.
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/base/gstadapter.h>
+#include <gst/vaapi/gstvaapidecoder.h>
+#include <gst/vaapi/gstvaapidecoder_h264.h>
+#include <gst/vaapi/gstvaapidecoder_h265.h>
+#include <gst/vaapi/gstvaapidecoder_jpeg.h>
+#include <gst/vaapi/gstvaapidecoder_mpeg2.h>
+#include <gst/vaapi/gstvaapidecoder_mpeg4.h>
+#include <gst/vaapi/gstvaapidecoder_vc1.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include "codec.h"
+#include "output.h"
+
+static gchar *g_codec_str;
+static gchar *g_lock_mode_str;
+static gint g_num_sessions = 16;
+static gint g_repeat = 1;
+
+static GOptionEntry g_options[] = {
+  {"codec", 'c',
+        0,
+        G_OPTION_ARG_STRING, &g_codec_str,
+      "suggested codec", NULL},
+  {"sessions", 's',
+        0,
+        G_OPTION_ARG_INT, &g_num_sessions,
+      "number of concurrent decode sessions", NULL},
+  {"lock-mode", 'l',
+        0,
+        G_OPTION_ARG_STRING, &g_lock_mode_str,
+      "display lock mode (global, context)", NULL},
+  {"repeat", 'r',
+        0,
+        G_OPTION_ARG_INT, &g_repeat,
+      "number of times each session decodes the stream", NULL},
+  {NULL,}
+};
+
+typedef struct
+{
+  GMutex mutex;
+  GCond cond;
+  gboolean started;
+} StartGate;
+
+typedef struct
+{
+  GstVaapiDisplay *display;
+  GstVaapiCodec codec;
+  GstBuffer *buffer;
+  StartGate *gate;
+  GThread *thread;
+  gboolean success;
+
+  /* statistics */
+  guint num_frames;
+  guint num_output_frames;
+  GstClockTime time;
+} Session;
+
+static GstVaapiDecoder *
+create_decoder (GstVaapiDisplay * display, GstVaapiCodec codec)
+{
+  GstVaapiDecoder *decoder = NULL;
+  GstCaps *caps;
+
+  caps = caps_from_codec (codec);
+  if (!caps)
+    return NULL;
+
+  switch (codec) {
+    case GST_VAAPI_CODEC_H264:
+      decoder = gst_vaapi_decoder_h264_new (display, caps);
+      break;
+    case GST_VAAPI_CODEC_H265:
+      decoder = gst_vaapi_decoder_h265_new (display, caps);
+      break;
+    case GST_VAAPI_CODEC_JPEG:
+      decoder = gst_vaapi_decoder_jpeg_new (display, caps);
+      break;
+    case GST_VAAPI_CODEC_MPEG2:
+      decoder = gst_vaapi_decoder_mpeg2_new (display, caps);
+      break;
+    case GST_VAAPI_CODEC_MPEG4:
+      decoder = gst_vaapi_decoder_mpeg4_new (display, caps);
+      break;
+    case GST_VAAPI_CODEC_VC1:
+      decoder = gst_vaapi_decoder_vc1_new (display, caps);
+      break;
+    default:
+      break;
+  }
+  gst_caps_unref (caps);
+  return decoder;
+}
+
+/* Syncs and releases all decoded frames, so that surfaces go back to
+   the pool */
+static void
+drain_output (Session * session, GstVaapiDecoder * decoder)
+{
+  GstVideoCodecFrame *out_frame;
+  GstVaapiSurfaceProxy *proxy;
+
+  while (gst_vaapi_decoder_get_frame_with_timeout (decoder, &out_frame,
+          0) == GST_VAAPI_DECODER_STATUS_SUCCESS) {
+    if (!GST_VIDEO_CODEC_FRAME_IS_DECODE_ONLY (out_frame)) {
+      proxy = gst_video_codec_frame_get_user_data (out_frame);
+      if (proxy)
+        gst_vaapi_surface_sync (gst_vaapi_surface_proxy_get_surface (proxy));
+      session->num_output_frames++;
+    }
+    gst_video_codec_frame_unref (out_frame);
+  }
+}
+
+static gboolean
+session_decode (Session * session, GstVaapiDecoder * decoder,
+    GstAdapter * input_adapter, GstAdapter * output_adapter)
+{
+  GstVideoCodecFrame *frame = NULL;
+  GstVaapiDecoderStatus status;
+  guint got_unit_size, frame_number = 0;
+  gboolean got_frame, success = FALSE;
+
+  /* At <EOS>, parse once more with an empty adapter to flush out the
+   * last frame */
+  while (gst_adapter_available (input_adapter) > 0 || frame) {
+    if (!frame) {
+      frame = g_slice_new0 (GstVideoCodecFrame);
+      frame->ref_count = 1;
+      frame->system_frame_number = frame_number++;
+    }
+
+    status = gst_vaapi_decoder_parse (decoder, frame, input_adapter, TRUE,
+        &got_unit_size, &got_frame);
+    if (status == GST_VAAPI_DECODER_STATUS_SUCCESS && got_unit_size > 0)
+      gst_adapter_push (output_adapter,
+          gst_adapter_take_buffer (input_adapter, got_unit_size));
+    if (status == GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA)
+      break;
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS) {
+      g_message ("parse error %d", status);
+      goto cleanup;
+    }
+    if (!got_frame)
+      continue;
+
+    frame->input_buffer = gst_adapter_take_buffer (output_adapter,
+        gst_adapter_available (output_adapter));
+    status = gst_vaapi_decoder_decode (decoder, frame);
+    gst_video_codec_frame_unref (frame);
+    frame = NULL;
+    drain_output (session, decoder);
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS) {
+      g_message ("decode error %d", status);
+      goto cleanup;
+    }
+    session->num_frames++;
+  }
+
+  gst_vaapi_decoder_flush (decoder);
+  drain_output (session, decoder);
+  success = TRUE;
+
+cleanup:
+  if (frame)
+    gst_video_codec_frame_unref (frame);
+  return success;
+}
+
+static gpointer
+session_run (gpointer data)
+{
+  Session *const session = data;
+  StartGate *const gate = session->gate;
+  GstVaapiDecoder *decoder;
+  GstAdapter *input_adapter, *output_adapter;
+  GstClockTime start;
+  gint i;
+
+  decoder = create_decoder (session->display, session->codec);
+  input_adapter = gst_adapter_new ();
+  output_adapter = gst_adapter_new ();
+
+  g_mutex_lock (&gate->mutex);
+  while (!gate->started)
+    g_cond_wait (&gate->cond, &gate->mutex);
+  g_mutex_unlock (&gate->mutex);
+
+  if (!decoder) {
+    g_message ("failed to create %s decoder",
+        string_from_codec (session->codec));
+    goto cleanup;
+  }
+
+  /* Data is only referenced, the adapter never copies it */
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < g_repeat; i++)
+    gst_adapter_push (input_adapter, gst_buffer_ref (session->buffer));
+  session->success = session_decode (session, decoder, input_adapter,
+      output_adapter);
+  session->time = gst_util_get_timestamp () - start;
+
+cleanup:
+  g_object_unref (input_adapter);
+  g_object_unref (output_adapter);
+  gst_vaapi_decoder_replace (&decoder, NULL);
+  return NULL;
+}
+
+static gboolean
+parse_lock_mode (const gchar * str, GstVaapiDisplayLockMode * mode_ptr)
+{
+  if (!str || g_ascii_strcasecmp (str, "global") == 0)
+    *mode_ptr = GST_VAAPI_DISPLAY_LOCK_MODE_GLOBAL;
+  else if (g_ascii_strcasecmp (str, "context") == 0)
+    *mode_ptr = GST_VAAPI_DISPLAY_LOCK_MODE_CONTEXT;
+  else
+    return FALSE;
+  return TRUE;
+}
+
+static void
+print_results (Session * sessions, guint num_sessions, GstClockTime time)
+{
+  GstClockTime min_time = GST_CLOCK_TIME_NONE, max_time = 0;
+  guint i, num_frames = 0, num_output_frames = 0;
+
+  for (i = 0; i < num_sessions; i++) {
+    num_frames += sessions[i].num_frames;
+    num_output_frames += sessions[i].num_output_frames;
+    min_time = MIN (min_time, sessions[i].time);
+    max_time = MAX (max_time, sessions[i].time);
+  }
+
+  g_print ("Sessions: %u\n", num_sessions);
+  g_print ("Frames: %u decoded, %u output\n", num_frames, num_output_frames);
+  g_print ("Wall time: %" GST_TIME_FORMAT "\n", GST_TIME_ARGS (time));
+  g_print ("Throughput: %.1f fps total, %.1f fps/session\n",
+      time > 0 ? (gdouble) num_frames * GST_SECOND / time : 0.0,
+      time > 0 ? (gdouble) num_frames * GST_SECOND / time / num_sessions :
+      0.0);
+  g_print ("Session time: %" GST_TIME_FORMAT " min, %" GST_TIME_FORMAT
+      " max\n", GST_TIME_ARGS (min_time), GST_TIME_ARGS (max_time));
+}
+
+int
+main (int argc, char *argv[])
+{
+  GstVaapiDisplay *display = NULL;
+  GstVaapiDisplayLockMode lock_mode;
+  GstVaapiCodec codec;
+  GMappedFile *file = NULL;
+  GstBuffer *buffer = NULL;
+  Session *sessions = NULL;
+  StartGate gate;
+  GstClockTime start;
+  gboolean success = FALSE;
+  gint i;
+
+  if (!video_output_init (&argc, argv, g_options))
+    g_error ("failed to initialize video output subsystem");
+
+  g_mutex_init (&gate.mutex);
+  g_cond_init (&gate.cond);
+  gate.started = FALSE;
+
+  if (argc < 2) {
+    g_message ("no bitstream file specified");
+    goto cleanup;
+  }
+  if (g_num_sessions < 1)
+    g_num_sessions = 1;
+  if (g_repeat < 1)
+    g_repeat = 1;
+  if (!parse_lock_mode (g_lock_mode_str, &lock_mode)) {
+    g_message ("invalid lock mode '%s'", g_lock_mode_str);
+    goto cleanup;
+  }
+
+  file = g_mapped_file_new (argv[1], FALSE, NULL);
+  if (!file) {
+    g_message ("failed to open file '%s'", argv[1]);
+    goto cleanup;
+  }
+  buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      g_mapped_file_get_contents (file), g_mapped_file_get_length (file), 0,
+      g_mapped_file_get_length (file), g_mapped_file_ref (file),
+      (GDestroyNotify) g_mapped_file_unref);
+
+  codec = identify_codec (argv[1]);
+  if (!codec)
+    codec = identify_codec_from_string (g_codec_str);
+  if (!codec) {
+    g_message ("failed to identify codec for '%s'", argv[1]);
+    goto cleanup;
+  }
+
+  display = video_output_create_display (NULL);
+  if (!display) {
+    g_message ("failed to create VA display");
+    goto cleanup;
+  }
+  gst_vaapi_display_set_lock_mode (display, lock_mode);
+
+  sessions = g_new0 (Session, g_num_sessions);
+  for (i = 0; i < g_num_sessions; i++) {
+    Session *const session = &sessions[i];
+
+    session->display = display;
+    session->codec = codec;
+    session->buffer = buffer;
+    session->gate = &gate;
+    session->thread = g_thread_new ("session", session_run, session);
+  }
+
+  g_mutex_lock (&gate.mutex);
+  start = gst_util_get_timestamp ();
+  gate.started = TRUE;
+  g_cond_broadcast (&gate.cond);
+  g_mutex_unlock (&gate.mutex);
+
+  success = TRUE;
+  for (i = 0; i < g_num_sessions; i++) {
+    g_thread_join (sessions[i].thread);
+    success &= sessions[i].success;
+  }
+  g_print ("Lock mode: %s\n",
+      lock_mode == GST_VAAPI_DISPLAY_LOCK_MODE_CONTEXT ? "context" : "global");
+  print_results (sessions, g_num_sessions, gst_util_get_timestamp () - start);
+
+cleanup:
+  g_free (sessions);
+  gst_buffer_replace (&buffer, NULL);
+  if (file)
+    g_mapped_file_unref (file);
+  gst_object_replace ((GstObject **) & display, NULL);
+  g_mutex_clear (&gate.mutex);
+  g_cond_clear (&gate.cond);
+  g_free (g_codec_str);
+  g_free (g_lock_mode_str);
+  video_output_exit ();
+  return !success;
+}
@@ -0,0 +1,154 @@
+/*
+ *  bench-copy.c - CPU benchmark of the plane copy kernels
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Copies an NV12 frame with every plane copy kernel the CPU supports,
+ * checks the result against the scalar kernel, and reports the
+ * throughput of each one. This only uses regular cached memory, so
+ * the gain of streaming loads on write-combined memory does not show
+ * up here; it measures the per-line overhead of each kernel.
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include "gst/vaapi/gstvaapiutils_copy.h"
+
+static gint g_width = 3840;
+static gint g_height = 2160;
+static gint g_iterations = 200;
+
+static GOptionEntry g_options[] = {
+  {"width", 'w',
+        0,
+        G_OPTION_ARG_INT, &g_width,
+      "frame width", NULL},
+  {"height", 'h',
+        0,
+        G_OPTION_ARG_INT, &g_height,
+      "frame height", NULL},
+  {"iterations", 'n',
+        0,
+        G_OPTION_ARG_INT, &g_iterations,
+      "number of frame copies per kernel", NULL},
+  {NULL,}
+};
+
+typedef struct
+{
+  guint8 *data;
+  guint stride;
+  guint size;
+} Plane;
+
+static void
+plane_init (Plane * plane, guint stride, guint height, guint offset)
+{
+  /* Odd offsets exercise the unaligned head and tail paths */
+  plane->stride = stride;
+  plane->size = stride * height;
+  plane->data = g_malloc (plane->size + offset + 64);
+  plane->data += offset;
+}
+
+static void
+copy_frame (GstVaapiCopyPlaneFunc func, Plane * dst, const Plane * src,
+    guint width, guint height)
+{
+  /* Y plane, then interleaved UV plane */
+  func (dst->data, dst->stride, src->data, src->stride, width, height);
+  func (dst->data + dst->stride * height, dst->stride,
+      src->data + src->stride * height, src->stride, width, height / 2);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx;
+  Plane src, dst, ref;
+  guint i, k, y, src_stride, dst_stride;
+  guint8 *src_data, *dst_data, *ref_data;
+  GstVaapiCopyPlaneFunc func;
+  gint ret = 0;
+
+  ctx = g_option_context_new ("- plane copy benchmark");
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  g_option_context_add_main_entries (ctx, g_options, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, NULL))
+    g_error ("failed to parse options");
+  g_option_context_free (ctx);
+
+  if (g_width < 2 || g_height < 2 || g_iterations < 1)
+    g_error ("invalid frame size or iteration count");
+
+  src_stride = GST_ROUND_UP_64 (g_width);
+  dst_stride = GST_ROUND_UP_32 (g_width);
+  plane_init (&src, src_stride, g_height * 3 / 2, 0);
+  plane_init (&dst, dst_stride, g_height * 3 / 2, 3);
+  plane_init (&ref, dst_stride, g_height * 3 / 2, 3);
+  src_data = src.data;
+  dst_data = dst.data - 3;
+  ref_data = ref.data - 3;
+
+  for (i = 0; i < src.size; i++)
+    src.data[i] = g_random_int ();
+  memset (ref.data, 0, ref.size);
+  copy_frame (gst_vaapi_copy_kernel_get_func (GST_VAAPI_COPY_KERNEL_SCALAR),
+      &ref, &src, g_width, g_height);
+
+  g_print ("Copying %dx%d NV12 frames, %d iterations (default kernel: %s)\n",
+      g_width, g_height, g_iterations,
+      gst_vaapi_copy_kernel_get_name (gst_vaapi_copy_get_default_kernel ()));
+
+  for (k = 0; k < GST_VAAPI_COPY_KERNEL_COUNT; k++) {
+    const gchar *const name = gst_vaapi_copy_kernel_get_name (k);
+    gint64 start, elapsed;
+    gdouble bytes;
+
+    func = gst_vaapi_copy_kernel_get_func (k);
+    if (!func) {
+      g_print ("%-8s not supported\n", name);
+      continue;
+    }
+
+    memset (dst.data, 0, dst.size);
+    copy_frame (func, &dst, &src, g_width, g_height);
+    for (y = 0; y < (guint) g_height * 3 / 2; y++) {
+      if (memcmp (dst.data + y * dst_stride, ref.data + y * dst_stride,
+              g_width) != 0) {
+        g_print ("%-8s MISMATCH at line %u\n", name, y);
+        ret = 1;
+        break;
+      }
+    }
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < (guint) g_iterations; i++)
+      copy_frame (func, &dst, &src, g_width, g_height);
+    elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+    bytes = (gdouble) g_width * g_height * 3 / 2 * g_iterations;
+    g_print ("%-8s %8.1f us/frame %8.2f GB/s\n", name,
+        (gdouble) elapsed / g_iterations, bytes / elapsed / 1000.0);
+  }
+
+  g_free (src_data);
+  g_free (dst_data);
+  g_free (ref_data);
+  gst_deinit ();
+  return ret;
+}
@@ -0,0 +1,656 @@
+/*
+ *  bench-decode.c - CPU benchmark of the decoder front-ends
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This benchmark feeds an elementary stream through
+ * gst_vaapi_decoder_parse() and gst_vaapi_decoder_decode(), the same
+ * way vaapidecode does, and reports the CPU cost of each stage. Run it
+ * with "--output null" so that the numbers are not dominated by the
+ * hardware, e.g.:
+ *
+ *   bench-decode --output null --repeat 10 stream.264
+ *
+ * Byte-stream formats (H.264, H.265, MPEG-2, MPEG-4, VC-1, JPEG) are
+ * fed as one contiguous stream. VP8 and VP9 are read from IVF files
+ * and fed one frame at a time.
+ *
+ * The "Output latency" line reports how many frames were decoded after
+ * a frame until it was output; compare the H.264 and H.265 numbers
+ * with and without "--low-latency".
+ *
+ * With "--check-subframe", an H.264 or H.265 stream is decoded a second
+ * time with sub-frame decoding, which must output the same pictures.
+ * Run it on multi-slice streams, so that slices are submitted before
+ * the end of their frame is parsed.
+ *
+ * With "--keyframe-interval", only one keyframe out of that many is
+ * decoded. Each output frame must then hold both of its fields, so run
+ * it on field coded H.264 or MPEG-2 streams too.
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/base/gstadapter.h>
+#include <gst/vaapi/gstvaapidecoder.h>
+#include <gst/vaapi/gstvaapidecoder_h264.h>
+#include <gst/vaapi/gstvaapidecoder_h265.h>
+#include <gst/vaapi/gstvaapidecoder_jpeg.h>
+#include <gst/vaapi/gstvaapidecoder_mpeg2.h>
+#include <gst/vaapi/gstvaapidecoder_mpeg4.h>
+#include <gst/vaapi/gstvaapidecoder_vc1.h>
+#include <gst/vaapi/gstvaapidecoder_vp8.h>
+#include <gst/vaapi/gstvaapidecoder_vp9.h>
+#include "codec.h"
+#include "output.h"
+
+/* Count heap allocations by interposing the glibc allocator */
+#if defined (__GLIBC__)
+#define HAVE_ALLOC_COUNTER 1
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static guint64 g_num_allocs;
+
+void *
+malloc (size_t size)
+{
+  __atomic_add_fetch (&g_num_allocs, 1, __ATOMIC_RELAXED);
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+  __atomic_add_fetch (&g_num_allocs, 1, __ATOMIC_RELAXED);
+  return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  __atomic_add_fetch (&g_num_allocs, 1, __ATOMIC_RELAXED);
+  return __libc_realloc (ptr, size);
+}
+
+static inline guint64
+get_num_allocs (void)
+{
+  return __atomic_load_n (&g_num_allocs, __ATOMIC_RELAXED);
+}
+#else
+static inline guint64
+get_num_allocs (void)
+{
+  return 0;
+}
+#endif
+
+static gchar *g_codec_str;
+static gint g_repeat = 1;
+static gboolean g_low_latency = FALSE;
+static gboolean g_subframe_decode = FALSE;
+static gint g_keyframe_interval = 0;
+static gboolean g_check_subframe = FALSE;
+
+static GOptionEntry g_options[] = {
+  {"codec", 'c',
+        0,
+        G_OPTION_ARG_STRING, &g_codec_str,
+      "suggested codec", NULL},
+  {"repeat", 'r',
+        0,
+        G_OPTION_ARG_INT, &g_repeat,
+      "number of times the stream is decoded", NULL},
+  {"low-latency", 'l',
+        0,
+        G_OPTION_ARG_NONE, &g_low_latency,
+      "enable the H.264/H.265 low-latency output mode", NULL},
+  {"subframe-decode", 0,
+        0,
+        G_OPTION_ARG_NONE, &g_subframe_decode,
+      "submit H.264/H.265 slices as soon as they are parsed", NULL},
+  {"keyframe-interval", 'k',
+        0,
+        G_OPTION_ARG_INT, &g_keyframe_interval,
+      "decode one keyframe out of every N, and check they are complete", NULL},
+  {"check-subframe", 0,
+        0,
+        G_OPTION_ARG_NONE, &g_check_subframe,
+      "decode again with sub-frame decoding, and compare the output", NULL},
+  {NULL,}
+};
+
+typedef struct
+{
+  GstVaapiDecoder *decoder;
+  GstAdapter *input_adapter;
+  GstAdapter *output_adapter;
+  GstVideoCodecFrame *frame;
+  guint frame_number;
+
+  /* statistics */
+  guint num_frames;
+  guint num_output_frames;
+  guint num_popped_frames;
+  guint num_onefield_frames;
+  GArray *checksums;
+  guint64 num_bytes;
+  GstClockTime parse_time;
+  GstClockTime decode_time;
+  guint64 parse_allocs;
+  guint64 decode_allocs;
+} Bench;
+
+static GstVaapiDecoder *
+create_decoder (GstVaapiDisplay * display, GstVaapiCodec codec)
+{
+  GstVaapiDecoder *decoder = NULL;
+  GstCaps *caps;
+
+  caps = caps_from_codec (codec);
+  if (!caps)
+    return NULL;
+
+  switch (codec) {
+    case GST_VAAPI_CODEC_H264:
+      decoder = gst_vaapi_decoder_h264_new (display, caps);
+      if (decoder)
+        gst_vaapi_decoder_h264_set_low_latency (GST_VAAPI_DECODER_H264
+            (decoder), g_low_latency);
+      if (decoder && g_subframe_decode)
+        gst_vaapi_decoder_set_subframe_decode (decoder, TRUE);
+      break;
+    case GST_VAAPI_CODEC_H265:
+      decoder = gst_vaapi_decoder_h265_new (display, caps);
+      if (decoder)
+        gst_vaapi_decoder_h265_set_low_latency (GST_VAAPI_DECODER_H265
+            (decoder), g_low_latency);
+      if (decoder && g_subframe_decode)
+        gst_vaapi_decoder_set_subframe_decode (decoder, TRUE);
+      break;
+    case GST_VAAPI_CODEC_JPEG:
+      decoder = gst_vaapi_decoder_jpeg_new (display, caps);
+      break;
+    case GST_VAAPI_CODEC_MPEG2:
+      decoder = gst_vaapi_decoder_mpeg2_new (display, caps);
+      break;
+    case GST_VAAPI_CODEC_MPEG4:
+      decoder = gst_vaapi_decoder_mpeg4_new (display, caps);
+      break;
+    case GST_VAAPI_CODEC_VC1:
+      decoder = gst_vaapi_decoder_vc1_new (display, caps);
+      break;
+    case GST_VAAPI_CODEC_VP8:
+      decoder = gst_vaapi_decoder_vp8_new (display, caps);
+      break;
+    case GST_VAAPI_CODEC_VP9:
+      decoder = gst_vaapi_decoder_vp9_new (display, caps);
+      break;
+    default:
+      break;
+  }
+  gst_caps_unref (caps);
+  return decoder;
+}
+
+/* Hashes the luma plane of the decoded surface */
+static guint32
+get_checksum (GstVaapiSurfaceProxy * proxy)
+{
+  GstVaapiSurface *const surface = gst_vaapi_surface_proxy_get_surface (proxy);
+  GstVaapiImage *image;
+  const guint8 *plane;
+  guint32 hash = 2166136261U;
+  guint x, y, width, height, pitch;
+
+  if (!gst_vaapi_surface_sync (surface))
+    return 0;
+  image = gst_vaapi_surface_derive_image (surface);
+  if (!image)
+    return 0;
+
+  if (gst_vaapi_image_map (image)) {
+    gst_vaapi_image_get_size (image, &width, &height);
+    plane = gst_vaapi_image_get_plane (image, 0);
+    pitch = gst_vaapi_image_get_pitch (image, 0);
+    for (y = 0; y < height; y++) {
+      for (x = 0; x < width; x++)
+        hash = (hash ^ plane[y * pitch + x]) * 16777619U;
+    }
+    gst_vaapi_image_unmap (image);
+  }
+  gst_vaapi_object_unref (image);
+  return hash;
+}
+
+/* Releases all decoded frames, so that surfaces go back to the pool */
+static void
+drain_output (Bench * bench)
+{
+  GstVideoCodecFrame *out_frame;
+  GstVaapiSurfaceProxy *proxy;
+
+  while (gst_vaapi_decoder_get_frame_with_timeout (bench->decoder,
+          &out_frame, 0) == GST_VAAPI_DECODER_STATUS_SUCCESS) {
+    bench->num_popped_frames++;
+    if (!GST_VIDEO_CODEC_FRAME_IS_DECODE_ONLY (out_frame)) {
+      proxy = gst_video_codec_frame_get_user_data (out_frame);
+      if (proxy && (gst_vaapi_surface_proxy_get_flags (proxy) &
+              GST_VAAPI_SURFACE_PROXY_FLAG_ONEFIELD))
+        bench->num_onefield_frames++;
+      if (proxy && bench->checksums) {
+        const guint32 checksum = get_checksum (proxy);
+        g_array_append_val (bench->checksums, checksum);
+      }
+      bench->num_output_frames++;
+    }
+    gst_video_codec_frame_unref (out_frame);
+  }
+}
+
+/* Parses and decodes everything available in the input adapter */
+static gboolean
+bench_run_adapter (Bench * bench, gboolean at_eos)
+{
+  GstVaapiDecoderStatus status;
+  GstClockTime start;
+  guint64 allocs;
+  guint got_unit_size;
+  gboolean got_frame;
+
+  /* At <EOS>, parse once more with an empty adapter to flush out the
+   * last frame */
+  while (gst_adapter_available (bench->input_adapter) > 0 ||
+      (at_eos && bench->frame)) {
+    if (!bench->frame) {
+      bench->frame = g_slice_new0 (GstVideoCodecFrame);
+      bench->frame->ref_count = 1;
+      bench->frame->system_frame_number = bench->frame_number++;
+    }
+
+    allocs = get_num_allocs ();
+    start = gst_util_get_timestamp ();
+    status = gst_vaapi_decoder_parse (bench->decoder, bench->frame,
+        bench->input_adapter, at_eos, &got_unit_size, &got_frame);
+    if (status == GST_VAAPI_DECODER_STATUS_SUCCESS && got_unit_size > 0) {
+      gst_adapter_push (bench->output_adapter,
+          gst_adapter_take_buffer (bench->input_adapter, got_unit_size));
+      bench->num_bytes += got_unit_size;
+    }
+    bench->parse_time += gst_util_get_timestamp () - start;
+    bench->parse_allocs += get_num_allocs () - allocs;
+
+    if (status == GST_VAAPI_DECODER_STATUS_ERROR_NO_DATA)
+      break;
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS) {
+      g_message ("parse error %d", status);
+      return FALSE;
+    }
+    if (!got_frame)
+      continue;
+
+    allocs = get_num_allocs ();
+    start = gst_util_get_timestamp ();
+    bench->frame->input_buffer =
+        gst_adapter_take_buffer (bench->output_adapter,
+        gst_adapter_available (bench->output_adapter));
+    status = gst_vaapi_decoder_decode (bench->decoder, bench->frame);
+    gst_video_codec_frame_unref (bench->frame);
+    bench->frame = NULL;
+    drain_output (bench);
+    bench->decode_time += gst_util_get_timestamp () - start;
+    bench->decode_allocs += get_num_allocs () - allocs;
+
+    if (status != GST_VAAPI_DECODER_STATUS_SUCCESS) {
+      g_message ("decode error %d", status);
+      return FALSE;
+    }
+    bench->num_frames++;
+  }
+  return TRUE;
+}
+
+static gboolean
+bench_run_stream (Bench * bench, GstBuffer * buffer)
+{
+  gint i;
+
+  /* Data is only referenced, the adapter never copies it */
+  for (i = 0; i < g_repeat; i++)
+    gst_adapter_push (bench->input_adapter, gst_buffer_ref (buffer));
+  return bench_run_adapter (bench, TRUE);
+}
+
+#define IVF_FILE_HEADER_SIZE  32
+#define IVF_FRAME_HEADER_SIZE 12
+
+static gboolean
+bench_run_ivf (Bench * bench, GstBuffer * buffer)
+{
+  GstMapInfo map;
+  gsize offset, frame_size;
+  gboolean success = TRUE;
+  gint i;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return FALSE;
+
+  for (i = 0; i < g_repeat && success; i++) {
+    offset = GST_READ_UINT16_LE (map.data + 6);
+    while (success && offset + IVF_FRAME_HEADER_SIZE <= map.size) {
+      frame_size = GST_READ_UINT32_LE (map.data + offset);
+      offset += IVF_FRAME_HEADER_SIZE;
+      if (offset + frame_size > map.size)
+        break;
+
+      gst_adapter_push (bench->input_adapter,
+          gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, offset,
+              frame_size));
+      success = bench_run_adapter (bench, TRUE);
+      offset += frame_size;
+    }
+  }
+  gst_buffer_unmap (buffer, &map);
+  return success;
+}
+
+static GstVaapiCodec
+identify_ivf_codec (GstBuffer * buffer)
+{
+  GstVaapiCodec codec = 0;
+  GstMapInfo map;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return 0;
+
+  if (map.size >= IVF_FILE_HEADER_SIZE &&
+      memcmp (map.data, "DKIF", 4) == 0) {
+    if (memcmp (map.data + 8, "VP80", 4) == 0)
+      codec = GST_VAAPI_CODEC_VP8;
+    else if (memcmp (map.data + 8, "VP90", 4) == 0)
+      codec = GST_VAAPI_CODEC_VP9;
+  }
+  gst_buffer_unmap (buffer, &map);
+  return codec;
+}
+
+static void
+print_percentiles (const GstStructure * stats, const gchar * label,
+    const gchar * name)
+{
+  guint64 p50 = 0, p99 = 0, max = 0;
+  gchar *field;
+
+  field = g_strdup_printf ("%s-p50", name);
+  gst_structure_get_uint64 (stats, field, &p50);
+  g_free (field);
+  field = g_strdup_printf ("%s-p99", name);
+  gst_structure_get_uint64 (stats, field, &p99);
+  g_free (field);
+  field = g_strdup_printf ("%s-max", name);
+  gst_structure_get_uint64 (stats, field, &max);
+  g_free (field);
+
+  g_print ("%s: p50 %" G_GUINT64_FORMAT ", p99 %" G_GUINT64_FORMAT
+      ", max %" G_GUINT64_FORMAT "\n", label, p50, p99, max);
+}
+
+static void
+print_results (Bench * bench, GstVaapiCodec codec)
+{
+  const guint n = MAX (bench->num_frames, 1);
+  const GstClockTime total_time = bench->parse_time + bench->decode_time;
+  GstStructure *object_stats, *decoder_stats;
+  guint64 object_allocs = 0, object_heap_allocs = 0;
+
+  g_print ("Codec: %s\n", string_from_codec (codec));
+  g_print ("Frames: %u decoded, %u output\n", bench->num_frames,
+      bench->num_output_frames);
+  g_print ("Parse: %" G_GUINT64_FORMAT " ns/frame",
+      bench->parse_time / n);
+#if HAVE_ALLOC_COUNTER
+  g_print (", %.1f allocs/frame", (gdouble) bench->parse_allocs / n);
+#endif
+  g_print ("\n");
+  g_print ("Decode: %" G_GUINT64_FORMAT " ns/frame",
+      bench->decode_time / n);
+#if HAVE_ALLOC_COUNTER
+  g_print (", %.1f allocs/frame", (gdouble) bench->decode_allocs / n);
+#endif
+  g_print ("\n");
+  g_print ("Total: %" G_GUINT64_FORMAT " ns/frame (%.1f fps)\n",
+      total_time / n, total_time > 0 ?
+      (gdouble) bench->num_frames * GST_SECOND / total_time : 0.0);
+  if (bench->parse_time > 0)
+    g_print ("Scan throughput: %.1f MiB/s\n",
+        (gdouble) bench->num_bytes * GST_SECOND / bench->parse_time /
+        (1024 * 1024));
+
+  object_stats = gst_vaapi_decoder_get_object_stats (bench->decoder);
+  if (object_stats) {
+    gst_structure_get_uint64 (object_stats, "object-allocs", &object_allocs);
+    gst_structure_get_uint64 (object_stats, "object-heap-allocs",
+        &object_heap_allocs);
+    g_print ("Objects: %.1f allocs/frame, %.1f heap allocs/frame\n",
+        (gdouble) object_allocs / n, (gdouble) object_heap_allocs / n);
+    gst_structure_free (object_stats);
+  }
+
+  decoder_stats = gst_vaapi_decoder_get_stats (bench->decoder);
+  if (decoder_stats) {
+    print_percentiles (decoder_stats, "Submit", "submit-time");
+    print_percentiles (decoder_stats, "End picture", "end-picture-time");
+    print_percentiles (decoder_stats, "DPB occupancy", "dpb-occupancy");
+    print_percentiles (decoder_stats, "Output latency", "output-latency");
+    gst_structure_free (decoder_stats);
+  }
+}
+
+/* Every frame handed out by the decoder, decode-only ones included,
+ * must have been accounted for in the object arena */
+static gboolean
+check_object_stats (Bench * bench)
+{
+  GstStructure *object_stats;
+  guint64 frames = 0;
+  guint last_frame_heap_allocs = 0;
+
+  object_stats = gst_vaapi_decoder_get_object_stats (bench->decoder);
+  if (!object_stats)
+    return FALSE;
+  gst_structure_get_uint64 (object_stats, "frames", &frames);
+  gst_structure_get_uint (object_stats, "object-heap-allocs-last-frame",
+      &last_frame_heap_allocs);
+  gst_structure_free (object_stats);
+
+  g_print ("Object frames: %" G_GUINT64_FORMAT ", %u heap allocs for the "
+      "last frame\n", frames, last_frame_heap_allocs);
+  if (frames != bench->num_popped_frames) {
+    g_message ("object arena counted %" G_GUINT64_FORMAT " frames, "
+        "%u were output", frames, bench->num_popped_frames);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* In keyframe mode, a field pair is decoded as a whole or not at all */
+static gboolean
+check_keyframes (Bench * bench)
+{
+  g_print ("Keyframes: %u output, %u with a single field\n",
+      bench->num_output_frames, bench->num_onefield_frames);
+  if (bench->num_output_frames == 0) {
+    g_message ("no keyframe was output");
+    return FALSE;
+  }
+  if (bench->num_onefield_frames > 0) {
+    g_message ("%u keyframes miss a field", bench->num_onefield_frames);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* Decodes the stream once more with sub-frame decoding, which must
+ * output the same pictures as the whole frame decoding of @bench */
+static gboolean
+check_subframe (Bench * bench, GstVaapiDisplay * display,
+    GstVaapiCodec codec, GstBuffer * buffer)
+{
+  Bench sub = { NULL, };
+  gboolean success = FALSE;
+  guint i;
+
+  sub.decoder = create_decoder (display, codec);
+  if (!sub.decoder ||
+      !gst_vaapi_decoder_set_subframe_decode (sub.decoder, TRUE)) {
+    g_message ("%s decoder has no sub-frame decoding",
+        string_from_codec (codec));
+    goto cleanup;
+  }
+  sub.input_adapter = gst_adapter_new ();
+  sub.output_adapter = gst_adapter_new ();
+  sub.checksums = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  if (!bench_run_stream (&sub, buffer))
+    goto cleanup;
+  gst_vaapi_decoder_flush (sub.decoder);
+  drain_output (&sub);
+
+  g_print ("Sub-frame decoding: %u frames output, %u expected\n",
+      sub.checksums->len, bench->checksums->len);
+  if (sub.checksums->len != bench->checksums->len)
+    goto cleanup;
+  for (i = 0; i < sub.checksums->len; i++) {
+    if (g_array_index (sub.checksums, guint32, i) !=
+        g_array_index (bench->checksums, guint32, i)) {
+      g_message ("output frame %u differs with sub-frame decoding", i);
+      goto cleanup;
+    }
+  }
+  success = TRUE;
+
+cleanup:
+  if (sub.frame)
+    gst_video_codec_frame_unref (sub.frame);
+  g_clear_object (&sub.input_adapter);
+  g_clear_object (&sub.output_adapter);
+  gst_vaapi_decoder_replace (&sub.decoder, NULL);
+  if (sub.checksums)
+    g_array_unref (sub.checksums);
+  return success;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GstVaapiDisplay *display = NULL;
+  GstVaapiCodec codec;
+  GMappedFile *file = NULL;
+  GstBuffer *buffer = NULL;
+  Bench bench = { NULL, };
+  gboolean success = FALSE;
+
+  if (!video_output_init (&argc, argv, g_options))
+    g_error ("failed to initialize video output subsystem");
+
+  if (argc < 2) {
+    g_message ("no bitstream file specified");
+    goto cleanup;
+  }
+  if (g_repeat < 1)
+    g_repeat = 1;
+
+  file = g_mapped_file_new (argv[1], FALSE, NULL);
+  if (!file) {
+    g_message ("failed to open file '%s'", argv[1]);
+    goto cleanup;
+  }
+  buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      g_mapped_file_get_contents (file), g_mapped_file_get_length (file), 0,
+      g_mapped_file_get_length (file), g_mapped_file_ref (file),
+      (GDestroyNotify) g_mapped_file_unref);
+
+  codec = identify_ivf_codec (buffer);
+  if (!codec)
+    codec = identify_codec (argv[1]);
+  if (!codec)
+    codec = identify_codec_from_string (g_codec_str);
+  if (!codec) {
+    g_message ("failed to identify codec for '%s'", argv[1]);
+    goto cleanup;
+  }
+
+  display = video_output_create_display (NULL);
+  if (!display) {
+    g_message ("failed to create VA display");
+    goto cleanup;
+  }
+
+  /* The reference output is decoded a whole frame at a time */
+  if (g_check_subframe)
+    g_subframe_decode = FALSE;
+  bench.decoder = create_decoder (display, codec);
+  if (!bench.decoder) {
+    g_message ("failed to create %s decoder", string_from_codec (codec));
+    goto cleanup;
+  }
+  if (g_keyframe_interval > 0 &&
+      !gst_vaapi_decoder_set_keyframe_interval (bench.decoder,
+          g_keyframe_interval)) {
+    g_message ("%s decoder has no keyframe mode", string_from_codec (codec));
+    goto cleanup;
+  }
+  bench.input_adapter = gst_adapter_new ();
+  bench.output_adapter = gst_adapter_new ();
+  if (g_check_subframe)
+    bench.checksums = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  if (codec == GST_VAAPI_CODEC_VP8 || codec == GST_VAAPI_CODEC_VP9)
+    success = bench_run_ivf (&bench, buffer);
+  else
+    success = bench_run_stream (&bench, buffer);
+
+  gst_vaapi_decoder_flush (bench.decoder);
+  drain_output (&bench);
+  print_results (&bench, codec);
+  if (success && !check_object_stats (&bench))
+    success = FALSE;
+  if (success && g_keyframe_interval > 0 && !check_keyframes (&bench))
+    success = FALSE;
+  if (success && g_check_subframe &&
+      !check_subframe (&bench, display, codec, buffer))
+    success = FALSE;
+
+cleanup:
+  if (bench.frame)
+    gst_video_codec_frame_unref (bench.frame);
+  g_clear_object (&bench.input_adapter);
+  g_clear_object (&bench.output_adapter);
+  gst_vaapi_decoder_replace (&bench.decoder, NULL);
+  if (bench.checksums)
+    g_array_unref (bench.checksums);
+  gst_buffer_replace (&buffer, NULL);
+  if (file)
+    g_mapped_file_unref (file);
+  gst_object_replace ((GstObject **) & display, NULL);
+  g_free (g_codec_str);
+  video_output_exit ();
+  return !success;
+}
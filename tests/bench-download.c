@@ -0,0 +1,291 @@
+/*
+ *  bench-download.c - CPU benchmark of the system memory download path
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Mimics what vaapidecode and vaapipostproc do when downstream doesn't
+ * support GstVideoMeta: a frame with padded strides, as a mapped VA
+ * image has, is copied into a tightly packed system memory buffer.
+ * The benchmark compares a fresh allocation per frame against a
+ * buffer pool, and a single-threaded gst_video_frame_copy() against
+ * the threaded GstVideoConverter used for "copy-threads" > 1.
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/video/video.h>
+#include <gst/video/gstvideopool.h>
+
+static gchar *g_format_str = "NV12";
+static gint g_width = 3840;
+static gint g_height = 2160;
+static gint g_iterations = 200;
+static gint g_max_threads = 0;
+
+static GOptionEntry g_options[] = {
+  {"format", 'f',
+        0,
+        G_OPTION_ARG_STRING, &g_format_str,
+      "video format", NULL},
+  {"width", 'w',
+        0,
+        G_OPTION_ARG_INT, &g_width,
+      "frame width", NULL},
+  {"height", 'h',
+        0,
+        G_OPTION_ARG_INT, &g_height,
+      "frame height", NULL},
+  {"iterations", 'n',
+        0,
+        G_OPTION_ARG_INT, &g_iterations,
+      "number of frame downloads per configuration", NULL},
+  {"threads", 't',
+        0,
+        G_OPTION_ARG_INT, &g_max_threads,
+      "maximum number of copy threads (0: number of processors)", NULL},
+  {NULL,}
+};
+
+typedef struct
+{
+  GstVideoInfo src_info;
+  GstVideoInfo dst_info;
+  GstBuffer *src_buf;
+  GstBufferPool *pool;
+  GstVideoConverter *converter;
+} Bench;
+
+static GstBuffer *
+alloc_buffer (Bench * bench)
+{
+  GstBuffer *buf = NULL;
+
+  if (!bench->pool)
+    return gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE
+        (&bench->dst_info), NULL);
+  if (gst_buffer_pool_acquire_buffer (bench->pool, &buf, NULL) != GST_FLOW_OK)
+    return NULL;
+  return buf;
+}
+
+static GstBuffer *
+download (Bench * bench)
+{
+  GstVideoFrame src_frame, dst_frame;
+  GstBuffer *buf;
+
+  buf = alloc_buffer (bench);
+  if (!buf)
+    g_error ("failed to allocate output buffer");
+
+  if (!gst_video_frame_map (&src_frame, &bench->src_info, bench->src_buf,
+          GST_MAP_READ))
+    g_error ("failed to map source frame");
+  if (!gst_video_frame_map (&dst_frame, &bench->dst_info, buf, GST_MAP_WRITE))
+    g_error ("failed to map destination frame");
+
+  if (bench->converter)
+    gst_video_converter_frame (bench->converter, &src_frame, &dst_frame);
+  else
+    gst_video_frame_copy (&dst_frame, &src_frame);
+
+  gst_video_frame_unmap (&dst_frame);
+  gst_video_frame_unmap (&src_frame);
+  return buf;
+}
+
+static gboolean
+check_frame (Bench * bench, GstBuffer * buf)
+{
+  GstVideoFrame src_frame, dst_frame;
+  gboolean success = TRUE;
+  guint i, y;
+
+  gst_video_frame_map (&src_frame, &bench->src_info, bench->src_buf,
+      GST_MAP_READ);
+  gst_video_frame_map (&dst_frame, &bench->dst_info, buf, GST_MAP_READ);
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (&src_frame) && success; i++) {
+    const guint8 *src = GST_VIDEO_FRAME_PLANE_DATA (&src_frame, i);
+    const guint8 *dst = GST_VIDEO_FRAME_PLANE_DATA (&dst_frame, i);
+    const gint src_stride = GST_VIDEO_FRAME_PLANE_STRIDE (&src_frame, i);
+    const gint dst_stride = GST_VIDEO_FRAME_PLANE_STRIDE (&dst_frame, i);
+    /* same line size as gst_video_frame_copy_plane() */
+    const guint width = GST_VIDEO_FRAME_COMP_WIDTH (&src_frame, i) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (&src_frame, i);
+    const guint height = GST_VIDEO_FRAME_COMP_HEIGHT (&src_frame, i);
+
+    for (y = 0; y < height; y++) {
+      if (memcmp (src + y * src_stride, dst + y * dst_stride, width) != 0) {
+        g_print ("MISMATCH in plane %u at line %u\n", i, y);
+        success = FALSE;
+        break;
+      }
+    }
+  }
+
+  gst_video_frame_unmap (&dst_frame);
+  gst_video_frame_unmap (&src_frame);
+  return success;
+}
+
+static gboolean
+run (Bench * bench, const gchar * name)
+{
+  GstBuffer *buf;
+  gint64 start, elapsed;
+  gdouble bytes;
+  gint i;
+
+  buf = download (bench);
+  if (!check_frame (bench, buf)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  gst_buffer_unref (buf);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < g_iterations; i++)
+    gst_buffer_unref (download (bench));
+  elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+  bytes = (gdouble) GST_VIDEO_INFO_SIZE (&bench->dst_info) * g_iterations;
+  g_print ("%-20s %8.1f us/frame %8.2f GB/s %8.1f fps\n", name,
+      (gdouble) elapsed / g_iterations, bytes / elapsed / 1000.0,
+      g_iterations * (gdouble) G_USEC_PER_SEC / elapsed);
+  return TRUE;
+}
+
+static void
+bench_set_threads (Bench * bench, guint n_threads)
+{
+  if (bench->converter) {
+    gst_video_converter_free (bench->converter);
+    bench->converter = NULL;
+  }
+  if (n_threads < 2)
+    return;
+
+  bench->converter = gst_video_converter_new (&bench->dst_info,
+      &bench->dst_info, gst_structure_new ("GstVideoConverterConfig",
+          GST_VIDEO_CONVERTER_OPT_DITHER_METHOD, GST_TYPE_VIDEO_DITHER_METHOD,
+          GST_VIDEO_DITHER_NONE, GST_VIDEO_CONVERTER_OPT_THREADS, G_TYPE_UINT,
+          n_threads, NULL));
+  if (!bench->converter)
+    g_error ("failed to create video converter");
+}
+
+static void
+bench_set_pool (Bench * bench, gboolean use_pool)
+{
+  GstStructure *config;
+  GstCaps *caps;
+
+  if (bench->pool) {
+    gst_buffer_pool_set_active (bench->pool, FALSE);
+    gst_object_unref (bench->pool);
+    bench->pool = NULL;
+  }
+  if (!use_pool)
+    return;
+
+  caps = gst_video_info_to_caps (&bench->dst_info);
+  bench->pool = gst_video_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (bench->pool);
+  gst_buffer_pool_config_set_params (config, caps,
+      GST_VIDEO_INFO_SIZE (&bench->dst_info), 0, 0);
+  gst_caps_unref (caps);
+  if (!gst_buffer_pool_set_config (bench->pool, config)
+      || !gst_buffer_pool_set_active (bench->pool, TRUE))
+    g_error ("failed to configure buffer pool");
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx;
+  GstVideoAlignment align;
+  GstVideoFormat format;
+  GstMapInfo map;
+  Bench bench = { 0, };
+  gchar name[32];
+  guint i, n_threads, max_threads;
+  gint ret = 0;
+
+  ctx = g_option_context_new ("- system memory download benchmark");
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  g_option_context_add_main_entries (ctx, g_options, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, NULL))
+    g_error ("failed to parse options");
+  g_option_context_free (ctx);
+
+  if (g_width < 2 || g_height < 2 || g_iterations < 1 || g_max_threads < 0)
+    g_error ("invalid frame size, iteration or thread count");
+
+  format = gst_video_format_from_string (g_format_str);
+  if (format == GST_VIDEO_FORMAT_UNKNOWN)
+    g_error ("unknown format %s", g_format_str);
+
+  gst_video_info_set_format (&bench.dst_info, format, g_width, g_height);
+
+  /* VA images usually have their lines padded */
+  bench.src_info = bench.dst_info;
+  gst_video_alignment_reset (&align);
+  align.padding_right = GST_ROUND_UP_128 (g_width) - g_width + 64;
+  for (i = 0; i < GST_VIDEO_MAX_PLANES; i++)
+    align.stride_align[i] = 63;
+  if (!gst_video_info_align (&bench.src_info, &align))
+    g_error ("failed to align source frame");
+
+  bench.src_buf = gst_buffer_new_allocate (NULL,
+      GST_VIDEO_INFO_SIZE (&bench.src_info), NULL);
+  gst_buffer_map (bench.src_buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < map.size; i++)
+    map.data[i] = g_random_int ();
+  gst_buffer_unmap (bench.src_buf, &map);
+
+  max_threads = g_max_threads ? g_max_threads : g_get_num_processors ();
+
+  g_print ("Downloading %dx%d %s frames, %d iterations\n", g_width, g_height,
+      gst_video_format_to_string (format), g_iterations);
+
+  if (!run (&bench, "alloc + copy"))
+    ret = 1;
+
+  bench_set_pool (&bench, TRUE);
+  if (!run (&bench, "pool + copy"))
+    ret = 1;
+
+  for (n_threads = 2; n_threads <= max_threads; n_threads *= 2) {
+    bench_set_threads (&bench, n_threads);
+    g_snprintf (name, sizeof (name), "pool + %u threads", n_threads);
+    if (!run (&bench, name))
+      ret = 1;
+  }
+  if (max_threads > 2 && (max_threads & (max_threads - 1)) != 0) {
+    bench_set_threads (&bench, max_threads);
+    g_snprintf (name, sizeof (name), "pool + %u threads", max_threads);
+    if (!run (&bench, name))
+      ret = 1;
+  }
+
+  bench_set_threads (&bench, 1);
+  bench_set_pool (&bench, FALSE);
+  gst_buffer_unref (bench.src_buf);
+  gst_deinit ();
+  return ret;
+}
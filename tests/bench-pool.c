@@ -0,0 +1,184 @@
+/*
+ *  bench-pool.c - Multi-threaded stress benchmark of the video pools
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Several threads hammer a single surface pool, each one holding up
+ * to --depth surfaces at a time, the way concurrent decode sessions
+ * sharing a pool would. The benchmark reports the get/put throughput
+ * and checks the pool invariants afterwards: the capacity is never
+ * exceeded, and every surface ends up back in the free list. Run it
+ * with "--output null" to measure the pool rather than the driver.
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/vaapi/gstvaapisurfacepool.h>
+#include <gst/vaapi/gstvaapisurface.h>
+#include "output.h"
+
+static gint g_num_threads = 8;
+static gint g_iterations = 100000;
+static gint g_depth = 4;
+static gint g_capacity = 0;
+
+static GOptionEntry g_options[] = {
+  {"threads", 't',
+        0,
+        G_OPTION_ARG_INT, &g_num_threads,
+      "number of threads sharing the pool", NULL},
+  {"iterations", 'n',
+        0,
+        G_OPTION_ARG_INT, &g_iterations,
+      "number of get/put cycles per thread", NULL},
+  {"depth", 'd',
+        0,
+        G_OPTION_ARG_INT, &g_depth,
+      "number of surfaces each thread holds at a time", NULL},
+  {"capacity", 'c',
+        0,
+        G_OPTION_ARG_INT, &g_capacity,
+      "pool capacity (0: unlimited)", NULL},
+  {NULL,}
+};
+
+typedef struct
+{
+  GstVaapiVideoPool *pool;
+  GThread *thread;
+  guint num_gets;
+  guint num_failures;
+} Worker;
+
+static volatile gint g_num_outstanding;
+static volatile gint g_max_outstanding;
+
+static void
+track_outstanding (gint delta)
+{
+  gint n, max_n;
+
+  n = g_atomic_int_add (&g_num_outstanding, delta) + delta;
+  do {
+    max_n = g_atomic_int_get (&g_max_outstanding);
+  } while (n > max_n &&
+      !g_atomic_int_compare_and_exchange (&g_max_outstanding, max_n, n));
+}
+
+static gpointer
+worker_run (gpointer data)
+{
+  Worker *const worker = data;
+  GstVaapiSurface **surfaces;
+  guint i, j, n;
+
+  surfaces = g_new0 (GstVaapiSurface *, g_depth);
+  for (i = 0; i < (guint) g_iterations; i++) {
+    /* Rotate through the held surfaces, as a decoder with a DPB does */
+    j = i % g_depth;
+    if (surfaces[j]) {
+      track_outstanding (-1);
+      gst_vaapi_video_pool_put_object (worker->pool, surfaces[j]);
+    }
+    surfaces[j] = gst_vaapi_video_pool_get_object (worker->pool);
+    if (surfaces[j])
+      track_outstanding (1);
+    else
+      worker->num_failures++;
+    worker->num_gets++;
+  }
+
+  for (n = 0; n < (guint) g_depth; n++) {
+    if (!surfaces[n])
+      continue;
+    track_outstanding (-1);
+    gst_vaapi_video_pool_put_object (worker->pool, surfaces[n]);
+  }
+  g_free (surfaces);
+  return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GstVaapiDisplay *display;
+  GstVaapiVideoPool *pool;
+  Worker *workers;
+  guint i, num_gets = 0, num_failures = 0, pool_size;
+  gint64 start, elapsed;
+  gboolean success = TRUE;
+
+  if (!video_output_init (&argc, argv, g_options))
+    g_error ("failed to initialize video output subsystem");
+
+  if (g_num_threads < 1 || g_iterations < 1 || g_depth < 1 || g_capacity < 0)
+    g_error ("invalid thread count, iteration count, depth or capacity");
+
+  display = video_output_create_display (NULL);
+  if (!display)
+    g_error ("could not create Gst/VA display");
+
+  pool = gst_vaapi_surface_pool_new (display, GST_VIDEO_FORMAT_ENCODED,
+      320, 240);
+  if (!pool)
+    g_error ("could not create Gst/VA surface pool");
+  gst_vaapi_video_pool_set_capacity (pool, g_capacity);
+
+  workers = g_new0 (Worker, g_num_threads);
+  start = g_get_monotonic_time ();
+  for (i = 0; i < (guint) g_num_threads; i++) {
+    workers[i].pool = pool;
+    workers[i].thread = g_thread_new ("bench-pool", worker_run, &workers[i]);
+  }
+  for (i = 0; i < (guint) g_num_threads; i++) {
+    g_thread_join (workers[i].thread);
+    num_gets += workers[i].num_gets;
+    num_failures += workers[i].num_failures;
+  }
+  elapsed = MAX (g_get_monotonic_time () - start, 1);
+  g_free (workers);
+
+  g_print ("%d threads, depth %d, capacity %d\n", g_num_threads, g_depth,
+      g_capacity);
+  g_print ("Get/put cycles: %u (%u failed at capacity)\n", num_gets,
+      num_failures);
+  g_print ("Time per cycle: %.1f ns\n", (gdouble) elapsed * 1000 / num_gets);
+  g_print ("Throughput: %.2f Mcycles/s\n", (gdouble) num_gets / elapsed);
+
+  /* Check the pool invariants */
+  pool_size = gst_vaapi_video_pool_get_size (pool);
+  g_print ("Surfaces in use at most: %d, allocated: %u\n",
+      g_max_outstanding, pool_size);
+  if (g_capacity > 0 && g_max_outstanding > g_capacity) {
+    g_print ("ERROR: capacity exceeded\n");
+    success = FALSE;
+  }
+  if (pool_size < (guint) g_max_outstanding) {
+    g_print ("ERROR: surfaces were not returned to the pool\n");
+    success = FALSE;
+  }
+  if (!gst_vaapi_video_pool_reserve (pool, pool_size) ||
+      gst_vaapi_video_pool_get_size (pool) != pool_size) {
+    g_print ("ERROR: pool accounting is inconsistent\n");
+    success = FALSE;
+  }
+
+  gst_vaapi_video_pool_unref (pool);
+  gst_object_unref (display);
+  video_output_exit ();
+  return !success;
+}
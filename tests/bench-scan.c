@@ -0,0 +1,226 @@
+/*
+ *  bench-scan.c - CPU benchmark of the start code scanners
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Generates a byte stream shaped like high bitrate intra coding, i.e.
+ * large NAL units of incompressible payload with emulation prevention
+ * bytes, then splits it into NAL units the way the H.264 and H.265
+ * parsers do, once with gst_adapter_masked_scan_uint32_peek() and once
+ * with gst_vaapi_adapter_scan_for_start_code(). The raw throughput of
+ * every scan kernel the CPU supports is reported as well. Use
+ * bench-decode on real streams to see the share of parsing in the
+ * whole decoder front-end.
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/base/gstadapter.h>
+#include "gst/vaapi/gstvaapiutils_scan.h"
+
+static gint g_nal_size = 1 << 20;
+static gint g_num_nals = 64;
+static gint g_chunk_size = 0;
+static gint g_iterations = 10;
+
+static GOptionEntry g_options[] = {
+  {"nal-size", 's',
+        0,
+        G_OPTION_ARG_INT, &g_nal_size,
+      "size of each NAL unit, in bytes", NULL},
+  {"nal-count", 'c',
+        0,
+        G_OPTION_ARG_INT, &g_num_nals,
+      "number of NAL units in the stream", NULL},
+  {"chunk", 'b',
+        0,
+        G_OPTION_ARG_INT, &g_chunk_size,
+      "size of the input buffers (0: one buffer per NAL unit)", NULL},
+  {"iterations", 'n',
+        0,
+        G_OPTION_ARG_INT, &g_iterations,
+      "number of passes over the stream", NULL},
+  {NULL,}
+};
+
+typedef gint (*ScanFunc) (GstAdapter * adapter, guint ofs, guint size,
+    guint32 * scp);
+
+static gint
+scan_adapter (GstAdapter * adapter, guint ofs, guint size, guint32 * scp)
+{
+  return (gint) gst_adapter_masked_scan_uint32_peek (adapter,
+      0xffffff00, 0x00000100, ofs, size, scp);
+}
+
+static guint8 *
+generate_stream (guint * size_ptr, guint * num_nals_ptr)
+{
+  GByteArray *const stream = g_byte_array_new ();
+  static const guint8 start_code[] = { 0x00, 0x00, 0x00, 0x01, 0x25 };
+  guint i, n, zeros;
+  guint8 byte;
+
+  for (n = 0; n < (guint) g_num_nals; n++) {
+    g_byte_array_append (stream, start_code, sizeof (start_code));
+    zeros = 0;
+    for (i = 0; i < (guint) g_nal_size; i++) {
+      /* Zero bytes are frequent in CABAC payload, make them so here */
+      byte = g_random_int_range (0, 8) ? g_random_int () : 0;
+      if (zeros >= 2 && byte <= 3) {
+        const guint8 epb = 0x03;
+        g_byte_array_append (stream, &epb, 1);
+        zeros = 0;
+      }
+      g_byte_array_append (stream, &byte, 1);
+      zeros = byte ? 0 : zeros + 1;
+    }
+  }
+  *size_ptr = stream->len;
+  *num_nals_ptr = g_num_nals;
+  return g_byte_array_free (stream, FALSE);
+}
+
+/* Splits the stream into NAL units, as gst_vaapi_decoder_h264_parse()
+   does for byte-stream input, and returns the number of units */
+static guint
+split_stream (const guint8 * data, guint size, ScanFunc scan)
+{
+  GstAdapter *const adapter = gst_adapter_new ();
+  const guint chunk_size = g_chunk_size > 0 ? g_chunk_size : g_nal_size;
+  guint pos = 0, avail, num_units = 0, scanned = 0;
+  gint ofs, ofs2;
+
+  for (;;) {
+    avail = gst_adapter_available (adapter);
+    ofs = avail < 4 ? -1 : scan (adapter, 0, avail, NULL);
+    if (ofs > 0) {
+      gst_adapter_flush (adapter, ofs);
+      avail -= ofs;
+      scanned = scanned > (guint) ofs ? scanned - ofs : 0;
+    }
+
+    /* Resume where the previous scan stopped, as GstVaapiParserState
+       does across parse() calls */
+    ofs2 = MAX (4, (gint) scanned - 4);
+    ofs2 = ofs < 0 || (gint) avail < ofs2 + 4 ? -1 :
+        scan (adapter, ofs2, avail - ofs2, NULL);
+    if (ofs2 < 0 && pos < size) {
+      const guint n = MIN (chunk_size, size - pos);
+      gst_adapter_push (adapter,
+          gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+              (gpointer) (data + pos), n, 0, n, NULL, NULL));
+      pos += n;
+      scanned = avail;
+      continue;
+    }
+    if (ofs < 0)
+      break;
+
+    gst_adapter_flush (adapter, ofs2 < 0 ? avail : ofs2);
+    scanned = 0;
+    num_units++;
+  }
+  g_object_unref (adapter);
+  return num_units;
+}
+
+static gboolean
+bench_split (const gchar * name, const guint8 * data, guint size,
+    guint num_nals, ScanFunc scan)
+{
+  gint64 start, elapsed;
+  guint i, num_units = 0;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < (guint) g_iterations; i++)
+    num_units = split_stream (data, size, scan);
+  elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+  g_print ("%-8s %8.2f GB/s  %u units\n", name,
+      (gdouble) size * g_iterations / elapsed / 1000.0, num_units);
+  return num_units == num_nals;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx;
+  GstVaapiScanFunc func;
+  guint8 *data;
+  guint i, k, size, num_nals;
+  gint64 start, elapsed;
+  gint ofs, ret = 0;
+
+  ctx = g_option_context_new ("- start code scan benchmark");
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  g_option_context_add_main_entries (ctx, g_options, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, NULL))
+    g_error ("failed to parse options");
+  g_option_context_free (ctx);
+
+  if (g_nal_size < 1 || g_num_nals < 1 || g_chunk_size < 0 ||
+      g_iterations < 1)
+    g_error ("invalid NAL unit size, count, chunk size or iteration count");
+
+  data = generate_stream (&size, &num_nals);
+  g_print ("Scanning %u NAL units of %d bytes, %d iterations "
+      "(default kernel: %s)\n", num_nals, g_nal_size, g_iterations,
+      gst_vaapi_scan_kernel_get_name (gst_vaapi_scan_get_default_kernel ()));
+
+  g_print ("Kernels, over the whole stream:\n");
+  for (k = 0; k < GST_VAAPI_SCAN_KERNEL_COUNT; k++) {
+    const gchar *const name = gst_vaapi_scan_kernel_get_name (k);
+    guint num_units = 0;
+
+    func = gst_vaapi_scan_kernel_get_func (k);
+    if (!func) {
+      g_print ("%-8s not supported\n", name);
+      continue;
+    }
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < (guint) g_iterations; i++) {
+      guint pos = 0;
+
+      num_units = 0;
+      while ((ofs = func (data + pos, size - pos)) >= 0) {
+        pos += ofs + 3;
+        num_units++;
+      }
+    }
+    elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+    g_print ("%-8s %8.2f GB/s  %u units\n", name,
+        (gdouble) size * g_iterations / elapsed / 1000.0, num_units);
+    if (num_units != num_nals) {
+      g_print ("%-8s MISMATCH\n", name);
+      ret = 1;
+    }
+  }
+
+  g_print ("NAL unit splitting through a GstAdapter:\n");
+  if (!bench_split ("adapter", data, size, num_nals, scan_adapter))
+    ret = 1;
+  if (!bench_split ("vaapi", data, size, num_nals,
+          gst_vaapi_adapter_scan_for_start_code))
+    ret = 1;
+
+  g_free (data);
+  gst_deinit ();
+  return ret;
+}
@@ -0,0 +1,188 @@
+/*
+ *  test-ladder.c - Checks the keyframe alignment of vaapiladderenc
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Encodes a test pattern that switches between black and white every
+ * SCENE_LENGTH frames into NUM_RUNGS rungs, with a keyframe period
+ * longer than the stream. Each switch is a scene cut, so every rung
+ * must start a GOP on the first frame and on each switch, and on no
+ * other frame.
+ */
+
+#include <stdio.h>
+#include <gst/gst.h>
+
+#define NUM_RUNGS       3
+#define NUM_FRAMES      90
+#define SCENE_LENGTH    20
+#define FRAMERATE       30
+
+typedef struct _CustomData
+{
+  GstElement *pipeline;
+  GstElement *src;
+  guint num_src_frames;
+  gboolean white;
+
+  /* written from the encoding threads */
+  GMutex lock;
+  guint num_frames[NUM_RUNGS];
+  gboolean keyframes[NUM_RUNGS][NUM_FRAMES];
+} AppData;
+
+/* Switches the pattern after the last frame of each scene */
+static GstPadProbeReturn
+cb_src_buffer (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  AppData *const app = user_data;
+
+  if (++app->num_src_frames % SCENE_LENGTH == 0) {
+    app->white = !app->white;
+    g_object_set (app->src, "pattern", app->white ? 3 : 2, NULL);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+cb_rung_buffer (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  AppData *const app = user_data;
+  GstBuffer *const buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  const guint rung = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad),
+          "rung"));
+  guint64 n;
+
+  n = gst_util_uint64_scale_round (GST_BUFFER_PTS (buf), FRAMERATE,
+      GST_SECOND);
+
+  g_mutex_lock (&app->lock);
+  app->num_frames[rung]++;
+  if (n < NUM_FRAMES)
+    app->keyframes[rung][n] =
+        !GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+  g_mutex_unlock (&app->lock);
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+add_probe (AppData * app, const gchar * name, GstPadProbeCallback callback,
+    guint rung)
+{
+  GstElement *el;
+  GstPad *pad;
+
+  el = gst_bin_get_by_name (GST_BIN (app->pipeline), name);
+  pad = gst_element_get_static_pad (el, rung == G_MAXUINT ? "src" : "sink");
+  g_object_set_data (G_OBJECT (pad), "rung", GUINT_TO_POINTER (rung));
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, callback, app, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (el);
+}
+
+static gboolean
+check_keyframes (AppData * app)
+{
+  gboolean success = TRUE;
+  guint i, n;
+
+  for (i = 0; i < NUM_RUNGS; i++) {
+    if (app->num_frames[i] != NUM_FRAMES) {
+      g_print ("rung %u: %u frames, expected %u\n", i, app->num_frames[i],
+          NUM_FRAMES);
+      success = FALSE;
+    }
+    for (n = 0; n < NUM_FRAMES; n++) {
+      const gboolean expected = n % SCENE_LENGTH == 0;
+
+      if (app->keyframes[i][n] != expected) {
+        g_print ("rung %u: frame %u is %sa keyframe\n", i, n,
+            expected ? "not " : "");
+        success = FALSE;
+      }
+    }
+  }
+  return success;
+}
+
+int
+main (int argc, char *argv[])
+{
+  AppData app = { 0, };
+  GstMessage *msg;
+  GstBus *bus;
+  GError *err = NULL;
+  gchar *desc;
+  gboolean success = FALSE;
+  guint i;
+
+  gst_init (&argc, &argv);
+  g_mutex_init (&app.lock);
+
+  desc = g_strdup_printf ("videotestsrc name=src pattern=black "
+      "num-buffers=%u ! video/x-raw, format=NV12, width=640, height=480, "
+      "framerate=%u/1 ! vaapiladderenc name=ladder keyframe-period=1000 "
+      "rungs=\"640x480:2000,320x240:800,160x120:300\" "
+      "ladder.src_0 ! fakesink name=sink0 "
+      "ladder.src_1 ! fakesink name=sink1 "
+      "ladder.src_2 ! fakesink name=sink2", NUM_FRAMES, FRAMERATE);
+  app.pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (err) {
+    g_printerr ("failed to parse pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  app.src = gst_bin_get_by_name (GST_BIN (app.pipeline), "src");
+  add_probe (&app, "src", cb_src_buffer, G_MAXUINT);
+  for (i = 0; i < NUM_RUNGS; i++) {
+    gchar name[16];
+
+    g_snprintf (name, sizeof (name), "sink%u", i);
+    add_probe (&app, name, cb_rung_buffer, i);
+  }
+
+  if (gst_element_set_state (app.pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE) {
+    g_printerr ("Unable to set the pipeline to the playing state.\n");
+    goto cleanup;
+  }
+
+  bus = gst_element_get_bus (app.pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  gst_object_unref (bus);
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    g_print ("Error: %s\n", err->message);
+    g_error_free (err);
+  } else {
+    success = check_keyframes (&app);
+    g_print ("%s\n", success ? "PASS" : "FAIL");
+  }
+  gst_message_unref (msg);
+
+cleanup:
+  gst_element_set_state (app.pipeline, GST_STATE_NULL);
+  gst_object_unref (app.src);
+  gst_object_unref (app.pipeline);
+  g_mutex_clear (&app.lock);
+  return success ? 0 : 1;
+}
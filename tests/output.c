@@ -43,6 +43,10 @@
 # include <gst/vaapi/gstvaapidisplay_wayland.h>
 # include <gst/vaapi/gstvaapiwindow_wayland.h>
 #endif
+#if USE_NULL
+# include <gst/vaapi/gstvaapidisplay_null.h>
+# include <gst/vaapi/gstvaapiwindow_null.h>
+#endif
 #include "output.h"
 
 static const VideoOutputInfo *g_video_output;
@@ -69,6 +73,11 @@ static const VideoOutputInfo g_video_outputs[] = {
   {"drm",
         gst_vaapi_display_drm_new,
       gst_vaapi_window_drm_new},
+#endif
+#if USE_NULL
+  {"null",
+        gst_vaapi_display_null_new,
+      gst_vaapi_window_null_new},
 #endif
   {NULL,}
 };
@@ -42,6 +42,7 @@
 static gchar *g_codec_str;
 static gboolean g_use_pixmap;
 static gboolean g_benchmark;
+static gint g_parse_ahead;
 
 static GOptionEntry g_options[] = {
   {"codec", 'c',
@@ -56,6 +57,10 @@ static GOptionEntry g_options[] = {
         0,
         G_OPTION_ARG_NONE, &g_benchmark,
       "benchmark mode", NULL},
+  {"parse-ahead", 0,
+        0,
+        G_OPTION_ARG_INT, &g_parse_ahead,
+      "number of frames to parse ahead on a separate thread", NULL},
   {NULL,}
 };
 
@@ -392,6 +397,10 @@ start_decoder (App * app)
   if (!app->decoder)
     return FALSE;
 
+  if (g_parse_ahead > 0 &&
+      !gst_vaapi_decoder_set_parse_ahead (app->decoder, g_parse_ahead))
+    g_warning ("parsing ahead is not supported for this codec");
+
   gst_vaapi_decoder_set_codec_state_changed_func (app->decoder,
       handle_decoder_state_changes, app);
 
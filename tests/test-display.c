@@ -46,6 +46,9 @@
 #if USE_EGL
 # include <gst/vaapi/gstvaapidisplay_egl.h>
 #endif
+#if USE_NULL
+# include <gst/vaapi/gstvaapidisplay_null.h>
+#endif
 
 #ifdef HAVE_VA_VA_GLX_H
 # include <va/va_glx.h>
@@ -421,6 +424,31 @@ main (int argc, char *argv[])
   g_print ("\n");
 #endif
 
+#if USE_NULL
+  g_print ("#\n");
+  g_print ("# Create display with gst_vaapi_display_null_new()\n");
+  g_print ("#\n");
+  {
+    GstStructure *stats;
+    gchar *str;
+
+    display = gst_vaapi_display_null_new ("latency=1000");
+    if (!display)
+      g_error ("could not create Gst/VA display");
+
+    dump_info (display);
+
+    stats = gst_vaapi_display_null_get_statistics
+        (GST_VAAPI_DISPLAY_NULL (display));
+    str = gst_structure_to_string (stats);
+    g_print ("Driver statistics: %s\n", str);
+    g_free (str);
+    gst_structure_free (stats);
+    gst_object_unref (display);
+  }
+  g_print ("\n");
+#endif
+
   gst_deinit ();
   return 0;
 }
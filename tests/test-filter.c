@@ -36,6 +36,7 @@ static gchar *g_denoise_str;
 static gchar *g_sharpen_str;
 static gchar *g_deinterlace_str;
 static gchar *g_deinterlace_flags_str;
+static gint g_benchmark_iterations;
 
 static GOptionEntry g_options[] = {
   {"src-format", 's',
@@ -62,6 +63,11 @@ static GOptionEntry g_options[] = {
         0,
         G_OPTION_ARG_STRING, &g_deinterlace_flags_str,
       "deinterlacing flags", NULL},
+  {"benchmark", 0,
+        0,
+        G_OPTION_ARG_INT, &g_benchmark_iterations,
+      "compare single and batch processing throughput over N iterations",
+      "N"},
   {NULL,}
 };
 
@@ -314,6 +320,119 @@ parse_deinterlace_flags (const gchar * str, guint * deinterlace_flags_ptr)
       deinterlace_flags_ptr);
 }
 
+#define BENCHMARK_TILES_X 4
+#define BENCHMARK_TILES_Y 4
+#define BENCHMARK_NUM_TILES (BENCHMARK_TILES_X * BENCHMARK_TILES_Y)
+
+typedef GstVaapiFilterStatus (*BenchmarkFunc) (GstVaapiFilter * filter,
+    const GstVaapiFilterJob * jobs, guint num_jobs);
+
+/* Processes the jobs one at a time, as gst_vaapi_filter_process() users do */
+static GstVaapiFilterStatus
+benchmark_process_single (GstVaapiFilter * filter,
+    const GstVaapiFilterJob * jobs, guint num_jobs)
+{
+  GstVaapiFilterStatus status = GST_VAAPI_FILTER_STATUS_SUCCESS;
+  guint i;
+
+  for (i = 0; i < num_jobs && status == GST_VAAPI_FILTER_STATUS_SUCCESS; i++) {
+    if (!gst_vaapi_filter_set_target_rectangle (filter, jobs[i].target_rect))
+      return GST_VAAPI_FILTER_STATUS_ERROR_INVALID_PARAMETER;
+    status = gst_vaapi_filter_process (filter, jobs[i].src_surface,
+        jobs[i].dst_surface, 0);
+  }
+  gst_vaapi_filter_set_target_rectangle (filter, NULL);
+  return status;
+}
+
+static GstVaapiFilterStatus
+benchmark_process_batch (GstVaapiFilter * filter,
+    const GstVaapiFilterJob * jobs, guint num_jobs)
+{
+  return gst_vaapi_filter_process_batch (filter, jobs, num_jobs, 0);
+}
+
+static void
+benchmark_run (const gchar * name, BenchmarkFunc func, GstVaapiFilter * filter,
+    const GstVaapiFilterJob * jobs, guint num_jobs, guint iterations)
+{
+  gint64 start, elapsed;
+  guint i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++) {
+    if (func (filter, jobs, num_jobs) != GST_VAAPI_FILTER_STATUS_SUCCESS)
+      g_error ("failed to process %s jobs", name);
+  }
+  for (i = 0; i < num_jobs; i++)
+    gst_vaapi_surface_sync (jobs[i].dst_surface);
+  elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+  g_print ("%-16s %8.1f us/iteration %10.1f jobs/s\n", name,
+      (gdouble) elapsed / iterations,
+      (gdouble) num_jobs * iterations * G_USEC_PER_SEC / elapsed);
+}
+
+/* Compares the throughput of gst_vaapi_filter_process() and
+ * gst_vaapi_filter_process_batch() when generating thumbnails, each
+ * into its own surface, and a mosaic of them into one surface */
+static void
+benchmark (GstVaapiDisplay * display, GstVaapiFilter * filter,
+    GstVaapiSurface * src_surface, guint width, guint height,
+    guint iterations)
+{
+  GstVaapiSurface *thumbnails[BENCHMARK_NUM_TILES], *mosaic;
+  GstVaapiRectangle tiles[BENCHMARK_NUM_TILES];
+  GstVaapiFilterJob jobs[BENCHMARK_NUM_TILES];
+  const guint tile_width = GST_ROUND_DOWN_2 (width / BENCHMARK_TILES_X);
+  const guint tile_height = GST_ROUND_DOWN_2 (height / BENCHMARK_TILES_Y);
+  guint i;
+
+  mosaic = gst_vaapi_surface_new (display, GST_VAAPI_CHROMA_TYPE_YUV420,
+      width, height);
+  if (!mosaic)
+    g_error ("failed to create mosaic VA surface");
+
+  for (i = 0; i < BENCHMARK_NUM_TILES; i++) {
+    thumbnails[i] = gst_vaapi_surface_new (display,
+        GST_VAAPI_CHROMA_TYPE_YUV420, tile_width, tile_height);
+    if (!thumbnails[i])
+      g_error ("failed to create thumbnail VA surface");
+
+    tiles[i].x = (i % BENCHMARK_TILES_X) * tile_width;
+    tiles[i].y = (i / BENCHMARK_TILES_X) * tile_height;
+    tiles[i].width = tile_width;
+    tiles[i].height = tile_height;
+  }
+
+  g_print ("Benchmark: %u jobs of %ux%u, %u iterations\n",
+      BENCHMARK_NUM_TILES, tile_width, tile_height, iterations);
+
+  for (i = 0; i < BENCHMARK_NUM_TILES; i++) {
+    jobs[i].src_surface = src_surface;
+    jobs[i].dst_surface = thumbnails[i];
+    jobs[i].crop_rect = NULL;
+    jobs[i].target_rect = NULL;
+  }
+  benchmark_run ("thumbs/single", benchmark_process_single, filter,
+      jobs, BENCHMARK_NUM_TILES, iterations);
+  benchmark_run ("thumbs/batch", benchmark_process_batch, filter,
+      jobs, BENCHMARK_NUM_TILES, iterations);
+
+  for (i = 0; i < BENCHMARK_NUM_TILES; i++) {
+    jobs[i].dst_surface = mosaic;
+    jobs[i].target_rect = &tiles[i];
+  }
+  benchmark_run ("mosaic/single", benchmark_process_single, filter,
+      jobs, BENCHMARK_NUM_TILES, iterations);
+  benchmark_run ("mosaic/batch", benchmark_process_batch, filter,
+      jobs, BENCHMARK_NUM_TILES, iterations);
+
+  for (i = 0; i < BENCHMARK_NUM_TILES; i++)
+    gst_vaapi_object_unref (thumbnails[i]);
+  gst_vaapi_object_unref (mosaic);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -427,6 +546,10 @@ main (int argc, char *argv[])
   if (!dst_surface)
     g_error ("failed to create target VA surface");
 
+  if (g_benchmark_iterations > 0)
+    benchmark (display, filter, src_surface, dst_width, dst_height,
+        g_benchmark_iterations);
+
   status = gst_vaapi_filter_process (filter, src_surface, dst_surface,
       filter_flags);
   if (status != GST_VAAPI_FILTER_STATUS_SUCCESS)
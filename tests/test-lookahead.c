@@ -0,0 +1,401 @@
+/*
+ *  test-lookahead.c - Test the encoder lookahead rate control
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Encodes a synthetic clip alternating flat and noisy segments in CQP
+ * mode with the lookahead rate control enabled, parses the QP of each
+ * coded frame back from its slice header, and checks that the noisy
+ * frames got a higher QP than the flat ones, within the QP limits.
+ * Run it with "--output null", where the coded size only depends on
+ * the QP, to check the decisions of the lookahead alone.
+ */
+
+#include "gst/vaapi/sysdeps.h"
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/vaapi/gstvaapiencoder_h264.h>
+#include <gst/vaapi/gstvaapiencoder_h265.h>
+#include <gst/vaapi/gstvaapisurfacepool.h>
+#include <gst/vaapi/gstvaapisurfaceproxy.h>
+#include <gst/vaapi/gstvaapiimage.h>
+#include "output.h"
+
+#define WIDTH   320
+#define HEIGHT  240
+#define FPS     30
+
+static gchar *g_codec_str;
+static gint g_lookahead = 10;
+static gint g_num_frames = 120;
+static gint g_segment_length = 30;
+static gint g_bitrate = 1000;
+static gint g_min_qp = 10;
+static gint g_max_qp = 46;
+
+static GOptionEntry g_options[] = {
+  {"codec", 'c',
+        0,
+        G_OPTION_ARG_STRING, &g_codec_str,
+      "codec to use for video encoding (h264/h265)", NULL},
+  {"lookahead", 'l',
+        0,
+        G_OPTION_ARG_INT, &g_lookahead,
+      "number of frames analysed ahead", NULL},
+  {"frames", 'n',
+        0,
+        G_OPTION_ARG_INT, &g_num_frames,
+      "number of frames to encode", NULL},
+  {"segment", 's',
+        0,
+        G_OPTION_ARG_INT, &g_segment_length,
+      "number of frames of each flat or noisy segment", NULL},
+  {"bitrate", 'b',
+        0,
+        G_OPTION_ARG_INT, &g_bitrate,
+      "target bitrate expressed in kbps", NULL},
+  {NULL,}
+};
+
+typedef struct
+{
+  GstVaapiEncoder *encoder;
+  gboolean is_h265;
+  GstH264NalParser *h264_parser;
+  GstH265Parser *h265_parser;
+  gint *qps;
+  guint num_coded;
+  guint num_errors;
+  volatile gint input_done;
+} App;
+
+static inline gboolean
+is_noisy_frame (guint n)
+{
+  return (n / g_segment_length) % 2 == 1;
+}
+
+/* Flat frames slowly fade, noisy frames are random in every sample */
+static gboolean
+fill_surface (GstVaapiSurface * surface, GstVaapiImage * image, guint n,
+    GRand * rand)
+{
+  guint8 *plane;
+  guint x, y, pitch;
+
+  if (!gst_vaapi_image_map (image))
+    return FALSE;
+
+  plane = gst_vaapi_image_get_plane (image, 0);
+  pitch = gst_vaapi_image_get_pitch (image, 0);
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++)
+      plane[y * pitch + x] = is_noisy_frame (n) ?
+          g_rand_int_range (rand, 0, 256) : 64 + n % 128;
+  }
+
+  plane = gst_vaapi_image_get_plane (image, 1);
+  pitch = gst_vaapi_image_get_pitch (image, 1);
+  for (y = 0; y < HEIGHT / 2; y++)
+    memset (plane + y * pitch, 128, WIDTH);
+
+  if (!gst_vaapi_image_unmap (image))
+    return FALSE;
+  return gst_vaapi_surface_put_image (surface, image);
+}
+
+/* Returns the QP of the first slice of the coded frame, or -1 */
+static gint
+parse_h264_qp (App * app, const guint8 * data, gsize size)
+{
+  GstH264NalUnit nalu;
+  GstH264SliceHdr slice;
+  GstH264ParserResult result;
+  guint offset = 0;
+
+  for (;;) {
+    result = gst_h264_parser_identify_nalu (app->h264_parser, data, offset,
+        size, &nalu);
+    if (result != GST_H264_PARSER_OK && result != GST_H264_PARSER_NO_NAL_END)
+      return -1;
+
+    switch (nalu.type) {
+      case GST_H264_NAL_SLICE:
+      case GST_H264_NAL_SLICE_IDR:
+        if (gst_h264_parser_parse_slice_hdr (app->h264_parser, &nalu,
+                &slice, FALSE, FALSE) != GST_H264_PARSER_OK)
+          return -1;
+        return 26 + slice.pps->pic_init_qp_minus26 + slice.slice_qp_delta;
+      default:
+        gst_h264_parser_parse_nal (app->h264_parser, &nalu);
+        break;
+    }
+    offset = nalu.offset + nalu.size;
+  }
+}
+
+static gint
+parse_h265_qp (App * app, const guint8 * data, gsize size)
+{
+  GstH265NalUnit nalu;
+  GstH265SliceHdr slice;
+  GstH265ParserResult result;
+  guint offset = 0;
+
+  for (;;) {
+    result = gst_h265_parser_identify_nalu (app->h265_parser, data, offset,
+        size, &nalu);
+    if (result != GST_H265_PARSER_OK && result != GST_H265_PARSER_NO_NAL_END)
+      return -1;
+
+    if (nalu.type <= GST_H265_NAL_SLICE_CRA_NUT) {
+      if (gst_h265_parser_parse_slice_hdr (app->h265_parser, &nalu,
+              &slice) != GST_H265_PARSER_OK)
+        return -1;
+      return 26 + slice.pps->init_qp_minus26 + slice.qp_delta;
+    }
+    gst_h265_parser_parse_nal (app->h265_parser, &nalu);
+    offset = nalu.offset + nalu.size;
+  }
+}
+
+static void
+process_coded_buffer (App * app, GstVaapiCodedBufferProxy * proxy)
+{
+  GstVaapiCodedBuffer *const buf = GST_VAAPI_CODED_BUFFER_PROXY_BUFFER (proxy);
+  GstVideoCodecFrame *const frame =
+      gst_vaapi_coded_buffer_proxy_get_user_data (proxy);
+  GstBuffer *buffer;
+  GstMapInfo info;
+  gint qp = -1;
+
+  buffer = gst_buffer_new_and_alloc (gst_vaapi_coded_buffer_get_size (buf));
+  if (gst_vaapi_coded_buffer_copy_into (buffer, buf) &&
+      gst_buffer_map (buffer, &info, GST_MAP_READ)) {
+    qp = app->is_h265 ? parse_h265_qp (app, info.data, info.size) :
+        parse_h264_qp (app, info.data, info.size);
+    gst_buffer_unmap (buffer, &info);
+  }
+  gst_buffer_unref (buffer);
+
+  if (qp < 0 || !frame || frame->system_frame_number >= g_num_frames) {
+    g_warning ("could not find the QP of coded frame %u", app->num_coded);
+    app->num_errors++;
+  } else
+    app->qps[frame->system_frame_number] = qp;
+  app->num_coded++;
+}
+
+static gpointer
+get_buffer_thread (gpointer data)
+{
+  App *const app = data;
+  GstVaapiCodedBufferProxy *proxy;
+  GstVaapiEncoderStatus status;
+
+  for (;;) {
+    proxy = NULL;
+    status = gst_vaapi_encoder_get_buffer_with_timeout (app->encoder, &proxy,
+        50000);
+    if (status == GST_VAAPI_ENCODER_STATUS_NO_BUFFER) {
+      if (g_atomic_int_get (&app->input_done))
+        break;
+      continue;
+    }
+    if (status != GST_VAAPI_ENCODER_STATUS_SUCCESS) {
+      app->num_errors++;
+      break;
+    }
+    process_coded_buffer (app, proxy);
+    gst_vaapi_coded_buffer_proxy_unref (proxy);
+  }
+  return NULL;
+}
+
+static GstVaapiEncoder *
+encoder_new (GstVaapiDisplay * display, gboolean is_h265)
+{
+  GstVaapiEncoder *encoder;
+  GstVideoCodecState state = { 0, };
+
+  if (is_h265)
+    encoder = gst_vaapi_encoder_h265_new (display);
+  else
+    encoder = gst_vaapi_encoder_h264_new (display);
+  if (!encoder)
+    return NULL;
+
+  g_object_set (encoder, "rate-control", GST_VAAPI_RATECONTROL_CQP,
+      "lookahead", g_lookahead, "min-qp", g_min_qp, "max-qp", g_max_qp,
+      NULL);
+  gst_vaapi_encoder_set_bitrate (encoder, g_bitrate);
+
+  state.ref_count = 1;
+  gst_video_info_set_format (&state.info, GST_VIDEO_FORMAT_ENCODED, WIDTH,
+      HEIGHT);
+  state.info.fps_n = FPS;
+  state.info.fps_d = 1;
+  if (gst_vaapi_encoder_set_codec_state (encoder, &state) !=
+      GST_VAAPI_ENCODER_STATUS_SUCCESS) {
+    gst_object_unref (encoder);
+    return NULL;
+  }
+  return encoder;
+}
+
+static gboolean
+encode_frames (App * app, GstVaapiDisplay * display)
+{
+  GstVaapiVideoPool *pool;
+  GstVaapiImage *image;
+  GstVaapiSurfaceProxy *proxy;
+  GstVideoCodecFrame *frame;
+  GRand *const rand = g_rand_new_with_seed (42);
+  gboolean success = TRUE;
+  guint n;
+
+  pool = gst_vaapi_surface_pool_new (display, GST_VIDEO_FORMAT_NV12, WIDTH,
+      HEIGHT);
+  image = gst_vaapi_image_new (display, GST_VIDEO_FORMAT_NV12, WIDTH, HEIGHT);
+  if (!pool || !image)
+    g_error ("could not create Gst/VA surface pool or image");
+
+  for (n = 0; success && n < (guint) g_num_frames; n++) {
+    proxy =
+        gst_vaapi_surface_proxy_new_from_pool (GST_VAAPI_SURFACE_POOL (pool));
+    if (!proxy || !fill_surface (GST_VAAPI_SURFACE_PROXY_SURFACE (proxy),
+            image, n, rand))
+      g_error ("could not upload frame %u", n);
+
+    frame = g_slice_new0 (GstVideoCodecFrame);
+    frame->ref_count = 1;
+    frame->system_frame_number = n;
+    gst_video_codec_frame_set_user_data (frame, proxy,
+        (GDestroyNotify) gst_vaapi_surface_proxy_unref);
+    success = gst_vaapi_encoder_put_frame (app->encoder, frame) ==
+        GST_VAAPI_ENCODER_STATUS_SUCCESS;
+    gst_video_codec_frame_unref (frame);
+  }
+  if (success)
+    success = gst_vaapi_encoder_flush (app->encoder) ==
+        GST_VAAPI_ENCODER_STATUS_SUCCESS;
+
+  g_rand_free (rand);
+  gst_vaapi_object_unref (image);
+  gst_vaapi_video_pool_replace (&pool, NULL);
+  return success;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GstVaapiDisplay *display;
+  GstStructure *stats;
+  GThread *thread;
+  App app = { 0, };
+  gdouble flat_qp = 0, noisy_qp = 0;
+  guint i, num_flat = 0, num_noisy = 0;
+  gboolean success = TRUE;
+
+  if (!video_output_init (&argc, argv, g_options))
+    g_error ("failed to initialize video output subsystem");
+
+  if (g_lookahead < 1 || g_num_frames < 2 || g_segment_length < 1 ||
+      g_num_frames <= g_segment_length || g_bitrate < 1)
+    g_error ("invalid lookahead, frame count, segment length or bitrate");
+
+  app.is_h265 = !g_strcmp0 (g_codec_str, "h265");
+  if (!app.is_h265 && g_codec_str && g_strcmp0 (g_codec_str, "h264"))
+    g_error ("unsupported codec %s", g_codec_str);
+
+  display = video_output_create_display (NULL);
+  if (!display)
+    g_error ("could not create Gst/VA display");
+
+  app.encoder = encoder_new (display, app.is_h265);
+  if (!app.encoder)
+    g_error ("could not create %s encoder", app.is_h265 ? "H.265" : "H.264");
+
+  if (app.is_h265)
+    app.h265_parser = gst_h265_parser_new ();
+  else
+    app.h264_parser = gst_h264_nal_parser_new ();
+  app.qps = g_new (gint, g_num_frames);
+  for (i = 0; i < (guint) g_num_frames; i++)
+    app.qps[i] = -1;
+
+  thread = g_thread_new ("get buffer thread", get_buffer_thread, &app);
+  if (!encode_frames (&app, display)) {
+    g_print ("failed to encode frames\n");
+    success = FALSE;
+  }
+  g_atomic_int_set (&app.input_done, TRUE);
+  g_thread_join (thread);
+
+  for (i = 0; i < (guint) g_num_frames; i++) {
+    if (app.qps[i] < g_min_qp || app.qps[i] > g_max_qp) {
+      g_print ("frame %u: QP %d out of [%d, %d]\n", i, app.qps[i], g_min_qp,
+          g_max_qp);
+      success = FALSE;
+      continue;
+    }
+    if (is_noisy_frame (i)) {
+      noisy_qp += app.qps[i];
+      num_noisy++;
+    } else {
+      flat_qp += app.qps[i];
+      num_flat++;
+    }
+  }
+  if (num_flat > 0)
+    flat_qp /= num_flat;
+  if (num_noisy > 0)
+    noisy_qp /= num_noisy;
+
+  stats = gst_vaapi_encoder_get_stats (app.encoder);
+  g_print ("%u frames coded, %u errors\n", app.num_coded, app.num_errors);
+  g_print ("average QP: %.2f for flat frames, %.2f for noisy frames\n",
+      flat_qp, noisy_qp);
+  if (stats) {
+    gchar *const str = gst_structure_to_string (stats);
+    g_print ("%s\n", str);
+    g_free (str);
+    gst_structure_free (stats);
+  }
+
+  if (app.num_coded != (guint) g_num_frames || app.num_errors > 0) {
+    g_print ("FAILED: %u frames coded out of %d\n", app.num_coded,
+        g_num_frames);
+    success = FALSE;
+  }
+  if (num_flat == 0 || num_noisy == 0 || noisy_qp <= flat_qp) {
+    g_print ("FAILED: noisy frames did not get a higher QP\n");
+    success = FALSE;
+  }
+
+  if (app.h264_parser)
+    gst_h264_nal_parser_free (app.h264_parser);
+  if (app.h265_parser)
+    gst_h265_parser_free (app.h265_parser);
+  g_free (app.qps);
+  gst_object_unref (app.encoder);
+  gst_object_unref (display);
+  g_free (g_codec_str);
+  video_output_exit ();
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -36,6 +36,7 @@ main (int argc, char *argv[])
   GstVaapiID surface_id;
   GstVaapiSurface *surfaces[MAX_SURFACES];
   GstVaapiVideoPool *pool;
+  GstVaapiSurfaceCacheStats cache_stats;
   gint i;
 
   static const GstVaapiChromaType chroma_type = GST_VAAPI_CHROMA_TYPE_YUV420;
@@ -59,6 +60,28 @@ main (int argc, char *argv[])
 
   gst_vaapi_object_unref (surface);
 
+  /* Check released surfaces are handed out again by the display cache */
+  gst_vaapi_display_set_surface_cache_size (display, 16 * 1024 * 1024);
+  surface = gst_vaapi_surface_new (display, chroma_type, width, height);
+  if (!surface)
+    g_error ("could not create Gst/VA surface");
+  surface_id = gst_vaapi_surface_get_id (surface);
+  gst_vaapi_object_unref (surface);
+
+  surface = gst_vaapi_surface_new (display, chroma_type, width, height);
+  if (!surface)
+    g_error ("could not create Gst/VA surface from cache");
+  if (gst_vaapi_surface_get_id (surface) != surface_id)
+    g_error ("Gst/VA display cache doesn't reuse released surfaces");
+  gst_vaapi_object_unref (surface);
+
+  gst_vaapi_display_get_surface_cache_stats (display, &cache_stats);
+  g_print ("surface cache: %u surfaces, %" G_GSIZE_FORMAT " bytes, %"
+      G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses\n",
+      cache_stats.num_surfaces, cache_stats.size, cache_stats.hits,
+      cache_stats.misses);
+  gst_vaapi_display_set_surface_cache_size (display, 0);
+
   pool = gst_vaapi_surface_pool_new (display, GST_VIDEO_FORMAT_ENCODED,
       width, height);
   if (!pool)